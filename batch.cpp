@@ -0,0 +1,137 @@
+#include "batch.h"
+#include "thread_pool.h"
+#include "diagram.h"
+#include "program_error.h"
+#include "snapshot.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+BatchRunner::BatchRunner(unsigned threads, bool isInterp, bool isDebug)
+    : threads(threads), isInterp(isInterp), isDebug(isDebug), last_seconds(0.0), prelude(nullptr), printFormat(PRINT_TEXT), checkOnly(false) {}
+
+std::vector<std::string> BatchRunner::CollectFiles(const std::vector<std::string>& paths) {
+    std::vector<std::string> files;
+    for (const std::string& path : paths) {
+        std::error_code ec;
+        if (std::filesystem::is_directory(path, ec)) {
+            std::vector<std::string> dir_files;
+            for (const auto& entry : std::filesystem::directory_iterator(path, ec)) {
+                if (entry.is_regular_file(ec)) {
+                    dir_files.push_back(entry.path().string());
+                }
+            }
+            std::sort(dir_files.begin(), dir_files.end());
+            files.insert(files.end(), dir_files.begin(), dir_files.end());
+        }
+        else {
+            files.push_back(path);
+        }
+    }
+    return files;
+}
+
+BatchResult BatchRunner::RunOne(const std::string& file) const {
+    BatchResult result;
+    result.file = file;
+    result.ok = false;
+
+    std::ostringstream out;
+    std::ostringstream err;
+
+    // Исключение не должно покинуть поток пула (std::terminate завершил бы весь пакет):
+    // любая ошибка становится результатом этого файла
+    try {
+        Scanner sc;
+        if (!sc.loadFile(file)) {
+            result.diagnostics = "Невозможно открыть " + file + "\n";
+            return result;
+        }
+
+        Context ctx;
+        ctx.out = &out;
+        ctx.err = &err;
+        ctx.printFormat = printFormat;
+        ctx.checkOnly = checkOnly;
+        if (prelude) {
+            prelude->LoadInto(ctx);
+        }
+
+        Diagram dg(&sc, &ctx);
+        dg.ParseProgram(isInterp, isDebug);
+        result.ok = true;
+    }
+    catch (const ProgramError& e) {
+        err << e.what();
+    }
+    catch (const std::exception& e) {
+        err << "Внутренняя ошибка: " << e.what() << '\n';
+    }
+    catch (...) {
+        err << "Внутренняя ошибка\n";
+    }
+
+    result.output = out.str();
+    result.diagnostics = err.str();
+    return result;
+}
+
+std::vector<BatchResult> BatchRunner::Run(const std::vector<std::string>& files) {
+    std::vector<BatchResult> results(files.size());
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool(threads);
+        for (size_t i = 0; i < files.size(); i++) {
+            pool.Submit([this, &files, &results, i] {
+                results[i] = RunOne(files[i]);
+            });
+        }
+        pool.Wait();
+    }
+    auto finish = std::chrono::steady_clock::now();
+    last_seconds = std::chrono::duration<double>(finish - start).count();
+
+    return results;
+}
+
+void BatchRunner::WriteResults(const std::vector<BatchResult>& results, std::ostream& out) {
+    for (const BatchResult& r : results) {
+        out << "=== " << r.file << (r.ok ? " (успешно)" : " (ошибка)") << '\n';
+        out << r.output;
+        out << r.diagnostics;
+    }
+    out.flush();
+}
+
+void BatchRunner::ReportScaling(const std::vector<std::string>& files, std::ostream& out) const {
+    const unsigned max_threads = threads;
+    out << "Потоков | Время, с | Файлов/с | Ускорение" << '\n';
+
+    double base_rate = 0.0;
+    for (unsigned n = 1; ; n = std::min(n * 2, max_threads)) {
+        BatchRunner runner(*this);
+        runner.threads = n;
+        runner.Run(files);
+
+        double seconds = runner.LastSeconds();
+        double rate = (seconds > 0.0) ? files.size() / seconds : 0.0;
+        if (n == 1) {
+            base_rate = rate;
+        }
+
+        out << std::setw(7) << n << " | "
+            << std::fixed << std::setprecision(3) << std::setw(8) << seconds << " | "
+            << std::setprecision(1) << std::setw(8) << rate << " | "
+            << std::setprecision(2) << ((base_rate > 0.0) ? rate / base_rate : 0.0) << '\n';
+
+        if (n >= max_threads) {
+            break;
+        }
+    }
+    out.flush();
+}
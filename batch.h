@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <ostream>
+#include "context.h"
+
+class Snapshot;
+
+// Результат обработки одного файла в пакетном режиме
+struct BatchResult {
+    std::string file;        // Имя входного файла
+    bool ok;                 // Программа разобрана и выполнена без ошибок
+    std::string output;      // Вывод программы (дерево, отладочная информация)
+    std::string diagnostics; // Предупреждения и сообщение об ошибке
+};
+
+// Пакетный режим: разбор и интерпретация множества программ на пуле потоков.
+// Каждая программа выполняется в собственном контексте, результаты
+// собираются в порядке входных файлов
+class BatchRunner {
+public:
+    BatchRunner(unsigned threads, bool isInterp, bool isDebug);
+
+    // Снимок общих объявлений, подставляемый как глобальная область каждой программы
+    void SetPrelude(const Snapshot* snapshot) { prelude = snapshot; }
+
+    // Формат печати дерева (режим без интерпретации)
+    void SetPrintFormat(PRINT_FORMAT format) { printFormat = format; }
+
+    // Режим только проверки (синтаксис и типы, без вычисления значений)
+    void SetCheckOnly(bool value) { checkOnly = value; }
+
+    // Развернуть список путей: каталоги заменяются отсортированным списком их файлов
+    static std::vector<std::string> CollectFiles(const std::vector<std::string>& paths);
+
+    // Обработать файлы; время обработки (в секундах) сохраняется в LastSeconds()
+    std::vector<BatchResult> Run(const std::vector<std::string>& files);
+
+    double LastSeconds() const { return last_seconds; }
+
+    // Вывести результаты в порядке входных файлов
+    static void WriteResults(const std::vector<BatchResult>& results, std::ostream& out);
+
+    // Отчёт о пропускной способности (файлов/с) для разного числа потоков: 1, 2, 4, ..., заданное
+    // в конструкторе; остальные параметры (снимок, формат, режим проверки) -- те же, что у Run
+    void ReportScaling(const std::vector<std::string>& files, std::ostream& out) const;
+
+private:
+    unsigned threads;
+    bool isInterp;
+    bool isDebug;
+    double last_seconds;
+    const Snapshot* prelude;
+    PRINT_FORMAT printFormat;
+    bool checkOnly;
+
+    BatchResult RunOne(const std::string& file) const;
+};
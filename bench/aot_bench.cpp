@@ -0,0 +1,225 @@
+// Нагрузочный тест перевода в C (c_emitter.h): интерпретатор по дереву и виртуальная
+// машина со всеми суперкомандами против программы, переведённой в C и собранной
+// системным компилятором.
+//
+// Для каждой нагрузки набора run_bench программа переводится в C, собирается
+// ($CC или --cc, по умолчанию cc -O2), и её вывод с ключом --result сверяется
+// с результатом интерпретатора (FormatRunResult): при расхождении тест прекращается.
+// Для дерева замеряется разбор с вычислением (по-другому он не выполняет программу),
+// для машины -- только выполнение, для собранной программы -- время, которое она
+// выводит с ключом --time (без запуска процесса). Время сборки выводится отдельно.
+// Для каждой пары (нагрузка, вариант) выводится строка таблицы и JSON-запись:
+//   {"label", "workload", "size", "config", "ops", "run_ns", "ns_per_op", "speedup", "build_ms"}
+// speedup -- ускорение относительно дерева, время -- лучшее из повторов.
+//
+// aot_bench [-o файл] [--label метка] [--repeat N] [--size N] [--cc команда] [--dir каталог]
+
+#include "workload.h"
+
+#include "code_gen.h"
+#include "context.h"
+#include "diagram.h"
+#include "program_error.h"
+#include "scanner.h"
+#include "tayat.h"
+#include "vm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static uint64_t ElapsedNs(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+static std::string ReadFile(const std::string& name) {
+    std::ifstream in(name, std::ios::binary);
+    std::ostringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+struct Measure {
+    uint64_t run_ns = UINT64_MAX;
+    uint64_t build_ns = 0;
+};
+
+// Прогон по дереву или на машине; ops -- число выполненных операций
+static bool RunInterp(const std::string& source, bool tree, Measure& m, uint64_t& ops) {
+    Scanner sc;
+    sc.loadText(source);
+    Context ctx;
+    ctx.out = nullptr;
+    ctx.err = nullptr;
+    Diagram dg(&sc, &ctx);
+    try {
+        if (tree) {
+            auto start = std::chrono::steady_clock::now();
+            dg.ParseProgram(true, false);
+            m.run_ns = std::min(m.run_ns, ElapsedNs(start));
+        }
+        else {
+            // Как ParseProgram(true, false): без отладочных предупреждений
+            ctx.debug = false;
+            Code code;
+            dg.CompileProgram(code);
+            Fuse(code, SUPER_ALL);
+            Vm vm(ctx, code);
+            auto start = std::chrono::steady_clock::now();
+            vm.Run();
+            m.run_ns = std::min(m.run_ns, ElapsedNs(start));
+        }
+    }
+    catch (const ProgramError& e) {
+        std::cerr << e.what();
+        return false;
+    }
+    ops = ctx.ring.Total();
+    return true;
+}
+
+// Перевести в C, собрать и сверить результат с интерпретатором
+static bool BuildAot(const std::string& source, const std::string& cc, const std::string& base, Measure& m) {
+    Program program = Compile(source);
+    std::string c_text = TranslateToC(program, RunOptions());
+    if (c_text.empty()) {
+        return false;
+    }
+    std::ofstream(base + ".c", std::ios::binary) << c_text;
+
+    auto start = std::chrono::steady_clock::now();
+    std::string build = cc + " -o \"" + base + "\" \"" + base + ".c\"";
+    if (std::system(build.c_str()) != 0) {
+        std::cerr << "Не удалось собрать " << base << ".c" << std::endl;
+        return false;
+    }
+    m.build_ns = ElapsedNs(start);
+
+    std::string run = "\"" + base + "\" --result > \"" + base + ".out\"";
+    std::system(run.c_str());
+    std::string expected = FormatRunResult(Run(program));
+    if (ReadFile(base + ".out") != expected) {
+        std::cerr << "Результат " << base << " --result не совпадает с интерпретатором" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool RunAot(const std::string& base, Measure& m) {
+    std::string run = "\"" + base + "\" --time > \"" + base + ".time\"";
+    if (std::system(run.c_str()) != 0) {
+        return false;
+    }
+    std::istringstream in(ReadFile(base + ".time"));
+    uint64_t ns = 0;
+    if (!(in >> ns)) {
+        return false;
+    }
+    m.run_ns = std::min(m.run_ns, ns);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string out_file = "aot_bench_results.jsonl";
+    std::string label;
+    int repeat = 5;
+    int size = 100;
+    const char* cc_env = std::getenv("CC");
+    std::string cc = std::string(cc_env ? cc_env : "cc") + " -O2";
+    std::string dir = ".";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-o") && (i + 1 < argc)) {
+            out_file = argv[++i];
+        }
+        else if ((arg == "--label") && (i + 1 < argc)) {
+            label = argv[++i];
+        }
+        else if ((arg == "--repeat") && (i + 1 < argc)) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        }
+        else if ((arg == "--size") && (i + 1 < argc)) {
+            size = std::max(1, std::atoi(argv[++i]));
+        }
+        else if ((arg == "--cc") && (i + 1 < argc)) {
+            cc = argv[++i];
+        }
+        else if ((arg == "--dir") && (i + 1 < argc)) {
+            dir = argv[++i];
+        }
+        else {
+            std::cerr << "Использование: aot_bench [-o файл] [--label метка] [--repeat N] [--size N]"
+                " [--cc команда] [--dir каталог]" << std::endl;
+            return -1;
+        }
+    }
+
+    // Наибольшие размеры run_bench; --size -- число итераций внешнего цикла
+    const int SIZES[WORKLOAD_COUNT] = { 1000, 200, 1000, 10000, 200, size, size, size, size };
+    const char* const CONFIGS[3] = { "tree", "vm+all", "aot" };
+
+    std::ofstream json(out_file, std::ios::app);
+    if (!json) {
+        std::cerr << "Невозможно открыть " << out_file << std::endl;
+        return -1;
+    }
+
+    std::cout << "Компилятор: " << cc << std::endl;
+    std::cout << std::left << std::setw(10) << "workload" << std::setw(10) << "config" << std::right
+        << std::setw(8) << "size" << std::setw(12) << "ops" << std::setw(14) << "run us"
+        << std::setw(11) << "ns/op" << std::setw(12) << "speedup" << std::setw(12) << "build ms" << std::endl;
+
+    for (int k = 0; k < WORKLOAD_COUNT; k++) {
+        WORKLOAD_KIND kind = static_cast<WORKLOAD_KIND>(k);
+        std::string source = GenerateWorkload(kind, SIZES[k]);
+        std::string base = dir + "/aot_" + WorkloadName(kind);
+
+        Measure results[3];
+        uint64_t ops = 0;
+        if (!BuildAot(source, cc, base, results[2])) {
+            std::cerr << "Ошибка в нагрузке " << WorkloadName(kind) << " (aot)" << std::endl;
+            return 1;
+        }
+        for (int i = 0; i < repeat; i++) {
+            if (!RunInterp(source, true, results[0], ops) || !RunInterp(source, false, results[1], ops)
+                || !RunAot(base, results[2])) {
+                std::cerr << "Ошибка в нагрузке " << WorkloadName(kind) << std::endl;
+                return 1;
+            }
+        }
+
+        for (int c = 0; c < 3; c++) {
+            const Measure& m = results[c];
+            double per_op = (ops > 0) ? static_cast<double>(m.run_ns) / static_cast<double>(ops) : 0.0;
+            double speedup = static_cast<double>(results[0].run_ns) / static_cast<double>(std::max<uint64_t>(1, m.run_ns));
+            double build_ms = static_cast<double>(m.build_ns) / 1e6;
+
+            std::cout << std::left << std::setw(10) << WorkloadName(kind) << std::setw(10) << CONFIGS[c] << std::right
+                << std::setw(8) << SIZES[k] << std::setw(12) << ops
+                << std::fixed << std::setprecision(1)
+                << std::setw(14) << static_cast<double>(m.run_ns) / 1000.0
+                << std::setw(11) << per_op
+                << std::setprecision(2) << std::setw(12) << speedup
+                << std::setprecision(1) << std::setw(12) << build_ms << std::endl;
+
+            json << "{\"label\": \"" << label << "\", \"workload\": \"" << WorkloadName(kind)
+                << "\", \"size\": " << SIZES[k] << ", \"config\": \"" << CONFIGS[c]
+                << "\", \"ops\": " << ops << ", \"run_ns\": " << m.run_ns
+                << std::fixed << std::setprecision(2)
+                << ", \"ns_per_op\": " << per_op << ", \"speedup\": " << speedup
+                << ", \"build_ms\": " << build_ms << "}\n";
+        }
+    }
+
+    std::cerr << "Результаты дописаны в " << out_file << std::endl;
+    return 0;
+}
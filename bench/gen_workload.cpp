@@ -0,0 +1,20 @@
+// Генератор синтетических программ для нагрузочных тестов.
+//
+// gen_workload вид размер > файл
+//   вид: globals | nesting | expr | arrays | typedefs | loops | invariant | stores | narrow
+
+#include "workload.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    WORKLOAD_KIND kind;
+    if ((argc < 3) || !ParseWorkloadKind(argv[1], kind)) {
+        std::cerr << "Использование: gen_workload globals|nesting|expr|arrays|typedefs|loops|invariant|stores|narrow размер" << std::endl;
+        return -1;
+    }
+    std::cout << GenerateWorkload(kind, std::atoi(argv[2]));
+    return 0;
+}
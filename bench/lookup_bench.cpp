@@ -0,0 +1,148 @@
+// Нагрузочный тест поиска идентификаторов в семантическом дереве.
+//
+// Строит глобальную область из N переменных и цепочку из D вложенных областей
+// по K переменных в каждой, затем многократно ищет имена из самой внутренней
+// области (SemGetVar) и читает их значения. Выводит пропускную способность
+// и, где доступны аппаратные счётчики (Linux, perf_event_open), число промахов кэша.
+//
+// lookup_bench [N] [D] [K] [повторов]
+
+#include "context.h"
+#include "tree.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Счётчик промахов кэша последнего уровня; без поддержки ОС -- недоступен
+class CacheMissCounter {
+public:
+    CacheMissCounter() : fd(-1) {
+#ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    bool Available() const { return fd >= 0; }
+
+    void Start() {
+#ifdef __linux__
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    uint64_t Stop() {
+        uint64_t count = 0;
+#ifdef __linux__
+        if (fd < 0) return 0;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count))) {
+            count = 0;
+        }
+#endif
+        return count;
+    }
+
+private:
+    int fd;
+};
+
+int main(int argc, char** argv) {
+    int globals = (argc > 1) ? std::atoi(argv[1]) : 2000;
+    int depth = (argc > 2) ? std::atoi(argv[2]) : 16;
+    int locals = (argc > 3) ? std::atoi(argv[3]) : 8;
+    int rounds = (argc > 4) ? std::atoi(argv[4]) : 200;
+
+    Context ctx;
+    ctx.out = nullptr;
+    ctx.err = nullptr;
+    ctx.CreateRoot();
+
+    // Все имена заранее, чтобы в измеряемом цикле не было построения строк
+    std::vector<std::string> names;
+    for (int i = 0; i < globals; i++) {
+        names.push_back("g" + std::to_string(i));
+        int node = ctx.tree.SemInclude(ctx.Cur, names.back(), TYPE_INT, 1, 1);
+        ctx.tree.Sem(node).hasValue = true;
+        ctx.tree.Sem(node).Value.v_int32 = i;
+    }
+    for (int d = 0; d < depth; d++) {
+        ctx.Cur = ctx.tree.SemEnterBlock(ctx.Cur, d + 2, 1);
+        for (int i = 0; i < locals; i++) {
+            names.push_back("l" + std::to_string(d) + "_" + std::to_string(i));
+            int node = ctx.tree.SemInclude(ctx.Cur, names.back(), TYPE_INT, d + 2, i + 1);
+            ctx.tree.Sem(node).hasValue = true;
+            ctx.tree.Sem(node).Value.v_int32 = i;
+        }
+    }
+
+    // Порядок обращений случайный, но одинаковый между запусками
+    std::vector<int> order(names.size());
+    std::mt19937 rng(12345);
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = static_cast<int>(rng() % names.size());
+    }
+
+    CacheMissCounter misses;
+    misses.Start();
+    auto start = std::chrono::steady_clock::now();
+
+    int64_t sum = 0;
+    for (int r = 0; r < rounds; r++) {
+        for (int i : order) {
+            int node = ctx.tree.SemGetVar(ctx.Cur, names[i], 0, 0);
+            sum += ctx.tree.Sem(node).Value.v_int32;
+        }
+    }
+
+    auto finish = std::chrono::steady_clock::now();
+    uint64_t miss_count = misses.Stop();
+
+    double seconds = std::chrono::duration<double>(finish - start).count();
+    double lookups = static_cast<double>(rounds) * static_cast<double>(order.size());
+
+    std::cout << "узлов: " << ctx.tree.Count()
+        << ", sizeof(SemNode) = " << sizeof(SemNode)
+        << ", sizeof(SemInfo) = " << sizeof(SemInfo) << std::endl;
+    std::cout << "поисков: " << static_cast<uint64_t>(lookups)
+        << ", время: " << seconds << " с"
+        << ", " << (seconds > 0.0 ? lookups / seconds : 0.0) << " поисков/с"
+        << ", " << (lookups > 0.0 ? seconds * 1e9 / lookups : 0.0) << " нс/поиск" << std::endl;
+    if (misses.Available()) {
+        std::cout << "промахов кэша: " << miss_count
+            << ", " << (lookups > 0.0 ? miss_count / lookups : 0.0) << " на поиск" << std::endl;
+    }
+    else {
+        std::cout << "промахов кэша: счётчик недоступен" << std::endl;
+    }
+    std::cout << "контрольная сумма: " << sum << std::endl;
+    return 0;
+}
@@ -0,0 +1,204 @@
+// Набор нагрузочных тестов: сканер, разбор (без вычисления) и полный интерпретатор
+// на синтетических программах всех видов (workload.h).
+//
+// Для каждой пары (вид, размер) выводится строка таблицы и JSON-запись
+// (по записи на строку) в файл результатов, чтобы сравнивать результаты между коммитами:
+//   {"label", "workload", "size", "bytes", "tokens", "ops",
+//    "scan_ns", "parse_ns", "run_ns", "scan_ns_per_token", "parse_ns_per_token",
+//    "run_ns_per_op", "peak_rss_kb"}
+// Время -- лучшее из повторов. ops -- выполненные операции (присваивания, арифметика,
+// входы и выходы из блоков). peak_rss_kb -- пик памяти процесса к концу замера
+// (0 -- недоступно); размеры идут по возрастанию, поэтому пик относится к текущей нагрузке.
+//
+// run_bench [-o файл] [--label метка] [--repeat N] [--scale K]
+
+#include "workload.h"
+
+#include "context.h"
+#include "defines.h"
+#include "diagram.h"
+#include "program_error.h"
+#include "scanner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+// Пик резидентной памяти процесса в килобайтах (0 -- недоступно)
+static uint64_t PeakRssKb() {
+#if defined(__linux__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return static_cast<uint64_t>(usage.ru_maxrss);
+    }
+#elif defined(__APPLE__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return static_cast<uint64_t>(usage.ru_maxrss) / 1024;
+    }
+#endif
+    return 0;
+}
+
+static uint64_t ElapsedNs(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+struct BenchResult {
+    uint64_t tokens = 0;
+    uint64_t ops = 0;
+    uint64_t scan_ns = UINT64_MAX;
+    uint64_t parse_ns = UINT64_MAX;
+    uint64_t run_ns = UINT64_MAX;
+};
+
+// Только сканер: все лексемы до конца текста
+static void MeasureScan(const std::string& source, BenchResult& r) {
+    auto start = std::chrono::steady_clock::now();
+    Scanner sc;
+    sc.loadText(source);
+    std::string lex;
+    uint64_t tokens = 0;
+    int t;
+    do {
+        t = sc.getNextLex(lex);
+        tokens++;
+    } while ((t != T_END) && (t != T_ERR));
+    r.scan_ns = std::min(r.scan_ns, ElapsedNs(start));
+    r.tokens = tokens;
+}
+
+// Разбор (isInterp -- с вычислением). false -- программа не прошла проверку
+static bool MeasureParse(const std::string& source, bool isInterp, BenchResult& r) {
+    auto start = std::chrono::steady_clock::now();
+    Scanner sc;
+    sc.loadText(source);
+    Context ctx;
+    ctx.out = nullptr;
+    ctx.err = nullptr;
+    ctx.checkOnly = !isInterp;
+    Diagram dg(&sc, &ctx);
+    try {
+        dg.ParseProgram(isInterp, false);
+    }
+    catch (const ProgramError& e) {
+        std::cerr << e.what();
+        return false;
+    }
+    uint64_t ns = ElapsedNs(start);
+    if (isInterp) {
+        r.run_ns = std::min(r.run_ns, ns);
+        r.ops = ctx.ring.Total();
+    }
+    else {
+        r.parse_ns = std::min(r.parse_ns, ns);
+    }
+    return true;
+}
+
+static double PerUnit(uint64_t ns, uint64_t units) {
+    return (units > 0) ? static_cast<double>(ns) / static_cast<double>(units) : 0.0;
+}
+
+int main(int argc, char** argv) {
+    std::string out_file = "bench_results.jsonl";
+    std::string label;
+    int repeat = 3;
+    int scale = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-o") && (i + 1 < argc)) {
+            out_file = argv[++i];
+        }
+        else if ((arg == "--label") && (i + 1 < argc)) {
+            label = argv[++i];
+        }
+        else if ((arg == "--repeat") && (i + 1 < argc)) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        }
+        else if ((arg == "--scale") && (i + 1 < argc)) {
+            scale = std::max(1, std::atoi(argv[++i]));
+        }
+        else {
+            std::cerr << "Использование: run_bench [-o файл] [--label метка] [--repeat N] [--scale K]" << std::endl;
+            return -1;
+        }
+    }
+
+    // Размеры по возрастанию для каждого вида нагрузки
+    const std::vector<int> SIZES[WORKLOAD_COUNT] = {
+        { 250, 1000 },     // globals
+        { 50, 200 },       // nesting
+        { 10, 100, 1000 }, // expr
+        { 1000, 10000 },   // arrays
+        { 50, 200 },       // typedefs
+        { 10, 100 },       // loops
+        { 10, 100 },       // invariant
+        { 10, 100 },       // stores
+        { 10, 100 }        // narrow
+    };
+
+    std::ofstream json(out_file, std::ios::app);
+    if (!json) {
+        std::cerr << "Невозможно открыть " << out_file << std::endl;
+        return -1;
+    }
+
+    std::cout << std::left << std::setw(10) << "workload" << std::right << std::setw(8) << "size"
+        << std::setw(10) << "tokens" << std::setw(10) << "ops"
+        << std::setw(14) << "scan ns/tok" << std::setw(15) << "parse ns/tok"
+        << std::setw(13) << "run ns/op" << std::setw(12) << "rss KB" << std::endl;
+
+    for (int k = 0; k < WORKLOAD_COUNT; k++) {
+        WORKLOAD_KIND kind = static_cast<WORKLOAD_KIND>(k);
+        for (int size : SIZES[k]) {
+            size *= scale;
+            std::string source = GenerateWorkload(kind, size);
+
+            BenchResult r;
+            for (int i = 0; i < repeat; i++) {
+                MeasureScan(source, r);
+                if (!MeasureParse(source, false, r) || !MeasureParse(source, true, r)) {
+                    std::cerr << "Ошибка в нагрузке " << WorkloadName(kind) << " " << size << std::endl;
+                    return 1;
+                }
+            }
+            uint64_t rss = PeakRssKb();
+
+            double scan_per_token = PerUnit(r.scan_ns, r.tokens);
+            double parse_per_token = PerUnit(r.parse_ns, r.tokens);
+            double run_per_op = PerUnit(r.run_ns, r.ops);
+
+            std::cout << std::left << std::setw(10) << WorkloadName(kind) << std::right << std::setw(8) << size
+                << std::setw(10) << r.tokens << std::setw(10) << r.ops
+                << std::fixed << std::setprecision(1)
+                << std::setw(14) << scan_per_token << std::setw(15) << parse_per_token
+                << std::setw(13) << run_per_op << std::setw(12) << rss << std::endl;
+
+            json << "{\"label\": \"" << label << "\", \"workload\": \"" << WorkloadName(kind)
+                << "\", \"size\": " << size << ", \"bytes\": " << source.size()
+                << ", \"tokens\": " << r.tokens << ", \"ops\": " << r.ops
+                << ", \"scan_ns\": " << r.scan_ns << ", \"parse_ns\": " << r.parse_ns << ", \"run_ns\": " << r.run_ns
+                << std::fixed << std::setprecision(2)
+                << ", \"scan_ns_per_token\": " << scan_per_token
+                << ", \"parse_ns_per_token\": " << parse_per_token
+                << ", \"run_ns_per_op\": " << run_per_op
+                << ", \"peak_rss_kb\": " << rss << "}\n";
+        }
+    }
+
+    std::cerr << "Результаты дописаны в " << out_file << std::endl;
+    return 0;
+}
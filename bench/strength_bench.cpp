@@ -0,0 +1,177 @@
+// Нагрузочный тест замены умножения, деления и остатка на константу (optimizer.h,
+// OPT_STRENGTH) для каждой разрядности: short (16 бит), int (32), longlong (64).
+//
+// Программа для типа T -- вложенные циклы, тело внутреннего цикла:
+//   s = (s + k / 3 + k % 10 + k / 16 + k % 8 + k * 9 + k * 8) % 1000;
+// где s и k типа T. Машина выполняет её со всеми суперкомандами без замены и с заменой,
+// и так же с машинным кодом циклов (jit.h, где поддерживается); замеряется только выполнение.
+// Для каждой пары (тип, вариант) выводится строка таблицы и JSON-запись:
+//   {"label", "type", "size", "config", "reduced", "ops", "run_ns", "ns_per_op", "speedup"}
+// reduced -- операций с планом замены, speedup -- ускорение относительно варианта
+// без замены с тем же исполнителем, время -- лучшее из повторов.
+//
+// strength_bench [-o файл] [--label метка] [--repeat N] [--size N]
+
+#include "code_gen.h"
+#include "context.h"
+#include "diagram.h"
+#include "jit.h"
+#include "optimizer.h"
+#include "program_error.h"
+#include "scanner.h"
+#include "vm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static uint64_t ElapsedNs(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+struct Config {
+    std::string name;
+    uint64_t jit;  // Порог трансляции циклов в машинный код (0 -- без неё)
+    unsigned opt;  // Маска оптимизаций байт-кода
+};
+
+struct Measure {
+    uint64_t run_ns = UINT64_MAX;
+    uint64_t ops = 0;
+    int reduced = 0;
+};
+
+// while (i < N) { T k = 0; while (k < 100) { s = (s + k / 3 + ...) % 1000; k = k + 1; } i = i + 1; }
+static std::string Program(const std::string& type, int n) {
+    std::string src = type + " s = 0;\nint main() {\n    int i = 0;\n";
+    src += "    while (i < " + std::to_string(n) + ") {\n";
+    src += "        " + type + " k = 0;\n";
+    src += "        while (k < 100) {\n";
+    src += "            s = (s + k / 3 + k % 10 + k / 16 + k % 8 + k * 9 + k * 8) % 1000;\n";
+    src += "            k = k + 1;\n";
+    src += "        }\n";
+    src += "        i = i + 1;\n";
+    src += "    }\n}\n";
+    return src;
+}
+
+// Один прогон; false -- программа завершилась ошибкой
+static bool RunOnce(const std::string& source, const Config& config, Measure& m) {
+    Scanner sc;
+    sc.loadText(source);
+    Context ctx;
+    ctx.out = nullptr;
+    ctx.err = nullptr;
+    Diagram dg(&sc, &ctx);
+    try {
+        ctx.debug = false;
+        ctx.jitThreshold = config.jit;
+        Code code;
+        dg.CompileProgram(code);
+        Optimize(code, ctx.tree, config.opt, false);
+        m.reduced = code.reduced;
+        Fuse(code, SUPER_ALL);
+        Vm vm(ctx, code);
+        auto start = std::chrono::steady_clock::now();
+        vm.Run();
+        m.run_ns = std::min(m.run_ns, ElapsedNs(start));
+    }
+    catch (const ProgramError& e) {
+        std::cerr << e.what();
+        return false;
+    }
+    m.ops = ctx.ring.Total();
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string out_file = "strength_bench_results.jsonl";
+    std::string label;
+    int repeat = 5;
+    int size = 200;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-o") && (i + 1 < argc)) {
+            out_file = argv[++i];
+        }
+        else if ((arg == "--label") && (i + 1 < argc)) {
+            label = argv[++i];
+        }
+        else if ((arg == "--repeat") && (i + 1 < argc)) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        }
+        else if ((arg == "--size") && (i + 1 < argc)) {
+            size = std::max(1, std::atoi(argv[++i]));
+        }
+        else {
+            std::cerr << "Использование: strength_bench [-o файл] [--label метка] [--repeat N] [--size N]" << std::endl;
+            return -1;
+        }
+    }
+
+    // Пары: без замены и с заменой при одном исполнителе
+    std::vector<Config> configs;
+    configs.push_back({ "vm+all", 0, 0 });
+    configs.push_back({ "vm+all+strength", 0, 1u << OPT_STRENGTH });
+    if (Jit::Supported()) {
+        configs.push_back({ "vm+all+jit", 16, 0 });
+        configs.push_back({ "vm+all+strength+jit", 16, 1u << OPT_STRENGTH });
+    }
+    const char* const TYPES[] = { "short", "int", "longlong" };
+
+    std::ofstream json(out_file, std::ios::app);
+    if (!json) {
+        std::cerr << "Невозможно открыть " << out_file << std::endl;
+        return -1;
+    }
+
+    std::cout << "Диспетчеризация: " << Vm::Dispatch() << std::endl;
+    std::cout << std::left << std::setw(10) << "type" << std::setw(22) << "config" << std::right
+        << std::setw(9) << "reduced" << std::setw(12) << "ops" << std::setw(14) << "run us"
+        << std::setw(11) << "ns/op" << std::setw(10) << "speedup" << std::endl;
+
+    for (const char* type : TYPES) {
+        std::string source = Program(type, size);
+
+        std::vector<Measure> results(configs.size());
+        for (size_t c = 0; c < configs.size(); c++) {
+            for (int i = 0; i < repeat; i++) {
+                if (!RunOnce(source, configs[c], results[c])) {
+                    std::cerr << "Ошибка в программе для " << type << " (" << configs[c].name << ")" << std::endl;
+                    return 1;
+                }
+            }
+        }
+
+        for (size_t c = 0; c < configs.size(); c++) {
+            const Measure& m = results[c];
+            const Measure& baseline = results[c & ~static_cast<size_t>(1)];
+            double per_op = (m.ops > 0) ? static_cast<double>(m.run_ns) / static_cast<double>(m.ops) : 0.0;
+            double speedup = static_cast<double>(baseline.run_ns) / static_cast<double>(std::max<uint64_t>(1, m.run_ns));
+
+            std::cout << std::left << std::setw(10) << type << std::setw(22) << configs[c].name << std::right
+                << std::setw(9) << m.reduced << std::setw(12) << m.ops
+                << std::fixed << std::setprecision(1)
+                << std::setw(14) << static_cast<double>(m.run_ns) / 1000.0
+                << std::setw(11) << per_op
+                << std::setprecision(2) << std::setw(10) << speedup << std::endl;
+
+            json << "{\"label\": \"" << label << "\", \"type\": \"" << type
+                << "\", \"size\": " << size << ", \"config\": \"" << configs[c].name
+                << "\", \"reduced\": " << m.reduced << ", \"ops\": " << m.ops << ", \"run_ns\": " << m.run_ns
+                << std::fixed << std::setprecision(2)
+                << ", \"ns_per_op\": " << per_op << ", \"speedup\": " << speedup << "}\n";
+        }
+    }
+
+    std::cerr << "Результаты дописаны в " << out_file << std::endl;
+    return 0;
+}
@@ -0,0 +1,218 @@
+// Нагрузочный тест виртуальной машины (vm.h): интерпретатор по дереву против
+// байт-кода без суперкоманд, с каждым шаблоном суперкоманд по отдельности, со всеми,
+// со всеми плюс машинный код горячих циклов (jit.h, где поддерживается) и с оптимизациями
+// байт-кода (optimizer.h): вынесение инвариантов, развёртывание циклов, вычисление
+// циклов при трансляции (нагрузки с известными при трансляции значениями вычисляются целиком),
+// распространение копий с удалением затираемых присваиваний и недостижимого кода, анализ
+// диапазонов (присваивания и операции без проверок обрезки и приведения).
+//
+// Для дерева замеряется разбор с вычислением (по-другому он не выполняет программу),
+// для машины -- только выполнение: программа транслируется и суперкоманды
+// подставляются до замера. Для каждой пары (нагрузка, вариант) выводится строка
+// таблицы и JSON-запись (по записи на строку):
+//   {"label", "workload", "size", "config", "fused", "hoisted", "unrolled", "evaluated", "dead", "fit", "ops", "run_ns", "ns_per_op", "speedup"}
+// hoisted -- вынесено из циклов операций (OPT_LICM), unrolled -- развёрнуто циклов (OPT_UNROLL),
+// evaluated -- вычислено циклов при трансляции (OPT_EVAL), dead -- удалено затираемых присваиваний (OPT_DSE),
+// fit -- присваиваний и операций без проверки обрезки и приведения (OPT_RANGE).
+// speedup -- ускорение относительно машины без суперкоманд, время -- лучшее из повторов.
+//
+// vm_bench [-o файл] [--label метка] [--repeat N] [--size N]
+
+#include "workload.h"
+
+#include "code_gen.h"
+#include "context.h"
+#include "diagram.h"
+#include "jit.h"
+#include "optimizer.h"
+#include "program_error.h"
+#include "scanner.h"
+#include "vm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static uint64_t ElapsedNs(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+struct Config {
+    std::string name;
+    bool tree;          // Интерпретатор по дереву
+    unsigned patterns;  // Маска шаблонов суперкоманд
+    uint64_t jit;       // Порог трансляции циклов в машинный код (0 -- без неё)
+    unsigned opt;       // Маска оптимизаций байт-кода
+};
+
+struct Measure {
+    uint64_t run_ns = UINT64_MAX;
+    uint64_t ops = 0;
+    int fused = 0;
+    int hoisted = 0;
+    int unrolled = 0;
+    int evaluated = 0;
+    int dead = 0;
+    int fit = 0;
+};
+
+// Один прогон; false -- программа завершилась ошибкой
+static bool RunOnce(const std::string& source, const Config& config, Measure& m) {
+    Scanner sc;
+    sc.loadText(source);
+    Context ctx;
+    ctx.out = nullptr;
+    ctx.err = nullptr;
+    Diagram dg(&sc, &ctx);
+    try {
+        if (config.tree) {
+            ctx.engine = ENGINE_TREE;
+            auto start = std::chrono::steady_clock::now();
+            dg.ParseProgram(true, false);
+            m.run_ns = std::min(m.run_ns, ElapsedNs(start));
+        }
+        else {
+            // Как ParseProgram(true, false): без отладочных предупреждений
+            ctx.debug = false;
+            ctx.jitThreshold = config.jit;
+            Code code;
+            dg.CompileProgram(code);
+            Optimize(code, ctx.tree, config.opt, false);
+            m.hoisted = code.hoistedOps;
+            m.unrolled = code.unrolled;
+            m.evaluated = code.evaluated;
+            m.dead = code.deadStores;
+            m.fit = code.fitStores + code.fitOps;
+            Fuse(code, config.patterns);
+            m.fused = 0;
+            for (int p = 0; p < SUPER_COUNT; p++) {
+                m.fused += code.fused[p];
+            }
+            Vm vm(ctx, code);
+            auto start = std::chrono::steady_clock::now();
+            vm.Run();
+            m.run_ns = std::min(m.run_ns, ElapsedNs(start));
+        }
+    }
+    catch (const ProgramError& e) {
+        std::cerr << e.what();
+        return false;
+    }
+    m.ops = ctx.ring.Total();
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string out_file = "vm_bench_results.jsonl";
+    std::string label;
+    int repeat = 5;
+    int size = 200;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-o") && (i + 1 < argc)) {
+            out_file = argv[++i];
+        }
+        else if ((arg == "--label") && (i + 1 < argc)) {
+            label = argv[++i];
+        }
+        else if ((arg == "--repeat") && (i + 1 < argc)) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        }
+        else if ((arg == "--size") && (i + 1 < argc)) {
+            size = std::max(1, std::atoi(argv[++i]));
+        }
+        else {
+            std::cerr << "Использование: vm_bench [-o файл] [--label метка] [--repeat N] [--size N]" << std::endl;
+            return -1;
+        }
+    }
+
+    std::vector<Config> configs;
+    configs.push_back({ "tree", true, 0, 0, 0 });
+    configs.push_back({ "vm", false, 0, 0, 0 });
+    for (int p = 0; p < SUPER_COUNT; p++) {
+        configs.push_back({ std::string("vm+") + SuperPatternName(p), false, 1u << p, 0, 0 });
+    }
+    configs.push_back({ "vm+all", false, SUPER_ALL, 0, 0 });
+    configs.push_back({ "vm+all+licm", false, SUPER_ALL, 0, 1u << OPT_LICM });
+    configs.push_back({ "vm+all+unroll", false, SUPER_ALL, 0, 1u << OPT_UNROLL });
+    configs.push_back({ "vm+all+eval", false, SUPER_ALL, 0, 1u << OPT_EVAL });
+    configs.push_back({ "vm+all+ssa", false, SUPER_ALL, 0, (1u << OPT_COPY) | (1u << OPT_DSE) | (1u << OPT_UNREACHABLE) });
+    configs.push_back({ "vm+all+range", false, SUPER_ALL, 0, 1u << OPT_RANGE });
+    if (Jit::Supported()) {
+        configs.push_back({ "vm+all+jit", false, SUPER_ALL, 16, 0 });
+        configs.push_back({ "vm+all+licm+jit", false, SUPER_ALL, 16, 1u << OPT_LICM });
+        configs.push_back({ "vm+all+unroll+jit", false, SUPER_ALL, 16, 1u << OPT_UNROLL });
+        configs.push_back({ "vm+all+range+jit", false, SUPER_ALL, 16, 1u << OPT_RANGE });
+        configs.push_back({ "vm+all+init+jit", false, SUPER_ALL, 16, 1u << OPT_INIT });
+    }
+
+    // Циклы -- основная нагрузка машины; длинные выражения -- арифметика без переходов
+    const std::pair<WORKLOAD_KIND, int> WORKLOADS[] = {
+        { WORKLOAD_LOOPS, size },
+        { WORKLOAD_INVARIANT, size },
+        { WORKLOAD_STORES, size },
+        { WORKLOAD_NARROW, size },
+        { WORKLOAD_EXPR, 100 },
+    };
+
+    std::ofstream json(out_file, std::ios::app);
+    if (!json) {
+        std::cerr << "Невозможно открыть " << out_file << std::endl;
+        return -1;
+    }
+
+    std::cout << "Диспетчеризация: " << Vm::Dispatch() << std::endl;
+    std::cout << std::left << std::setw(10) << "workload" << std::setw(26) << "config" << std::right
+        << std::setw(8) << "fused" << std::setw(9) << "hoisted" << std::setw(10) << "unrolled" << std::setw(11) << "evaluated" << std::setw(6) << "dead" << std::setw(7) << "fit"
+        << std::setw(12) << "ops" << std::setw(14) << "run us"
+        << std::setw(11) << "ns/op" << std::setw(10) << "speedup" << std::endl;
+
+    for (const auto& w : WORKLOADS) {
+        std::string source = GenerateWorkload(w.first, w.second);
+
+        std::vector<Measure> results(configs.size());
+        for (size_t c = 0; c < configs.size(); c++) {
+            for (int i = 0; i < repeat; i++) {
+                if (!RunOnce(source, configs[c], results[c])) {
+                    std::cerr << "Ошибка в нагрузке " << WorkloadName(w.first) << " (" << configs[c].name << ")" << std::endl;
+                    return 1;
+                }
+            }
+        }
+
+        const Measure& baseline = results[1];
+        for (size_t c = 0; c < configs.size(); c++) {
+            const Measure& m = results[c];
+            double per_op = (m.ops > 0) ? static_cast<double>(m.run_ns) / static_cast<double>(m.ops) : 0.0;
+            double speedup = static_cast<double>(baseline.run_ns) / static_cast<double>(std::max<uint64_t>(1, m.run_ns));
+
+            std::cout << std::left << std::setw(10) << WorkloadName(w.first) << std::setw(26) << configs[c].name << std::right
+                << std::setw(8) << m.fused << std::setw(9) << m.hoisted << std::setw(10) << m.unrolled
+                << std::setw(11) << m.evaluated << std::setw(6) << m.dead << std::setw(7) << m.fit << std::setw(12) << m.ops
+                << std::fixed << std::setprecision(1)
+                << std::setw(14) << static_cast<double>(m.run_ns) / 1000.0
+                << std::setw(11) << per_op
+                << std::setprecision(2) << std::setw(10) << speedup << std::endl;
+
+            json << "{\"label\": \"" << label << "\", \"workload\": \"" << WorkloadName(w.first)
+                << "\", \"size\": " << w.second << ", \"config\": \"" << configs[c].name
+                << "\", \"fused\": " << m.fused << ", \"hoisted\": " << m.hoisted
+                << ", \"unrolled\": " << m.unrolled << ", \"evaluated\": " << m.evaluated
+                << ", \"dead\": " << m.dead << ", \"fit\": " << m.fit << ", \"ops\": " << m.ops << ", \"run_ns\": " << m.run_ns
+                << std::fixed << std::setprecision(2)
+                << ", \"ns_per_op\": " << per_op << ", \"speedup\": " << speedup << "}\n";
+        }
+    }
+
+    std::cerr << "Результаты дописаны в " << out_file << std::endl;
+    return 0;
+}
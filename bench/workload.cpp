@@ -0,0 +1,184 @@
+#include "workload.h"
+
+#include <algorithm>
+
+static const char* const WORKLOAD_NAMES[WORKLOAD_COUNT] = {
+    "globals", "nesting", "expr", "arrays", "typedefs", "loops", "invariant", "stores", "narrow"
+};
+
+const char* WorkloadName(WORKLOAD_KIND kind) {
+    return WORKLOAD_NAMES[kind];
+}
+
+bool ParseWorkloadKind(const std::string& name, WORKLOAD_KIND& kind) {
+    for (int i = 0; i < WORKLOAD_COUNT; i++) {
+        if (name == WORKLOAD_NAMES[i]) {
+            kind = static_cast<WORKLOAD_KIND>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// int g0 = 0; ... int gN = N % 100;  main: s = (s + gi) % 1000 по всем i
+static std::string Globals(int n) {
+    std::string src;
+    for (int i = 0; i < n; i++) {
+        src += "int g" + std::to_string(i) + " = " + std::to_string(i % 100) + ";\n";
+    }
+    src += "int main() {\n    int s = 0;\n";
+    for (int i = 0; i < n; i++) {
+        src += "    s = (s + g" + std::to_string(i) + ") % 1000;\n";
+    }
+    src += "}\n";
+    return src;
+}
+
+// { int v1 = v0 + 1; { int v2 = v1 + 1; ... } v1 = v1 % 100; }
+static std::string Nesting(int depth) {
+    std::string src = "int main() {\n    int v0 = 0;\n";
+    for (int i = 1; i <= depth; i++) {
+        src += "{ int v" + std::to_string(i) + " = v" + std::to_string(i - 1) + " % 100 + 1;\n";
+    }
+    for (int i = depth; i >= 1; i--) {
+        src += "v" + std::to_string(i) + " = v" + std::to_string(i) + " * 2 % 100; }\n";
+    }
+    src += "}\n";
+    return src;
+}
+
+// Операторы присваивания с выражениями из length операндов; значения остаются малыми
+static std::string Expr(int length) {
+    static const char* const VARS[3] = { "a", "b", "c" };
+    int statements = std::max(1, std::min(200, 20000 / std::max(1, length)));
+
+    std::string src = "int main() {\n    int a = 1;\n    int b = 2;\n    int c = 3;\n    int r = 0;\n";
+    for (int s = 0; s < statements; s++) {
+        src += "    r = (r";
+        for (int i = 0; i < length; i++) {
+            src += (i % 2 == 0) ? " + " : " - ";
+            src += VARS[(i + s) % 3];
+            if (i % 4 == 1) {
+                src += " * 2";
+            }
+            else if (i % 4 == 3) {
+                src += " % 2";
+            }
+        }
+        src += ") % 1000;\n";
+    }
+    src += "}\n";
+    return src;
+}
+
+// typedef int big[N]; big a; запись и чтение не более 1000 равномерно расположенных элементов
+static std::string Arrays(int n) {
+    int touched = std::min(n, 1000);
+    std::string src = "typedef int big[" + std::to_string(n) + "];\nbig a;\nint main() {\n    int s = 0;\n";
+    for (int k = 0; k < touched; k++) {
+        int i = static_cast<int>(static_cast<long long>(k) * n / touched);
+        src += "    a[" + std::to_string(i) + "] = " + std::to_string(i % 100) + ";\n";
+    }
+    for (int k = 0; k < touched; k++) {
+        int i = static_cast<int>(static_cast<long long>(k) * n / touched);
+        src += "    s = (s + a[" + std::to_string(i) + "]) % 1000;\n";
+    }
+    src += "}\n";
+    return src;
+}
+
+// typedef int t0; typedef t0 t1; ... и переменные последнего типа
+static std::string Typedefs(int n) {
+    std::string src = "typedef int t0;\n";
+    for (int i = 1; i < n; i++) {
+        src += "typedef t" + std::to_string(i - 1) + " t" + std::to_string(i) + ";\n";
+    }
+    std::string last = "t" + std::to_string(std::max(0, n - 1));
+    src += last + " x = 1;\nint main() {\n";
+    for (int i = 0; i < n; i++) {
+        src += "    { t" + std::to_string(i) + " y = x + " + std::to_string(i % 100) + "; x = y % 100; }\n";
+    }
+    src += "}\n";
+    return src;
+}
+
+// while (i < N) { int j = 0; while (j < 100) { s = (s + i * j) % 1000; j = j + 1; } i = i + 1; }
+static std::string Loops(int n) {
+    std::string src = "int main() {\n    int s = 0;\n    int i = 0;\n";
+    src += "    while (i < " + std::to_string(n) + ") {\n";
+    src += "        int j = 0;\n";
+    src += "        while (j < 100) {\n";
+    src += "            s = (s + i * j) % 1000;\n";
+    src += "            j = j + 1;\n";
+    src += "        }\n";
+    src += "        i = i + 1;\n";
+    src += "    }\n}\n";
+    return src;
+}
+
+// Как Loops, но s = (s + (a * b + i) % 97 * j + (a - b) * (i + 3) / 5) % 1000:
+// большая часть выражения не меняется во внутреннем цикле
+static std::string Invariant(int n) {
+    std::string src = "int a = 12;\nint b = 7;\nint main() {\n    int s = 0;\n    int i = 0;\n";
+    src += "    while (i < " + std::to_string(n) + ") {\n";
+    src += "        int j = 0;\n";
+    src += "        while (j < 100) {\n";
+    src += "            s = (s + (a * b + i) % 97 * j + (a - b) * (i + 3) / 5) % 1000;\n";
+    src += "            j = j + 1;\n";
+    src += "        }\n";
+    src += "        i = i + 1;\n";
+    src += "    }\n}\n";
+    return src;
+}
+
+// Как Loops, но во внутреннем цикле u -- копия j, а первое значение t затирается раньше,
+// чем его прочтут: int u = j; int t = i * j; t = u + 1; s = (s + t * i) % 1000;
+static std::string Stores(int n) {
+    std::string src = "int main() {\n    int s = 0;\n    int i = 0;\n";
+    src += "    while (i < " + std::to_string(n) + ") {\n";
+    src += "        int j = 0;\n";
+    src += "        while (j < 100) {\n";
+    src += "            int u = j;\n";
+    src += "            int t = i * j;\n";
+    src += "            t = u + 1;\n";
+    src += "            s = (s + t * i) % 1000;\n";
+    src += "            j = j + 1;\n";
+    src += "        }\n";
+    src += "        i = i + 1;\n";
+    src += "    }\n}\n";
+    return src;
+}
+
+// Как Loops, но счётчик внутреннего цикла -- longlong, а значения более широкого типа
+// присваиваются переменным short и int (проверка обрезки; значения в диапазоне типа):
+// short k = j * 3; int q = j / 7 + i; s = (s + k * q) % 1000;
+static std::string Narrow(int n) {
+    std::string src = "int main() {\n    short s = 0;\n    int i = 0;\n";
+    src += "    while (i < " + std::to_string(n) + ") {\n";
+    src += "        longlong j = 0;\n";
+    src += "        while (j < 100) {\n";
+    src += "            short k = j * 3;\n";
+    src += "            int q = j / 7 + i;\n";
+    src += "            s = (s + k * q) % 1000;\n";
+    src += "            j = j + 1;\n";
+    src += "        }\n";
+    src += "        i = i + 1;\n";
+    src += "    }\n}\n";
+    return src;
+}
+
+std::string GenerateWorkload(WORKLOAD_KIND kind, int size) {
+    size = std::max(1, size);
+    switch (kind) {
+    case WORKLOAD_GLOBALS: return Globals(size);
+    case WORKLOAD_NESTING: return Nesting(size);
+    case WORKLOAD_EXPR: return Expr(size);
+    case WORKLOAD_ARRAYS: return Arrays(size);
+    case WORKLOAD_TYPEDEFS: return Typedefs(size);
+    case WORKLOAD_LOOPS: return Loops(size);
+    case WORKLOAD_INVARIANT: return Invariant(size);
+    case WORKLOAD_STORES: return Stores(size);
+    case WORKLOAD_NARROW: return Narrow(size);
+    default: return "";
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+
+// Вид синтетической нагрузки: каждая нагружает одно направление
+enum WORKLOAD_KIND {
+    WORKLOAD_GLOBALS,  // size глобальных переменных, main читает их все
+    WORKLOAD_NESTING,  // size вложенных блоков, в каждом объявление и присваивание
+    WORKLOAD_EXPR,     // Выражения из size операндов
+    WORKLOAD_ARRAYS,   // Массив из size элементов (size узлов дерева), запись и чтение элементов
+    WORKLOAD_TYPEDEFS, // Цепочка из size меток типов, каждая через предыдущую
+    WORKLOAD_LOOPS,    // Вложенные циклы: size итераций внешнего по 100 итераций внутреннего
+    WORKLOAD_INVARIANT, // Те же циклы, во внутреннем -- выражения из переменных, не меняющихся в цикле
+    WORKLOAD_STORES,   // Те же циклы, во внутреннем -- копия переменной и затираемое присваивание
+    WORKLOAD_NARROW,   // Те же циклы, во внутреннем -- присваивания short и int значений более широкого типа
+    WORKLOAD_COUNT
+};
+
+// Имя вида нагрузки ("globals", "nesting", ...)
+const char* WorkloadName(WORKLOAD_KIND kind);
+
+// Вид нагрузки по имени; false -- неизвестное имя
+bool ParseWorkloadKind(const std::string& name, WORKLOAD_KIND& kind);
+
+// Текст программы. Программа корректна и выполняется без ошибок и предупреждений
+std::string GenerateWorkload(WORKLOAD_KIND kind, int size);
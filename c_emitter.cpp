@@ -0,0 +1,388 @@
+#include "c_emitter.h"
+#include "context.h"
+#include "program_error.h"
+#include "tree.h"
+
+#include <string>
+#include <vector>
+
+static bool IsIntType(DATA_TYPE t) {
+    return (t == TYPE_SHORT_INT) || (t == TYPE_INT) || (t == TYPE_LONG_INT) || (t == TYPE_LONG_LONG_INT);
+}
+
+// Тип C по типу переменной (как поле SemNode::Value)
+static const char* CType(int type) {
+    switch (type) {
+    case TYPE_SHORT_INT: return "int16_t";
+    case TYPE_INT: return "int32_t";
+    case TYPE_LONG_INT: return "int32_t";
+    default: return "int64_t";
+    }
+}
+
+// Имя типа в сообщениях (как Tree::OverflowError)
+static const char* TypeName(int type) {
+    switch (type) {
+    case TYPE_SHORT_INT: return "short";
+    case TYPE_INT: return "int";
+    case TYPE_LONG_INT: return "long";
+    default: return "longlong";
+    }
+}
+
+static std::string Literal(int64_t v) {
+    if (v == INT64_MIN) {
+        return "(-INT64_C(9223372036854775807) - 1)";
+    }
+    return "INT64_C(" + std::to_string(v) + ")";
+}
+
+// Строковый литерал C (UTF-8 остаётся как есть)
+static std::string CString(const std::string& s) {
+    std::string r = "\"";
+    for (char c : s) {
+        switch (c) {
+        case '\\': r += "\\\\"; break;
+        case '"': r += "\\\""; break;
+        case '?': r += "\\?"; break; // Триграфы
+        case '\n': r += "\\n"; break;
+        case '\t': r += "\\t"; break;
+        default: r += c; break;
+        }
+    }
+    return r + "\"";
+}
+
+// Тексты сообщений берутся у интерпретатора, чтобы совпадать дословно
+static std::string ConversionMessage(DATA_TYPE from, DATA_TYPE to, const std::string& context, const std::string& expression) {
+    Context scratch;
+    scratch.err = nullptr;
+    scratch.debug = true;
+    Tree::PrintTypeConversionWarning(scratch, from, to, context, expression, 0, 0);
+    return scratch.warnings.empty() ? "" : scratch.warnings.back().message;
+}
+
+static std::string IterationLimitMessage(uint64_t maxIterations) {
+    Context scratch;
+    scratch.maxIterations = maxIterations;
+    scratch.iterations = maxIterations;
+    try {
+        Tree::CountIteration(scratch, 0, 0);
+    }
+    catch (const ProgramError& e) {
+        return e.GetDiagnostic().message;
+    }
+    return "";
+}
+
+// Начало сообщения вида kind ("Предупреждение: ", ...)
+static std::string DiagnosticPrefix(DIAG_KIND kind) {
+    std::string text = FormatDiagnostic({ kind, "", "", 0, 0 });
+    return text.substr(0, text.find('\n'));
+}
+
+// Глубина стека значений перед каждой командой (-1 -- команда недостижима)
+static std::vector<int> StackDepths(const std::vector<Instr>& code) {
+    std::vector<int> depth(code.size(), -1);
+    std::vector<int> work;
+    auto reach = [&](int pc, int d) {
+        if ((pc >= 0) && (pc < static_cast<int>(code.size())) && (depth[pc] < 0)) {
+            depth[pc] = d;
+            work.push_back(pc);
+        }
+    };
+    reach(0, 0);
+    while (!work.empty()) {
+        int pc = work.back();
+        work.pop_back();
+        const Instr& in = code[pc];
+        int d = depth[pc];
+        switch (BaseOpcode(in.op)) {
+        case OP_CONST: case OP_LOAD: reach(pc + 1, d + 1); break;
+        case OP_STORE: case OP_TSET: reach(pc + 1, d - 1); break;
+        case OP_TGET: reach(in.b, d + 1); reach(pc + 1, d); break;
+        case OP_LOADQ: reach(in.b, d - static_cast<int>(in.imm)); reach(pc + 1, d + 1); break;
+        case OP_DIVQ: case OP_MODQ: reach(in.b, d - static_cast<int>(in.imm)); reach(pc + 1, d - 1); break;
+        case OP_JMP: reach(in.a, d); break;
+        case OP_JZ: reach(in.a, d - 1); reach(pc + 1, d - 1); break;
+        case OP_LOOP: reach(in.a, d); break;
+        case OP_ITER: reach(in.a, d); reach(pc + 1, d); break;
+        case OP_RAISE: case OP_HALT: break;
+        default:
+            if ((BaseOpcode(in.op) >= OP_ADD) && (BaseOpcode(in.op) <= OP_NE)) reach(pc + 1, d - 1);
+            else reach(pc + 1, d);
+            break;
+        }
+    }
+    return depth;
+}
+
+void EmitC(const Code& code, const Tree& tree, const CEmitOptions& options, std::ostream& out) {
+    const std::vector<Instr>& c = code.instrs;
+    const int nodes = tree.Count();
+    std::vector<int> depth = StackDepths(c);
+
+    std::vector<bool> labelled(c.size() + 1, false);
+    for (const Instr& in : c) {
+        int op = BaseOpcode(in.op);
+        if ((op == OP_JMP) || (op == OP_JZ) || (op == OP_LOOP) || (op == OP_ITER)) {
+            labelled[in.a] = true;
+        }
+        if ((op == OP_TGET) || (op == OP_LOADQ) || (op == OP_DIVQ) || (op == OP_MODQ)) {
+            labelled[in.b] = true;
+        }
+    }
+
+    out << "/* Программа, переведённая из байт-кода tayat (c_emitter.h).\n"
+        << "   Сборка: cc -O2 программа.c; запуск: программа [--result | --time] */\n"
+        << "#include <inttypes.h>\n#include <stdint.h>\n#include <stdio.h>\n#include <string.h>\n#include <time.h>\n\n";
+
+    out << "static int tayat_mode; /* 0 -- сообщения в stderr, 1 -- --result, 2 -- --time */\n\n";
+    out << "static void tayat_diag(int kind, const char* msg, const char* id, int line, int col) {\n"
+        << "    static const char* const PREFIX[] = { \"\"";
+    for (int k = DIAG_LEXICAL; k <= DIAG_WARNING; k++) {
+        out << ", " << CString(DiagnosticPrefix(static_cast<DIAG_KIND>(k)));
+    }
+    out << " };\n"
+        << "    if (tayat_mode == 1) {\n"
+        << "        printf(\"D\\t%d\\t%d\\t%d\\t%s\\t%s\\n\", kind, line, col, id, msg);\n"
+        << "        return;\n"
+        << "    }\n"
+        << "    fprintf(stderr, \"%s%s\", PREFIX[kind], msg);\n"
+        << "    if (id[0]) fprintf(stderr, " << CString(" (около '%s')") << ", id);\n"
+        << "    fprintf(stderr, " << CString("\n(строка %d:%d)\n") << ", line, col);\n"
+        << "}\n\n";
+    // Как Tree::WarnTruncation
+    out << "static void tayat_truncated(int64_t value, const char* type, int line, int col) {\n"
+        << "    char msg[128];\n"
+        << "    snprintf(msg, sizeof msg, " << CString("значение %") << " PRId64 " << CString(" обрезается при преобразовании к %s")
+        << ", value, type);\n"
+        << "    tayat_diag(" << DIAG_WARNING << ", msg, \"\", line, col);\n"
+        << "}\n\n";
+    if (options.checked) {
+        // Как Tree::OverflowError
+        out << "static const char* tayat_overflow(int64_t a, char op, int64_t b, const char* type) {\n"
+            << "    static char msg[160];\n"
+            << "    snprintf(msg, sizeof msg, " << CString("Переполнение при вычислении %") << " PRId64 \" %c %\" PRId64 "
+            << CString(" в типе %s") << ", a, op, b, type);\n"
+            << "    return msg;\n"
+            << "}\n\n";
+    }
+    out << "static void tayat_var(const char* name, int type, int depth, int has, int64_t value) {\n"
+        << "    printf(\"V\\t%d\\t%d\\t%d\\t%\" PRId64 \"\\t%s\\n\", type, depth, has, has ? value : 0, name);\n"
+        << "}\n\n";
+    out << "#define TAYAT_FAIL(kind, msg, id, line, col, nodes) \\\n"
+        << "    do { tayat_diag(kind, msg, id, line, col); tayat_ok = 0; tayat_nodes = nodes; goto tayat_end; } while (0)\n\n";
+
+    out << "int main(int argc, char** argv) {\n"
+        << "    int tayat_ok = 1;\n"
+        << "    int tayat_nodes = " << nodes << ";\n"
+        << "    uint64_t tayat_iterations = 0;\n"
+        << "    struct timespec tayat_start, tayat_stop;\n";
+    for (int s = 0; s < code.maxStack; s++) {
+        out << "    int64_t s" << s << " = 0;\n";
+    }
+    for (int n = 0; n < nodes; n++) {
+        const SemNode& v = tree.Sem(n);
+        if (!IsIntType(v.DataType)) continue;
+        out << "    " << CType(v.DataType) << " v" << n << " = " << (v.hasValue ? WidenValue(v) : 0)
+            << "; unsigned char i" << n << " = " << (v.hasValue ? 1 : 0) << "; /* " << tree.Info(n).id << " */\n";
+    }
+    for (int t = code.tempBase; t < code.tempBase + code.temps; t++) {
+        out << "    int64_t v" << t << " = 0; unsigned char i" << t << " = 0; /* вынесенное значение */\n";
+    }
+    out << "    (void)tayat_iterations; (void)tayat_truncated;\n"
+        << "    if (argc > 1) tayat_mode = (strcmp(argv[1], \"--result\") == 0) ? 1 : (strcmp(argv[1], \"--time\") == 0) ? 2 : 0;\n"
+        << "    timespec_get(&tayat_start, TIME_UTC);\n\n";
+
+    static const char* const ARITH[3] = { "+", "-", "*" };
+    static const char* const CMP[6] = { "<", "<=", ">", ">=", "==", "!=" };
+    const std::string limit_message = (options.maxIterations > 0) ? IterationLimitMessage(options.maxIterations) : "";
+
+    for (size_t i = 0; i < c.size(); i++) {
+        const Instr& in = c[i];
+        if (labelled[i]) {
+            out << "L" << i << ":\n";
+        }
+        if (depth[i] < 0) {
+            continue;
+        }
+        const int d = depth[i];
+        const std::string top = "s" + std::to_string(d - 1);
+        const std::string second = "s" + std::to_string(d - 2);
+        const std::string pos = std::to_string(in.line) + ", " + std::to_string(in.col);
+        const std::string nodes_here = std::to_string(code.nodes[i]);
+        const int op = BaseOpcode(in.op);
+
+        switch (op) {
+        case OP_CONST:
+            out << "    s" << d << " = " << Literal(in.imm) << ";\n";
+            break;
+        case OP_LOAD: {
+            // Переменная инициализирована на всех путях (PROVEN_INIT) -- без проверки
+            if (!(in.proven & PROVEN_INIT)) {
+                const Diagnostic& e = code.errors[in.b];
+                out << "    if (!i" << in.a << ") TAYAT_FAIL(" << e.kind << ", " << CString(e.message) << ", " << CString(e.id)
+                    << ", " << e.line << ", " << e.col << ", " << nodes_here << ");\n";
+            }
+            out << "    s" << d << " = v" << in.a << ";\n";
+            break;
+        }
+        case OP_STORE:
+            // Значение в диапазоне типа (PROVEN_FITS) не проверяется
+            if ((in.type2 != in.type) && !(in.proven & PROVEN_FITS)) {
+                DATA_TYPE to = static_cast<DATA_TYPE>(in.type);
+                std::string warning = options.debug
+                    ? "tayat_diag(" + std::to_string(DIAG_WARNING) + ", " + CString(ConversionMessage(static_cast<DATA_TYPE>(in.type2), to,
+                        "присваивании", tree.Info(in.a).id + " = ...")) + ", \"\", " + pos + ");"
+                    : "";
+                if (to != TYPE_LONG_LONG_INT) {
+                    const char* range = (to == TYPE_SHORT_INT) ? "INT16" : "INT32";
+                    const char* name = (to == TYPE_SHORT_INT) ? "short" : (to == TYPE_INT) ? "int" : "long";
+                    out << "    if ((" << top << " < " << range << "_MIN) || (" << top << " > " << range << "_MAX)) tayat_truncated("
+                        << top << ", \"" << name << "\", " << pos << ");\n";
+                    if (!warning.empty()) {
+                        out << "    else " << warning << "\n";
+                    }
+                }
+                else if (!warning.empty()) {
+                    out << "    " << warning << "\n";
+                }
+            }
+            out << "    v" << in.a << " = (" << CType(in.type) << ")" << top << "; i" << in.a << " = 1;\n";
+            break;
+        case OP_TGET:
+            out << "    if (i" << in.a << ") { s" << d << " = v" << in.a << "; goto L" << in.b << "; }\n";
+            break;
+        case OP_TSET:
+            out << "    v" << in.a << " = " << top << "; i" << in.a << " = 1;\n";
+            break;
+        case OP_TCLR:
+            out << "    i" << in.a << " = 0;\n";
+            break;
+        case OP_LOADQ:
+            out << "    if (!i" << in.a << ") goto L" << in.b << ";\n"
+                << "    s" << d << " = v" << in.a << ";\n";
+            break;
+        case OP_DIVQ: case OP_MODQ:
+            out << "    if (" << top << " == 0) goto L" << in.b << ";\n";
+            out << "    " << second << " = (" << top << " == -1) ? "
+                << ((op == OP_DIVQ) ? "(int64_t)(0 - (uint64_t)" + second + ") : " + second + " / " + top
+                    : "0 : " + second + " % " + top) << ";\n";
+            if (in.type != TYPE_LONG_LONG_INT) {
+                out << "    " << second << " = (" << CType(in.type) << ")" << second << ";\n";
+            }
+            break;
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+            if (options.debug && in.warn) {
+                out << "    tayat_diag(" << DIAG_WARNING << ", " << CString(ConversionMessage(static_cast<DATA_TYPE>(in.type2),
+                    static_cast<DATA_TYPE>(in.type3), "арифметической операции", "")) << ", \"\", " << pos << ");\n";
+            }
+            // План замены (in.reduce) не нужен: константа -- литерал, и компилятор C сам заменяет
+            // умножение и деление на неё сдвигами и умножением
+            if ((op <= OP_MUL) && options.checked && !(in.proven & PROVEN_FITS)) {
+                // Операция в разрядности типа результата с флагом переполнения
+                static const char* const BUILTIN[3] = { "__builtin_add_overflow", "__builtin_sub_overflow", "__builtin_mul_overflow" };
+                out << "    { " << CType(in.type) << " r; if (" << BUILTIN[op - OP_ADD] << "((" << CType(in.type) << ")" << second
+                    << ", (" << CType(in.type) << ")" << top << ", &r)) TAYAT_FAIL(" << DIAG_INTERP << ", tayat_overflow(" << second
+                    << ", '" << ARITH[op - OP_ADD] << "', " << top << ", \"" << TypeName(in.type) << "\"), \"\", " << pos << ", "
+                    << nodes_here << "); " << second << " = r; }\n";
+            }
+            else if (op <= OP_MUL) {
+                out << "    " << second << " = (int64_t)((uint64_t)" << second << " " << ARITH[op - OP_ADD] << " (uint64_t)" << top << ");\n";
+            }
+            else {
+                out << "    if (" << top << " == 0) TAYAT_FAIL(" << DIAG_INTERP << ", " << CString("Деление на ноль") << ", \"\", "
+                    << pos << ", " << nodes_here << ");\n";
+                if ((op == OP_DIV) && options.checked && !(in.proven & PROVEN_FITS)) {
+                    static const char* const MIN[4] = { "INT32_MIN", "INT16_MIN", "INT32_MIN", "INT64_MIN" };
+                    out << "    if ((" << top << " == -1) && (" << second << " == " << MIN[in.type - TYPE_INT] << ")) TAYAT_FAIL("
+                        << DIAG_INTERP << ", tayat_overflow(" << second << ", '/', " << top << ", \"" << TypeName(in.type) << "\"), \"\", "
+                        << pos << ", " << nodes_here << ");\n";
+                }
+                // Операнды и результат в int32 (PROVEN_NARROW) -- деление в 32 битах
+                const std::string x = (in.proven & PROVEN_NARROW) ? "(int32_t)" + second : second;
+                const std::string y = (in.proven & PROVEN_NARROW) ? "(int32_t)" + top : top;
+                if (op == OP_DIV) {
+                    out << "    " << second << " = (" << top << " == -1) ? (int64_t)(0 - (uint64_t)" << second << ") : "
+                        << x << " / " << y << ";\n";
+                }
+                else {
+                    out << "    " << second << " = (" << top << " == -1) ? 0 : " << x << " % " << y << ";\n";
+                }
+            }
+            if ((in.type != TYPE_LONG_LONG_INT) && !(in.proven & PROVEN_FITS)) {
+                out << "    " << second << " = (" << CType(in.type) << ")" << second << ";\n";
+            }
+            break;
+        case OP_LT: case OP_LE: case OP_GT: case OP_GE: case OP_EQ: case OP_NE:
+            out << "    " << second << " = " << second << " " << CMP[op - OP_LT] << " " << top << ";\n";
+            break;
+        case OP_JMP:
+            out << "    goto L" << in.a << ";\n";
+            break;
+        case OP_JZ:
+            out << "    if (" << top << " == 0) goto L" << in.a << ";\n";
+            break;
+        case OP_LOOP:
+        case OP_NEXT:
+            if (options.maxIterations > 0) {
+                out << "    if (++tayat_iterations > UINT64_C(" << options.maxIterations << ")) TAYAT_FAIL(" << DIAG_INTERP << ", "
+                    << CString(limit_message) << ", \"\", " << pos << ", " << nodes_here << ");\n";
+            }
+            for (int64_t n = in.b; n < in.imm; n++) {
+                if (IsIntType(tree.Sem(static_cast<int>(n)).DataType)) {
+                    out << "    i" << n << " = 0;\n";
+                }
+            }
+            if (op == OP_LOOP) {
+                out << "    goto L" << in.a << ";\n";
+            }
+            break;
+        case OP_ITER:
+            if (options.maxIterations > 0) {
+                out << "    if (tayat_iterations + UINT64_C(" << in.imm << ") > UINT64_C(" << options.maxIterations
+                    << ")) goto L" << in.a << ";\n";
+            }
+            out << "    tayat_iterations += UINT64_C(" << in.imm << ");\n";
+            break;
+        case OP_RAISE: {
+            const Diagnostic& e = code.errors[in.b];
+            out << "    TAYAT_FAIL(" << e.kind << ", " << CString(e.message) << ", " << CString(e.id) << ", "
+                << e.line << ", " << e.col << ", " << nodes_here << ");\n";
+            break;
+        }
+        case OP_HALT:
+            out << "    goto tayat_end;\n";
+            break;
+        default:
+            // ENTER, EXIT, NOP: текущая область нужна только истории выполнения
+            break;
+        }
+    }
+    if (labelled[c.size()]) {
+        out << "L" << c.size() << ":\n";
+    }
+
+    // Переменные -- в порядке объявления, только объявленные до места ошибки
+    out << "tayat_end:\n"
+        << "    timespec_get(&tayat_stop, TIME_UTC);\n"
+        << "    if (tayat_mode == 2) {\n"
+        << "        printf(\"%\" PRId64 \"\\n\", (int64_t)(tayat_stop.tv_sec - tayat_start.tv_sec) * 1000000000 + (tayat_stop.tv_nsec - tayat_start.tv_nsec));\n"
+        << "    }\n"
+        << "    if (tayat_mode == 1) {\n"
+        << "        printf(\"OK\\t%d\\n\", tayat_ok);\n";
+    int root = 0;
+    std::vector<int> var_depth(nodes, 0);
+    for (int n = root + 1; n < nodes; n++) {
+        int up = tree.Up(n);
+        var_depth[n] = (up == root) ? 0 : var_depth[up] + 1;
+        const SemNode& v = tree.Sem(n);
+        if (!IsIntType(v.DataType)) continue;
+        out << "        if (tayat_nodes > " << n << ") tayat_var(" << CString(tree.Info(n).id) << ", " << v.DataType << ", "
+            << var_depth[n] << ", i" << n << ", v" << n << ");\n";
+    }
+    out << "    }\n"
+        << "    return tayat_ok ? 0 : 1;\n"
+        << "}\n";
+}
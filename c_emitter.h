@@ -0,0 +1,24 @@
+#pragma once
+#include "code_gen.h"
+#include <cstdint>
+#include <ostream>
+
+class Tree;
+
+// Параметры перевода в C
+struct CEmitOptions {
+    bool debug = false;         // Предупреждения о преобразовании типов (как ParseProgram с isDebug)
+    uint64_t maxIterations = 0; // Предел числа итераций циклов (0 -- без предела)
+    bool checked = false;       // Переполнение в арифметике -- ошибка выполнения (__builtin_*_overflow, GCC и Clang)
+};
+
+// Перевод байт-кода в самостоятельный исходный текст на C (C11, без зависимостей).
+// Переменные -- локальные int16_t/int32_t/int64_t по типу (как SemNode::Value) с признаком
+// инициализации, промежуточные значения -- int64_t, приведение к типу результата -- как
+// Tree::CastToType (вычисление в 64 битах и обрезка до разрядности). Сообщения и их порядок
+// совпадают с интерпретатором; история выполнения и отладочная трассировка не ведутся.
+// Собранная программа:
+//   без аргументов -- сообщения в stderr в том же виде, что у lab4, код возврата 1 при ошибке;
+//   --result -- результат в текстовой форме FormatRunResult (tayat.h) в stdout;
+//   --time -- время выполнения в наносекундах в stdout
+void EmitC(const Code& code, const Tree& tree, const CEmitOptions& options, std::ostream& out);
@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+
+// Арифметика с проверкой переполнения (режим Context::checkedArithmetic). Операция выполняется
+// в разрядности типа результата: int16_t -- short, int32_t -- int и long, int64_t -- longlong
+// (как SemNode::Value). GCC и Clang -- встроенные __builtin_*_overflow (флаг переполнения
+// процессора), иначе -- точное значение в 64 битах для short, int и long и сравнения для longlong
+
+// Значение умещается в T (проверка обрезки при присваивании, Tree::WarnTruncation)
+template <typename T>
+inline bool Fits(int64_t value) {
+    return (value >= std::numeric_limits<T>::min()) && (value <= std::numeric_limits<T>::max());
+}
+
+// Сложение, вычитание, умножение: true -- результат не умещается в T (тогда *r не определён)
+#if defined(__GNUC__) || defined(__clang__)
+
+template <typename T>
+inline bool AddOverflow(T a, T b, T* r) {
+    return __builtin_add_overflow(a, b, r);
+}
+
+template <typename T>
+inline bool SubOverflow(T a, T b, T* r) {
+    return __builtin_sub_overflow(a, b, r);
+}
+
+template <typename T>
+inline bool MulOverflow(T a, T b, T* r) {
+    return __builtin_mul_overflow(a, b, r);
+}
+
+#else
+
+template <typename T>
+inline bool AddOverflow(T a, T b, T* r) {
+    if (sizeof(T) < sizeof(int64_t)) {
+        const int64_t w = static_cast<int64_t>(a) + b;
+        *r = static_cast<T>(w);
+        return !Fits<T>(w);
+    }
+    *r = static_cast<T>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+    return ((a < 0) == (b < 0)) && ((*r < 0) != (a < 0));
+}
+
+template <typename T>
+inline bool SubOverflow(T a, T b, T* r) {
+    if (sizeof(T) < sizeof(int64_t)) {
+        const int64_t w = static_cast<int64_t>(a) - b;
+        *r = static_cast<T>(w);
+        return !Fits<T>(w);
+    }
+    *r = static_cast<T>(static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+    return ((a < 0) != (b < 0)) && ((*r < 0) != (a < 0));
+}
+
+template <typename T>
+inline bool MulOverflow(T a, T b, T* r) {
+    if (sizeof(T) < sizeof(int64_t)) {
+        const int64_t w = static_cast<int64_t>(a) * b;
+        *r = static_cast<T>(w);
+        return !Fits<T>(w);
+    }
+    *r = static_cast<T>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+    if ((a == 0) || (b == 0)) {
+        return false;
+    }
+    if (((a == -1) && (b == std::numeric_limits<T>::min())) || ((b == -1) && (a == std::numeric_limits<T>::min()))) {
+        return true;
+    }
+    return (*r / b != a);
+}
+
+#endif
+
+// Деление: переполняется только наименьшее значение типа на -1 (остаток -- 0, без переполнения)
+template <typename T>
+inline bool DivOverflow(T a, T b) {
+    return (b == -1) && (a == std::numeric_limits<T>::min());
+}
+
+// Операция op ('+', '-', '*', '/'; остальные не переполняются) над значениями разрядности 64 - shift,
+// как Wrap в машине: 48 -- short, 32 -- int и long, 0 -- longlong. result -- результат, если
+// переполнения нет (для '/' не вычисляется)
+template <typename T>
+inline bool ArithOverflow(char op, int64_t a, int64_t b, int64_t& result) {
+    const T x = static_cast<T>(a);
+    const T y = static_cast<T>(b);
+    T r = 0;
+    bool overflow = false;
+    switch (op) {
+    case '+': overflow = AddOverflow(x, y, &r); break;
+    case '-': overflow = SubOverflow(x, y, &r); break;
+    case '*': overflow = MulOverflow(x, y, &r); break;
+    case '/': return DivOverflow(x, y);
+    default: return false;
+    }
+    result = r;
+    return overflow;
+}
+
+inline bool ArithOverflow(char op, int64_t a, int64_t b, unsigned shift, int64_t& result) {
+    switch (shift) {
+    case 48: return ArithOverflow<int16_t>(op, a, b, result);
+    case 32: return ArithOverflow<int32_t>(op, a, b, result);
+    default: return ArithOverflow<int64_t>(op, a, b, result);
+    }
+}
@@ -0,0 +1,372 @@
+#include "code_gen.h"
+#include "tree.h"
+
+#include <algorithm>
+#include <initializer_list>
+
+static const char* const OPCODE_NAMES[OP_COUNT] = {
+#define TAYAT_OPCODE_NAME(name) #name,
+    TAYAT_OPCODES(TAYAT_OPCODE_NAME)
+#undef TAYAT_OPCODE_NAME
+};
+
+static const char* const REDUCE_KIND_NAMES[] = {
+    "-", "shl", "shl-add", "shl-sub", "div-pow2", "mod-pow2", "div-magic", "mod-magic"
+};
+
+static const char* const SUPER_PATTERN_NAMES[SUPER_COUNT] = {
+    "load-const-op-store", "load-load-cmp-jz", "load-const-cmp-jz",
+    "load-load-op", "load-const-op", "const-store", "load-store"
+};
+
+const char* OpcodeName(int op) {
+    return ((op >= 0) && (op < OP_COUNT)) ? OPCODE_NAMES[op] : "?";
+}
+
+const char* SuperPatternName(int pattern) {
+    return ((pattern >= 0) && (pattern < SUPER_COUNT)) ? SUPER_PATTERN_NAMES[pattern] : "?";
+}
+
+const char* ReduceKindName(int kind) {
+    return ((kind >= REDUCE_NONE) && (kind <= REDUCE_MOD_MAGIC)) ? REDUCE_KIND_NAMES[kind] : "?";
+}
+
+int BaseOpcode(int op) {
+    if (op < OP_LC_ADD_ST) {
+        return op;
+    }
+    return (op == OP_C_ST) ? OP_CONST : OP_LOAD;
+}
+
+int32_t* JumpTarget(Instr& in) {
+    switch (in.op) {
+    case OP_JMP: case OP_JZ: case OP_LOOP: case OP_ITER: return &in.a;
+    case OP_TGET: case OP_LOADQ: case OP_DIVQ: case OP_MODQ: return &in.b;
+    default: return nullptr;
+    }
+}
+
+const int32_t* JumpTarget(const Instr& in) {
+    return JumpTarget(const_cast<Instr&>(in));
+}
+
+// 64 - разрядность типа
+static uint8_t ShiftOf(DATA_TYPE type) {
+    switch (type) {
+    case TYPE_SHORT_INT: return 48;
+    case TYPE_INT: return 32;
+    case TYPE_LONG_INT: return 32;
+    default: return 0;
+    }
+}
+
+CodeGen::CodeGen(Code& code, const Tree& tree) : code(code), tree(tree), depth(0) {
+}
+
+Instr& CodeGen::Emit(OPCODE op, int stackEffect) {
+    Instr in = {};
+    in.op = static_cast<uint8_t>(op);
+    in.a = Tree::NONE;
+    in.b = Tree::NONE;
+    code.instrs.push_back(in);
+    code.nodes.push_back(tree.Count());
+
+    depth += stackEffect;
+    code.maxStack = std::max(code.maxStack, depth);
+    return code.instrs.back();
+}
+
+void CodeGen::Const(DATA_TYPE type, int64_t value) {
+    Instr& in = Emit(OP_CONST, 1);
+    in.imm = value;
+    in.type = static_cast<uint8_t>(type);
+}
+
+void CodeGen::Load(int node, DATA_TYPE type, const Diagnostic& uninit) {
+    Instr& in = Emit(OP_LOAD, 1);
+    in.a = node;
+    in.b = static_cast<int32_t>(code.errors.size());
+    in.type = static_cast<uint8_t>(type);
+    in.line = uninit.line;
+    in.col = uninit.col;
+    code.errors.push_back(uninit);
+}
+
+void CodeGen::Store(int node, DATA_TYPE varType, DATA_TYPE exprType, int line, int col) {
+    Instr& in = Emit(OP_STORE, -1);
+    in.a = node;
+    in.type = static_cast<uint8_t>(varType);
+    in.type2 = static_cast<uint8_t>(exprType);
+    in.shift = ShiftOf(varType);
+    in.line = line;
+    in.col = col;
+}
+
+void CodeGen::Arith(char op, DATA_TYPE left, DATA_TYPE right, int line, int col) {
+    OPCODE opcode = OP_ADD;
+    switch (op) {
+    case '+': opcode = OP_ADD; break;
+    case '-': opcode = OP_SUB; break;
+    case '*': opcode = OP_MUL; break;
+    case '/': opcode = OP_DIV; break;
+    case '%': opcode = OP_MOD; break;
+    }
+    DATA_TYPE result = Tree::GetMaxType(left, right);
+    Instr& in = Emit(opcode, -1);
+    in.type = static_cast<uint8_t>(result);
+    in.type2 = static_cast<uint8_t>(left);
+    in.type3 = static_cast<uint8_t>(right);
+    in.shift = ShiftOf(result);
+    in.warn = (left != right) ? 1 : 0;
+    in.line = line;
+    in.col = col;
+}
+
+void CodeGen::Compare(const std::string& op, DATA_TYPE left, DATA_TYPE right, int line, int col) {
+    OPCODE opcode = OP_EQ;
+    if (op == "<") opcode = OP_LT;
+    else if (op == "<=") opcode = OP_LE;
+    else if (op == ">") opcode = OP_GT;
+    else if (op == ">=") opcode = OP_GE;
+    else if (op == "!=") opcode = OP_NE;
+
+    // Значения на стеке уже приведены к своим типам, а приведение к большему
+    // из типов их не меняет: сравниваются 64-битные значения
+    Instr& in = Emit(opcode, -1);
+    in.type = static_cast<uint8_t>(TYPE_INT);
+    in.type2 = static_cast<uint8_t>(left);
+    in.type3 = static_cast<uint8_t>(right);
+    in.line = line;
+    in.col = col;
+}
+
+int CodeGen::JumpIfZero() {
+    Emit(OP_JZ, -1);
+    pending.push_back(Here() - 1);
+    return Here() - 1;
+}
+
+void CodeGen::Patch(int jump) {
+    code.instrs[jump].a = Here();
+    pending.erase(std::remove(pending.begin(), pending.end(), jump), pending.end());
+}
+
+void CodeGen::Loop(int head, int first, int end, int line, int col) {
+    Instr& in = Emit(OP_LOOP, 0);
+    in.a = head;
+    in.b = first;
+    in.imm = end;
+    in.line = line;
+    in.col = col;
+}
+
+void CodeGen::Enter(int scope, int line, int col) {
+    Instr& in = Emit(OP_ENTER, 0);
+    in.a = scope;
+    in.line = line;
+    in.col = col;
+}
+
+void CodeGen::Exit(int scope, int up, int line, int col) {
+    Instr& in = Emit(OP_EXIT, 0);
+    in.a = scope;
+    in.b = up;
+    in.line = line;
+    in.col = col;
+}
+
+void CodeGen::Finish() {
+    Emit(OP_HALT, 0);
+}
+
+void CodeGen::Fail(const Diagnostic& error) {
+    Instr& in = Emit(OP_RAISE, 0);
+    in.b = static_cast<int32_t>(code.errors.size());
+    in.line = error.line;
+    in.col = error.col;
+    code.parseError = in.b;
+    code.errors.push_back(error);
+
+    // Условие цикла ложно -- интерпретатор всё равно разбирает тело и доходит до ошибки
+    int raise = Here() - 1;
+    for (int jump : pending) {
+        code.instrs[jump].a = raise;
+    }
+    pending.clear();
+}
+
+// Команды i..i+n-1 существуют и совпадают с ops (для арифметики и сравнений -- по группе)
+static bool Match(const std::vector<Instr>& instrs, size_t i, std::initializer_list<int> ops) {
+    if (i + ops.size() > instrs.size()) {
+        return false;
+    }
+    for (int op : ops) {
+        int actual = instrs[i++].op;
+        bool ok = (op == OP_ADD) ? ((actual >= OP_ADD) && (actual <= OP_MOD))
+            : (op == OP_LT) ? ((actual >= OP_LT) && (actual <= OP_NE))
+            : (actual == op);
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Голова последовательности получает код суперкоманды; остальные команды не меняются,
+// поэтому переход внутрь последовательности выполняет её обычными командами
+void Fuse(Code& code, unsigned patterns) {
+    std::vector<Instr>& c = code.instrs;
+    auto enabled = [patterns](SUPER_PATTERN p) { return (patterns & (1u << p)) != 0; };
+
+    for (size_t i = 0; i < c.size(); i++) {
+        int fused = OP_NOP;
+        SUPER_PATTERN pattern = SUPER_COUNT;
+        size_t length = 1;
+
+        if (enabled(SUPER_LOAD_CONST_OP_STORE) && Match(c, i, { OP_LOAD, OP_CONST, OP_ADD, OP_STORE })) {
+            fused = OP_LC_ADD_ST + (c[i + 2].op - OP_ADD);
+            pattern = SUPER_LOAD_CONST_OP_STORE;
+            length = 4;
+        }
+        else if (enabled(SUPER_LOAD_LOAD_CMP_JZ) && Match(c, i, { OP_LOAD, OP_LOAD, OP_LT, OP_JZ })) {
+            fused = OP_LL_LT_JZ + (c[i + 2].op - OP_LT);
+            pattern = SUPER_LOAD_LOAD_CMP_JZ;
+            length = 4;
+        }
+        else if (enabled(SUPER_LOAD_CONST_CMP_JZ) && Match(c, i, { OP_LOAD, OP_CONST, OP_LT, OP_JZ })) {
+            fused = OP_LC_LT_JZ + (c[i + 2].op - OP_LT);
+            pattern = SUPER_LOAD_CONST_CMP_JZ;
+            length = 4;
+        }
+        else if (enabled(SUPER_LOAD_LOAD_OP) && Match(c, i, { OP_LOAD, OP_LOAD, OP_ADD })) {
+            fused = OP_LL_ADD + (c[i + 2].op - OP_ADD);
+            pattern = SUPER_LOAD_LOAD_OP;
+            length = 3;
+        }
+        else if (enabled(SUPER_LOAD_CONST_OP) && Match(c, i, { OP_LOAD, OP_CONST, OP_ADD })) {
+            fused = OP_LC_ADD + (c[i + 2].op - OP_ADD);
+            pattern = SUPER_LOAD_CONST_OP;
+            length = 3;
+        }
+        else if (enabled(SUPER_CONST_STORE) && Match(c, i, { OP_CONST, OP_STORE })) {
+            fused = OP_C_ST;
+            pattern = SUPER_CONST_STORE;
+            length = 2;
+        }
+        else if (enabled(SUPER_LOAD_STORE) && Match(c, i, { OP_LOAD, OP_STORE })) {
+            fused = OP_L_ST;
+            pattern = SUPER_LOAD_STORE;
+            length = 2;
+        }
+
+        if (pattern != SUPER_COUNT) {
+            c[i].op = static_cast<uint8_t>(fused);
+            code.fused[pattern]++;
+            i += length - 1;
+        }
+    }
+}
+
+static const char* TypeName(int type) {
+    switch (type) {
+    case TYPE_SHORT_INT: return "short";
+    case TYPE_INT: return "int";
+    case TYPE_LONG_INT: return "long";
+    case TYPE_LONG_LONG_INT: return "longlong";
+    default: return "-";
+    }
+}
+
+void Disassemble(const Code& code, const Tree& tree, std::ostream& out) {
+    auto name = [&tree](int node) -> std::string {
+        if ((node < 0) || (node >= tree.Count())) return "?";
+        const std::string& id = tree.Info(node).id;
+        return id.empty() ? "{" + std::to_string(node) + "}" : id;
+    };
+
+    for (size_t i = 0; i < code.instrs.size(); i++) {
+        const Instr& in = code.instrs[i];
+        out << i << ": " << OpcodeName(in.op);
+
+        // Операнды суперкоманды -- операнды её головы (LOAD или CONST)
+        switch (BaseOpcode(in.op)) {
+        case OP_CONST:
+            out << " " << in.imm << " (" << TypeName(in.type) << ")";
+            break;
+        case OP_LOAD:
+            out << " " << name(in.a) << " (" << TypeName(in.type) << ")";
+            break;
+        case OP_STORE:
+            out << " " << name(in.a) << " (" << TypeName(in.type2) << " -> " << TypeName(in.type) << ")";
+            break;
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+            out << " " << TypeName(in.type2) << ", " << TypeName(in.type3) << " -> " << TypeName(in.type);
+            if (in.reduce != REDUCE_NONE) {
+                out << " [" << ReduceKindName(in.reduce);
+                if ((in.reduce == REDUCE_DIV_MAGIC) || (in.reduce == REDUCE_MOD_MAGIC)) {
+                    out << " " << in.imm << (((in.b & REDUCE_ADD) != 0) ? " +x" : "");
+                }
+                out << " " << in.a << (((in.b & REDUCE_NEG) != 0) ? " neg" : "") << "]";
+            }
+            break;
+        case OP_JMP:
+        case OP_JZ:
+            out << " " << in.a;
+            break;
+        case OP_LOOP:
+            out << " " << in.a;
+            if (in.imm > in.b) {
+                out << " (сброс " << in.b << ".." << (in.imm - 1) << ")";
+            }
+            break;
+        case OP_NEXT:
+            if (in.imm > in.b) {
+                out << " (сброс " << in.b << ".." << (in.imm - 1) << ")";
+            }
+            break;
+        case OP_ITER:
+            out << " " << in.imm << " " << in.a;
+            break;
+        case OP_ENTER:
+        case OP_EXIT:
+            out << " " << name(in.a);
+            break;
+        case OP_RAISE:
+            out << " " << code.errors[in.b].message;
+            break;
+        case OP_TGET:
+            out << " t" << (in.a - code.tempBase) << " " << in.b;
+            break;
+        case OP_TSET:
+            out << " t" << (in.a - code.tempBase);
+            break;
+        case OP_TCLR:
+            // Ячейка вынесенного значения или переменная (после вычисленного цикла)
+            if (in.a < code.tempBase) {
+                out << " " << name(in.a);
+            }
+            else {
+                out << " t" << (in.a - code.tempBase);
+            }
+            break;
+        case OP_LOADQ:
+            out << " " << name(in.a) << " (" << TypeName(in.type) << ") " << in.b << " (снять " << in.imm << ")";
+            break;
+        case OP_DIVQ:
+        case OP_MODQ:
+            out << " " << TypeName(in.type2) << ", " << TypeName(in.type3) << " -> " << TypeName(in.type)
+                << " " << in.b << " (снять " << in.imm << ")";
+            break;
+        default:
+            break;
+        }
+        // Свойства, доказанные при трансляции (OPT_RANGE, OPT_INIT)
+        if (in.proven & PROVEN_FITS) out << " [в диапазоне]";
+        if (in.proven & PROVEN_NARROW) out << " [32 бита]";
+        if (in.proven & PROVEN_INIT) out << " [инициализирована]";
+        if (in.line > 0) {
+            out << "  ; " << in.line << ":" << in.col;
+        }
+        out << "\n";
+    }
+}
@@ -0,0 +1,203 @@
+#pragma once
+#include "data_type.h"
+#include "diagnostic.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Tree;
+
+// Команды байт-кода. Машина стековая: операнды выражений лежат на стеке значений
+// (int64, значение уже приведено к своему типу), переменные -- в ячейках с номерами
+// узлов семантического дерева. Типы всех выражений известны при разборе, поэтому
+// команды не проверяют и не приводят типы во время выполнения (кроме присваивания
+// значения другого типа). Список задан X-макросом: по нему строятся перечисление,
+// имена команд и таблица обработчиков виртуальной машины
+#define TAYAT_OPCODES(X) \
+    X(NOP)         /* ничего */ \
+    X(CONST)       /* push imm */ \
+    X(LOAD)        /* push ячейка a; не инициализирована -- ошибка errors[b] */ \
+    X(STORE)       /* ячейка a = pop; тип значения type2, переменной type */ \
+    X(ADD) X(SUB) X(MUL) X(DIV) X(MOD) /* арифметика в типе type (операнды type2, type3) */ \
+    X(LT) X(LE) X(GT) X(GE) X(EQ) X(NE) /* сравнение, результат int 0 / 1 */ \
+    X(JMP)         /* переход на a */ \
+    X(JZ)          /* pop; ноль -- переход на a */ \
+    X(LOOP)        /* конец тела цикла: учёт итерации, сброс ячеек [b, imm), переход на a */ \
+    X(ENTER)       /* вход в область a */ \
+    X(EXIT)        /* выход из области a во внешнюю область b */ \
+    X(RAISE)       /* ошибка errors[b], найденная при разборе */ \
+    X(HALT)        /* конец программы */ \
+    /* Вынесенные из циклов выражения (optimizer.h): ячейки a -- после ячеек узлов */ \
+    X(TGET)        /* ячейка a вычислена -- push её и переход на b, иначе следующая команда */ \
+    X(TSET)        /* ячейка a = pop, вычислена */ \
+    X(TCLR)        /* ячейка a не вычислена (не инициализирована) */ \
+    X(LOADQ)       /* как LOAD, но ячейка не инициализирована -- снять imm значений и перейти на b */ \
+    X(DIVQ) X(MODQ) /* как DIV, MOD, но деление на ноль -- снять imm значений и перейти на b */ \
+    /* Развёрнутые и вычисленные при трансляции циклы (optimizer.h) */ \
+    X(NEXT)        /* конец копии тела развёрнутого цикла: учёт итерации, сброс ячеек [b, imm) */ \
+    X(ITER)        /* учёт imm итераций вычисленного цикла; предел будет превышен -- переход на a */ \
+    /* Суперкоманды: голова последовательности выполняет её целиком, */ \
+    /* операнды берутся из следующих (неизменённых) команд */ \
+    X(LC_ADD_ST) X(LC_SUB_ST) X(LC_MUL_ST) X(LC_DIV_ST) X(LC_MOD_ST) /* LOAD CONST op STORE */ \
+    X(LL_LT_JZ) X(LL_LE_JZ) X(LL_GT_JZ) X(LL_GE_JZ) X(LL_EQ_JZ) X(LL_NE_JZ) /* LOAD LOAD cmp JZ */ \
+    X(LC_LT_JZ) X(LC_LE_JZ) X(LC_GT_JZ) X(LC_GE_JZ) X(LC_EQ_JZ) X(LC_NE_JZ) /* LOAD CONST cmp JZ */ \
+    X(LL_ADD) X(LL_SUB) X(LL_MUL) X(LL_DIV) X(LL_MOD) /* LOAD LOAD op */ \
+    X(LC_ADD) X(LC_SUB) X(LC_MUL) X(LC_DIV) X(LC_MOD) /* LOAD CONST op */ \
+    X(C_ST)        /* CONST STORE */ \
+    X(L_ST)        /* LOAD STORE */
+
+enum OPCODE {
+#define TAYAT_OPCODE_ENUM(name) OP_##name,
+    TAYAT_OPCODES(TAYAT_OPCODE_ENUM)
+#undef TAYAT_OPCODE_ENUM
+    OP_COUNT
+};
+
+// Шаблоны суперкоманд (номер бита в маске Context::superinstructions)
+enum SUPER_PATTERN {
+    SUPER_LOAD_CONST_OP_STORE, // x = y op c
+    SUPER_LOAD_LOAD_CMP_JZ,    // while (x cmp y)
+    SUPER_LOAD_CONST_CMP_JZ,   // while (x cmp c)
+    SUPER_LOAD_LOAD_OP,        // x op y
+    SUPER_LOAD_CONST_OP,       // x op c
+    SUPER_CONST_STORE,         // x = c
+    SUPER_LOAD_STORE,          // x = y
+    SUPER_COUNT
+};
+
+constexpr unsigned SUPER_ALL = (1u << SUPER_COUNT) - 1;
+
+const char* OpcodeName(int op);
+const char* SuperPatternName(int pattern);
+
+// Обычная команда, которую заменяет голова суперкоманды (LOAD или CONST); для обычной -- она сама
+int BaseOpcode(int op);
+
+struct Instr;
+
+// Поле с адресом перехода команды (до подстановки суперкоманд); nullptr -- команда не переходит
+int32_t* JumpTarget(Instr& in);
+const int32_t* JumpTarget(const Instr& in);
+
+// Замена умножения, деления и остатка на константу c (правый операнд, команда CONST
+// прямо перед операцией) сдвигами и умножением (optimizer.h, OPT_STRENGTH).
+// Константа по-прежнему на стеке: результат тот же, что у обычной операции
+enum REDUCE_KIND {
+    REDUCE_NONE,
+    REDUCE_SHL,       // x * c: |c| = 2^a, x << a
+    REDUCE_SHL_ADD,   // x * c: |c| = 2^a + 1, (x << a) + x
+    REDUCE_SHL_SUB,   // x * c: |c| = 2^a - 1, (x << a) - x
+    REDUCE_DIV_POW2,  // x / c: |c| = 2^a, (x + смещение отрицательного x) >> a
+    REDUCE_MOD_POW2,  // x % c: |c| = 2^a, x - ((x + смещение) & -2^a)
+    REDUCE_DIV_MAGIC, // x / c: старшая половина x * imm, сдвиг на a, плюс 1 для отрицательного x
+    REDUCE_MOD_MAGIC  // x % c: x - (x / c) * c, частное -- как REDUCE_DIV_MAGIC
+};
+
+// Флаги плана замены (поле b)
+enum REDUCE_FLAG {
+    REDUCE_NEG = 1, // c < 0: результат по |c| меняет знак (частное, произведение)
+    REDUCE_ADD = 2  // Магическое число не меньше 2^(W-1): к старшей половине прибавляется x
+};
+
+const char* ReduceKindName(int kind);
+
+// Свойства команды, доказанные при трансляции (поле proven, optimizer.h: OPT_RANGE, OPT_INIT)
+enum PROVEN_FLAG {
+    PROVEN_FITS = 1,   // Результат операции / присваиваемое значение заведомо в диапазоне типа:
+                       // без проверки обрезки (STORE), приведения и проверки переполнения (арифметика)
+    PROVEN_NARROW = 2, // DIV, MOD: операнды и результат умещаются в int32 -- деление в 32 битах
+    PROVEN_INIT = 4    // LOAD: переменная инициализирована на всех путях -- без проверки значения
+};
+
+// Команда (40 байт)
+struct Instr {
+    const void* handler; // Адрес обработчика (шитый код; заполняет виртуальная машина)
+    int64_t imm;         // Константа (CONST) / конец сбрасываемых ячеек (LOOP, NEXT) / число снимаемых значений (LOADQ, DIVQ, MODQ) / число итераций (ITER) / магическое число (reduce)
+    int32_t a;           // Узел / адрес перехода / область / сдвиг (reduce)
+    int32_t b;           // Номер сообщения в errors / внешняя область / начало сбрасываемых ячеек / адрес перехода (TGET, LOADQ, DIVQ, MODQ) / REDUCE_FLAG
+    int32_t line;        // Позиция для предупреждений, ошибок и истории выполнения
+    int32_t col;
+    uint8_t op;          // OPCODE
+    uint8_t type;        // DATA_TYPE результата / переменной
+    uint8_t type2;       // DATA_TYPE левого операнда / присваиваемого значения
+    uint8_t type3;       // DATA_TYPE правого операнда
+    uint8_t shift;       // 64 - разрядность type: приведение к типу -- сдвиг влево и арифметический вправо
+    uint8_t warn;        // Операнды разных типов: предупреждение в debug режиме
+    uint8_t reduce;      // REDUCE_KIND для MUL, DIV, MOD (разрядность W: 32 при shift >= 32, иначе 64)
+    uint8_t proven;      // PROVEN_FLAG: STORE и арифметика (OPT_RANGE), LOAD (OPT_INIT)
+};
+
+// Байт-код программы
+struct Code {
+    std::vector<Instr> instrs;
+    std::vector<Diagnostic> errors; // Сообщения LOAD (неинициализированное значение) и RAISE
+    int parseError = -1;            // Ошибка разбора в errors (RAISE вместо продолжения программы), -1 -- нет
+    std::vector<int> nodes;         // Число узлов дерева при порождении каждой команды
+    int maxStack = 0;               // Наибольшая глубина стека значений
+    int fused[SUPER_COUNT] = {};    // Сколько последовательностей заменено суперкомандами
+    int tempBase = 0;               // Первая ячейка вынесенных значений (после ячеек узлов дерева)
+    int temps = 0;                  // Число ячеек вынесенных значений
+    int hoisted = 0;                // Вынесено из циклов выражений (OPT_LICM)
+    int hoistedOps = 0;             // Арифметических операций и сравнений в них
+    int reduced = 0;                // Операций с константой, заменённых сдвигами и умножением (OPT_STRENGTH)
+    int evaluated = 0;              // Циклов, вычисленных при трансляции (OPT_EVAL)
+    int unrolled = 0;               // Развёрнутых циклов (OPT_UNROLL)
+    int propagated = 0;             // Чтений переменных, заменённых константой или другой переменной (OPT_COPY)
+    int folded = 0;                 // Операций и переходов, вычисленных при трансляции (OPT_COPY)
+    int unreachable = 0;            // Удалено недостижимых команд (OPT_UNREACHABLE)
+    int deadStores = 0;             // Удалено затираемых присваиваний (OPT_DSE)
+    int fitStores = 0;              // Присваиваний без проверки обрезки (OPT_RANGE)
+    int fitOps = 0;                 // Операций с результатом в диапазоне типа (OPT_RANGE)
+    int narrowDivs = 0;             // Делений и остатков в 32 битах (OPT_RANGE)
+    int initLoads = 0;              // Чтений переменных без проверки значения (OPT_INIT)
+    std::vector<int> uninitLoads;   // Чтения, до которых значение не доходит ни по одному пути (OPT_INIT)
+};
+
+// Порождение байт-кода. Вызывается из Diagram в режиме проверки в тех же точках,
+// где интерпретатор по дереву вычисляет значения, с теми же позициями и лексемами,
+// поэтому предупреждения и ошибки выполнения совпадают с интерпретатором по дереву.
+// Ошибка разбора не прерывает порождение: на её месте ставится RAISE, и уже
+// порождённая часть программы выполняется до неё, как при интерпретации
+class CodeGen {
+public:
+    CodeGen(Code& code, const Tree& tree);
+
+    // Адрес следующей команды
+    int Here() const { return static_cast<int>(code.instrs.size()); }
+
+    void Const(DATA_TYPE type, int64_t value);
+    void Load(int node, DATA_TYPE type, const Diagnostic& uninit);
+    void Store(int node, DATA_TYPE varType, DATA_TYPE exprType, int line, int col);
+    void Arith(char op, DATA_TYPE left, DATA_TYPE right, int line, int col);
+    void Compare(const std::string& op, DATA_TYPE left, DATA_TYPE right, int line, int col);
+
+    // Условный переход вперёд; адрес задаёт Patch
+    int JumpIfZero();
+    void Patch(int jump);
+
+    // Конец тела цикла с началом head; ячейки [first, end) -- имена, объявленные в теле
+    void Loop(int head, int first, int end, int line, int col);
+
+    void Enter(int scope, int line, int col);
+    void Exit(int scope, int up, int line, int col);
+
+    // Конец программы
+    void Finish();
+    // Ошибка разбора: RAISE, на него же -- все незаполненные переходы
+    void Fail(const Diagnostic& error);
+
+private:
+    Code& code;
+    const Tree& tree;
+    int depth;                // Глубина стека значений в текущей точке
+    std::vector<int> pending; // Переходы без адреса
+
+    Instr& Emit(OPCODE op, int stackEffect);
+};
+
+// Заменить последовательности команд суперкомандами (patterns -- маска SUPER_PATTERN)
+void Fuse(Code& code, unsigned patterns = SUPER_ALL);
+
+// Текстовый листинг байт-кода (имена переменных и областей берутся из дерева)
+void Disassemble(const Code& code, const Tree& tree, std::ostream& out);
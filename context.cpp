@@ -0,0 +1,43 @@
+#include "context.h"
+#include "optimizer.h"
+
+#include <iostream>
+
+Context::Context() : Root(Tree::NONE), Cur(Tree::NONE), currentArea(Tree::NONE),
+    interpretationEnabled(true), // По умолчанию включена
+    debug(true), // По умолчанию включен подробный вывод
+    checkOnly(false), declarationsOnly(false), warnUninit(false), checkedArithmetic(false), arithmetic(Tree::ArithmeticFor(false)),
+    out(&std::cout), err(&std::cerr), printFormat(PRINT_TEXT),
+    traceOut(nullptr), traceFormat(TRACE_TEXT), traceAsync(false),
+    ringOnError(true), profiler(nullptr),
+    engine(ENGINE_TREE), superinstructions(~0u), optimizations(0), unrollFactor(UNROLL_DEFAULT), maxIterations(0), iterations(0), jitThreshold(0)
+{
+}
+
+int Context::CreateRoot() {
+    if (Root == Tree::NONE) {
+        Root = tree.AddNode(Tree::NONE, "<глобальная область видимости>", TYPE_SCOPE, 0, 0);
+    }
+    Cur = Root;
+    return Root;
+}
+
+bool Context::RunsBytecode(bool isInterp) const {
+    // Профилировщик считает операции по ходу разбора, поэтому с ним (и при выполнении
+    // только объявлений) программа выполняется интерпретатором по дереву
+    return isInterp && (engine == ENGINE_VM) && !profiler && !declarationsOnly;
+}
+
+void Context::Warn(const std::string& msg, int line, int col) {
+    Diagnostic d = { DIAG_WARNING, msg, "", line, col };
+    warnings.push_back(d);
+    if (err) {
+        // Трассировка до предупреждения должна попасть в вывод раньше него
+        trace.Flush();
+        *err << FormatDiagnostic(d);
+    }
+}
+
+void Context::DumpRecent(std::ostream& to) const {
+    ring.Dump(tree, to);
+}
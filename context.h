@@ -0,0 +1,75 @@
+#pragma once
+#include "sem_node.h"
+#include "diagnostic.h"
+#include "tree.h"
+#include "trace_sink.h"
+#include "exec_ring.h"
+#include "profiler.h"
+#include "exec_engine.h"
+#include <cstdint>
+#include <stack>
+#include <vector>
+#include <ostream>
+
+// Контекст интерпретатора: всё состояние одного разбора/выполнения программы.
+// Разные экземпляры независимы, поэтому несколько программ можно выполнять
+// в одном процессе (в том числе параллельно, по одному контексту на поток)
+class Context {
+public:
+    Tree tree;       // Семантическое дерево
+    int Root;        // Корень семантического дерева (глобальная область)
+    int Cur;         // Текущая область
+    int currentArea; // Текущая область для отладочного вывода
+
+    bool interpretationEnabled; // Флаг интерпретации
+    bool debug;                 // Флаг для подробного вывода
+    bool checkOnly;             // Только проверка: синтаксис и типы, без вычисления значений и присваиваний
+    bool declarationsOnly;      // Выполнять только объявления верхнего уровня: тело main проверяется без выполнения
+    bool warnUninit;            // Предупреждать о чтениях без значения на всех путях (по байт-коду выполнения)
+    bool checkedArithmetic;     // Переполнение в арифметике -- ошибка выполнения (иначе -- с переносом)
+    Tree::ArithmeticFn arithmetic; // Экземпляр арифметики по checkedArithmetic (выбирается в начале ParseProgram)
+
+    std::ostream* out; // Поток для вывода дерева и отладочной информации (по умолчанию std::cout, nullptr -- не выводить)
+    std::ostream* err; // Поток для предупреждений (по умолчанию std::cerr, nullptr -- не выводить)
+
+    PRINT_FORMAT printFormat; // Формат печати дерева (режим без интерпретации)
+
+    std::ostream* traceOut;   // Поток для отладочной трассировки (nullptr -- out)
+    TRACE_FORMAT traceFormat; // Формат отладочной трассировки (по умолчанию текст)
+    bool traceAsync;          // Писать трассировку в фоновом потоке
+    TraceSink trace;          // Буфер трассировки (открыт на время ParseProgram)
+
+    ExecRing ring;     // Последние выполненные операции (всегда включён)
+    bool ringOnError;  // Выводить ring в err при ошибке выполнения
+
+    Profiler* profiler; // Профилировщик по строкам (nullptr -- выключен)
+
+    EXEC_ENGINE engine;         // Исполнитель (ENGINE_VM при включённом профилировщике не используется)
+    unsigned superinstructions; // Разрешённые суперкоманды байт-кода (маска SUPER_PATTERN)
+    unsigned optimizations;     // Оптимизации байт-кода (маска OPT_PASS, optimizer.h)
+    int unrollFactor;           // Кратность развёртывания циклов (OPT_UNROLL)
+    uint64_t maxIterations;     // Предел числа итераций циклов (0 -- без предела)
+    uint64_t iterations;        // Выполнено итераций циклов
+    uint64_t jitThreshold;      // Итераций цикла до трансляции в машинный код (ENGINE_VM; 0 -- выключена)
+
+    std::vector<Diagnostic> warnings; // Предупреждения, выданные во время разбора/интерпретации
+
+    std::stack<SemNode> eval_stack; // Стек для вычисления выражений
+
+    Context();
+
+    Context(const Context&) = delete;
+    Context& operator=(const Context&) = delete;
+
+    // Создать корень семантического дерева, если его ещё нет, и сделать его текущей областью
+    int CreateRoot();
+
+    // Выполняется ли программа байт-кодом (Diagram::ParseProgram с isInterp), а не интерпретатором по дереву
+    bool RunsBytecode(bool isInterp) const;
+
+    // Выдать предупреждение: сохранить его и вывести в err
+    void Warn(const std::string& msg, int line, int col);
+
+    // Вывести последние выполненные операции
+    void DumpRecent(std::ostream& to) const;
+};
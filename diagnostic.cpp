@@ -0,0 +1,20 @@
+#include "diagnostic.h"
+
+#include <sstream>
+
+std::string FormatDiagnostic(const Diagnostic& d) {
+    std::ostringstream oss;
+    switch (d.kind) {
+    case DIAG_LEXICAL: oss << "Лексическая ошибка: "; break;
+    case DIAG_SYNTAX: oss << "Синтаксическая ошибка: "; break;
+    case DIAG_SEMANTIC: oss << "Семантическая ошибка: "; break;
+    case DIAG_INTERP: oss << "Ошибка при интерпретации: "; break;
+    case DIAG_WARNING: oss << "Предупреждение: "; break;
+    }
+    oss << d.message;
+    if (!d.id.empty()) {
+        oss << " (около '" << d.id << "')";
+    }
+    oss << std::endl << "(строка " << d.line << ":" << d.col << ")" << std::endl;
+    return oss.str();
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+
+// Вид диагностического сообщения
+enum DIAG_KIND {
+	DIAG_LEXICAL = 1, // Лексическая ошибка
+	DIAG_SYNTAX, // Синтаксическая ошибка
+	DIAG_SEMANTIC, // Семантическая ошибка
+	DIAG_INTERP, // Ошибка при интерпретации
+	DIAG_WARNING // Предупреждение
+};
+
+// Диагностическое сообщение о программе
+struct Diagnostic {
+	DIAG_KIND kind; // Вид сообщения
+	std::string message; // Текст сообщения
+	std::string id; // Лексема/идентификатор, около которого обнаружена ошибка (может быть пустым)
+	int line; // Строка
+	int col; // Позиция в строке
+};
+
+// Текст сообщения в том виде, в котором он выводится пользователю
+std::string FormatDiagnostic(const Diagnostic& d);
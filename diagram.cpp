@@ -1,26 +1,22 @@
 #include "diagram.h"
 #include "tree.h"
+#include "optimizer.h"
+#include "program_error.h"
+#include "vm.h"
 
-#include <iostream>
-
-Diagram::Diagram(Scanner* scanner) : sc(scanner), cur_tok(0), cur_lex(), current_decl_type(TYPE_UNDEFINED), current_arr_elem_count(0) {
+Diagram::Diagram(Scanner* scanner, Context* context) : sc(scanner), ctx(context), cur_tok(0), cur_lex(), current_type(0), gen(nullptr) {
     push_tok.clear();
     push_lex.clear();
 }
 
 void Diagram::synError(const std::string& msg) {
     std::pair<int, int> lc = sc->getLineCol();
-    std::cerr << "Синтаксическая ошибка: " << msg;
-    if (!cur_lex.empty()) std::cerr << " (около '" << cur_lex << "')";
-    std::cerr << std::endl << "(строка " << lc.first << ":" << lc.second << ")" << std::endl;
-    std::exit(1);
+    throw ProgramError({ DIAG_SYNTAX, msg, cur_lex, lc.first, lc.second });
 }
 
 void Diagram::lexError() {
     std::pair<int, int> lc = sc->getLineCol();
-    std::cerr << "Лексическая ошибка: неизвестная лексема '" << cur_lex << "'";
-    std::cerr << std::endl << "(строка " << lc.first << ":" << lc.second << ")" << std::endl;
-    std::exit(1);
+    throw ProgramError({ DIAG_LEXICAL, "неизвестная лексема '" + cur_lex + "'", "", lc.first, lc.second });
 }
 
 void Diagram::semError(const std::string& msg) {
@@ -68,17 +64,40 @@ void Diagram::pushBack(int tok, const std::string& lex) {
     push_lex.push_back(lex);
 }
 
+Diagram::ParseState Diagram::saveState() const {
+    return { sc->getPos(), push_tok, push_lex, cur_tok, cur_lex };
+}
+
+void Diagram::restoreState(const ParseState& state) {
+    sc->setPos(state.pos);
+    push_tok = state.push_tok;
+    push_lex = state.push_lex;
+    cur_tok = state.cur_tok;
+    cur_lex = state.cur_lex;
+}
+
+// Значение условия отлично от нуля
+static bool IsTrue(const SemNode& value) {
+    return WidenValue(value) != 0;
+}
+
+// Сообщение об использовании переменной или элемента массива без значения
+static std::string UninitMessage(const std::string& name, bool isElement) {
+    return isElement ? "Использование неинициализированного элемента массива '" + name + "'"
+        : "Использование неинициализированной переменной/именованной константы '" + name + "'";
+}
+
 // Вспомогательные методы для интерпретации
 void Diagram::pushValue(const SemNode& node) {
-    eval_stack.push(node);
+    ctx->eval_stack.push(node);
 }
 
 SemNode Diagram::popValue() {
-    if (eval_stack.empty()) {
+    if (ctx->eval_stack.empty()) {
         semError("Внутренняя ошибка: стек вычислений пуст");
     }
-    SemNode node = eval_stack.top();
-    eval_stack.pop();
+    SemNode node = ctx->eval_stack.top();
+    ctx->eval_stack.pop();
     return node;
 }
 
@@ -125,8 +144,8 @@ SemNode Diagram::evaluateConstant(const std::string& value, DATA_TYPE type) {
 
 void Diagram::executeAssignment(const std::string& varName, DATA_TYPE exprType, int line, int col) {
     SemNode value = popValue();
-    Tree* varNode = Tree::Cur->SemGetVar(varName, line, col);
-    DATA_TYPE varType = varNode->n->DataType;
+    int varNode = ctx->tree.SemGetVar(ctx->Cur, varName, line, col);
+    DATA_TYPE varType = ctx->tree.Sem(varNode).DataType;
 
     bool varIsInt = (varType == TYPE_INT || varType == TYPE_SHORT_INT || varType == TYPE_LONG_INT || varType == TYPE_LONG_LONG_INT);
     bool exprIsInt = (exprType == TYPE_INT || exprType == TYPE_SHORT_INT || exprType == TYPE_LONG_INT || exprType == TYPE_LONG_LONG_INT);
@@ -135,34 +154,76 @@ void Diagram::executeAssignment(const std::string& varName, DATA_TYPE exprType,
         semError("Несоответствие типов при присваивании для '" + varName + "'");
     }
 
-    Tree::SetVarValue(varName, value, line, col);
+    Tree::SetVarValue(*ctx, varName, value, line, col);
 }
 
 // Точка входа
-void Diagram::ParseProgram(bool isInterp, bool isDebug) {
+void Diagram::ParseProgram(bool isInterp, bool isDebug, const Code* compiled) {
     // Создаём корень семантического дерева (область верхнего уровня)
-    SemNode* root_node = new SemNode();
-    root_node->id = "<глобальная область видимости>";
-    root_node->DataType = TYPE_SCOPE;
-    root_node->line = 0;
-    root_node->col = 0;
-    Tree* root_tree = new Tree(root_node, nullptr);
-    Tree::SetCur(root_tree);
+    int root_tree = ctx->CreateRoot();
+
+    ctx->interpretationEnabled = isInterp;
+    ctx->debug = isDebug;
+    // Проверка переполнения не меняется во время выполнения -- экземпляр арифметики выбирается один раз
+    ctx->arithmetic = Tree::ArithmeticFor(ctx->checkedArithmetic);
 
-    if (isInterp) {
-        Tree::EnableInterpretation();
+    // Отладочная трассировка копится в буфере и записывается блоками
+    std::ostream* trace_out = ctx->traceOut ? ctx->traceOut : ctx->out;
+    if (isInterp && isDebug && trace_out) {
+        ctx->trace.Open(trace_out, ctx->traceFormat, ctx->traceAsync);
     }
-    else {
-        Tree::DisableInterpretation();
+
+    if (isInterp && ctx->profiler) {
+        ctx->profiler->Start();
     }
 
-    if (isDebug) {
-        Tree::EnableDebug();
+    try {
+        if (ctx->RunsBytecode(isInterp)) {
+            Code code;
+            if (compiled) {
+                code = *compiled;
+            }
+            else {
+                CompileProgram(code);
+            }
+            // Чтения без значения на всех путях -- по тому же байт-коду, до выполнения
+            if (ctx->warnUninit) {
+                for (const Diagnostic& d : UninitializedReads(code, ctx->tree)) {
+                    ctx->Warn(d.message, d.line, d.col);
+                }
+            }
+            // С трассировкой печатается каждая выполненная операция -- без оптимизаций
+            if (!ctx->trace.IsOpen()) {
+                Optimize(code, ctx->tree, ctx->optimizations, ctx->debug, ctx->unrollFactor, ctx->checkedArithmetic);
+            }
+            Fuse(code, ctx->superinstructions);
+            Vm(*ctx, code).Run();
+        }
+        else {
+            ProgramToEnd();
+        }
     }
-    else {
-        Tree::DisableDebug();
+    catch (const ProgramError& e) {
+        ctx->trace.Close();
+        // История выполнения перед ошибкой выполнения (сообщение об ошибке выводит вызывающий);
+        // при лексических, синтаксических и семантических ошибках не выводится
+        if (isInterp && (e.GetDiagnostic().kind == DIAG_INTERP) && ctx->ringOnError && ctx->err && (ctx->ring.Total() > 0)) {
+            ctx->DumpRecent(*ctx->err);
+        }
+        throw;
     }
+    catch (...) {
+        ctx->trace.Close();
+        throw;
+    }
+    ctx->trace.Close();
+
+    if (!isInterp && !ctx->checkOnly && ctx->out) {
+        ctx->tree.Print(root_tree, *ctx->out, ctx->printFormat);
+    }
+}
 
+void Diagram::ProgramToEnd() {
     Program();
 
     // Проверим, что в конце файла действительно конец
@@ -170,10 +231,33 @@ void Diagram::ParseProgram(bool isInterp, bool isDebug) {
     if (t != T_END) {
         synError("Лишний текст в конце программы");
     }
+}
+
+void Diagram::CompileProgram(Code& code) {
+    ctx->CreateRoot();
+
+    bool saved_check = ctx->checkOnly;
+    bool saved_interp = ctx->interpretationEnabled;
+    int saved_area = ctx->currentArea;
+    ctx->checkOnly = true;
+    ctx->interpretationEnabled = false;
 
-    if (!isInterp) {
-        root_tree->Print();
+    CodeGen cg(code, ctx->tree);
+    gen = &cg;
+    try {
+        ProgramToEnd();
+        cg.Finish();
+    }
+    catch (const ProgramError& e) {
+        cg.Fail(e.GetDiagnostic());
     }
+    gen = nullptr;
+
+    // Выполнение начинается в глобальной области
+    ctx->checkOnly = saved_check;
+    ctx->interpretationEnabled = saved_interp;
+    ctx->Cur = ctx->Root;
+    ctx->currentArea = saved_area;
 }
 
 // Program -> TopDecl*
@@ -196,14 +280,11 @@ void Diagram::TopDecl() {
             MainFunc();
         }
         else {
-            current_decl_type = TYPE_INT;
-            current_arr_elem_count = 0;
+            current_type = ctx->tree.types.Intern(TYPE_INT, 0);
             VarDecl();
         }
     }
     else if (t == KW_TYPEDEF) {
-        current_decl_type = TYPE_TYPEDEF_NAME;
-
         nextToken();
         TypeDefinition();
     }
@@ -213,33 +294,22 @@ void Diagram::TopDecl() {
     }
     else {
         if (t == KW_SHORT) {
-            current_decl_type = TYPE_SHORT_INT;
-            current_arr_elem_count = 0;
+            current_type = ctx->tree.types.Intern(TYPE_SHORT_INT, 0);
         }
         else if (t == KW_LONG) {
-            current_decl_type = TYPE_LONG_INT;
-            current_arr_elem_count = 0;
+            current_type = ctx->tree.types.Intern(TYPE_LONG_INT, 0);
         }
         else if (t == KW_LONGLONG) {
-            current_decl_type = TYPE_LONG_LONG_INT;
-            current_arr_elem_count = 0;
+            current_type = ctx->tree.types.Intern(TYPE_LONG_LONG_INT, 0);
         }
         else {
-            Tree* saved_cur = Tree::Cur;
-            Tree::SetCur(Tree::Root);
-
             t = nextToken();
             std::string typedef_name = cur_lex;
             pushBack(t, typedef_name);
 
             std::pair<int, int> lc = sc->getLineCol();
-            
-            Tree* typedef_node = Tree::Cur->SemGetType(typedef_name, lc.first, lc.second);
 
-            current_decl_type = typedef_node->n->BasicType;
-            current_arr_elem_count = typedef_node->n->ArrElemCount;
-
-            Tree::SetCur(saved_cur);
+            current_type = ctx->tree.SemResolveType(ctx->Root, typedef_name, lc.first, lc.second);
         }
 
         nextToken();
@@ -250,7 +320,7 @@ void Diagram::TopDecl() {
 // MainFunc -> 'int' main '('')' Block
 void Diagram::MainFunc() {
     // Запомним текущую область, чтобы потом восстановить
-    Tree* saved_cur = Tree::Cur;
+    int saved_cur = ctx->Cur;
 
     int t = peekToken();
     if (t != LPAREN) {
@@ -264,13 +334,23 @@ void Diagram::MainFunc() {
     }
     nextToken();
 
-    // Тело main
+    // Тело main (только объявления -- проверяется без выполнения, глобальные значения остаются объявленными)
+    bool skip_body = ctx->declarationsOnly && !ctx->checkOnly;
+    bool saved_interp = ctx->interpretationEnabled;
+    if (skip_body) {
+        ctx->checkOnly = true;
+        ctx->interpretationEnabled = false;
+    }
     Block();
+    if (skip_body) {
+        ctx->checkOnly = false;
+        ctx->interpretationEnabled = saved_interp;
+    }
 
 
     // Восстанавливаем предыдущую область
-    Tree::SetCur(saved_cur);
-    Tree::SetCurrentArea(saved_cur);
+    ctx->Cur = saved_cur;
+    ctx->currentArea = saved_cur;
 }
 
 // VarDecl -> Type IdInitList ;
@@ -291,41 +371,29 @@ void Diagram::ConstDecl() {
     }
 
     if (t == KW_INT) {
-        current_decl_type = TYPE_INT;
-        current_arr_elem_count = 0;
+        current_type = ctx->tree.types.Intern(TYPE_INT, 0);
     }
     else if (t == KW_SHORT) {
-        current_decl_type = TYPE_SHORT_INT;
-        current_arr_elem_count = 0;
+        current_type = ctx->tree.types.Intern(TYPE_SHORT_INT, 0);
     }
     else if (t == KW_LONG) {
-        current_decl_type = TYPE_LONG_INT;
-        current_arr_elem_count = 0;
+        current_type = ctx->tree.types.Intern(TYPE_LONG_INT, 0);
     }
     else if (t == KW_LONGLONG) {
-        current_decl_type = TYPE_LONG_LONG_INT;
-        current_arr_elem_count = 0;
+        current_type = ctx->tree.types.Intern(TYPE_LONG_LONG_INT, 0);
     }
     else {
-        Tree* saved_cur = Tree::Cur;
-        Tree::SetCur(Tree::Root);
-
         t = nextToken();
         std::string typedef_name = cur_lex;
         pushBack(t, typedef_name);
 
         std::pair<int, int> lc = sc->getLineCol();
 
-        Tree* typedef_node = Tree::Cur->SemGetType(typedef_name, lc.first, lc.second);
+        current_type = ctx->tree.SemResolveType(ctx->Root, typedef_name, lc.first, lc.second);
 
-        current_decl_type = typedef_node->n->BasicType;
-        current_arr_elem_count = typedef_node->n->ArrElemCount;
-
-        if (current_arr_elem_count > 0) {
+        if (ctx->tree.types.Get(current_type).ArrElemCount > 0) {
             semError("Нельзя объявить именованную константу-массив");
         }
-
-        Tree::SetCur(saved_cur);
     }
 
     nextToken();
@@ -359,21 +427,16 @@ void Diagram::TypeDefinition() {
         basic_type = TYPE_LONG_LONG_INT;
     }
     else {
-        Tree* saved_cur = Tree::Cur;
-        Tree::SetCur(Tree::Root);
-
         t = nextToken();
         std::string typedef_name = cur_lex;
         pushBack(t, typedef_name);
 
         std::pair<int, int> lc = sc->getLineCol();
 
-        Tree* basic_typedef_node = Tree::Cur->SemGetType(typedef_name, lc.first, lc.second);
-
-        basic_type = basic_typedef_node->n->BasicType;
-        basic_typedef_arr_elem_count = basic_typedef_node->n->ArrElemCount;
+        const TypeDesc& basic_typedef = ctx->tree.types.Get(ctx->tree.SemResolveType(ctx->Root, typedef_name, lc.first, lc.second));
 
-        Tree::SetCur(saved_cur);
+        basic_type = basic_typedef.BasicType;
+        basic_typedef_arr_elem_count = basic_typedef.ArrElemCount;
     }
 
     nextToken();
@@ -422,9 +485,8 @@ void Diagram::TypeDefinition() {
     }
 
     std::pair<int, int> lc = sc->getLineCol();
-    Tree* typedef_node = Tree::Cur->SemInclude(typedef_name, TYPE_TYPEDEF_NAME, lc.first, lc.second);
-    typedef_node->SemSetBasicType(typedef_node, basic_type);
-    typedef_node->SemSetArrElemCount(typedef_node, arr_elem_count);
+    int typedef_node = ctx->tree.SemInclude(ctx->Cur, typedef_name, TYPE_TYPEDEF_NAME, lc.first, lc.second);
+    ctx->tree.SemSetType(typedef_node, ctx->tree.types.Intern(basic_type, arr_elem_count));
 
     if (t != SEMI) {
         synError("Ожидалась ';' после определения метки");
@@ -453,44 +515,50 @@ void Diagram::IdInit(bool const_flag) {
 
     std::string name = cur_lex;
     std::pair<int, int> lc = sc->getLineCol();
-    Tree* node;
+    int node;
     
-    if (current_arr_elem_count > 0) {
-        node = Tree::Cur->SemInclude(name, TYPE_ARRAY, lc.first, lc.second);
-        node->SemSetBasicType(node, current_decl_type);
-        node->SemSetArrElemCount(node, current_arr_elem_count);
+    TypeDesc type = ctx->tree.types.Get(current_type);
+
+    if (type.ArrElemCount > 0) {
+        node = ctx->tree.SemInclude(ctx->Cur, name, TYPE_ARRAY, lc.first, lc.second);
+        ctx->tree.SemSetType(node, current_type);
 
-        for (int i = 0; i < current_arr_elem_count; i++) {
-            Tree::Cur->SemInclude((name + "_" + std::to_string(i)), current_decl_type, lc.first, lc.second);
-            node->SemSetIndex(node, i);
+        for (int i = 0; i < type.ArrElemCount; i++) {
+            ctx->tree.SemInclude(ctx->Cur, (name + "_" + std::to_string(i)), type.BasicType, lc.first, lc.second);
+            ctx->tree.SemSetIndex(node, i);
         }
     }
     else {
-        node = Tree::Cur->SemInclude(name, current_decl_type, lc.first, lc.second);
+        node = ctx->tree.SemInclude(ctx->Cur, name, type.BasicType, lc.first, lc.second);
         if (const_flag) {
-            node->SemSetConst(node, const_flag);
+            ctx->tree.SemSetConst(node, const_flag);
         }
     }
 
     t = peekToken();
     if (t == ASSIGN) {
-        if (node->n->DataType == TYPE_ARRAY) {
+        if (ctx->tree.Sem(node).DataType == TYPE_ARRAY) {
             semError("Нельзя ничего присваивать массиву целиком");
         }
 
         nextToken();
         DATA_TYPE expr_type = Expr();
 
-        SemNode value = popValue();
-
-        bool node_is_int = (node->n->DataType == TYPE_INT || node->n->DataType == TYPE_SHORT_INT || node->n->DataType == TYPE_LONG_INT || node->n->DataType == TYPE_LONG_LONG_INT);
+        DATA_TYPE node_type = ctx->tree.Sem(node).DataType;
+        bool node_is_int = (node_type == TYPE_INT || node_type == TYPE_SHORT_INT || node_type == TYPE_LONG_INT || node_type == TYPE_LONG_LONG_INT);
         bool expr_is_int = (expr_type == TYPE_INT || expr_type == TYPE_SHORT_INT || expr_type == TYPE_LONG_INT || expr_type == TYPE_LONG_LONG_INT);
 
         if (!(node_is_int && expr_is_int)) {
             semError("Несоответствие типов при инициализации переменной / именованной константы '" + name + "'");
         }
 
-        Tree::SetVarValue(node->n->id, value, sc->getLineCol().first, sc->getLineCol().second);
+        if (!ctx->checkOnly) {
+            SemNode value = popValue();
+            Tree::SetVarValue(*ctx, ctx->tree.Info(node).id, value, sc->getLineCol().first, sc->getLineCol().second);
+        }
+        else if (gen) {
+            gen->Store(node, node_type, expr_type, sc->getLineCol().first, sc->getLineCol().second);
+        }
     }
     else {
         if (const_flag) {
@@ -507,8 +575,14 @@ void Diagram::Block() {
     }
 
     auto lc = sc->getLineCol();
-    Tree::Cur->SemEnterBlock(lc.first, lc.second);
-    Tree::SetCurrentArea(Tree::Cur);
+    ctx->Cur = ctx->tree.SemEnterBlock(ctx->Cur, lc.first, lc.second);
+    ctx->currentArea = ctx->Cur;
+    if (ctx->interpretationEnabled) {
+        ctx->ring.Record(RING_ENTER, ctx->Cur, lc.first, lc.second);
+    }
+    else if (gen) {
+        gen->Enter(ctx->Cur, lc.first, lc.second);
+    }
 
     t = nextToken();
     BlockItems();
@@ -517,8 +591,16 @@ void Diagram::Block() {
         synError("Ожидалась '}' для конца блока");
     }
 
-    Tree::Cur->SemExitBlock();
-    Tree::SetCurrentArea(Tree::Cur);
+    if (ctx->interpretationEnabled) {
+        lc = sc->getLineCol();
+        ctx->ring.Record(RING_EXIT, ctx->Cur, lc.first, lc.second);
+    }
+    else if (gen) {
+        lc = sc->getLineCol();
+        gen->Exit(ctx->Cur, ctx->tree.Up(ctx->Cur), lc.first, lc.second);
+    }
+    ctx->Cur = ctx->tree.SemExitBlock(ctx->Cur);
+    ctx->currentArea = ctx->Cur;
     nextToken();
 }
 
@@ -537,33 +619,21 @@ void Diagram::BlockItems() {
             }
             else {
                 if (t2 == KW_INT) {
-                    current_decl_type = TYPE_INT;
-                    current_arr_elem_count = 0;
+                    current_type = ctx->tree.types.Intern(TYPE_INT, 0);
                 }
                 else if (t2 == KW_SHORT) {
-                    current_decl_type = TYPE_SHORT_INT;
-                    current_arr_elem_count = 0;
+                    current_type = ctx->tree.types.Intern(TYPE_SHORT_INT, 0);
                 }
                 else if (t2 == KW_LONG) {
-                    current_decl_type = TYPE_LONG_INT;
-                    current_arr_elem_count = 0;
+                    current_type = ctx->tree.types.Intern(TYPE_LONG_INT, 0);
                 }
                 else if (t2 == KW_LONGLONG) {
-                    current_decl_type = TYPE_LONG_LONG_INT;
-                    current_arr_elem_count = 0;
+                    current_type = ctx->tree.types.Intern(TYPE_LONG_LONG_INT, 0);
                 }
                 else {
-                    Tree* saved_cur = Tree::Cur;
-                    Tree::SetCur(Tree::Root);
-
                     std::pair<int, int> lc = sc->getLineCol();
 
-                    Tree* typedef_node = Tree::Cur->SemGetType(type_name, lc.first, lc.second);
-
-                    current_decl_type = typedef_node->n->BasicType;
-                    current_arr_elem_count = typedef_node->n->ArrElemCount;
-
-                    Tree::SetCur(saved_cur);
+                    current_type = ctx->tree.SemResolveType(ctx->Root, type_name, lc.first, lc.second);
                 }
 
                 VarDecl();
@@ -602,16 +672,16 @@ void Diagram::Stmt() {
 
         std::string name = cur_lex;
         std::pair<int, int> lc = sc->getLineCol();
-        Tree* node = Tree::Cur->SemGetVar(name, lc.first, lc.second);
+        int node = ctx->tree.SemGetVar(ctx->Cur, name, lc.first, lc.second);
 
-        if (node->n->FlagConst) {
+        if (ctx->tree.Info(node).FlagConst) {
             semError("Именованной константе может быть присвоено значение только при её объявлении");
         }
 
         t = peekToken();
 
         if (t == LBRACKET) {
-            if (node->n->DataType != TYPE_ARRAY) {
+            if (ctx->tree.Sem(node).DataType != TYPE_ARRAY) {
                 semError("Операция индексирования ([]) применима только к идентификаторам, объявленным как массив");
             }
 
@@ -634,7 +704,7 @@ void Diagram::Stmt() {
                 semError("Индекс при обращении к массиву не может превышать диапазон типа int");
             }
 
-            if ((index < 0) || (index >= node->n->ArrElemCount)) {
+            if ((index < 0) || (index >= ctx->tree.Type(node).ArrElemCount)) {
                 semError("Индекс при обращении к массиву должен быть больше или равен 0 и меньше указанного при объявлении размера");
             }
 
@@ -649,7 +719,7 @@ void Diagram::Stmt() {
             t = peekToken();
         }
         else {
-            if (node->n->DataType == TYPE_ARRAY) {
+            if (ctx->tree.Sem(node).DataType == TYPE_ARRAY) {
                 semError("Нельзя использовать массив целиком в качестве операнда");
             }
         }
@@ -660,11 +730,13 @@ void Diagram::Stmt() {
             DATA_TYPE expr_type = Expr();
 
             bool node_is_int;
-            if (node->n->DataType == TYPE_ARRAY) {
-                node_is_int = (node->n->BasicType == TYPE_INT || node->n->BasicType == TYPE_SHORT_INT || node->n->BasicType == TYPE_LONG_INT || node->n->BasicType == TYPE_LONG_LONG_INT);
+            if (ctx->tree.Sem(node).DataType == TYPE_ARRAY) {
+                DATA_TYPE elem_type = ctx->tree.Type(node).BasicType;
+                node_is_int = (elem_type == TYPE_INT || elem_type == TYPE_SHORT_INT || elem_type == TYPE_LONG_INT || elem_type == TYPE_LONG_LONG_INT);
             }
             else {
-                node_is_int = (node->n->DataType == TYPE_INT || node->n->DataType == TYPE_SHORT_INT || node->n->DataType == TYPE_LONG_INT || node->n->DataType == TYPE_LONG_LONG_INT);
+                DATA_TYPE node_type = ctx->tree.Sem(node).DataType;
+                node_is_int = (node_type == TYPE_INT || node_type == TYPE_SHORT_INT || node_type == TYPE_LONG_INT || node_type == TYPE_LONG_LONG_INT);
             }
             bool expr_is_int = (expr_type == TYPE_INT || expr_type == TYPE_SHORT_INT || expr_type == TYPE_LONG_INT || expr_type == TYPE_LONG_LONG_INT);
 
@@ -673,7 +745,15 @@ void Diagram::Stmt() {
             }
 
             // Выполняем присваивание
-            executeAssignment(name, expr_type, sc->getLineCol().first, sc->getLineCol().second);
+            if (!ctx->checkOnly) {
+                executeAssignment(name, expr_type, sc->getLineCol().first, sc->getLineCol().second);
+            }
+            else if (gen) {
+                // Переменная -- та же, что найдёт executeAssignment (элемент массива -- по имени a_i)
+                std::pair<int, int> store_lc = sc->getLineCol();
+                int var = ctx->tree.SemGetVar(ctx->Cur, name, store_lc.first, store_lc.second);
+                gen->Store(var, ctx->tree.Sem(var).DataType, expr_type, store_lc.first, store_lc.second);
+            }
 
             t = peekToken();
             if (t != SEMI) {
@@ -691,25 +771,61 @@ void Diagram::Stmt() {
 }
 
 // WhileStmt -> while ( Expr ) Stmt
+// При интерпретации условие и тело разбираются заново на каждой итерации: позиция
+// после '(' запоминается, а имена, объявленные телом, удаляются из дерева перед
+// следующим разбором. Ложное условие -- тело разбирается ещё раз без вычисления
+// (проверки типов и имён те же, что и в режиме проверки)
 void Diagram::WhileStmt() {
+    std::pair<int, int> while_lc = sc->getLineCol();
+
     int t = peekToken();
     if (t != LPAREN) {
         synError("Ожидалась '(' после while");
     }
     nextToken();
 
-    DATA_TYPE cond = Expr();
-    bool is_cond_int = (cond == TYPE_INT || cond == TYPE_SHORT_INT || cond == TYPE_LONG_INT || cond == TYPE_LONG_LONG_INT);
-    if (!(is_cond_int)) {
-        semError("Выражение-условие должно иметь тип int / short / long / longlong");
-    }
+    ParseState start = saveState();
+    Tree::Mark mark = ctx->tree.MarkScope(ctx->Cur);
+    int head = gen ? gen->Here() : 0;
 
-    t = peekToken();
-    if (t != RPAREN) {
-        synError("Ожидалась ')' после выражения");
+    for (;;) {
+        DATA_TYPE cond = Expr();
+        bool is_cond_int = (cond == TYPE_INT || cond == TYPE_SHORT_INT || cond == TYPE_LONG_INT || cond == TYPE_LONG_LONG_INT);
+        if (!(is_cond_int)) {
+            semError("Выражение-условие должно иметь тип int / short / long / longlong");
+        }
+
+        t = peekToken();
+        if (t != RPAREN) {
+            synError("Ожидалась ')' после выражения");
+        }
+        nextToken();
+
+        if (ctx->checkOnly) {
+            int exit_jump = gen ? gen->JumpIfZero() : 0;
+            Stmt();
+            if (gen) {
+                gen->Loop(head, mark.count, ctx->tree.Count(), while_lc.first, while_lc.second);
+                gen->Patch(exit_jump);
+            }
+            return;
+        }
+
+        if (!IsTrue(popValue())) {
+            bool saved_interp = ctx->interpretationEnabled;
+            ctx->checkOnly = true;
+            ctx->interpretationEnabled = false;
+            Stmt();
+            ctx->checkOnly = false;
+            ctx->interpretationEnabled = saved_interp;
+            return;
+        }
+
+        Stmt();
+        Tree::CountIteration(*ctx, while_lc.first, while_lc.second);
+        restoreState(start);
+        ctx->tree.Rollback(mark);
     }
-    nextToken();
-    Stmt();
 }
 
 // Expr -> ['+'|'-'] Rel ( ('==' | '!=') Rel )*
@@ -744,7 +860,10 @@ DATA_TYPE Diagram::Expr() {
         if (!(left == TYPE_INT || left == TYPE_SHORT_INT || left == TYPE_LONG_INT || left == TYPE_LONG_LONG_INT)) {
             semError("Унарный '+'/'-' применим только к целым типам");
         }
+    }
 
+    // В режиме проверки тип результата унарной операции совпадает с типом операнда
+    if (has_unary && !ctx->checkOnly) {
         SemNode operand = popValue();
         SemNode result;
 
@@ -761,7 +880,7 @@ DATA_TYPE Diagram::Expr() {
             default: break;
             }
 
-            result = Tree::ExecuteArithmeticOp(operand, minusOne, "*", sc->getLineCol().first, sc->getLineCol().second);
+            result = Tree::ExecuteArithmeticOp(*ctx, operand, minusOne, "*", sc->getLineCol().first, sc->getLineCol().second);
         }
         else {
             result = operand;
@@ -770,6 +889,10 @@ DATA_TYPE Diagram::Expr() {
         pushValue(result);
         left = result.DataType;
     }
+    else if (has_unary && gen && (unary_op == "-")) {
+        gen->Const(left, -1);
+        gen->Arith('*', left, left, sc->getLineCol().first, sc->getLineCol().second);
+    }
 
     t = peekToken();
     while (t == EQ || t == NEQ) {
@@ -778,15 +901,19 @@ DATA_TYPE Diagram::Expr() {
 
         DATA_TYPE right = Rel();
 
-        SemNode right_val = popValue();
-        SemNode left_val = popValue();
-
         bool is_left_int = (left == TYPE_INT || left == TYPE_SHORT_INT || left == TYPE_LONG_INT || left == TYPE_LONG_LONG_INT);
         bool is_right_int = (right == TYPE_INT || right == TYPE_SHORT_INT || right == TYPE_LONG_INT || right == TYPE_LONG_LONG_INT);
 
         if (is_left_int && is_right_int) {
-            SemNode result = Tree::ExecuteComparisonOp(left_val, right_val, op, sc->getLineCol().first, sc->getLineCol().second);
-            pushValue(result);
+            if (!ctx->checkOnly) {
+                SemNode right_val = popValue();
+                SemNode left_val = popValue();
+                SemNode result = Tree::ExecuteComparisonOp(*ctx, left_val, right_val, op, sc->getLineCol().first, sc->getLineCol().second);
+                pushValue(result);
+            }
+            else if (gen) {
+                gen->Compare(op, left, right, sc->getLineCol().first, sc->getLineCol().second);
+            }
             left = TYPE_INT;
         }
         else {
@@ -815,9 +942,6 @@ DATA_TYPE Diagram::Rel() {
 
         DATA_TYPE right = Add();
 
-        SemNode right_val = popValue();
-        SemNode left_val = popValue();
-
         bool is_left_int = (left == TYPE_INT || left == TYPE_SHORT_INT || left == TYPE_LONG_INT || left == TYPE_LONG_LONG_INT);
         bool is_right_int = (right == TYPE_INT || right == TYPE_SHORT_INT || right == TYPE_LONG_INT || right == TYPE_LONG_LONG_INT);
 
@@ -825,8 +949,15 @@ DATA_TYPE Diagram::Rel() {
             semError("Операнды для '<, <=, >, >=' должны быть целыми (int / short / long / longlong)");
         }
 
-        SemNode result = Tree::ExecuteComparisonOp(left_val, right_val, op, sc->getLineCol().first, sc->getLineCol().second);
-        pushValue(result);
+        if (!ctx->checkOnly) {
+            SemNode right_val = popValue();
+            SemNode left_val = popValue();
+            SemNode result = Tree::ExecuteComparisonOp(*ctx, left_val, right_val, op, sc->getLineCol().first, sc->getLineCol().second);
+            pushValue(result);
+        }
+        else if (gen) {
+            gen->Compare(op, left, right, sc->getLineCol().first, sc->getLineCol().second);
+        }
         left = TYPE_INT;
 
         t = peekToken();
@@ -845,9 +976,6 @@ DATA_TYPE Diagram::Add() {
 
         DATA_TYPE right = Mul();
 
-        SemNode right_val = popValue();
-        SemNode left_val = popValue();
-
         bool is_left_int = (left == TYPE_INT || left == TYPE_SHORT_INT || left == TYPE_LONG_INT || left == TYPE_LONG_LONG_INT);
         bool is_right_int = (right == TYPE_INT || right == TYPE_SHORT_INT || right == TYPE_LONG_INT || right == TYPE_LONG_LONG_INT);
 
@@ -855,9 +983,19 @@ DATA_TYPE Diagram::Add() {
             semError("Операнды для '+'/'-' должны быть целыми (int / short / long / longlong)");
         }
 
-        SemNode result = Tree::ExecuteArithmeticOp(left_val, right_val, op, sc->getLineCol().first, sc->getLineCol().second);
-        pushValue(result);
-        left = result.DataType;
+        if (ctx->checkOnly) {
+            if (gen) {
+                gen->Arith(op[0], left, right, sc->getLineCol().first, sc->getLineCol().second);
+            }
+            left = Tree::GetMaxType(left, right);
+        }
+        else {
+            SemNode right_val = popValue();
+            SemNode left_val = popValue();
+            SemNode result = Tree::ExecuteArithmeticOp(*ctx, left_val, right_val, op, sc->getLineCol().first, sc->getLineCol().second);
+            pushValue(result);
+            left = result.DataType;
+        }
 
         t = peekToken();
     }
@@ -880,9 +1018,6 @@ DATA_TYPE Diagram::Mul() {
 
         DATA_TYPE right = Prim();
 
-        SemNode right_val = popValue();
-        SemNode left_val = popValue();
-
         bool is_left_int = (left == TYPE_INT || left == TYPE_SHORT_INT || left == TYPE_LONG_INT || left == TYPE_LONG_LONG_INT);
         bool is_right_int = (right == TYPE_INT || right == TYPE_SHORT_INT || right == TYPE_LONG_INT || right == TYPE_LONG_LONG_INT);
 
@@ -890,9 +1025,19 @@ DATA_TYPE Diagram::Mul() {
             semError("Операнды для '*', '/', '%' должны быть целыми (int / short / long / longlong)");
         }
 
-        SemNode result = Tree::ExecuteArithmeticOp(left_val, right_val, op, sc->getLineCol().first, sc->getLineCol().second);
-        pushValue(result);
-        left = result.DataType;
+        if (ctx->checkOnly) {
+            if (gen) {
+                gen->Arith(op[0], left, right, sc->getLineCol().first, sc->getLineCol().second);
+            }
+            left = Tree::GetMaxType(left, right);
+        }
+        else {
+            SemNode right_val = popValue();
+            SemNode left_val = popValue();
+            SemNode result = Tree::ExecuteArithmeticOp(*ctx, left_val, right_val, op, sc->getLineCol().first, sc->getLineCol().second);
+            pushValue(result);
+            left = result.DataType;
+        }
 
         t = peekToken();
     }
@@ -932,7 +1077,12 @@ DATA_TYPE Diagram::Prim() {
             }
 
             SemNode const_node = evaluateConstant("-" + cur_lex, const_type);
-            pushValue(const_node);
+            if (!ctx->checkOnly) {
+                pushValue(const_node);
+            }
+            else if (gen) {
+                gen->Const(const_type, WidenValue(const_node));
+            }
             return const_type;
         }
         else {
@@ -979,7 +1129,12 @@ DATA_TYPE Diagram::Prim() {
         }
 
         SemNode const_node = evaluateConstant(cur_lex, const_type);
-        pushValue(const_node);
+        if (!ctx->checkOnly) {
+            pushValue(const_node);
+        }
+        else if (gen) {
+            gen->Const(const_type, WidenValue(const_node));
+        }
         return const_type;
     }
     if (t == LPAREN) {
@@ -997,11 +1152,11 @@ DATA_TYPE Diagram::Prim() {
 
         std::string name = cur_lex;
         std::pair<int, int> lc = sc->getLineCol();
-        Tree* node = Tree::Cur->SemGetVar(name, lc.first, lc.second);
+        int node = ctx->tree.SemGetVar(ctx->Cur, name, lc.first, lc.second);
 
         t = peekToken();
         if (t == LBRACKET) {
-            if (node->n->DataType != TYPE_ARRAY) {
+            if (ctx->tree.Sem(node).DataType != TYPE_ARRAY) {
                 semError("Операция индексирования ([]) применима только к идентификаторам, объявленным как массив");
             }
             nextToken();
@@ -1021,7 +1176,7 @@ DATA_TYPE Diagram::Prim() {
                     semError("Индекс при обращении к массиву не может превышать диапазон типа int");
                 }
 
-                if ((index < 0) || (index >= node->n->ArrElemCount)) {
+                if ((index < 0) || (index >= ctx->tree.Type(node).ArrElemCount)) {
                     semError("Индекс при обращении к массиву должен быть больше или равен 0 и меньше указанного при объявлении размера");
                 }
 
@@ -1032,40 +1187,44 @@ DATA_TYPE Diagram::Prim() {
                 nextToken();
 
                 name = (name + "_" + std::to_string(index));
-                node = Tree::Cur->SemGetVar(name, sc->getLineCol().first, sc->getLineCol().second);
-
-                if (!node->n->hasValue) {
-                    interpError("Использование неинициализированного элемента массива '" + name + "'");
+                node = ctx->tree.SemGetVar(ctx->Cur, name, sc->getLineCol().first, sc->getLineCol().second);
+
+                const SemNode& value = ctx->tree.Sem(node);
+                if (!ctx->checkOnly) {
+                    if (!value.hasValue) {
+                        interpError(UninitMessage(name, true));
+                    }
+                    pushValue(value);
+                }
+                else if (gen) {
+                    std::pair<int, int> load_lc = sc->getLineCol();
+                    gen->Load(node, value.DataType, { DIAG_INTERP, UninitMessage(name, true), cur_lex, load_lc.first, load_lc.second });
                 }
 
-                SemNode value;
-                value.DataType = node->n->DataType;
-                value.hasValue = true;
-                value.Value = node->n->Value;
-                pushValue(value);
-
-                return node->n->DataType;
+                return value.DataType;
             }
             else {
                 synError("Ожидалась константа после '['");
             }
         }
         else {
-            if (node->n->DataType == TYPE_ARRAY) {
+            const SemNode& value = ctx->tree.Sem(node);
+            if (value.DataType == TYPE_ARRAY) {
                 semError("Нельзя использовать массив целиком в качестве операнда");
             }
 
-            if (!node->n->hasValue) {
-                interpError("Использование неинициализированной переменной/именованной константы '" + name + "'");
+            if (!ctx->checkOnly) {
+                if (!value.hasValue) {
+                    interpError(UninitMessage(name, false));
+                }
+                pushValue(value);
+            }
+            else if (gen) {
+                std::pair<int, int> load_lc = sc->getLineCol();
+                gen->Load(node, value.DataType, { DIAG_INTERP, UninitMessage(name, false), cur_lex, load_lc.first, load_lc.second });
             }
 
-            SemNode value;
-            value.DataType = node->n->DataType;
-            value.hasValue = true;
-            value.Value = node->n->Value;
-            pushValue(value);
-
-            return node->n->DataType;
+            return value.DataType;
         }
     }
     synError("Ожидалось первичное выражение (IDENT, константа или скобки)");
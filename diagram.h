@@ -4,13 +4,15 @@
 #include "defines.h"
 #include "data_type.h"
 #include "tree.h"
+#include "context.h"
+#include "code_gen.h"
 #include <string>
 #include <vector>
-#include <stack>
 
 class Diagram {
 private:
     Scanner* sc;
+    Context* ctx; // Контекст интерпретатора (семантическое дерево, флаги, стек вычислений)
 
     // Буфер для токенов
     std::vector<int> push_tok;
@@ -20,11 +22,21 @@ private:
     int cur_tok;
     std::string cur_lex;
 
-    DATA_TYPE current_decl_type; // Текущий тип при объявлении переменных, массивов и именованных констант
-    int current_arr_elem_count; // Текущая размерность массива (для определения: массив или нет)
+    int current_type; // Описатель типа (TypeTable) при объявлении переменных, массивов и именованных констант
 
-    // Стек для вычисления выражений
-    std::stack<SemNode> eval_stack;
+    CodeGen* gen; // Порождение байт-кода (CompileProgram), иначе nullptr
+
+    // Состояние разбора для повторного разбора тела цикла
+    struct ParseState {
+        size_t pos;
+        std::vector<int> push_tok;
+        std::vector<std::string> push_lex;
+        int cur_tok;
+        std::string cur_lex;
+    };
+
+    ParseState saveState() const;
+    void restoreState(const ParseState& state);
 
     int nextToken();
     int peekToken();
@@ -36,6 +48,7 @@ private:
     void semError(const std::string& msg);
     void interpError(const std::string& msg);
 
+    void ProgramToEnd(); // Program и проверка конца текста
     void Program(); // Верхнеуровневая программа (TopDecl*)
     void TopDecl(); // Одно верхнеуровневое объявление (MainFunc | TypeDefinition | VarDecl | ConstDecl)
     void MainFunc(); // Разбор функции main: int main () Block
@@ -61,8 +74,15 @@ private:
     void executeAssignment(const std::string& varName, DATA_TYPE exprType, int line, int col);
 
 public:
-    Diagram(Scanner* scanner);
+    Diagram(Scanner* scanner, Context* context);
 
     // Точка входа: разбор всей программы
-    void ParseProgram(bool isInterp = true, bool isDebug = false);
+    // (при ctx->engine == ENGINE_VM и isInterp -- байт-код и виртуальная машина).
+    // compiled -- байт-код этой программы, уже порождённый CompileProgram на дереве ctx
+    // (tayat::Compile): при выполнении байт-кодом текст не разбирается, выполняется копия compiled
+    void ParseProgram(bool isInterp = true, bool isDebug = false, const Code* compiled = nullptr);
+
+    // Разбор в режиме проверки с порождением байт-кода. Ошибка разбора не
+    // выбрасывается, а становится командой RAISE в конце кода
+    void CompileProgram(Code& code);
 };
\ No newline at end of file
@@ -0,0 +1,7 @@
+#pragma once
+
+// Исполнитель программы
+enum EXEC_ENGINE {
+	ENGINE_TREE, // Вычисление во время разбора (по тексту и семантическому дереву)
+	ENGINE_VM // Байт-код на виртуальной машине (code_gen.h, vm.h)
+};
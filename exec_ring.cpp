@@ -0,0 +1,71 @@
+#include "exec_ring.h"
+#include "tree.h"
+
+void ExecRing::SetCapacity(size_t capacity) {
+    size_t size = 0;
+    if (capacity > 0) {
+        size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+    }
+    events.assign(size, RingEvent());
+    mask = (size > 0) ? size - 1 : 0;
+    head = 0;
+}
+
+static void PrintValue(std::ostream& out, const SemNode& v) {
+    if (!v.hasValue) {
+        out << "неинициализирована";
+        return;
+    }
+    switch (v.DataType) {
+    case TYPE_SHORT_INT: out << v.Value.v_int16 << " (short)"; break;
+    case TYPE_INT: out << v.Value.v_int32 << " (int)"; break;
+    case TYPE_LONG_INT: out << v.Value.v_int32 << " (long)"; break;
+    case TYPE_LONG_LONG_INT: out << v.Value.v_int64 << " (longlong)"; break;
+    default: out << "unknown"; break;
+    }
+}
+
+// Имя области для вывода: имя функции или "{}" для составного оператора
+static std::string ScopeName(const Tree& tree, int node) {
+    if ((node == Tree::NONE) || (node >= tree.Count())) {
+        return "?";
+    }
+    if (tree.Up(node) == Tree::NONE) {
+        return "глобальная область";
+    }
+    const std::string& id = tree.Info(node).id;
+    return id.empty() ? "{}" : id;
+}
+
+void ExecRing::Dump(const Tree& tree, std::ostream& out) const {
+    size_t count = (head < events.size()) ? static_cast<size_t>(head) : events.size();
+    out << "Последние выполненные операции (" << count << " из " << head << "):\n";
+
+    for (uint64_t i = head - count; i < head; i++) {
+        const RingEvent& e = events[static_cast<size_t>(i) & mask];
+        out << "  #" << i << " (строка " << e.line << ":" << e.col << ") ";
+        switch (e.kind) {
+        case RING_ASSIGN:
+            out << (((e.node >= 0) && (e.node < tree.Count())) ? tree.Info(e.node).id : "?") << " = ";
+            PrintValue(out, e.value);
+            break;
+        case RING_ARITH:
+            out << "операция '" << e.op << "' = ";
+            PrintValue(out, e.value);
+            break;
+        case RING_ENTER:
+            out << "вход в " << ScopeName(tree, e.node);
+            break;
+        case RING_EXIT:
+            out << "выход из " << ScopeName(tree, e.node);
+            break;
+        default:
+            out << "?";
+            break;
+        }
+        out << "\n";
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "sem_node.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+class Tree;
+
+// Вид события выполнения
+enum RING_EVENT {
+    RING_ASSIGN, // Присваивание: node -- переменная, value -- новое значение
+    RING_ARITH,  // Арифметическая операция: op -- знак, value -- результат
+    RING_ENTER,  // Вход в область node
+    RING_EXIT    // Выход из области node
+};
+
+// Событие выполнения (32 байта, без строк и выделения памяти)
+struct RingEvent {
+    SemNode value;
+    int32_t line;
+    int32_t col;
+    int32_t node;
+    uint8_t kind; // RING_EVENT
+    char op;      // Знак операции для RING_ARITH
+};
+
+// Кольцевой буфер последних выполненных операций.
+// Запись всегда включена и стоит нескольких присваиваний: событие копируется
+// в ячейку с номером head по маске, старые события затираются. Содержимое
+// выводится после ошибки выполнения или по запросу (Dump)
+class ExecRing {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 256;
+
+    ExecRing() { SetCapacity(DEFAULT_CAPACITY); }
+
+    // Ёмкость округляется вверх до степени двойки; 0 -- запись отключена
+    void SetCapacity(size_t capacity);
+    size_t Capacity() const { return events.size(); }
+
+    // Всего записано событий (включая затёртые)
+    uint64_t Total() const { return head; }
+
+    void Clear() { head = 0; }
+
+    void Record(RING_EVENT kind, int node, char op, const SemNode& value, int line, int col) {
+        if (events.empty()) return;
+        RingEvent& e = events[static_cast<size_t>(head) & mask];
+        e.value = value;
+        e.line = line;
+        e.col = col;
+        e.node = node;
+        e.kind = static_cast<uint8_t>(kind);
+        e.op = op;
+        head++;
+    }
+
+    void Record(RING_EVENT kind, int node, int line, int col) {
+        Record(kind, node, 0, SemNode(), line, col);
+    }
+
+    // Для машинного кода (jit.h), который пишет события сам
+    RingEvent* Events() { return events.data(); }
+    size_t Mask() const { return mask; }
+    uint64_t* Head() { return &head; }
+
+    // Вывести сохранённые события от старых к новым (имена берутся из дерева)
+    void Dump(const Tree& tree, std::ostream& out) const;
+
+private:
+    std::vector<RingEvent> events;
+    size_t mask = 0;
+    uint64_t head = 0;
+};
@@ -0,0 +1,386 @@
+// Дифференциальное тестирование исполнителей.
+//
+// Случайные программы (ProgramGenerator) выполняются эталонным исполнителем
+// (интерпретатор по дереву, tayat.h: Compile + Run) и проверяемым (по умолчанию --
+// виртуальная машина с машинным кодом циклов, jit.h); сравниваются итоговые значения
+// всех переменных, все диагностические сообщения (предупреждения и ошибка с позицией)
+// и история выполнения перед ошибкой (если её ведут оба исполнителя). Исполнитель aot
+// переводит программу в C (TranslateToC), собирает её компилятором $CC (по умолчанию cc)
+// и сравнивает вывод собранной программы с ключом --result. Расхождение сохраняется
+// вместе с минимизированной программой: строки удаляются, пока расхождение сохраняется (ddmin).
+// С --checked оба исполнителя проверяют переполнение в арифметике (RunOptions::checkedArithmetic).
+//
+// difftest [--engine имя] [--reference имя] [--runs N] [--seed S] [--debug] [--checked]
+//          [--out каталог] [--keep-going] [--list]
+
+#include "program_gen.h"
+
+#include "optimizer.h"
+#include "tayat.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+// Исполнитель: текст программы -> результат выполнения
+struct Engine {
+    const char* name;
+    RunResult (*run)(const std::string& source, bool isDebug);
+    bool hasRecent; // Ведёт историю выполнения (RunResult::recent)
+};
+
+// Предел итераций: при минимизации может пропасть приращение счётчика цикла
+static const uint64_t MAX_ITERATIONS = 100000;
+
+// Проверка переполнения (--checked) -- у всех исполнителей
+static bool checkedArithmetic = false;
+
+static RunResult RunWith(const std::string& source, bool isDebug, EXEC_ENGINE engine, bool superinstructions,
+    uint64_t jitThreshold = 0, unsigned optimizations = 0) {
+    RunOptions options;
+    options.isDebug = isDebug;
+    options.engine = engine;
+    options.superinstructions = superinstructions;
+    options.maxIterations = MAX_ITERATIONS;
+    options.jitThreshold = jitThreshold;
+    options.checkedArithmetic = checkedArithmetic;
+    options.optimizations = optimizations;
+    return Run(Compile(source), options);
+}
+
+static RunResult RunTree(const std::string& source, bool isDebug) {
+    return RunWith(source, isDebug, ENGINE_TREE, false);
+}
+
+static RunResult RunVmNoSuper(const std::string& source, bool isDebug) {
+    return RunWith(source, isDebug, ENGINE_VM, false);
+}
+
+static RunResult RunVm(const std::string& source, bool isDebug) {
+    return RunWith(source, isDebug, ENGINE_VM, true);
+}
+
+// Машинный код с первой итерации: в нём выполняется почти всё тело цикла
+static RunResult RunVmJit(const std::string& source, bool isDebug) {
+    return RunWith(source, isDebug, ENGINE_VM, true, 1);
+}
+
+// Оптимизации байт-кода (optimizer.h) меняют историю выполнения: её не сравниваем
+static RunResult RunVmOpt(const std::string& source, bool isDebug) {
+    return RunWith(source, isDebug, ENGINE_VM, true, 0, OPT_ALL);
+}
+
+static RunResult RunVmOptJit(const std::string& source, bool isDebug) {
+    return RunWith(source, isDebug, ENGINE_VM, true, 1, OPT_ALL);
+}
+
+static std::string ReadFile(const std::string& name) {
+    std::ifstream in(name, std::ios::binary);
+    std::ostringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+// Ошибка сборки или запуска переведённой программы -- как расхождение
+static RunResult AotFailure(const std::string& message) {
+    RunResult result;
+    result.ok = false;
+    result.diagnostics.push_back({ DIAG_INTERP, "aot: " + message, "", 0, 0 });
+    return result;
+}
+
+static RunResult RunAotWith(const std::string& source, bool isDebug, unsigned optimizations) {
+    RunOptions options;
+    options.isDebug = isDebug;
+    options.maxIterations = MAX_ITERATIONS;
+    options.optimizations = optimizations;
+    options.checkedArithmetic = checkedArithmetic;
+    Program program = Compile(source);
+    if (!program.ok) {
+        return Run(program, options);
+    }
+
+    static const std::filesystem::path dir = std::filesystem::temp_directory_path()
+        / ("difftest_aot_" + std::to_string(getpid()));
+    std::filesystem::create_directories(dir);
+    const std::string c_file = (dir / "program.c").string();
+    const std::string exe = (dir / "program").string();
+    const std::string out = (dir / "result.txt").string();
+
+    std::ofstream(c_file, std::ios::binary) << TranslateToC(program, options);
+    const char* cc = std::getenv("CC");
+    std::string build = std::string(cc ? cc : "cc") + " -O2 -std=c11 -w -o \"" + exe + "\" \"" + c_file + "\"";
+    if (std::system(build.c_str()) != 0) {
+        return AotFailure("не удалось собрать " + c_file);
+    }
+    std::string run = "\"" + exe + "\" --result > \"" + out + "\"";
+    std::system(run.c_str()); // Код возврата 1 -- ошибка выполнения программы
+
+    RunResult result;
+    if (!ParseRunResult(ReadFile(out), result)) {
+        return AotFailure("неверный вывод " + exe + " --result");
+    }
+    return result;
+}
+
+static RunResult RunAot(const std::string& source, bool isDebug) {
+    return RunAotWith(source, isDebug, 0);
+}
+
+static RunResult RunAotOpt(const std::string& source, bool isDebug) {
+    return RunAotWith(source, isDebug, OPT_ALL);
+}
+
+// Исполнители, доступные для сравнения (первый -- эталон по умолчанию,
+// последний -- проверяемый по умолчанию)
+static const Engine ENGINES[] = {
+    { "tree", RunTree, true },
+    { "vm-nosuper", RunVmNoSuper, true },
+    { "vm", RunVm, true },
+    { "vm-opt", RunVmOpt, false },
+    { "vm-opt-jit", RunVmOptJit, false },
+    { "aot", RunAot, false },
+    { "aot-opt", RunAotOpt, false },
+    { "vm-jit", RunVmJit, true },
+};
+
+static const Engine* FindEngine(const std::string& name) {
+    for (const Engine& e : ENGINES) {
+        if (name == e.name) return &e;
+    }
+    return nullptr;
+}
+
+static const char* TypeName(DATA_TYPE t) {
+    switch (t) {
+    case TYPE_SHORT_INT: return "short";
+    case TYPE_INT: return "int";
+    case TYPE_LONG_INT: return "long";
+    case TYPE_LONG_LONG_INT: return "longlong";
+    default: return "?";
+    }
+}
+
+static std::string DescribeVar(const VarValue& v) {
+    std::ostringstream s;
+    s << v.name << " (" << TypeName(v.type) << ", глубина " << v.depth << ") = ";
+    if (v.hasValue) s << v.value;
+    else s << "неинициализирована";
+    return s.str();
+}
+
+// Сравнить результаты; diff -- описание первого расхождения
+static bool SameResult(const RunResult& a, const RunResult& b, bool compareRecent, std::string& diff) {
+    if (a.ok != b.ok) {
+        diff = std::string("успешность выполнения: ") + (a.ok ? "да" : "нет") + " / " + (b.ok ? "да" : "нет");
+        return false;
+    }
+    size_t nd = std::max(a.diagnostics.size(), b.diagnostics.size());
+    for (size_t i = 0; i < nd; i++) {
+        if (i >= a.diagnostics.size() || i >= b.diagnostics.size()) {
+            const Diagnostic& d = (i < a.diagnostics.size()) ? a.diagnostics[i] : b.diagnostics[i];
+            diff = "лишнее сообщение у " + std::string((i < a.diagnostics.size()) ? "эталона" : "проверяемого")
+                + ": " + FormatDiagnostic(d);
+            return false;
+        }
+        const Diagnostic& x = a.diagnostics[i];
+        const Diagnostic& y = b.diagnostics[i];
+        if ((x.kind != y.kind) || (x.message != y.message) || (x.id != y.id) || (x.line != y.line) || (x.col != y.col)) {
+            diff = "сообщение " + std::to_string(i) + ":\n  " + FormatDiagnostic(x) + "\n  " + FormatDiagnostic(y);
+            return false;
+        }
+    }
+    if (compareRecent && (a.recent != b.recent)) {
+        diff = "история выполнения перед ошибкой:\n" + a.recent + "--\n" + b.recent;
+        return false;
+    }
+    size_t nv = std::max(a.variables.size(), b.variables.size());
+    for (size_t i = 0; i < nv; i++) {
+        if (i >= a.variables.size() || i >= b.variables.size()) {
+            diff = "разное число переменных: " + std::to_string(a.variables.size()) + " / " + std::to_string(b.variables.size());
+            return false;
+        }
+        const VarValue& x = a.variables[i];
+        const VarValue& y = b.variables[i];
+        if ((x.name != y.name) || (x.type != y.type) || (x.depth != y.depth) || (x.hasValue != y.hasValue)
+            || (x.hasValue && (x.value != y.value))) {
+            diff = "переменная " + std::to_string(i) + ": " + DescribeVar(x) + " / " + DescribeVar(y);
+            return false;
+        }
+    }
+    return true;
+}
+
+struct DiffCase {
+    const Engine* reference;
+    const Engine* engine;
+    bool isDebug;
+
+    // Расходятся ли исполнители на программе source
+    bool Differs(const std::string& source, std::string& diff) const {
+        RunResult a = reference->run(source, isDebug);
+        RunResult b = engine->run(source, isDebug);
+        return !SameResult(a, b, reference->hasRecent && engine->hasRecent, diff);
+    }
+};
+
+static std::vector<std::string> SplitLines(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+static std::string JoinLines(const std::vector<std::string>& lines) {
+    std::string text;
+    for (const std::string& l : lines) {
+        text += l;
+        text += "\n";
+    }
+    return text;
+}
+
+// Минимизация по строкам (ddmin): удаляются части всё меньшего размера,
+// пока программа продолжает давать расхождение
+static std::string Minimize(const std::string& source, const DiffCase& dc) {
+    std::vector<std::string> lines = SplitLines(source);
+    std::string diff;
+    size_t chunk = lines.size() / 2;
+    while (chunk > 0) {
+        bool reduced = false;
+        for (size_t start = 0; start < lines.size(); ) {
+            std::vector<std::string> candidate;
+            candidate.insert(candidate.end(), lines.begin(), lines.begin() + start);
+            size_t end = std::min(lines.size(), start + chunk);
+            candidate.insert(candidate.end(), lines.begin() + end, lines.end());
+            if (!candidate.empty() && dc.Differs(JoinLines(candidate), diff)) {
+                lines.swap(candidate);
+                reduced = true;
+            }
+            else {
+                start += chunk;
+            }
+        }
+        if (!reduced) {
+            chunk /= 2;
+        }
+    }
+    return JoinLines(lines);
+}
+
+static bool WriteFile(const std::string& name, const std::string& text) {
+    std::ofstream out(name);
+    out << text;
+    return static_cast<bool>(out);
+}
+
+int main(int argc, char** argv) {
+    const size_t engine_count = sizeof(ENGINES) / sizeof(ENGINES[0]);
+    const Engine* reference = &ENGINES[0];
+    const Engine* engine = &ENGINES[engine_count - 1];
+    long long runs = 1000;
+    uint32_t seed = 1;
+    bool isDebug = false;
+    bool keepGoing = false;
+    std::string out_dir = ".";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (((arg == "--engine") || (arg == "--reference")) && (i + 1 < argc)) {
+            const Engine* e = FindEngine(argv[++i]);
+            if (!e) {
+                std::cerr << "Неизвестный исполнитель " << argv[i] << std::endl;
+                return -1;
+            }
+            (arg == "--engine" ? engine : reference) = e;
+        }
+        else if ((arg == "--runs") && (i + 1 < argc)) {
+            runs = std::atoll(argv[++i]);
+        }
+        else if ((arg == "--seed") && (i + 1 < argc)) {
+            seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--debug") {
+            isDebug = true;
+        }
+        else if (arg == "--checked") {
+            checkedArithmetic = true;
+        }
+        else if ((arg == "--out") && (i + 1 < argc)) {
+            out_dir = argv[++i];
+        }
+        else if (arg == "--keep-going") {
+            keepGoing = true;
+        }
+        else if (arg == "--list") {
+            for (const Engine& e : ENGINES) {
+                std::cout << e.name << std::endl;
+            }
+            return 0;
+        }
+        else {
+            std::cerr << "Использование: difftest [--engine имя] [--reference имя] [--runs N] [--seed S] [--debug] [--checked]"
+                " [--out каталог] [--keep-going] [--list]" << std::endl;
+            return -1;
+        }
+    }
+
+    DiffCase dc = { reference, engine, isDebug };
+    long long done = 0;
+    long long failures = 0;
+    long long rejected = 0;
+
+    for (long long r = 0; r < runs; r++, done++) {
+        uint32_t case_seed = seed + static_cast<uint32_t>(r);
+        ProgramGenerator gen(case_seed);
+        std::string source = gen.Generate();
+
+        RunResult a = reference->run(source, isDebug);
+        RunResult b = engine->run(source, isDebug);
+        // Доля программ, завершившихся ошибкой, -- показатель качества генератора
+        if (!a.ok) rejected++;
+
+        std::string diff;
+        if (SameResult(a, b, reference->hasRecent && engine->hasRecent, diff)) {
+            continue;
+        }
+
+        failures++;
+        std::string min_source = Minimize(source, dc);
+        std::string min_diff;
+        dc.Differs(min_source, min_diff);
+
+        std::string base = out_dir + "/difftest_" + std::to_string(case_seed);
+        WriteFile(base + ".txt", source);
+        WriteFile(base + ".min.txt", min_source);
+
+        std::cerr << "Расхождение " << reference->name << " / " << engine->name
+            << " (seed " << case_seed << "): " << diff << "\n"
+            << "Минимизированная программа (" << base << ".min.txt): " << min_diff << "\n"
+            << min_source << std::endl;
+
+        if (!keepGoing) {
+            done++;
+            break;
+        }
+    }
+
+    std::cerr << "Программ: " << done << ", расхождений: " << failures
+        << ", завершились ошибкой у эталона: " << rejected << std::endl;
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,397 @@
+#include "program_gen.h"
+
+ProgramGenerator::ProgramGenerator(uint32_t seed, const GenOptions& options)
+    : rng(seed), opt(options), indent(0), nameCounter(0), allowErrors(false) {
+}
+
+std::string ProgramGenerator::NewName(const char* prefix) {
+    return prefix + std::to_string(nameCounter++);
+}
+
+void ProgramGenerator::Line(const std::string& text) {
+    out.append(static_cast<size_t>(indent) * 4, ' ');
+    out += text;
+    out += "\n";
+}
+
+ProgramGenerator::Symbol* ProgramGenerator::Find(const std::string& name) {
+    for (size_t i = scopes.size(); i > 0; i--) {
+        for (Symbol& s : scopes[i - 1]) {
+            if (s.name == name) {
+                return &s;
+            }
+        }
+    }
+    return nullptr;
+}
+
+DATA_TYPE ProgramGenerator::RandomBasicType() {
+    static const DATA_TYPE TYPES[4] = { TYPE_SHORT_INT, TYPE_INT, TYPE_LONG_INT, TYPE_LONG_LONG_INT };
+    return TYPES[Rand(4)];
+}
+
+std::string ProgramGenerator::TypeKeyword(DATA_TYPE t) {
+    switch (t) {
+    case TYPE_SHORT_INT: return "short";
+    case TYPE_INT: return "int";
+    case TYPE_LONG_INT: return "long";
+    default: return "longlong";
+    }
+}
+
+// Константы: малые значения и значения на границах short / int / longlong
+// (тип литерала выбирается по значению), десятичные и шестнадцатеричные
+std::string ProgramGenerator::RandomConst(bool allowNegative) {
+    static const char* const BOUNDARY[] = {
+        "32767", "32768", "65535", "70000", "2147483647", "2147483648",
+        "3000000000", "9000000000", "0x7fff", "0x8000", "0xFFFF", "0x7FFFFFFF", "0x80000000"
+    };
+    std::string value;
+    int kind = Rand(10);
+    if (kind < 6) {
+        value = std::to_string(Rand(21));
+    }
+    else if (kind < 8) {
+        value = std::to_string(100 + Rand(2000));
+    }
+    else if (kind < 9) {
+        value = BOUNDARY[Rand(sizeof(BOUNDARY) / sizeof(BOUNDARY[0]))];
+    }
+    else {
+        static const char HEX[] = "0123456789abcdef";
+        value = "0x";
+        value += HEX[1 + Rand(15)];
+        value += HEX[Rand(16)];
+    }
+    if (allowNegative && Chance(20)) {
+        value = "-" + value;
+    }
+    return value;
+}
+
+std::string ProgramGenerator::RandomOperand(bool allowUninit) {
+    std::vector<std::string> candidates;
+    for (size_t i = scopes.size(); i > 0; i--) {
+        for (const Symbol& s : scopes[i - 1]) {
+            // Имя, перекрытое во внутренней области, обозначает внутренний символ
+            if (Find(s.name) != &s) continue;
+
+            if ((s.kind == SYM_VAR) || (s.kind == SYM_CONST)) {
+                if (allowUninit || s.inited[0]) {
+                    candidates.push_back(s.name);
+                }
+            }
+            else if (s.kind == SYM_ARRAY) {
+                for (int k = 0; k < s.count; k++) {
+                    if (allowUninit || s.inited[k]) {
+                        // Элемент доступен и как a[k], и как переменная a_k
+                        candidates.push_back(Chance(85)
+                            ? s.name + "[" + std::to_string(k) + "]"
+                            : s.name + "_" + std::to_string(k));
+                    }
+                }
+            }
+        }
+    }
+    if (candidates.empty()) {
+        return "";
+    }
+    return candidates[Rand(static_cast<int>(candidates.size()))];
+}
+
+// Expr -> ['+'|'-'] Rel (('=='|'!=') Rel)*
+std::string ProgramGenerator::GenExpr(int depth) {
+    std::string rel = GenRel(depth);
+    std::string e;
+    if (Chance(10)) {
+        // '+' перед константой Prim не разбирает -- там только '-'
+        bool const_first = (rel[0] >= '0') && (rel[0] <= '9');
+        e = (const_first || Chance(70)) ? "- " : "+ ";
+    }
+    e += rel;
+    if (Chance(15)) {
+        e += Chance(50) ? " == " : " != ";
+        e += GenRel(depth);
+    }
+    return e;
+}
+
+// Rel -> Add (('<'|'<='|'>'|'>=') Add)*
+std::string ProgramGenerator::GenRel(int depth) {
+    static const char* const OPS[4] = { " < ", " <= ", " > ", " >= " };
+    std::string e = GenAdd(depth);
+    if (Chance(15)) {
+        e += OPS[Rand(4)];
+        e += GenAdd(depth);
+    }
+    return e;
+}
+
+// Add -> Mul (('+'|'-') Mul)*
+std::string ProgramGenerator::GenAdd(int depth) {
+    std::string e = GenMul(depth);
+    int n = Rand(depth < opt.maxExprDepth ? 3 : 2);
+    for (int i = 0; i < n; i++) {
+        e += Chance(50) ? " + " : " - ";
+        e += GenMul(depth);
+    }
+    return e;
+}
+
+// Mul -> Prim (('*'|'/'|'%') Prim)*; делитель -- обычно ненулевая константа
+std::string ProgramGenerator::GenMul(int depth) {
+    std::string e = GenPrim(depth);
+    int n = Rand(2);
+    for (int i = 0; i < n; i++) {
+        int op = Rand(3);
+        if (op == 0) {
+            e += " * ";
+            e += GenPrim(depth);
+            continue;
+        }
+        e += (op == 1) ? " / " : " % ";
+        std::string divisor;
+        if (allowErrors && Chance(10)) {
+            divisor = RandomOperand(false);
+        }
+        if (divisor.empty()) {
+            divisor = std::to_string(1 + Rand(20));
+            if (Chance(15)) {
+                divisor = "-" + divisor;
+            }
+        }
+        e += divisor;
+    }
+    return e;
+}
+
+// Prim -> IDENT | IDENT '[' Const ']' | Const | '-' Const | '-' '(' Expr ')' | '(' Expr ')'
+std::string ProgramGenerator::GenPrim(int depth) {
+    int choice = Rand(100);
+    if (depth >= opt.maxExprDepth) {
+        choice = Rand(65);
+    }
+    if (choice < 40) {
+        std::string operand = RandomOperand(allowErrors && Chance(5));
+        if (!operand.empty()) {
+            return operand;
+        }
+        return RandomConst(false);
+    }
+    if (choice < 65) {
+        return RandomConst(true);
+    }
+    if (choice < 88) {
+        return "(" + GenExpr(depth + 1) + ")";
+    }
+    return "-(" + GenExpr(depth + 1) + ")";
+}
+
+// typedef Type IDENT [[Const]] ;
+void ProgramGenerator::GenTypedef() {
+    std::vector<Symbol*> typedefs;
+    for (Symbol& s : scopes[0]) {
+        if (s.kind == SYM_TYPEDEF) typedefs.push_back(&s);
+    }
+
+    Symbol t;
+    t.name = NewName("t");
+    t.kind = SYM_TYPEDEF;
+    std::string base;
+    if (!typedefs.empty() && Chance(40)) {
+        // Метка через метку: наследует тип и размер массива
+        Symbol* from = typedefs[Rand(static_cast<int>(typedefs.size()))];
+        base = from->name;
+        t.type = from->type;
+        t.count = from->count;
+    }
+    else {
+        t.type = RandomBasicType();
+        base = TypeKeyword(t.type);
+        t.count = 0;
+    }
+
+    std::string text = "typedef " + base + " " + t.name;
+    if ((t.count == 0) && Chance(40)) {
+        t.count = 1 + Rand(5);
+        text += "[" + std::to_string(t.count) + "]";
+    }
+    t.inited.push_back(true);
+    Line(text + ";");
+    scopes[0].push_back(t);
+}
+
+// [const] Type IdInit (',' IdInit)* ;
+void ProgramGenerator::GenDecl(bool isConst) {
+    // Тип: ключевое слово или метка типа (для констант -- не массив)
+    std::vector<Symbol*> typedefs;
+    for (Symbol& s : scopes[0]) {
+        if ((s.kind == SYM_TYPEDEF) && (!isConst || (s.count == 0))) typedefs.push_back(&s);
+    }
+    std::string type_name;
+    DATA_TYPE type;
+    int count = 0;
+    if (!typedefs.empty() && Chance(35)) {
+        Symbol* t = typedefs[Rand(static_cast<int>(typedefs.size()))];
+        type_name = t->name;
+        type = t->type;
+        count = t->count;
+    }
+    else {
+        type = RandomBasicType();
+        type_name = TypeKeyword(type);
+    }
+
+    std::string text = isConst ? "const " + type_name + " " : type_name + " ";
+    int names = 1 + Rand(3);
+    for (int i = 0; i < names; i++) {
+        Symbol s;
+        // Иногда перекрываем имя из внешней области
+        s.name.clear();
+        if ((scopes.size() > 1) && Chance(15)) {
+            const std::vector<Symbol>& outer = scopes[Rand(static_cast<int>(scopes.size() - 1))];
+            if (!outer.empty()) {
+                const Symbol& o = outer[Rand(static_cast<int>(outer.size()))];
+                if ((o.kind != SYM_TYPEDEF) && !o.counter) {
+                    bool taken = false;
+                    for (const Symbol& c : scopes.back()) {
+                        if (c.name == o.name) taken = true;
+                    }
+                    if (!taken) s.name = o.name;
+                }
+            }
+        }
+        if (s.name.empty()) {
+            s.name = NewName(count > 0 ? "a" : (isConst ? "c" : "v"));
+        }
+        s.kind = (count > 0) ? SYM_ARRAY : (isConst ? SYM_CONST : SYM_VAR);
+        s.type = type;
+        s.count = count;
+        s.inited.assign(count > 0 ? count : 1, false);
+
+        if (i > 0) text += ", ";
+        text += s.name;
+
+        // Идентификатор заносится в область до разбора инициализатора
+        scopes.back().push_back(s);
+        if ((count == 0) && (isConst || Chance(70))) {
+            text += " = " + GenExpr(0);
+            scopes.back().back().inited[0] = true;
+        }
+    }
+    Line(text + ";");
+}
+
+void ProgramGenerator::GenStmt(int depth) {
+    int choice = Rand(100);
+    if (depth >= opt.maxDepth) {
+        choice = 20 + Rand(75);
+    }
+
+    if (choice < 10) {
+        GenBlock(depth + 1, 1 + Rand(std::max(1, opt.maxStatements / 3)));
+        return;
+    }
+    if (choice < 20) {
+        GenWhile(depth);
+        return;
+    }
+    if (choice >= 95) {
+        Line(";");
+        return;
+    }
+
+    // Присваивание: переменная или элемент массива
+    std::vector<std::string> targets;
+    std::vector<std::pair<Symbol*, int>> refs;
+    for (size_t i = scopes.size(); i > 0; i--) {
+        for (Symbol& s : scopes[i - 1]) {
+            if (Find(s.name) != &s) continue;
+            if ((s.kind == SYM_VAR) && !s.counter) {
+                targets.push_back(s.name);
+                refs.push_back({ &s, 0 });
+            }
+            else if (s.kind == SYM_ARRAY) {
+                int k = Rand(s.count);
+                targets.push_back(s.name + "[" + std::to_string(k) + "]");
+                refs.push_back({ &s, k });
+            }
+        }
+    }
+    if (targets.empty()) {
+        Line(";");
+        return;
+    }
+    int pick = Rand(static_cast<int>(targets.size()));
+    std::string target = targets[pick];
+    std::pair<Symbol*, int> ref = refs[pick];
+    std::string rhs = GenExpr(0);
+    ref.first->inited[ref.second] = true;
+    Line(target + " = " + rhs + ";");
+}
+
+// int k = 0; while (k < n) { ...; k = k + 1; }
+void ProgramGenerator::GenWhile(int depth) {
+    Symbol k;
+    k.name = NewName("k");
+    k.kind = SYM_VAR;
+    k.type = TYPE_INT;
+    k.count = 0;
+    k.inited.push_back(true);
+    k.counter = true;
+    Line("int " + k.name + " = 0;");
+    scopes.back().push_back(k);
+
+    std::string n = std::to_string(1 + Rand(4));
+    int form = Rand(3);
+    std::string cond = (form == 0) ? k.name + " < " + n
+        : (form == 1) ? k.name + " != " + n
+        : n + " - " + k.name;
+    Line("while (" + cond + ")");
+    GenBlock(depth + 1, 1 + Rand(std::max(1, opt.maxStatements / 3)), k.name + " = " + k.name + " + 1;");
+}
+
+void ProgramGenerator::GenBlock(int depth, int items, const std::string& tail) {
+    Line("{");
+    indent++;
+    scopes.emplace_back();
+    for (int i = 0; i < items; i++) {
+        int choice = Rand(100);
+        if (choice < 25) {
+            GenDecl(false);
+        }
+        else if (choice < 32) {
+            GenDecl(true);
+        }
+        else {
+            GenStmt(depth);
+        }
+    }
+    if (!tail.empty()) {
+        Line(tail);
+    }
+    scopes.pop_back();
+    indent--;
+    Line("}");
+}
+
+std::string ProgramGenerator::Generate() {
+    out.clear();
+    indent = 0;
+    nameCounter = 0;
+    scopes.assign(1, std::vector<Symbol>());
+    allowErrors = Chance(opt.errorPercent);
+
+    int typedefs = Rand(opt.maxTypedefs + 1);
+    for (int i = 0; i < typedefs; i++) {
+        GenTypedef();
+    }
+    int globals = Rand(opt.maxGlobals + 1);
+    for (int i = 0; i < globals; i++) {
+        GenDecl(Chance(30));
+    }
+
+    Line("int main()");
+    GenBlock(0, 1 + Rand(opt.maxStatements));
+    return out;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "data_type.h"
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Параметры генератора программ
+struct GenOptions {
+    int maxTypedefs = 4;    // Меток типов в глобальной области
+    int maxGlobals = 6;     // Глобальных объявлений
+    int maxStatements = 30; // Элементов блока main (объявления и операторы)
+    int maxDepth = 3;       // Вложенность блоков и while
+    int maxExprDepth = 3;   // Вложенность выражений
+    int errorPercent = 15;  // Доля программ (в процентах), в которых возможны ошибки выполнения:
+                            // чтение неинициализированной переменной, деление на переменную
+};
+
+// Генератор случайных корректных (почти всегда) программ по грамматике Diagram:
+//   Program   -> (typedef | const | VarDecl)* int main() Block
+//   Block     -> '{' (VarDecl | ConstDecl | Stmt)* '}'
+//   Stmt      -> ';' | Block | IDENT ['[' Const ']'] '=' Expr ';' | while '(' Expr ')' Stmt
+// Циклы порождаются только со счётчиком (int k = 0; while (k < n) { ...; k = k + 1; },
+// n от 1 до 4): тело выполняется хотя бы раз, и программа всегда завершается.
+//   Expr      -> ['+'|'-'] Rel (('=='|'!=') Rel)*, Rel, Add, Mul -- как в Diagram
+//   Prim      -> IDENT | IDENT '[' Const ']' | Const | '-' Const | '-' '(' Expr ')' | '(' Expr ')'
+// Генератор следит за областями видимости, типами и инициализацией (операторы
+// выполняются по порядку, тело цикла -- хотя бы раз, поэтому это отслеживается точно) и подбирает
+// константы на границах short/int/longlong, чтобы задействовать выбор типа литерала,
+// повышение типов и обрезку при присваивании.
+// Каждое объявление и оператор -- отдельная строка, '{' и '}' -- тоже, что удобно
+// для минимизации по строкам
+class ProgramGenerator {
+public:
+    ProgramGenerator(uint32_t seed, const GenOptions& options = GenOptions());
+
+    std::string Generate();
+
+private:
+    enum SYM_KIND { SYM_VAR, SYM_CONST, SYM_ARRAY, SYM_TYPEDEF };
+
+    struct Symbol {
+        std::string name;
+        SYM_KIND kind;
+        DATA_TYPE type;            // Тип переменной / элемента массива / тип метки
+        int count;                 // Размер массива (для массивов и меток-массивов), иначе 0
+        std::vector<bool> inited;  // Инициализирован ли (по элементам для массива)
+        bool counter = false;      // Счётчик цикла: не присваивается и не перекрывается
+    };
+
+    std::mt19937 rng;
+    GenOptions opt;
+    std::vector<std::vector<Symbol>> scopes;
+    std::string out;
+    int indent;
+    int nameCounter;
+    bool allowErrors; // В этой программе возможны ошибки выполнения
+
+    int Rand(int n) { return static_cast<int>(rng() % static_cast<uint32_t>(n)); }
+    bool Chance(int percent) { return Rand(100) < percent; }
+
+    std::string NewName(const char* prefix);
+    void Line(const std::string& text);
+
+    // Поиск видимого символа (ближайшая область)
+    Symbol* Find(const std::string& name);
+
+    DATA_TYPE RandomBasicType();
+    std::string TypeKeyword(DATA_TYPE t);
+    std::string RandomConst(bool allowNegative);
+
+    // Операнд: инициализированная переменная/константа/элемент массива; пусто, если нет
+    std::string RandomOperand(bool allowUninit);
+    std::string GenExpr(int depth);
+    std::string GenRel(int depth);
+    std::string GenAdd(int depth);
+    std::string GenMul(int depth);
+    std::string GenPrim(int depth);
+
+    void GenTypedef();
+    void GenDecl(bool isConst);
+    void GenStmt(int depth);
+    void GenWhile(int depth);
+    // tail -- последняя строка блока (приращение счётчика цикла)
+    void GenBlock(int depth, int items, const std::string& tail = "");
+};
@@ -0,0 +1,562 @@
+#include "jit.h"
+#include "context.h"
+#include "tree.h"
+
+#include <cstddef>
+#include <cstring>
+#include <map>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define TAYAT_JIT 1
+#include <sys/mman.h>
+#else
+#define TAYAT_JIT 0
+#endif
+
+bool Jit::Supported() {
+    return TAYAT_JIT != 0;
+}
+
+Jit::Jit(Context& ctx, const std::vector<Instr>& code, uint64_t threshold)
+    : ctx(ctx), code(code), threshold(threshold), loops(code.size()), compiled(0) {
+}
+
+#if TAYAT_JIT
+
+Jit::~Jit() {
+    for (const Block& b : blocks) {
+        munmap(b.memory, b.size);
+    }
+}
+
+int Jit::Enter(Native native, Vm::Slot* slots, int64_t*& sp) {
+    Frame frame = { slots, sp, ctx.ring.Events(), ctx.ring.Head(), &ctx.iterations, &ctx.currentArea };
+    int next = native(&frame);
+    sp = frame.sp;
+    return next;
+}
+
+namespace {
+
+enum REG { RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSI = 6, R12 = 12, R13 = 13, R14 = 14, R15 = 15 };
+
+// Условия переходов и setcc
+enum COND { CC_O = 0x0, CC_AE = 0x3, CC_A = 0x7, CC_E = 0x4, CC_NE = 0x5, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF };
+
+// Кодирование команд x86-64: только те формы, что нужны шаблонам.
+// Память адресуется как [база + disp32]
+class Assembler {
+public:
+    std::vector<uint8_t> bytes;
+
+    void MovLoad(int dst, int base, int32_t disp) { Rex(true, dst, base); Byte(0x8B); Mem(dst, base, disp); }
+    void MovStore(int base, int32_t disp, int src) { Rex(true, src, base); Byte(0x89); Mem(src, base, disp); }
+    void MovStoreImm64(int base, int32_t disp, int32_t value) { Rex(true, 0, base); Byte(0xC7); Mem(0, base, disp); Dword(value); }
+    void MovStoreImm32(int base, int32_t disp, int32_t value) { Rex(false, 0, base); Byte(0xC7); Mem(0, base, disp); Dword(value); }
+    void MovStoreImm8(int base, int32_t disp, uint8_t value) { Rex(false, 0, base); Byte(0xC6); Mem(0, base, disp); Byte(value); }
+    void CmpImm8(int base, int32_t disp, uint8_t value) { Rex(false, 0, base); Byte(0x80); Mem(7, base, disp); Byte(value); }
+    void MovImm(int dst, int64_t value) { Rex(true, 0, dst); Byte(static_cast<uint8_t>(0xB8 + (dst & 7))); Qword(value); }
+
+    void Mov(int dst, int src) { Binary(0x89, dst, src); }
+    void Add(int dst, int src) { Binary(0x01, dst, src); }
+    void Sub(int dst, int src) { Binary(0x29, dst, src); }
+    void And(int dst, int src) { Binary(0x21, dst, src); }
+    void Cmp(int dst, int src) { Binary(0x39, dst, src); }
+    void Test(int dst, int src) { Binary(0x85, dst, src); }
+    void Imul(int dst, int src) { Rex(true, dst, src); Byte(0x0F); Byte(0xAF); Reg(dst, src); }
+    void ImulWide(int src) { Rex(true, 0, src); Byte(0xF7); Reg(5, src); } // rdx:rax = rax * src
+
+    void AddImm(int dst, int32_t value) { Immediate(0, dst, value); }
+    void AndImm(int dst, int32_t value) { Immediate(4, dst, value); }
+    void SubImm(int dst, int32_t value) { Immediate(5, dst, value); }
+    void CmpImm(int dst, int32_t value) { Immediate(7, dst, value); }
+    void Shl(int dst, uint8_t count) { Rex(true, 0, dst); Byte(0xC1); Reg(4, dst); Byte(count); }
+    void Sar(int dst, uint8_t count) { Rex(true, 0, dst); Byte(0xC1); Reg(7, dst); Byte(count); }
+    void Shr(int dst, uint8_t count) { Rex(true, 0, dst); Byte(0xC1); Reg(5, dst); Byte(count); }
+    void Neg(int dst) { Rex(true, 0, dst); Byte(0xF7); Reg(3, dst); }
+    void Idiv(int src) { Rex(true, 0, src); Byte(0xF7); Reg(7, src); }
+    void Cqo() { Byte(0x48); Byte(0x99); }
+    void Idiv32(int src) { Rex(false, 0, src); Byte(0xF7); Reg(7, src); } // edx:eax / src
+    void Cdq() { Byte(0x99); }
+    void Movsxd(int dst, int src) { Rex(true, dst, src); Byte(0x63); Reg(dst, src); }
+    void ZeroEax() { Byte(0x31); Byte(0xC0); }
+    void MovEax(int32_t value) { Byte(0xB8); Dword(value); }
+    void SetccRax(COND cc) { Byte(0x0F); Byte(static_cast<uint8_t>(0x90 | cc)); Byte(0xC0); Byte(0x0F); Byte(0xB6); Byte(0xC0); }
+
+    void Push(int r) { if (r & 8) Byte(0x41); Byte(static_cast<uint8_t>(0x50 + (r & 7))); }
+    void Pop(int r) { if (r & 8) Byte(0x41); Byte(static_cast<uint8_t>(0x58 + (r & 7))); }
+    void Ret() { Byte(0xC3); }
+
+    // Метки и переходы rel32 (адреса подставляет Link)
+    int NewLabel() { labels.push_back(-1); return static_cast<int>(labels.size()) - 1; }
+    void Bind(int label) { labels[label] = static_cast<int>(bytes.size()); }
+    void Jmp(int label) { Byte(0xE9); Fixup(label); }
+    void Jcc(COND cc, int label) { Byte(0x0F); Byte(static_cast<uint8_t>(0x80 | cc)); Fixup(label); }
+
+    void Link() {
+        for (const auto& f : fixups) {
+            int32_t rel = labels[f.second] - (f.first + 4);
+            std::memcpy(&bytes[f.first], &rel, 4);
+        }
+    }
+
+private:
+    std::vector<int> labels;
+    std::vector<std::pair<int, int>> fixups; // Позиция rel32, метка
+
+    void Byte(uint8_t b) { bytes.push_back(b); }
+    void Dword(int32_t v) { const uint8_t* p = reinterpret_cast<const uint8_t*>(&v); bytes.insert(bytes.end(), p, p + 4); }
+    void Qword(int64_t v) { const uint8_t* p = reinterpret_cast<const uint8_t*>(&v); bytes.insert(bytes.end(), p, p + 8); }
+    void Fixup(int label) { fixups.push_back({ static_cast<int>(bytes.size()), label }); Dword(0); }
+
+    void Rex(bool w, int reg, int base) {
+        uint8_t rex = static_cast<uint8_t>(0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((base & 8) ? 1 : 0));
+        if (rex != 0x40) Byte(rex);
+    }
+    void Mem(int reg, int base, int32_t disp) {
+        Byte(static_cast<uint8_t>(0x80 | ((reg & 7) << 3) | (base & 7)));
+        if ((base & 7) == 4) Byte(0x24); // r12: нужен байт SIB
+        Dword(disp);
+    }
+    void Reg(int reg, int rm) { Byte(static_cast<uint8_t>(0xC0 | ((reg & 7) << 3) | (rm & 7))); }
+    void Binary(uint8_t opcode, int dst, int src) { Rex(true, src, dst); Byte(opcode); Reg(src, dst); }
+    void Immediate(int ext, int dst, int32_t value) { Rex(true, 0, dst); Byte(0x81); Reg(ext, dst); Dword(value); }
+};
+
+const int32_t SLOT_SIZE = static_cast<int32_t>(sizeof(Vm::Slot));
+const int32_t SLOT_VALUE = static_cast<int32_t>(offsetof(Vm::Slot, value));
+const int32_t SLOT_INIT = static_cast<int32_t>(offsetof(Vm::Slot, init));
+
+static_assert(sizeof(RingEvent) == 32, "Машинный код вычисляет адрес события сдвигом на 5");
+
+} // namespace
+
+// Операция с константой по плану замены (optimizer.h, OPT_STRENGTH): x в rax, константа в rcx,
+// результат в rax (до приведения к типу); rdx, rsi -- рабочие
+static void EmitReduced(Assembler& as, const Instr& in) {
+    const uint8_t k = static_cast<uint8_t>(in.a);
+    switch (in.reduce) {
+    case REDUCE_SHL:
+        if (k > 0) as.Shl(RAX, k);
+        break;
+    case REDUCE_SHL_ADD:
+    case REDUCE_SHL_SUB:
+        as.Mov(RDX, RAX);
+        as.Shl(RAX, k);
+        if (in.reduce == REDUCE_SHL_ADD) as.Add(RAX, RDX);
+        else as.Sub(RAX, RDX);
+        break;
+    case REDUCE_DIV_POW2:
+    case REDUCE_MOD_POW2:
+        if (k == 0) {
+            if (in.reduce == REDUCE_MOD_POW2) as.ZeroEax();
+            break;
+        }
+        // Смещение 2^k - 1 для отрицательного x
+        as.Mov(RDX, RAX);
+        as.Sar(RDX, 63);
+        as.Shr(RDX, static_cast<uint8_t>(64 - k));
+        as.Add(RDX, RAX);
+        if (in.reduce == REDUCE_DIV_POW2) {
+            as.Sar(RDX, k);
+            as.Mov(RAX, RDX);
+        }
+        else {
+            if (k < 32) {
+                as.AndImm(RDX, -(int32_t(1) << k));
+            }
+            else {
+                as.MovImm(RSI, static_cast<int64_t>(~((uint64_t(1) << k) - 1)));
+                as.And(RDX, RSI);
+            }
+            as.Sub(RAX, RDX);
+        }
+        break;
+    case REDUCE_DIV_MAGIC:
+    case REDUCE_MOD_MAGIC:
+        as.Mov(RSI, RAX);
+        as.MovImm(RDX, in.imm);
+        if (in.shift >= 32) {
+            // x и магическое число умещаются в 32 бита: произведение -- в 64
+            as.Imul(RAX, RDX);
+            as.Sar(RAX, 32);
+        }
+        else {
+            as.ImulWide(RDX);
+            as.Mov(RAX, RDX);
+        }
+        if (in.b & REDUCE_ADD) as.Add(RAX, RSI);
+        if (k > 0) as.Sar(RAX, k);
+        as.Mov(RDX, RSI);
+        as.Shr(RDX, 63);
+        as.Add(RAX, RDX);
+        if (in.reduce == REDUCE_MOD_MAGIC) {
+            if (in.b & REDUCE_NEG) as.Neg(RAX);
+            as.Imul(RAX, RCX);
+            as.Sub(RSI, RAX);
+            as.Mov(RAX, RSI);
+            return;
+        }
+        break;
+    }
+    if (in.b & REDUCE_NEG) {
+        as.Neg(RAX);
+    }
+}
+
+// Регистры машинного кода: rbx -- ячейки, r12 -- вершина стека значений,
+// r13 -- события истории, r14 -- счётчик событий, r15 -- Frame; rax, rcx, rdx, rsi -- рабочие
+bool Jit::Compile(int loop) {
+    Entry& entry = loops[loop];
+    entry.failed = true;
+
+    const int head = code[loop].a;
+    const bool debug = ctx.debug;
+    const bool checked = ctx.checkedArithmetic;
+    const bool ring = ctx.ring.Capacity() > 0;
+    const size_t ring_mask = ctx.ring.Mask();
+    const uint64_t max_iterations = ctx.maxIterations;
+    if ((head < 0) || (head > loop) || (ring_mask > 0x7fffffff)) {
+        return false;
+    }
+
+    // Проверка: смещения ячеек умещаются в disp32, в debug режиме нет предупреждений о типах
+    for (int i = head; i <= loop; i++) {
+        const Instr& in = code[i];
+        int op = BaseOpcode(in.op);
+        if ((in.a > (0x7fffffff - SLOT_SIZE) / SLOT_SIZE) || (((op == OP_LOOP) || (op == OP_NEXT)) && (in.imm - in.b > 4096))) {
+            return false;
+        }
+        if (debug && (((op >= OP_ADD) && (op <= OP_MOD) && in.warn) || ((op == OP_STORE) && (in.type2 != in.type)))) {
+            return false;
+        }
+    }
+
+    Assembler as;
+    std::vector<int> at(static_cast<size_t>(loop - head + 1));
+    for (int& label : at) {
+        label = as.NewLabel();
+    }
+    std::map<int, int> exits; // Адрес команды -> метка выхода на неё
+    auto exit_to = [&](int pc) {
+        auto it = exits.find(pc);
+        if (it == exits.end()) {
+            it = exits.insert({ pc, as.NewLabel() }).first;
+        }
+        return it->second;
+    };
+    auto target = [&](int pc) {
+        return ((pc >= head) && (pc <= loop)) ? at[static_cast<size_t>(pc - head)] : exit_to(pc);
+    };
+
+    const int32_t ev_type = static_cast<int32_t>(offsetof(RingEvent, value) + offsetof(SemNode, DataType));
+    const int32_t ev_has = static_cast<int32_t>(offsetof(RingEvent, value) + offsetof(SemNode, hasValue));
+    const int32_t ev_value = static_cast<int32_t>(offsetof(RingEvent, value) + offsetof(SemNode, Value));
+    // Как ExecRing::Record; значение (если есть) -- в rax
+    auto record = [&](RING_EVENT kind, int node, char op, int type, bool value, const Instr& in) {
+        if (!ring) return;
+        as.MovLoad(RDX, R14, 0);
+        as.Mov(RCX, RDX);
+        as.AndImm(RCX, static_cast<int32_t>(ring_mask));
+        as.Shl(RCX, 5);
+        as.Add(RCX, R13);
+        as.MovStoreImm32(RCX, ev_type, value ? type : 0);
+        as.MovStoreImm8(RCX, ev_has, value ? 1 : 0);
+        if (value) {
+            as.MovStore(RCX, ev_value, RAX);
+        }
+        else {
+            as.MovStoreImm64(RCX, ev_value, 0);
+        }
+        as.MovStoreImm32(RCX, static_cast<int32_t>(offsetof(RingEvent, line)), in.line);
+        as.MovStoreImm32(RCX, static_cast<int32_t>(offsetof(RingEvent, col)), in.col);
+        as.MovStoreImm32(RCX, static_cast<int32_t>(offsetof(RingEvent, node)), node);
+        as.MovStoreImm8(RCX, static_cast<int32_t>(offsetof(RingEvent, kind)), static_cast<uint8_t>(kind));
+        as.MovStoreImm8(RCX, static_cast<int32_t>(offsetof(RingEvent, op)), static_cast<uint8_t>(op));
+        as.AddImm(RDX, 1);
+        as.MovStore(R14, 0, RDX);
+    };
+    auto wrap = [&](int reg, uint8_t shift) {
+        if (shift > 0) {
+            as.Shl(reg, shift);
+            as.Sar(reg, shift);
+        }
+    };
+
+    // Пролог: сохранить регистры, загрузить указатели из Frame (rdi)
+    as.Push(RBX);
+    as.Push(R12);
+    as.Push(R13);
+    as.Push(R14);
+    as.Push(R15);
+    as.Mov(R15, 7 /* rdi */);
+    as.MovLoad(RBX, R15, static_cast<int32_t>(offsetof(Frame, slots)));
+    as.MovLoad(R12, R15, static_cast<int32_t>(offsetof(Frame, sp)));
+    as.MovLoad(R13, R15, static_cast<int32_t>(offsetof(Frame, ring)));
+    as.MovLoad(R14, R15, static_cast<int32_t>(offsetof(Frame, ringHead)));
+
+    static const char OP_CHAR[5] = { '+', '-', '*', '/', '%' };
+    for (int i = head; i <= loop; i++) {
+        const Instr& in = code[i];
+        as.Bind(at[static_cast<size_t>(i - head)]);
+        const int32_t slot = in.a * SLOT_SIZE;
+
+        switch (BaseOpcode(in.op)) {
+        case OP_NOP:
+            break;
+        case OP_CONST:
+            if ((in.imm >= INT32_MIN) && (in.imm <= INT32_MAX)) {
+                as.MovStoreImm64(R12, 0, static_cast<int32_t>(in.imm));
+            }
+            else {
+                as.MovImm(RAX, in.imm);
+                as.MovStore(R12, 0, RAX);
+            }
+            as.AddImm(R12, 8);
+            break;
+        case OP_LOAD:
+            // Переменная инициализирована на всех путях (PROVEN_INIT) -- без проверки
+            if (!(in.proven & PROVEN_INIT)) {
+                as.CmpImm8(RBX, slot + SLOT_INIT, 0);
+                as.Jcc(CC_E, exit_to(i));
+            }
+            as.MovLoad(RAX, RBX, slot + SLOT_VALUE);
+            as.MovStore(R12, 0, RAX);
+            as.AddImm(R12, 8);
+            break;
+        case OP_STORE:
+            as.MovLoad(RAX, R12, -8);
+            if ((in.type2 != in.type) && (in.shift > 0) && !(in.proven & PROVEN_FITS)) {
+                // Значение не умещается в тип переменной -- предупреждение об обрезке выдаёт машина
+                as.Mov(RDX, RAX);
+                wrap(RDX, in.shift);
+                as.Cmp(RDX, RAX);
+                as.Jcc(CC_NE, exit_to(i));
+            }
+            as.SubImm(R12, 8);
+            as.MovStore(RBX, slot + SLOT_VALUE, RAX);
+            as.MovStoreImm8(RBX, slot + SLOT_INIT, 1);
+            record(RING_ASSIGN, in.a, 0, in.type, true, in);
+            break;
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD: case OP_DIVQ: case OP_MODQ: {
+            int op = BaseOpcode(in.op);
+            if ((op == OP_DIVQ) || (op == OP_MODQ)) {
+                // Деление на ноль в предзаголовке -- снять imm значений и перейти на b
+                int nonzero = as.NewLabel();
+                as.MovLoad(RCX, R12, -8);
+                as.Test(RCX, RCX);
+                as.Jcc(CC_NE, nonzero);
+                as.SubImm(R12, static_cast<int32_t>(in.imm * 8));
+                as.Jmp(target(in.b));
+                as.Bind(nonzero);
+                op = (op == OP_DIVQ) ? OP_DIV : OP_MOD;
+            }
+            as.MovLoad(RAX, R12, -16);
+            as.MovLoad(RCX, R12, -8);
+            // Переполнение (checked): longlong -- флаг OF, short, int и long -- результат в 64 битах
+            // не умещается в тип (ниже); ошибку выдаёт машина. Замену (in.reduce) оптимизатор в этом
+            // режиме делает только для деления и остатка на константу, кроме -1: они не переполняются.
+            // Результат в диапазоне типа (PROVEN_FITS) -- без проверки и приведения (кроме замены)
+            const bool fits = (in.proven & PROVEN_FITS) != 0;
+            const bool check = checked && !fits && (in.reduce == REDUCE_NONE) && (op != OP_MOD);
+            if (in.reduce != REDUCE_NONE) EmitReduced(as, in);
+            else if (op == OP_ADD) as.Add(RAX, RCX);
+            else if (op == OP_SUB) as.Sub(RAX, RCX);
+            else if (op == OP_MUL) as.Imul(RAX, RCX);
+            else {
+                // Деление на ноль -- ошибка выполнения в машине; на -1 -- без idiv (INT64_MIN / -1)
+                int divide = as.NewLabel();
+                int done = as.NewLabel();
+                as.Test(RCX, RCX);
+                as.Jcc(CC_E, exit_to(i));
+                as.CmpImm(RCX, -1);
+                as.Jcc(CC_NE, divide);
+                if (op == OP_DIV) as.Neg(RAX);
+                else as.ZeroEax();
+                if (check && (in.shift == 0)) as.Jcc(CC_O, exit_to(i));
+                as.Jmp(done);
+                as.Bind(divide);
+                if (in.proven & PROVEN_NARROW) {
+                    // Операнды и результат умещаются в int32: idiv r32 быстрее
+                    as.Cdq();
+                    as.Idiv32(RCX);
+                    as.Movsxd(RAX, (op == OP_MOD) ? RDX : RAX);
+                }
+                else {
+                    as.Cqo();
+                    as.Idiv(RCX);
+                    if (op == OP_MOD) as.Mov(RAX, RDX);
+                }
+                as.Bind(done);
+            }
+            if (check && (in.shift == 0) && (op <= OP_MUL)) {
+                as.Jcc(CC_O, exit_to(i));
+            }
+            if (check && (in.shift > 0)) {
+                as.Mov(RDX, RAX);
+                wrap(RDX, in.shift);
+                as.Cmp(RDX, RAX);
+                as.Jcc(CC_NE, exit_to(i));
+            }
+            if (!fits || (in.reduce != REDUCE_NONE)) wrap(RAX, in.shift);
+            as.SubImm(R12, 8);
+            as.MovStore(R12, -8, RAX);
+            record(RING_ARITH, Tree::NONE, OP_CHAR[op - OP_ADD], in.type, true, in);
+            break;
+        }
+        case OP_LT: case OP_LE: case OP_GT: case OP_GE: case OP_EQ: case OP_NE: {
+            static const COND CONDS[6] = { CC_L, CC_LE, CC_G, CC_GE, CC_E, CC_NE };
+            as.MovLoad(RAX, R12, -16);
+            as.MovLoad(RCX, R12, -8);
+            as.Cmp(RAX, RCX);
+            as.SetccRax(CONDS[BaseOpcode(in.op) - OP_LT]);
+            as.SubImm(R12, 8);
+            as.MovStore(R12, -8, RAX);
+            break;
+        }
+        case OP_JMP:
+            as.Jmp(target(in.a));
+            break;
+        case OP_JZ:
+            as.SubImm(R12, 8);
+            as.MovLoad(RAX, R12, 0);
+            as.Test(RAX, RAX);
+            as.Jcc(CC_E, target(in.a));
+            break;
+        case OP_LOOP:
+        case OP_NEXT:
+            // Tree::CountIteration: при достижении предела ошибку выдаёт машина
+            as.MovLoad(RDX, R15, static_cast<int32_t>(offsetof(Frame, iterations)));
+            as.MovLoad(RAX, RDX, 0);
+            if (max_iterations > 0) {
+                as.MovImm(RCX, static_cast<int64_t>(max_iterations));
+                as.Cmp(RAX, RCX);
+                as.Jcc(CC_AE, exit_to(i));
+            }
+            as.AddImm(RAX, 1);
+            as.MovStore(RDX, 0, RAX);
+            for (int64_t n = in.b; n < in.imm; n++) {
+                as.MovStoreImm8(RBX, static_cast<int32_t>(n) * SLOT_SIZE + SLOT_INIT, 0);
+            }
+            if (in.op == OP_LOOP) {
+                as.Jmp(target(in.a));
+            }
+            break;
+        case OP_ITER:
+            // Предел будет превышен -- запасной путь a (исходный цикл)
+            as.MovLoad(RDX, R15, static_cast<int32_t>(offsetof(Frame, iterations)));
+            as.MovLoad(RAX, RDX, 0);
+            if ((max_iterations > 0) && (max_iterations < static_cast<uint64_t>(in.imm))) {
+                as.Jmp(target(in.a));
+                break;
+            }
+            if (max_iterations > 0) {
+                as.MovImm(RCX, static_cast<int64_t>(max_iterations - static_cast<uint64_t>(in.imm)));
+                as.Cmp(RAX, RCX);
+                as.Jcc(CC_A, target(in.a));
+            }
+            as.MovImm(RCX, in.imm);
+            as.Add(RAX, RCX);
+            as.MovStore(RDX, 0, RAX);
+            break;
+        case OP_TGET: {
+            int compute = as.NewLabel();
+            as.CmpImm8(RBX, slot + SLOT_INIT, 0);
+            as.Jcc(CC_E, compute);
+            as.MovLoad(RAX, RBX, slot + SLOT_VALUE);
+            as.MovStore(R12, 0, RAX);
+            as.AddImm(R12, 8);
+            as.Jmp(target(in.b));
+            as.Bind(compute);
+            break;
+        }
+        case OP_TSET:
+            as.MovLoad(RAX, R12, -8);
+            as.SubImm(R12, 8);
+            as.MovStore(RBX, slot + SLOT_VALUE, RAX);
+            as.MovStoreImm8(RBX, slot + SLOT_INIT, 1);
+            break;
+        case OP_TCLR:
+            as.MovStoreImm8(RBX, slot + SLOT_INIT, 0);
+            break;
+        case OP_LOADQ: {
+            int loaded = as.NewLabel();
+            as.CmpImm8(RBX, slot + SLOT_INIT, 0);
+            as.Jcc(CC_NE, loaded);
+            as.SubImm(R12, static_cast<int32_t>(in.imm * 8));
+            as.Jmp(target(in.b));
+            as.Bind(loaded);
+            as.MovLoad(RAX, RBX, slot + SLOT_VALUE);
+            as.MovStore(R12, 0, RAX);
+            as.AddImm(R12, 8);
+            break;
+        }
+        case OP_ENTER:
+            as.MovLoad(RDX, R15, static_cast<int32_t>(offsetof(Frame, currentArea)));
+            as.MovStoreImm32(RDX, 0, in.a);
+            record(RING_ENTER, in.a, 0, 0, false, in);
+            break;
+        case OP_EXIT:
+            record(RING_EXIT, in.a, 0, 0, false, in);
+            as.MovLoad(RDX, R15, static_cast<int32_t>(offsetof(Frame, currentArea)));
+            as.MovStoreImm32(RDX, 0, in.b);
+            break;
+        default:
+            // RAISE, HALT -- выполняет машина
+            as.Jmp(exit_to(i));
+            break;
+        }
+    }
+    // Последняя команда -- LOOP, управление сюда не доходит
+
+    // Выходы: сохранить вершину стека, вернуть адрес команды
+    int epilogue = as.NewLabel();
+    for (const auto& e : exits) {
+        as.Bind(e.second);
+        as.MovStore(R15, static_cast<int32_t>(offsetof(Frame, sp)), R12);
+        as.MovEax(e.first);
+        as.Jmp(epilogue);
+    }
+    as.Bind(epilogue);
+    as.Pop(R15);
+    as.Pop(R14);
+    as.Pop(R13);
+    as.Pop(R12);
+    as.Pop(RBX);
+    as.Ret();
+    as.Link();
+
+    // Память сначала доступна для записи, затем только для выполнения
+    size_t size = as.bytes.size();
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+    std::memcpy(memory, as.bytes.data(), size);
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return false;
+    }
+    blocks.push_back({ memory, size });
+
+    entry.native = reinterpret_cast<Native>(memory);
+    entry.failed = false;
+    compiled++;
+    return true;
+}
+
+#else
+
+Jit::~Jit() {
+}
+
+int Jit::Enter(Native, Vm::Slot*, int64_t*&) {
+    return -1;
+}
+
+bool Jit::Compile(int loop) {
+    loops[loop].failed = true;
+    return false;
+}
+
+#endif
@@ -0,0 +1,80 @@
+#pragma once
+#include "vm.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Context;
+
+// Трансляция горячих циклов байт-кода в машинный код x86-64 (Linux).
+// Цикл -- команды от начала условия до его LOOP; после threshold обратных переходов
+// каждая команда цикла заменяется шаблоном машинного кода с той же семантикой,
+// что и у виртуальной машины: арифметика в 64 битах с приведением к типу,
+// история выполнения (ExecRing), счёт итераций, сброс имён тела.
+// Всё, что требует интерпретатора (чтение неинициализированной переменной,
+// деление на ноль, обрезка при присваивании, предел итераций, RAISE, HALT,
+// переход за пределы цикла), -- выход из машинного кода на эту же команду
+// с неизменённым стеком: её выполняет виртуальная машина, выдавая те же сообщения.
+// Стек значений и ячейки переменных -- общие с машиной, поэтому войти в машинный
+// код и выйти из него можно на любой команде.
+// Циклы с предупреждениями о преобразовании типов в debug режиме не транслируются
+class Jit {
+public:
+    // Есть ли машинный код для этой платформы
+    static bool Supported();
+
+    Jit(Context& ctx, const std::vector<Instr>& code, uint64_t threshold);
+    ~Jit();
+
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+
+    // Виртуальная машина выполнила LOOP с адресом loop. Если цикл оттранслирован
+    // (в том числе только что), выполняет его с начала и возвращает адрес, с которого
+    // продолжает машина (sp обновляется); иначе -1
+    int Run(int loop, Vm::Slot* slots, int64_t*& sp) {
+        Entry& e = loops[loop];
+        if (!e.native) {
+            if (e.failed || (++e.hits < threshold) || !Compile(loop)) {
+                return -1;
+            }
+        }
+        return Enter(e.native, slots, sp);
+    }
+
+    // Оттранслировано циклов
+    int Compiled() const { return compiled; }
+
+private:
+    // Аргумент машинного кода: указатели, которые он держит в регистрах
+    struct Frame {
+        Vm::Slot* slots;
+        int64_t* sp;
+        void* ring;
+        uint64_t* ringHead;
+        uint64_t* iterations;
+        int* currentArea;
+    };
+    typedef int (*Native)(Frame*);
+
+    struct Entry {
+        Native native = nullptr;
+        uint64_t hits = 0;
+        bool failed = false;
+    };
+
+    struct Block {
+        void* memory;
+        size_t size;
+    };
+
+    Context& ctx;
+    const std::vector<Instr>& code;
+    uint64_t threshold;
+    std::vector<Entry> loops;   // По адресам команд LOOP
+    std::vector<Block> blocks;  // Выделенная исполняемая память
+    int compiled;
+
+    bool Compile(int loop);
+    int Enter(Native native, Vm::Slot* slots, int64_t*& sp);
+};
@@ -1,16 +1,313 @@
 #include <iostream>
+#include <fstream>
 #include <string>
+#include <vector>
+#include <thread>
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 
 #include "diagram.h"
+#include "batch.h"
+#include "c_emitter.h"
+#include "optimizer.h"
+#include "program_error.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "vm.h"
+
+// Открыть снимок общих объявлений
+static bool OpenPrelude(Snapshot& prelude, const std::string& file_name) {
+    if (!prelude.Open(file_name)) {
+        std::cerr << "Невозможно открыть снимок " << file_name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Разбор формата печати дерева: text | dot | json
+static bool ParsePrintFormat(const std::string& name, PRINT_FORMAT& format) {
+    if (name == "text") format = PRINT_TEXT;
+    else if (name == "dot") format = PRINT_DOT;
+    else if (name == "json") format = PRINT_JSON;
+    else {
+        std::cerr << "Неизвестный формат печати дерева " << name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Разбор формата трассировки: text | binary
+static bool ParseTraceFormat(const std::string& name, TRACE_FORMAT& format) {
+    if (name == "text") format = TRACE_TEXT;
+    else if (name == "binary") format = TRACE_BINARY;
+    else {
+        std::cerr << "Неизвестный формат трассировки " << name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Разбор исполнителя: tree | vm
+static bool ParseEngine(const std::string& name, EXEC_ENGINE& engine) {
+    if (name == "tree") engine = ENGINE_TREE;
+    else if (name == "vm") engine = ENGINE_VM;
+    else {
+        std::cerr << "Неизвестный исполнитель " << name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Разбор списка оптимизаций байт-кода: licm,strength | all | none
+static bool ParseOptimizations(const std::string& list, unsigned& passes) {
+    if (!ParseOptPasses(list, passes)) {
+        std::cerr << "Неизвестная оптимизация в списке " << list << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Перевод двоичной трассировки в текст: lab4 --decode-trace файл
+static int DecodeTrace(const std::string& file_name) {
+    std::ifstream in(file_name, std::ios::binary);
+    if (!in) {
+        std::cerr << "Невозможно открыть " << file_name << std::endl;
+        return -1;
+    }
+    if (!TraceSink::Decode(in, std::cout)) {
+        std::cerr << "Повреждённый файл трассировки " << file_name << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Пакетный режим: lab4 --batch [-j N] [--tree | --check] [--format text|dot|json] [--debug] [--scaling] [--snapshot файл] файл|каталог ...
+static int RunBatch(int argc, char** argv) {
+    unsigned threads = std::thread::hardware_concurrency();
+    bool isInterp = true;
+    bool isDebug = false;
+    bool checkOnly = false;
+    bool scaling = false;
+    PRINT_FORMAT format = PRINT_TEXT;
+    Snapshot prelude;
+    bool hasPrelude = false;
+    std::vector<std::string> paths;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-j") && (i + 1 < argc)) {
+            threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--tree") {
+            isInterp = false;
+        }
+        else if (arg == "--check") {
+            isInterp = false;
+            checkOnly = true;
+        }
+        else if ((arg == "--format") && (i + 1 < argc)) {
+            if (!ParsePrintFormat(argv[++i], format)) return -1;
+        }
+        else if (arg == "--debug") {
+            isDebug = true;
+        }
+        else if (arg == "--scaling") {
+            scaling = true;
+        }
+        else if ((arg == "--snapshot") && (i + 1 < argc)) {
+            if (!OpenPrelude(prelude, argv[++i])) return -1;
+            hasPrelude = true;
+        }
+        else {
+            paths.push_back(arg);
+        }
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    std::vector<std::string> files = BatchRunner::CollectFiles(paths);
+    if (files.empty()) {
+        std::cerr << "Не заданы входные файлы" << std::endl;
+        return -1;
+    }
+
+    BatchRunner runner(threads, isInterp, isDebug);
+    runner.SetPrelude(hasPrelude ? &prelude : nullptr);
+    runner.SetPrintFormat(format);
+    runner.SetCheckOnly(checkOnly);
+
+    if (scaling) {
+        runner.ReportScaling(files, std::cerr);
+        return 0;
+    }
+    std::vector<BatchResult> results = runner.Run(files);
+    BatchRunner::WriteResults(results, std::cout);
+
+    int failed = 0;
+    for (const BatchResult& r : results) {
+        if (!r.ok) failed++;
+    }
+
+    double seconds = runner.LastSeconds();
+    std::cerr << "Файлов: " << files.size() << ", с ошибками: " << failed
+        << ", потоков: " << threads << ", время: " << seconds << " с";
+    if (seconds > 0.0) {
+        std::cerr << ", " << (files.size() / seconds) << " файлов/с";
+    }
+    std::cerr << std::endl;
+
+    return (failed == 0) ? 0 : 1;
+}
 
 int main(int argc, char** argv) {
 
+#ifdef _WIN32
     SetConsoleCP(1251);
     SetConsoleOutputCP(1251);
+#endif
+
+    if ((argc > 1) && (std::string(argv[1]) == "--batch")) {
+        return RunBatch(argc, argv);
+    }
+    if ((argc > 2) && (std::string(argv[1]) == "--decode-trace")) {
+        return DecodeTrace(argv[2]);
+    }
 
+    // Обычный режим: lab4 [--tree | --check] [--format text|dot|json] [--debug] [--trace файл]
+    //     [--trace-format text|binary] [--trace-async] [--ring N] [--dump-ring]
+    //     [--profile] [--profile-top N] [--profile-folded файл] [--stats]
+    //     [--engine tree|vm] [--no-super] [--dump-code] [--max-iterations N] [--jit N] [--checked]
+    //     [--opt список] [--unroll N] [--emit-c файл] [--snapshot файл] [--save-snapshot файл] [--warn-uninit] [файл]
     std::string fname = "input.txt";
-    if (argc > 1) fname = argv[1];
+    std::string save_snapshot;
+    bool isInterp = true;
+    bool isDebug = false;
+    bool checkOnly = false;
+    PRINT_FORMAT format = PRINT_TEXT;
+    std::string trace_file;
+    TRACE_FORMAT trace_format = TRACE_TEXT;
+    bool trace_async = false;
+    size_t ring_size = ExecRing::DEFAULT_CAPACITY;
+    bool dump_ring = false;
+    bool profile = false;
+    size_t profile_top = 20;
+    std::string profile_folded;
+    bool show_stats = false;
+    EXEC_ENGINE engine = ENGINE_TREE;
+    bool superinstructions = true;
+    unsigned optimizations = 0;
+    int unroll_factor = UNROLL_DEFAULT;
+    bool dump_code = false;
+    std::string emit_c;
+    uint64_t max_iterations = 0;
+    uint64_t jit_threshold = 0;
+    bool checked = false;
+    bool warn_uninit = false;
+    Snapshot prelude;
+    bool hasPrelude = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "--snapshot") && (i + 1 < argc)) {
+            if (!OpenPrelude(prelude, argv[++i])) return -1;
+            hasPrelude = true;
+        }
+        else if ((arg == "--save-snapshot") && (i + 1 < argc)) {
+            save_snapshot = argv[++i];
+        }
+        else if (arg == "--tree") {
+            isInterp = false;
+        }
+        else if (arg == "--check") {
+            isInterp = false;
+            checkOnly = true;
+        }
+        else if ((arg == "--format") && (i + 1 < argc)) {
+            if (!ParsePrintFormat(argv[++i], format)) return -1;
+        }
+        else if (arg == "--debug") {
+            isDebug = true;
+        }
+        else if ((arg == "--trace") && (i + 1 < argc)) {
+            trace_file = argv[++i];
+            isDebug = true;
+        }
+        else if ((arg == "--trace-format") && (i + 1 < argc)) {
+            if (!ParseTraceFormat(argv[++i], trace_format)) return -1;
+        }
+        else if (arg == "--trace-async") {
+            trace_async = true;
+        }
+        else if ((arg == "--ring") && (i + 1 < argc)) {
+            ring_size = static_cast<size_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--dump-ring") {
+            dump_ring = true;
+        }
+        else if (arg == "--profile") {
+            profile = true;
+        }
+        else if ((arg == "--profile-top") && (i + 1 < argc)) {
+            profile_top = static_cast<size_t>(std::stoul(argv[++i]));
+            profile = true;
+        }
+        else if ((arg == "--profile-folded") && (i + 1 < argc)) {
+            profile_folded = argv[++i];
+            profile = true;
+        }
+        else if (arg == "--stats") {
+            show_stats = true;
+        }
+        else if ((arg == "--engine") && (i + 1 < argc)) {
+            if (!ParseEngine(argv[++i], engine)) return -1;
+        }
+        else if (arg == "--no-super") {
+            superinstructions = false;
+        }
+        else if ((arg == "--opt") && (i + 1 < argc)) {
+            if (!ParseOptimizations(argv[++i], optimizations)) return -1;
+        }
+        else if ((arg == "--unroll") && (i + 1 < argc)) {
+            unroll_factor = std::stoi(argv[++i]);
+        }
+        else if (arg == "--dump-code") {
+            dump_code = true;
+        }
+        else if ((arg == "--emit-c") && (i + 1 < argc)) {
+            emit_c = argv[++i];
+        }
+        else if ((arg == "--max-iterations") && (i + 1 < argc)) {
+            max_iterations = std::stoull(argv[++i]);
+        }
+        else if ((arg == "--jit") && (i + 1 < argc)) {
+            jit_threshold = std::stoull(argv[++i]);
+        }
+        else if (arg == "--checked") {
+            checked = true;
+        }
+        else if (arg == "--warn-uninit") {
+            warn_uninit = true;
+        }
+        else {
+            fname = arg;
+        }
+    }
+
+    // Статистика фаз и выделений памяти: выводится в JSON при завершении (в том числе по ошибке)
+    Stats stats;
+    Stats::Scope stats_scope(show_stats ? &stats : nullptr);
+    struct StatsReport {
+        Stats& stats;
+        bool enabled;
+        ~StatsReport() {
+            if (enabled) {
+                stats.Stop();
+                stats.WriteJson(std::cerr);
+            }
+        }
+    } stats_report{ stats, show_stats };
 
     Scanner sc;
     if (!sc.loadFile(fname)) {
@@ -18,8 +315,186 @@ int main(int argc, char** argv) {
         return -1;
     }
 
-    Diagram dg(&sc);
-    dg.ParseProgram(true);
+    Context ctx;
+    ctx.printFormat = format;
+    ctx.checkOnly = checkOnly;
+    ctx.traceFormat = trace_format;
+    ctx.traceAsync = trace_async;
+    ctx.ring.SetCapacity(ring_size);
+    ctx.engine = engine;
+    ctx.superinstructions = superinstructions ? SUPER_ALL : 0;
+    ctx.optimizations = optimizations;
+    ctx.unrollFactor = unroll_factor;
+    ctx.maxIterations = max_iterations;
+    ctx.jitThreshold = jit_threshold;
+    ctx.checkedArithmetic = checked;
+    ctx.warnUninit = warn_uninit;
+    // Снимок сохраняет объявления со значениями из объявлений, а не после выполнения main
+    ctx.declarationsOnly = !save_snapshot.empty();
+
+    Profiler profiler;
+    if (profile) {
+        ctx.profiler = &profiler;
+    }
+
+    std::ofstream trace_stream;
+    if (!trace_file.empty()) {
+        trace_stream.open(trace_file, std::ios::binary);
+        if (!trace_stream) {
+            std::cerr << "Невозможно открыть " << trace_file << std::endl;
+            return -1;
+        }
+        ctx.traceOut = &trace_stream;
+    }
+
+    if (hasPrelude) {
+        prelude.LoadInto(ctx);
+    }
+
+    Diagram dg(&sc, &ctx);
+
+    // Листинг байт-кода без выполнения
+    if (dump_code) {
+        Code code;
+        dg.CompileProgram(code);
+        // Программа с ошибкой разбора не листингуется (её байт-код завершается RAISE)
+        if (code.parseError >= 0) {
+            std::cerr << FormatDiagnostic(code.errors[code.parseError]);
+            return 1;
+        }
+        Optimize(code, ctx.tree, ctx.optimizations, isDebug, ctx.unrollFactor, checked);
+        Fuse(code, ctx.superinstructions);
+        Disassemble(code, ctx.tree, std::cout);
+        std::cout << "Диспетчеризация: " << Vm::Dispatch() << ", суперкоманды:";
+        for (int p = 0; p < SUPER_COUNT; p++) {
+            std::cout << " " << SuperPatternName(p) << "=" << code.fused[p];
+        }
+        std::cout << std::endl;
+        if (ctx.optimizations & (1u << OPT_LICM)) {
+            std::cout << "Вынесено из циклов выражений: " << code.hoisted << ", операций: " << code.hoistedOps << std::endl;
+        }
+        if (ctx.optimizations & (1u << OPT_STRENGTH)) {
+            std::cout << "Операций с константой заменено сдвигами и умножением: " << code.reduced << std::endl;
+        }
+        if (ctx.optimizations & ((1u << OPT_EVAL) | (1u << OPT_UNROLL))) {
+            std::cout << "Циклов вычислено при трансляции: " << code.evaluated << ", развёрнуто: " << code.unrolled << std::endl;
+        }
+        if (ctx.optimizations & ((1u << OPT_COPY) | (1u << OPT_DSE) | (1u << OPT_UNREACHABLE))) {
+            std::cout << "Чтений заменено копией: " << code.propagated << ", вычислено операций: " << code.folded
+                << ", удалено присваиваний: " << code.deadStores << ", недостижимых команд: " << code.unreachable << std::endl;
+        }
+        if (ctx.optimizations & (1u << OPT_RANGE)) {
+            std::cout << "Присваиваний без проверки обрезки: " << code.fitStores << ", операций без приведения: " << code.fitOps
+                << ", делений в 32 битах: " << code.narrowDivs << std::endl;
+        }
+        if (ctx.optimizations & (1u << OPT_INIT)) {
+            std::cout << "Чтений без проверки значения: " << code.initLoads << ", без значения на всех путях: "
+                << code.uninitLoads.size() << std::endl;
+            for (int pc : code.uninitLoads) {
+                const Diagnostic& e = code.errors[code.instrs[pc].b];
+                std::cout << "    строка " << e.line << ":" << e.col << ": " << e.message << std::endl;
+            }
+        }
+        return 0;
+    }
+
+    // Перевод в C без выполнения
+    if (!emit_c.empty()) {
+        ctx.debug = isDebug;
+        Code code;
+        dg.CompileProgram(code);
+        // Переводится только проверенная программа: с ошибкой разбора -- сообщение, файл не создаётся
+        if (code.parseError >= 0) {
+            std::cerr << FormatDiagnostic(code.errors[code.parseError]);
+            return 1;
+        }
+        Optimize(code, ctx.tree, ctx.optimizations, isDebug, ctx.unrollFactor, checked);
+        std::ofstream c_file(emit_c, std::ios::binary);
+        if (!c_file) {
+            std::cerr << "Невозможно открыть " << emit_c << std::endl;
+            return -1;
+        }
+        CEmitOptions options;
+        options.debug = isDebug;
+        options.maxIterations = max_iterations;
+        options.checked = checked;
+        EmitC(code, ctx.tree, options, c_file);
+        return 0;
+    }
+
+    // Чтения без значения на всех путях (--warn-uninit) -- предупреждения до выполнения. Байт-код
+    // выполнения и проверки (--check) анализируется без повторного разбора; интерпретатору по дереву
+    // байт-код не нужен -- для него программа разбирается ещё раз
+    if (warn_uninit && isInterp && !ctx.RunsBytecode(isInterp)) {
+        Scanner code_sc;
+        code_sc.loadFile(fname);
+        Context code_ctx;
+        code_ctx.out = nullptr;
+        code_ctx.err = nullptr;
+        if (hasPrelude) {
+            prelude.LoadInto(code_ctx);
+        }
+
+        Code code;
+        Diagram code_dg(&code_sc, &code_ctx);
+        try {
+            code_dg.CompileProgram(code);
+            for (const Diagnostic& d : UninitializedReads(code, code_ctx.tree)) {
+                ctx.Warn(d.message, d.line, d.col);
+            }
+        }
+        catch (const ProgramError&) {
+            // Ошибку разбора выдаст основной разбор
+        }
+    }
+
+    if (warn_uninit && checkOnly) {
+        // Проверка тем же разбором, что порождает байт-код
+        Code code;
+        dg.CompileProgram(code);
+        if (code.parseError >= 0) {
+            std::cerr << FormatDiagnostic(code.errors[code.parseError]);
+            return 1;
+        }
+        for (const Diagnostic& d : UninitializedReads(code, ctx.tree)) {
+            ctx.Warn(d.message, d.line, d.col);
+        }
+    }
+    else {
+        try {
+            dg.ParseProgram(isInterp, isDebug);
+        }
+        catch (const ProgramError& e) {
+            std::cerr << e.what();
+            return 1;
+        }
+    }
+
+    if (dump_ring) {
+        ctx.DumpRecent(std::cerr);
+    }
+
+    if (profile) {
+        profiler.Report(std::cerr, profile_top);
+        if (!profile_folded.empty()) {
+            std::ofstream folded(profile_folded);
+            if (!folded) {
+                std::cerr << "Невозможно открыть " << profile_folded << std::endl;
+                return -1;
+            }
+            profiler.WriteFolded(ctx.tree, folded);
+        }
+    }
+
+    // Сохранение разобранных объявлений для последующих запусков (тело main не выполнялось)
+    if (!save_snapshot.empty() && !Snapshot::Save(ctx, save_snapshot)) {
+        std::cerr << "Невозможно записать снимок " << save_snapshot << std::endl;
+        return -1;
+    }
+    if (!save_snapshot.empty() && !Snapshot::Verify(ctx, save_snapshot)) {
+        std::cerr << "Снимок " << save_snapshot << " не совпадает с глобальной областью после загрузки" << std::endl;
+        return -1;
+    }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,1795 @@
+#include "optimizer.h"
+#include "checked_arith.h"
+#include "ssa.h"
+#include "tree.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <set>
+
+static const char* const OPT_PASS_NAMES[OPT_COUNT] = { "licm", "strength", "eval", "unroll", "copy", "dse", "unreachable", "range", "init" };
+
+const char* OptPassName(int pass) {
+    return ((pass >= 0) && (pass < OPT_COUNT)) ? OPT_PASS_NAMES[pass] : "?";
+}
+
+bool ParseOptPasses(const std::string& list, unsigned& passes) {
+    passes = 0;
+    size_t start = 0;
+    for (;;) {
+        size_t comma = list.find(',', start);
+        std::string name = list.substr(start, (comma == std::string::npos) ? std::string::npos : comma - start);
+        if (name == "all") {
+            passes = OPT_ALL;
+        }
+        else if (name != "none") {
+            int p = 0;
+            while ((p < OPT_COUNT) && (name != OPT_PASS_NAMES[p])) {
+                p++;
+            }
+            if (p == OPT_COUNT) {
+                return false;
+            }
+            passes |= 1u << p;
+        }
+        if (comma == std::string::npos) {
+            return true;
+        }
+        start = comma + 1;
+    }
+}
+
+static bool IsArith(int op) {
+    return (op >= OP_ADD) && (op <= OP_MOD);
+}
+
+// Операция может переполнить тип результата (ошибка в режиме проверки переполнения)
+static bool CanOverflow(int op) {
+    return (op >= OP_ADD) && (op <= OP_DIV);
+}
+
+static bool IsBinary(int op) {
+    return (op >= OP_ADD) && (op <= OP_NE);
+}
+
+// Заменить команды [first, last] командами repl (nodes -- их Code::nodes). Адрес перехода
+// команды repl[j] -- номер команды в repl, если local[j], иначе прежний адрес. Переходы
+// остальных команд на [first, last] ведут на начало repl
+static void Splice(Code& code, int first, int last, std::vector<Instr> repl, std::vector<int> nodes,
+    const std::vector<bool>& local) {
+    const int delta = static_cast<int>(repl.size()) - (last - first + 1);
+    auto outside = [&](int32_t t) { return (t < first) ? t : (t <= last) ? first : t + delta; };
+
+    for (size_t j = 0; j < repl.size(); j++) {
+        if (int32_t* t = JumpTarget(repl[j])) {
+            *t = local[j] ? first + *t : outside(*t);
+        }
+    }
+    std::vector<Instr>& c = code.instrs;
+    for (int k = 0; k < static_cast<int>(c.size()); k++) {
+        if ((k >= first) && (k <= last)) {
+            continue;
+        }
+        if (int32_t* t = JumpTarget(c[k])) {
+            *t = outside(*t);
+        }
+    }
+    c.erase(c.begin() + first, c.begin() + last + 1);
+    c.insert(c.begin() + first, repl.begin(), repl.end());
+    code.nodes.erase(code.nodes.begin() + first, code.nodes.begin() + last + 1);
+    code.nodes.insert(code.nodes.begin() + first, nodes.begin(), nodes.end());
+}
+
+// Инвариантное выражение: команды [start, end]
+struct Invariant {
+    int start;
+    int end;
+    int ops;   // Операций (арифметика и сравнения)
+    int depth; // Глубина стека, нужная для вычисления
+};
+
+// Наибольшие инвариантные выражения цикла, которому принадлежит LOOP с адресом loop
+static std::vector<Invariant> FindInvariants(const Code& code, int loop, bool debug, bool checked) {
+    const std::vector<Instr>& c = code.instrs;
+    const Instr& back = c[loop];
+    const int head = back.a;
+
+    // Ячейки, присваиваемые в цикле; переходы внутрь выражений
+    std::vector<bool> assigned(static_cast<size_t>(code.tempBase + code.temps), false);
+    std::vector<bool> target(c.size() + 1, false);
+    for (size_t i = 0; i < c.size(); i++) {
+        Instr in = c[i];
+        if (const int32_t* t = JumpTarget(in)) {
+            target[*t] = true;
+        }
+        if ((static_cast<int>(i) >= head) && (static_cast<int>(i) <= loop) && (in.op == OP_STORE)) {
+            assigned[in.a] = true;
+        }
+    }
+    auto invariant_load = [&](int node) {
+        return !assigned[node] && ((node < back.b) || (node >= back.imm));
+    };
+
+    // Разбор выражений по стеку: значение -- команды от start до текущей
+    struct Value {
+        int start;
+        bool invariant;
+        int ops;
+        int depth;
+    };
+    std::vector<Value> stack;
+    std::vector<Invariant> found;
+    auto take = [&](const Value& v, int end) {
+        // Уже вынесенное во вложенном цикле выражение начинается после его TGET
+        if (v.invariant && (v.ops > 0) && !((v.start > 0) && (c[v.start - 1].op == OP_TGET))) {
+            found.push_back({ v.start, end, v.ops, v.depth });
+        }
+    };
+
+    for (int i = head; i <= loop; i++) {
+        const Instr& in = c[i];
+        if (target[i]) {
+            stack.clear();
+        }
+        if (in.op == OP_CONST) {
+            stack.push_back({ i, true, 0, 1 });
+        }
+        else if (in.op == OP_LOAD) {
+            stack.push_back({ i, invariant_load(in.a), 0, 1 });
+        }
+        else if (IsBinary(in.op) && (stack.size() >= 2)) {
+            Value r = stack.back();
+            stack.pop_back();
+            Value l = stack.back();
+            stack.pop_back();
+            // Переполнение (checked) вынесенного выражения было бы выдано до цикла, а не на месте
+            bool inv = l.invariant && r.invariant && !(debug && IsArith(in.op) && in.warn) && !(checked && CanOverflow(in.op));
+            if (!inv) {
+                take(l, r.start - 1);
+                take(r, i - 1);
+            }
+            stack.push_back({ l.start, inv, l.ops + r.ops + 1, std::max(l.depth, r.depth + 1) });
+        }
+        else if (((in.op == OP_STORE) || (in.op == OP_JZ)) && (stack.size() == 1)) {
+            take(stack.back(), i - 1);
+            stack.clear();
+        }
+        else {
+            stack.clear();
+        }
+    }
+
+    std::sort(found.begin(), found.end(), [](const Invariant& x, const Invariant& y) { return x.start < y.start; });
+    return found;
+}
+
+// Предзаголовок перед командой head и TGET перед каждым выражением
+static void Hoist(Code& code, int loop, const std::vector<Invariant>& found) {
+    const std::vector<Instr> old = code.instrs;
+    const std::vector<int> old_nodes = code.nodes;
+    const int head = old[loop].a;
+
+    std::vector<Instr> out;
+    std::vector<int> out_nodes;
+    std::vector<int> origin;          // Адрес команды до вставки (-1 -- вставленная с готовым адресом)
+    std::vector<int> before(old.size() + 1);
+    int new_head = 0;
+
+    auto emit = [&](const Instr& in, int nodes, int from) {
+        out.push_back(in);
+        out_nodes.push_back(nodes);
+        origin.push_back(from);
+    };
+    auto make = [](OPCODE op, int a) {
+        Instr in = {};
+        in.op = static_cast<uint8_t>(op);
+        in.a = a;
+        in.b = Tree::NONE;
+        return in;
+    };
+
+    std::vector<int> temp(found.size());
+    for (size_t k = 0; k < found.size(); k++) {
+        temp[k] = code.tempBase + code.temps++;
+        code.hoisted++;
+        code.hoistedOps += found[k].ops;
+        // Цикл начинается там, где стек значений пуст
+        code.maxStack = std::max(code.maxStack, found[k].depth);
+    }
+
+    size_t next = 0;
+    for (size_t i = 0; i <= old.size(); i++) {
+        before[i] = static_cast<int>(out.size());
+        if (static_cast<int>(i) == head) {
+            for (size_t k = 0; k < found.size(); k++) {
+                emit(make(OP_TCLR, temp[k]), old_nodes[head], -1);
+            }
+            for (size_t k = 0; k < found.size(); k++) {
+                // Копия выражения, которая вместо ошибки переходит за TSET
+                std::vector<size_t> quiet;
+                int depth = 0;
+                for (int j = found[k].start; j <= found[k].end; j++) {
+                    Instr in = old[j];
+                    if (in.op == OP_LOAD) in.op = OP_LOADQ;
+                    else if (in.op == OP_DIV) in.op = OP_DIVQ;
+                    else if (in.op == OP_MOD) in.op = OP_MODQ;
+                    if ((in.op == OP_LOADQ) || (in.op == OP_DIVQ) || (in.op == OP_MODQ)) {
+                        in.imm = depth;
+                        quiet.push_back(out.size());
+                    }
+                    depth += ((in.op == OP_CONST) || (in.op == OP_LOADQ)) ? 1 : -1;
+                    emit(in, old_nodes[head], -1);
+                }
+                emit(make(OP_TSET, temp[k]), old_nodes[head], -1);
+                for (size_t q : quiet) {
+                    out[q].b = static_cast<int32_t>(out.size());
+                }
+            }
+            new_head = static_cast<int>(out.size());
+        }
+        if (i == old.size()) {
+            break;
+        }
+        if ((next < found.size()) && (found[next].start == static_cast<int>(i))) {
+            Instr get = make(OP_TGET, temp[next]);
+            get.b = found[next].end + 1;
+            get.line = old[found[next].end].line;
+            get.col = old[found[next].end].col;
+            emit(get, old_nodes[i], static_cast<int>(i));
+            next++;
+        }
+        emit(old[i], old_nodes[i], static_cast<int>(i));
+    }
+
+    // Переход на команду -- на то, что вставлено перед ней; переход назад из своего цикла -- мимо предзаголовка
+    for (size_t j = 0; j < out.size(); j++) {
+        int32_t* t = JumpTarget(out[j]);
+        if (!t || (origin[j] < 0)) {
+            continue;
+        }
+        *t = (origin[j] == loop) ? new_head : before[*t];
+    }
+
+    code.instrs.swap(out);
+    code.nodes.swap(out_nodes);
+}
+
+// Циклы по порядку команд LOOP: вложенный цикл раньше внешнего
+static void HoistInvariants(Code& code, bool debug, bool checked) {
+    for (int k = 0; ; k++) {
+        int loop = -1;
+        for (int i = 0, seen = 0; i < static_cast<int>(code.instrs.size()); i++) {
+            if ((code.instrs[i].op == OP_LOOP) && (seen++ == k)) {
+                loop = i;
+                break;
+            }
+        }
+        if (loop < 0) {
+            return;
+        }
+        std::vector<Invariant> found = FindInvariants(code, loop, debug, checked);
+        if (!found.empty()) {
+            Hoist(code, loop, found);
+        }
+    }
+}
+
+// Магическое число и сдвиг для знакового деления W-битных чисел на d (3 <= d < 2^(W-1),
+// не степень двойки): Г. Уоррен, «Алгоритмические трюки для программистов», 10.3.
+// U -- беззнаковый тип разрядности W: вычисления рассчитаны на перенос по модулю 2^W
+template <typename U>
+static void SignedMagic(U d, U& magic, int& shift) {
+    const int w = static_cast<int>(sizeof(U) * 8);
+    const U two = static_cast<U>(U(1) << (w - 1));
+    const U anc = static_cast<U>(two - 1 - two % d);
+    int p = w - 1;
+    U q1 = two / anc;
+    U r1 = static_cast<U>(two - q1 * anc);
+    U q2 = two / d;
+    U r2 = static_cast<U>(two - q2 * d);
+    U delta = 0;
+    do {
+        p++;
+        q1 = static_cast<U>(q1 * 2);
+        r1 = static_cast<U>(r1 * 2);
+        if (r1 >= anc) {
+            q1++;
+            r1 = static_cast<U>(r1 - anc);
+        }
+        q2 = static_cast<U>(q2 * 2);
+        r2 = static_cast<U>(r2 * 2);
+        if (r2 >= d) {
+            q2++;
+            r2 = static_cast<U>(r2 - d);
+        }
+        delta = static_cast<U>(d - r2);
+    } while ((q1 < delta) || ((q1 == delta) && (r1 == 0)));
+    magic = static_cast<U>(q2 + 1);
+    shift = p - w;
+}
+
+// Показатель степени двойки; -1 -- не степень двойки
+static int Log2(uint64_t m) {
+    if ((m == 0) || ((m & (m - 1)) != 0)) {
+        return -1;
+    }
+    int k = 0;
+    while ((m >> k) != 1) {
+        k++;
+    }
+    return k;
+}
+
+// План замены операции in с константой c справа; false -- замена не выгодна
+static bool PlanReduction(Instr& in, int64_t c) {
+    if ((c == 0) || (c == INT64_MIN)) {
+        return false;
+    }
+    const uint64_t m = (c < 0) ? 0 - static_cast<uint64_t>(c) : static_cast<uint64_t>(c);
+    const int k = Log2(m);
+    int32_t flags = (c < 0) ? REDUCE_NEG : 0;
+    int kind = REDUCE_NONE;
+    int shift = k;
+    int64_t magic = 0;
+
+    if (in.op == OP_MUL) {
+        if (k >= 0) {
+            kind = REDUCE_SHL;
+        }
+        else if (Log2(m - 1) > 0) {
+            kind = REDUCE_SHL_ADD;
+            shift = Log2(m - 1);
+        }
+        else if (Log2(m + 1) > 1) {
+            kind = REDUCE_SHL_SUB;
+            shift = Log2(m + 1);
+        }
+    }
+    else if (k >= 0) {
+        kind = (in.op == OP_DIV) ? REDUCE_DIV_POW2 : REDUCE_MOD_POW2;
+        if (in.op == OP_MOD) {
+            flags = 0;
+        }
+    }
+    else {
+        // Значения short, int и long умещаются в 32 бита вместе с константой
+        kind = (in.op == OP_DIV) ? REDUCE_DIV_MAGIC : REDUCE_MOD_MAGIC;
+        if (in.shift >= 32) {
+            uint32_t magic32 = 0;
+            SignedMagic<uint32_t>(static_cast<uint32_t>(m), magic32, shift);
+            magic = static_cast<int32_t>(magic32);
+        }
+        else {
+            uint64_t magic64 = 0;
+            SignedMagic<uint64_t>(m, magic64, shift);
+            magic = static_cast<int64_t>(magic64);
+        }
+        if (magic < 0) {
+            flags |= REDUCE_ADD;
+        }
+    }
+    if (kind == REDUCE_NONE) {
+        return false;
+    }
+    in.reduce = static_cast<uint8_t>(kind);
+    in.imm = magic;
+    in.a = shift;
+    in.b = flags;
+    return true;
+}
+
+// Операции с константой справа: константа -- предыдущая команда, и на операцию нет переходов.
+// При проверке переполнения (checked) -- только деление и остаток на константу, кроме -1:
+// сдвиги не проверяют переполнение умножения
+static void ReduceStrength(Code& code, bool checked) {
+    std::vector<Instr>& c = code.instrs;
+    std::vector<bool> target(c.size() + 1, false);
+    for (Instr& in : c) {
+        if (const int32_t* t = JumpTarget(in)) {
+            target[*t] = true;
+        }
+    }
+    for (size_t i = 1; i < c.size(); i++) {
+        Instr& in = c[i];
+        bool candidate = ((in.op == OP_MUL) && !checked) || (in.op == OP_DIV) || (in.op == OP_MOD);
+        if (candidate && (in.reduce == REDUCE_NONE) && (c[i - 1].op == OP_CONST) && !target[i]
+            && !(checked && (c[i - 1].imm == -1))
+            && PlanReduction(in, c[i - 1].imm)) {
+            code.reduced++;
+        }
+    }
+}
+
+// Приведение к типу разрядности 64 - shift, как в машине
+static int64_t Wrap(int64_t value, unsigned shift) {
+    return static_cast<int64_t>(static_cast<uint64_t>(value) << shift) >> shift;
+}
+
+// Арифметика и сравнение как в машине (Vm::Arith); false -- деление на ноль или (checked) переполнение
+static bool EvalBinary(const Instr& in, int64_t a, int64_t b, int64_t& result, bool checked) {
+    const uint64_t ua = static_cast<uint64_t>(a);
+    const uint64_t ub = static_cast<uint64_t>(b);
+    if (checked && CanOverflow(in.op)) {
+        static const char OP_CHAR[4] = { '+', '-', '*', '/' };
+        int64_t exact = 0;
+        if (ArithOverflow(OP_CHAR[in.op - OP_ADD], a, b, in.shift, exact)) return false;
+    }
+    switch (in.op) {
+    case OP_ADD: result = static_cast<int64_t>(ua + ub); break;
+    case OP_SUB: result = static_cast<int64_t>(ua - ub); break;
+    case OP_MUL: result = static_cast<int64_t>(ua * ub); break;
+    case OP_DIV:
+        if (b == 0) return false;
+        result = (b == -1) ? static_cast<int64_t>(0 - ua) : a / b;
+        break;
+    case OP_MOD:
+        if (b == 0) return false;
+        result = (b == -1) ? 0 : a % b;
+        break;
+    case OP_LT: result = a < b; return true;
+    case OP_LE: result = a <= b; return true;
+    case OP_GT: result = a > b; return true;
+    case OP_GE: result = a >= b; return true;
+    case OP_EQ: result = a == b; return true;
+    case OP_NE: result = a != b; return true;
+    default: return false;
+    }
+    result = Wrap(result, in.shift);
+    return true;
+}
+
+// Состояние ячейки при вычислении цикла
+enum SLOT_STATE : uint8_t { SLOT_UNKNOWN, SLOT_KNOWN, SLOT_UNINIT };
+
+// Предел числа команд, выполняемых при вычислении одного цикла
+static const int EVAL_BUDGET = 1 << 20;
+
+// Значения ячеек перед командой head: последовательность команд без переходов перед
+// циклом выполняется с известными константами (остальное неизвестно)
+static void EntryState(const Code& code, int head, std::vector<uint8_t>& state, std::vector<int64_t>& value,
+    const std::vector<bool>& target, bool checked) {
+    const std::vector<Instr>& c = code.instrs;
+    int first = head;
+    while ((first > 0) && ((first == head) || !target[first]) && !JumpTarget(c[first - 1])
+        && (c[first - 1].op != OP_RAISE) && (c[first - 1].op != OP_HALT)) {
+        first--;
+    }
+
+    struct Value {
+        bool known;
+        int64_t v;
+    };
+    std::vector<Value> stack;
+    auto pop = [&]() {
+        if (stack.empty()) return Value{ false, 0 };
+        Value v = stack.back();
+        stack.pop_back();
+        return v;
+    };
+    for (int i = first; i < head; i++) {
+        const Instr& in = c[i];
+        if (in.op == OP_CONST) {
+            stack.push_back({ true, in.imm });
+        }
+        else if (in.op == OP_LOAD) {
+            stack.push_back({ state[in.a] == SLOT_KNOWN, value[in.a] });
+        }
+        else if (IsBinary(in.op)) {
+            Value r = pop();
+            Value l = pop();
+            int64_t result = 0;
+            bool known = l.known && r.known && EvalBinary(in, l.v, r.v, result, checked);
+            stack.push_back({ known, result });
+        }
+        else if (in.op == OP_STORE) {
+            Value v = pop();
+            state[in.a] = v.known ? SLOT_KNOWN : SLOT_UNKNOWN;
+            value[in.a] = Wrap(v.v, in.shift);
+        }
+        else if ((in.op != OP_ENTER) && (in.op != OP_EXIT) && (in.op != OP_NOP)) {
+            std::fill(state.begin(), state.end(), SLOT_UNKNOWN);
+            stack.clear();
+        }
+    }
+}
+
+// Вычислить цикл [head, loop] из состояния state; n -- выполнено итераций (LOOP).
+// false -- значения неизвестны, выдаётся предупреждение или ошибка (в том числе переполнение), предел команд исчерпан
+static bool EvalLoop(const Code& code, int loop, bool debug, bool checked, std::vector<uint8_t>& state, std::vector<int64_t>& value,
+    std::vector<bool>& touched, int64_t& n) {
+    const std::vector<Instr>& c = code.instrs;
+    const int head = c[loop].a;
+    std::vector<int64_t> stack;
+    n = 0;
+    int pc = head;
+    for (int steps = 0; steps < EVAL_BUDGET; steps++) {
+        if ((pc < head) || (pc > loop)) {
+            return pc == loop + 1;
+        }
+        const Instr& in = c[pc];
+        pc++;
+        switch (in.op) {
+        case OP_NOP: case OP_ENTER: case OP_EXIT:
+            break;
+        case OP_CONST:
+            stack.push_back(in.imm);
+            break;
+        case OP_LOAD:
+            if (state[in.a] != SLOT_KNOWN) return false;
+            stack.push_back(value[in.a]);
+            break;
+        case OP_STORE: {
+            if (stack.empty()) return false;
+            int64_t v = stack.back();
+            stack.pop_back();
+            if ((in.type2 != in.type) && (debug || (Wrap(v, in.shift) != v))) return false;
+            state[in.a] = SLOT_KNOWN;
+            value[in.a] = v;
+            touched[in.a] = true;
+            break;
+        }
+        case OP_JZ: {
+            if (stack.empty()) return false;
+            int64_t v = stack.back();
+            stack.pop_back();
+            if (v == 0) pc = in.a;
+            break;
+        }
+        case OP_JMP:
+            pc = in.a;
+            break;
+        case OP_LOOP:
+            n++;
+            for (int64_t k = in.b; k < in.imm; k++) {
+                state[k] = SLOT_UNINIT;
+                touched[k] = true;
+            }
+            pc = in.a;
+            break;
+        default: {
+            if (!IsBinary(in.op) || (stack.size() < 2) || (debug && IsArith(in.op) && in.warn)) return false;
+            int64_t r = stack.back();
+            stack.pop_back();
+            if (!EvalBinary(in, stack.back(), r, stack.back(), checked)) return false;
+            break;
+        }
+        }
+    }
+    return false;
+}
+
+// Число циклов (команд LOOP) в [first, last]
+static int CountLoops(const std::vector<Instr>& c, int first, int last) {
+    int n = 0;
+    for (int i = first; i <= last; i++) {
+        n += (c[i].op == OP_LOOP) ? 1 : 0;
+    }
+    return n;
+}
+
+// Циклы, начиная с внешних: цикл со значениями, известными при входе, заменяется
+// результатом -- ITER, присваивания итоговых значений и переход за цикл; сам цикл
+// остаётся за ними и выполняется, только если будет превышен предел итераций
+static void EvaluateLoops(Code& code, const Tree& tree, bool debug, bool checked) {
+    const int slots = code.tempBase + code.temps;
+    for (int k = 0; ; k++) {
+        std::vector<Instr>& c = code.instrs;
+        // k-й цикл по возрастанию адреса начала
+        std::vector<std::pair<int, int>> loops;
+        for (int i = 0; i < static_cast<int>(c.size()); i++) {
+            if ((c[i].op == OP_LOOP) && (c[i].a <= i)) {
+                loops.push_back({ c[i].a, i });
+            }
+        }
+        if (k >= static_cast<int>(loops.size())) {
+            return;
+        }
+        std::sort(loops.begin(), loops.end());
+        const int head = loops[k].first;
+        const int loop = loops[k].second;
+
+        // На начало цикла переходит только его LOOP, внутрь -- только команды цикла
+        std::vector<bool> target(c.size() + 1, false);
+        bool closed = true;
+        for (int i = 0; i < static_cast<int>(c.size()); i++) {
+            if (const int32_t* t = JumpTarget(c[i])) {
+                target[*t] = true;
+                bool inside = (i >= head) && (i <= loop);
+                if (!inside && (*t >= head) && (*t <= loop)) closed = false;
+                if ((*t == head) && (i != loop)) closed = false;
+            }
+        }
+        if (!closed) {
+            continue;
+        }
+
+        std::vector<uint8_t> state(static_cast<size_t>(slots), SLOT_UNKNOWN);
+        std::vector<int64_t> value(static_cast<size_t>(slots), 0);
+        std::vector<bool> touched(static_cast<size_t>(slots), false);
+        int64_t n = 0;
+        EntryState(code, head, state, value, target, checked);
+        if (!EvalLoop(code, loop, debug, checked, state, value, touched, n) || (n == 0)) {
+            continue;
+        }
+
+        // Тип переменной -- из присваивания ей в цикле
+        std::vector<const Instr*> store(static_cast<size_t>(slots), nullptr);
+        for (int i = head; i <= loop; i++) {
+            if (c[i].op == OP_STORE) store[c[i].a] = &c[i];
+        }
+
+        std::vector<Instr> repl;
+        std::vector<int> nodes;
+        std::vector<bool> local;
+        auto emit = [&](const Instr& in, bool is_local) {
+            repl.push_back(in);
+            nodes.push_back(code.nodes[head]);
+            local.push_back(is_local);
+        };
+        Instr iter = {};
+        iter.op = OP_ITER;
+        iter.imm = n;
+        iter.b = Tree::NONE;
+        iter.line = c[loop].line;
+        iter.col = c[loop].col;
+        emit(iter, true);
+        for (int slot = 0; slot < slots; slot++) {
+            if (!touched[slot]) {
+                continue;
+            }
+            if (state[slot] == SLOT_KNOWN) {
+                Instr cst = {};
+                cst.op = OP_CONST;
+                cst.imm = value[slot];
+                cst.type = store[slot]->type;
+                cst.a = Tree::NONE;
+                cst.b = Tree::NONE;
+                emit(cst, false);
+                Instr st = *store[slot];
+                st.type2 = st.type;
+                emit(st, false);
+            }
+            else if ((slot < tree.Count()) && (tree.Sem(slot).DataType >= TYPE_INT)
+                && (tree.Sem(slot).DataType <= TYPE_LONG_LONG_INT)) {
+                // Объявленная в теле переменная -- без значения, как после LOOP
+                Instr clr = {};
+                clr.op = OP_TCLR;
+                clr.a = slot;
+                clr.b = Tree::NONE;
+                emit(clr, false);
+            }
+        }
+        Instr jump = {};
+        jump.op = OP_JMP;
+        jump.a = loop + 1;
+        jump.b = Tree::NONE;
+        emit(jump, false);
+
+        const int fallback = static_cast<int>(repl.size());
+        repl[0].a = fallback;
+        for (int i = head; i <= loop; i++) {
+            Instr in = c[i];
+            int32_t* t = JumpTarget(in);
+            bool inside = t && (*t >= head) && (*t <= loop);
+            if (inside) {
+                *t = fallback + (*t - head);
+            }
+            repl.push_back(in);
+            nodes.push_back(code.nodes[i]);
+            local.push_back(inside);
+        }
+
+        const int inner = CountLoops(c, head, loop);
+        Splice(code, head, loop, repl, nodes, local);
+        code.evaluated++;
+        // Циклы запасного пути -- следующие по адресу начала
+        k += inner - 1;
+    }
+}
+
+// Предел числа команд тела развёрнутого цикла (всех копий)
+static const int UNROLL_LIMIT = 4096;
+
+// Развернуть внутренний цикл [head, loop] вида
+//   while (i cmp N) { ...; i = i + c; ... }
+// где присваивание i -- единственное в цикле и выполняется на каждой итерации
+// (не во вложенном цикле), cmp -- < или <= при c > 0, > или >= при c < 0.
+// Пока i cmp N - (factor - 1) * c, следующие factor - 1 проверок условия тоже истинны
+// (с переносом при переполнении i только удаляется от N), поэтому тело повторяется factor раз
+// подряд (NEXT между копиями), а оставшиеся итерации выполняет исходный цикл
+static bool Unroll(Code& code, int loop, int factor) {
+    std::vector<Instr>& c = code.instrs;
+    const int head = c[loop].a;
+    const int body = head + 4;
+    if ((head < 0) || (body >= loop)) {
+        return false;
+    }
+    const Instr& var = c[head];
+    const Instr& bound = c[head + 1];
+    const int cmp = c[head + 2].op;
+    if ((var.op != OP_LOAD) || (bound.op != OP_CONST) || (cmp < OP_LT) || (cmp > OP_GE)
+        || (c[head + 3].op != OP_JZ) || (c[head + 3].a != loop + 1)) {
+        return false;
+    }
+
+    // Тело без вложенных циклов и переходов наружу; на тело переходов извне нет
+    int stores = 0;
+    int step_at = -1;
+    for (int i = body; i < loop; i++) {
+        const Instr& in = c[i];
+        if ((in.op == OP_LOOP) || (in.op == OP_RAISE) || (in.op == OP_HALT) || (in.op == OP_ITER)) {
+            return false;
+        }
+        if (const int32_t* t = JumpTarget(in)) {
+            if ((*t < body) || (*t >= loop)) return false;
+        }
+        if ((in.op == OP_STORE) && (in.a == var.a)) {
+            stores++;
+            step_at = i;
+        }
+    }
+    for (int i = 0; i < static_cast<int>(c.size()); i++) {
+        const int32_t* t = JumpTarget(c[i]);
+        if (t && ((i < body) || (i >= loop)) && (*t > head) && (*t <= loop)) {
+            return false;
+        }
+    }
+    const int body_size = loop - body;
+    if ((stores != 1) || (step_at < body + 3) || (body_size * factor > UNROLL_LIMIT)
+        || ((var.a >= c[loop].b) && (var.a < c[loop].imm))) {
+        return false;
+    }
+    // Шаг выполняется на каждой итерации: переходы тела (только вперёд) его не обходят
+    for (int i = body; i < step_at - 3; i++) {
+        const int32_t* t = JumpTarget(c[i]);
+        if (t && (*t > step_at - 3)) {
+            return false;
+        }
+    }
+    const Instr& load = c[step_at - 3];
+    const Instr& delta = c[step_at - 2];
+    const int op = c[step_at - 1].op;
+    if ((load.op != OP_LOAD) || (load.a != var.a) || (delta.op != OP_CONST) || ((op != OP_ADD) && (op != OP_SUB))
+        || (delta.imm == INT64_MIN) || (delta.imm == 0)) {
+        return false;
+    }
+    const int64_t step = (op == OP_ADD) ? delta.imm : -delta.imm;
+    if (((cmp == OP_LT) || (cmp == OP_LE)) != (step > 0)) {
+        return false;
+    }
+    // N - (factor - 1) * step без переполнения
+    const int64_t reach = static_cast<int64_t>(factor - 1);
+    const int64_t mag = (step > 0) ? step : -step;
+    if (mag > INT64_MAX / reach / 2) {
+        return false;
+    }
+    const int64_t shift = reach * step;
+    if (((shift > 0) && (bound.imm < INT64_MIN + shift)) || ((shift < 0) && (bound.imm > INT64_MAX + shift))) {
+        return false;
+    }
+
+    std::vector<Instr> repl;
+    std::vector<int> nodes;
+    std::vector<bool> local;
+    auto emit = [&](Instr in, int node, bool is_local) {
+        repl.push_back(in);
+        nodes.push_back(node);
+        local.push_back(is_local);
+    };
+    const int remainder = 4 + factor * (body_size + 1);
+
+    // Условие: i cmp N - (factor - 1) * step, иначе -- исходный цикл
+    emit(var, code.nodes[head], false);
+    Instr guard = bound;
+    guard.imm = bound.imm - shift;
+    emit(guard, code.nodes[head + 1], false);
+    emit(c[head + 2], code.nodes[head + 2], false);
+    Instr jz = c[head + 3];
+    jz.a = remainder;
+    emit(jz, code.nodes[head + 3], true);
+    for (int copy = 0; copy < factor; copy++) {
+        const int base = static_cast<int>(repl.size());
+        for (int i = body; i < loop; i++) {
+            Instr in = c[i];
+            int32_t* t = JumpTarget(in);
+            if (t) {
+                *t = base + (*t - body);
+            }
+            emit(in, code.nodes[i], t != nullptr);
+        }
+        Instr end = c[loop];
+        if (copy + 1 < factor) {
+            end.op = OP_NEXT;
+            end.a = Tree::NONE;
+            emit(end, code.nodes[loop], false);
+        }
+        else {
+            end.a = 0;
+            emit(end, code.nodes[loop], true);
+        }
+    }
+    for (int i = head; i <= loop; i++) {
+        Instr in = c[i];
+        int32_t* t = JumpTarget(in);
+        bool inside = t && (*t >= head) && (*t <= loop);
+        if (inside) {
+            *t = remainder + (*t - head);
+        }
+        emit(in, code.nodes[i], inside);
+    }
+    Splice(code, head, loop, repl, nodes, local);
+    code.unrolled++;
+    return true;
+}
+
+// Внутренние циклы по порядку команд LOOP; исходный цикл после развёрнутого не разворачивается
+static void UnrollLoops(Code& code, int factor) {
+    if (factor < 2) {
+        return;
+    }
+    for (int k = 0; ; k++) {
+        int loop = -1;
+        for (int i = 0, seen = 0; i < static_cast<int>(code.instrs.size()); i++) {
+            if ((code.instrs[i].op == OP_LOOP) && (seen++ == k)) {
+                loop = i;
+                break;
+            }
+        }
+        if (loop < 0) {
+            return;
+        }
+        if (Unroll(code, loop, factor)) {
+            k++;
+        }
+    }
+}
+
+// Удалить отмеченные команды; переход на удалённую команду ведёт на следующую оставшуюся
+static void Compact(Code& code, const std::vector<bool>& removed) {
+    std::vector<Instr>& c = code.instrs;
+    const int n = static_cast<int>(c.size());
+    std::vector<int32_t> moved(static_cast<size_t>(n) + 1);
+    int kept = 0;
+    for (int i = 0; i < n; i++) {
+        moved[i] = kept;
+        kept += removed[i] ? 0 : 1;
+    }
+    moved[n] = kept;
+    int out = 0;
+    for (int i = 0; i < n; i++) {
+        if (removed[i]) {
+            continue;
+        }
+        if (int32_t* t = JumpTarget(c[i])) {
+            *t = moved[std::min(std::max(*t, 0), n)];
+        }
+        c[out] = c[i];
+        code.nodes[out] = code.nodes[i];
+        out++;
+    }
+    c.resize(static_cast<size_t>(out));
+    code.nodes.resize(static_cast<size_t>(out));
+}
+
+static Instr MakeConst(int64_t value, uint8_t type) {
+    Instr in = {};
+    in.op = OP_CONST;
+    in.imm = value;
+    in.type = type;
+    in.a = Tree::NONE;
+    in.b = Tree::NONE;
+    return in;
+}
+
+// Чтение переменной, значение которой -- копия константы или другой переменной:
+//   x = c; ... x       ->  x = c; ... c
+//   x = y; ... x       ->  x = y; ... y   (y с тех пор не менялась, типы совпадают)
+// Определение, которое доходит до чтения, единственно (не phi), поэтому значение известно
+// на всех путях, а переменная заведомо инициализирована
+static void PropagateCopies(Code& code) {
+    Ssa ssa(code);
+    std::vector<Instr>& c = code.instrs;
+    for (int pc = 0; pc < static_cast<int>(c.size()); pc++) {
+        if ((c[pc].op != OP_LOAD) || !ssa.Blocks()[ssa.BlockOf(pc)].reachable) {
+            continue;
+        }
+        const int def = ssa.Use(pc);
+        const Ssa::Def& d = ssa.Get(def);
+        if ((d.kind != Ssa::DEF_STORE) || (c[d.at].op != OP_STORE) || (d.at == 0) || ssa.Leader(d.at)) {
+            continue;
+        }
+        const Instr& store = c[d.at];
+        const Instr& src = c[d.at - 1];
+        if (src.op == OP_CONST) {
+            Instr k = MakeConst(Wrap(src.imm, store.shift), c[pc].type);
+            k.line = c[pc].line;
+            k.col = c[pc].col;
+            c[pc] = k;
+            ssa.Retarget(pc, -1);
+        }
+        else if ((src.op == OP_LOAD) && (src.a != store.a) && (store.type2 == store.type)) {
+            const int origin = ssa.Use(d.at - 1);
+            if (ssa.DefAt(src.a, pc) != origin) {
+                continue;
+            }
+            c[pc].a = src.a;
+            c[pc].b = src.b;
+            ssa.Retarget(pc, origin);
+        }
+        else {
+            continue;
+        }
+        code.propagated++;
+    }
+}
+
+// Операции над константами и переходы по константе вычисляются при трансляции,
+// кроме деления на ноль, переполнения (checked) и операций с предупреждением в debug режиме.
+// true -- что-то вычислено
+static bool FoldConstants(Code& code, bool debug, bool checked) {
+    std::vector<Instr>& c = code.instrs;
+    const int n = static_cast<int>(c.size());
+    std::vector<bool> target(static_cast<size_t>(n) + 1, false);
+    for (const Instr& in : c) {
+        if (const int32_t* t = JumpTarget(in)) {
+            target[*t] = true;
+        }
+    }
+    // На команды после first можно попасть только от first
+    auto straight = [&](int first, int last) {
+        for (int i = first + 1; i <= last; i++) {
+            if (target[i]) return false;
+        }
+        return true;
+    };
+
+    std::vector<bool> removed(static_cast<size_t>(n), false);
+    std::vector<int> kept;
+    bool changed = false;
+    for (int pc = 0; pc < n; pc++) {
+        Instr& in = c[pc];
+        const size_t k = kept.size();
+        if (IsBinary(in.op) && (k >= 2) && (c[kept[k - 2]].op == OP_CONST) && (c[kept[k - 1]].op == OP_CONST)
+            && straight(kept[k - 2], pc) && !(debug && IsArith(in.op) && in.warn)) {
+            int64_t value = 0;
+            if (EvalBinary(in, c[kept[k - 2]].imm, c[kept[k - 1]].imm, value, checked)) {
+                removed[kept[k - 2]] = true;
+                removed[kept[k - 1]] = true;
+                kept.resize(k - 2);
+                Instr folded = MakeConst(value, in.type);
+                folded.line = in.line;
+                folded.col = in.col;
+                in = folded;
+                kept.push_back(pc);
+                code.folded++;
+                changed = true;
+                continue;
+            }
+        }
+        if ((in.op == OP_JZ) && (k >= 1) && (c[kept[k - 1]].op == OP_CONST) && straight(kept[k - 1], pc)) {
+            const int64_t condition = c[kept[k - 1]].imm;
+            removed[kept[k - 1]] = true;
+            kept.pop_back();
+            if (condition != 0) {
+                // Условие истинно: перехода нет
+                removed[pc] = true;
+            }
+            else {
+                in.op = OP_JMP;
+                kept.push_back(pc);
+            }
+            code.folded++;
+            changed = true;
+            continue;
+        }
+        kept.push_back(pc);
+    }
+    if (changed) {
+        Compact(code, removed);
+    }
+    return changed;
+}
+
+// Команды недостижимых блоков (после RAISE, за переходом по константе) удаляются
+static void RemoveUnreachable(Code& code) {
+    Ssa ssa(code);
+    std::vector<bool> removed(code.instrs.size(), false);
+    int count = 0;
+    for (const Ssa::Block& b : ssa.Blocks()) {
+        if (b.reachable) {
+            continue;
+        }
+        for (int pc = b.first; pc <= b.last; pc++) {
+            removed[pc] = true;
+            count++;
+        }
+    }
+    if (count > 0) {
+        Compact(code, removed);
+        code.unreachable += count;
+    }
+}
+
+// Команда не может завершиться ошибкой: переменная инициализирована на всех путях,
+// делитель -- ненулевая константа, при проверке переполнения (checked) -- без сложения,
+// вычитания, умножения и деления на -1
+static bool CannotFail(const Ssa& ssa, const std::vector<Instr>& c, int pc, bool checked) {
+    const Instr& in = c[pc];
+    switch (in.op) {
+    case OP_NOP: case OP_CONST: case OP_STORE: case OP_ENTER: case OP_EXIT:
+    case OP_LT: case OP_LE: case OP_GT: case OP_GE: case OP_EQ: case OP_NE:
+        return true;
+    case OP_ADD: case OP_SUB: case OP_MUL:
+        return !checked;
+    case OP_LOAD:
+        return ssa.Defined(ssa.Use(pc));
+    case OP_DIV: case OP_MOD:
+        return (pc > 0) && !ssa.Leader(pc) && (c[pc - 1].op == OP_CONST) && (c[pc - 1].imm != 0)
+            && !(checked && (in.op == OP_DIV) && (c[pc - 1].imm == -1));
+    default:
+        return false;
+    }
+}
+
+// Начало выражения, значение которого присваивает STORE pc, если его можно не вычислять:
+// без ошибок, предупреждений и переходов внутрь; иначе -1
+static int PureExpression(const Ssa& ssa, const std::vector<Instr>& c, int pc, bool debug, bool checked) {
+    int values = 0;
+    for (int i = pc - 1; i >= 0; i--) {
+        const Instr& in = c[i];
+        if (ssa.Leader(i + 1) || !CannotFail(ssa, c, i, checked) || (debug && IsArith(in.op) && in.warn)) {
+            return -1;
+        }
+        if ((in.op == OP_CONST) || (in.op == OP_LOAD)) values++;
+        else if (IsBinary(in.op)) values--;
+        else return -1;
+        if (values == 1) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Присваивание, значение которого в том же блоке затирается следующим присваиванием (или TCLR)
+// раньше, чем его прочтут или выполнение может прерваться ошибкой (при ошибке значения
+// переменных видны), удаляется вместе с вычислением значения, если оно без побочных эффектов.
+// Присваивание с предупреждением остаётся. true -- что-то удалено
+static bool EliminateDeadStores(Code& code, bool debug, bool checked) {
+    Ssa ssa(code);
+    const std::vector<Instr>& c = code.instrs;
+    std::vector<bool> removed(c.size(), false);
+    bool changed = false;
+    for (const Ssa::Block& b : ssa.Blocks()) {
+        if (!b.reachable) {
+            continue;
+        }
+        for (int pc = b.first; pc <= b.last; pc++) {
+            const Instr& store = c[pc];
+            if (store.op != OP_STORE) {
+                continue;
+            }
+            // Присваивание значения другого типа: предупреждение, если константа не умещается или debug
+            if ((store.type2 != store.type) && (debug || (pc == b.first) || (c[pc - 1].op != OP_CONST)
+                || (Wrap(c[pc - 1].imm, store.shift) != c[pc - 1].imm))) {
+                continue;
+            }
+            bool dead = false;
+            for (int i = pc + 1; i <= b.last; i++) {
+                const Instr& in = c[i];
+                if (((in.op == OP_STORE) || (in.op == OP_TCLR)) && (in.a == store.a)) {
+                    dead = true;
+                    break;
+                }
+                if ((in.op == OP_LOAD) && (in.a == store.a)) {
+                    break;
+                }
+                if (!CannotFail(ssa, c, i, checked)) {
+                    break;
+                }
+            }
+            if (!dead) {
+                continue;
+            }
+            const int first = PureExpression(ssa, c, pc, debug, checked);
+            if (first < 0) {
+                continue;
+            }
+            for (int i = first; i <= pc; i++) {
+                removed[i] = true;
+            }
+            code.deadStores++;
+            changed = true;
+        }
+    }
+    if (changed) {
+        Compact(code, removed);
+    }
+    return changed;
+}
+
+// Анализ диапазонов значений (OPT_RANGE)
+
+// Диапазон значений [lo, hi]
+struct Interval {
+    int64_t lo;
+    int64_t hi;
+
+    bool operator==(const Interval& other) const { return (lo == other.lo) && (hi == other.hi); }
+    bool Within(const Interval& other) const { return (lo >= other.lo) && (hi <= other.hi); }
+};
+
+static const Interval ANY_VALUE = { INT64_MIN, INT64_MAX };
+static const Interval INT32_VALUE = { INT32_MIN, INT32_MAX };
+
+// Значения типа разрядности 64 - shift (как Wrap)
+static Interval ShiftInterval(unsigned shift) {
+    if (shift == 0) {
+        return ANY_VALUE;
+    }
+    const int64_t half = int64_t(1) << (63 - shift);
+    return { -half, half - 1 };
+}
+
+// Значения типа переменной (LOAD)
+static Interval TypeInterval(int type) {
+    switch (type) {
+    case TYPE_SHORT_INT: return ShiftInterval(48);
+    case TYPE_INT: case TYPE_LONG_INT: return ShiftInterval(32);
+    default: return ANY_VALUE;
+    }
+}
+
+static Interval Hull(const Interval& a, const Interval& b) {
+    return { std::min(a.lo, b.lo), std::max(a.hi, b.hi) };
+}
+
+// Точный диапазон a op b (до приведения к типу); false -- не умещается в 64 бита
+// или значения нет (делитель -- только ноль)
+static bool ExactRange(int op, const Interval& a, const Interval& b, Interval& r) {
+    switch (op) {
+    case OP_ADD:
+        return !AddOverflow(a.lo, b.lo, &r.lo) && !AddOverflow(a.hi, b.hi, &r.hi);
+    case OP_SUB:
+        return !SubOverflow(a.lo, b.hi, &r.lo) && !SubOverflow(a.hi, b.lo, &r.hi);
+    case OP_MUL: {
+        const int64_t x[2] = { a.lo, a.hi };
+        const int64_t y[2] = { b.lo, b.hi };
+        int64_t v[4];
+        for (int i = 0; i < 4; i++) {
+            if (MulOverflow(x[i / 2], y[i % 2], &v[i])) return false;
+        }
+        r = { *std::min_element(v, v + 4), *std::max_element(v, v + 4) };
+        return true;
+    }
+    case OP_DIV: {
+        // При делителе одного знака частное монотонно по каждому операнду: крайние значения --
+        // в углах. Делитель, содержащий ноль, делится на отрицательную и положительную части
+        const Interval parts[2] = { { b.lo, std::min<int64_t>(b.hi, -1) }, { std::max<int64_t>(b.lo, 1), b.hi } };
+        bool any = false;
+        for (const Interval& d : parts) {
+            if (d.lo > d.hi) continue;
+            if (DivOverflow(a.lo, d.hi)) return false;
+            const int64_t v[4] = { a.lo / d.lo, a.lo / d.hi, a.hi / d.lo, a.hi / d.hi };
+            const Interval q = { *std::min_element(v, v + 4), *std::max_element(v, v + 4) };
+            r = any ? Hull(r, q) : q;
+            any = true;
+        }
+        return any;
+    }
+    case OP_MOD: {
+        if ((b.lo == 0) && (b.hi == 0)) return false;
+        // |остаток| < |делитель|, знак -- как у делимого
+        const int64_t m = std::max<int64_t>((b.hi > 0) ? b.hi - 1 : 0, (b.lo < 0) ? -(b.lo + 1) : 0);
+        r = { (a.lo >= 0) ? 0 : std::max(a.lo, -m), (a.hi <= 0) ? 0 : std::min(a.hi, m) };
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+// Сравнение с противоположным результатом
+static int NegateCompare(int op) {
+    static const int NEGATED[6] = { OP_GE, OP_GT, OP_LE, OP_LT, OP_NE, OP_EQ };
+    return NEGATED[op - OP_LT];
+}
+
+// Сузить диапазоны x и y при условии x op y (OP_LT..OP_NE); false -- условие невыполнимо
+static bool Constrain(int op, Interval& x, Interval& y) {
+    switch (op) {
+    case OP_LT:
+        if ((y.hi == INT64_MIN) || (x.lo == INT64_MAX)) return false;
+        x.hi = std::min(x.hi, y.hi - 1);
+        y.lo = std::max(y.lo, x.lo + 1);
+        break;
+    case OP_LE:
+        x.hi = std::min(x.hi, y.hi);
+        y.lo = std::max(y.lo, x.lo);
+        break;
+    case OP_GT:
+        return Constrain(OP_LT, y, x);
+    case OP_GE:
+        return Constrain(OP_LE, y, x);
+    case OP_EQ:
+        x.lo = y.lo = std::max(x.lo, y.lo);
+        x.hi = y.hi = std::min(x.hi, y.hi);
+        break;
+    case OP_NE:
+        // Исключается только значение на краю диапазона
+        for (int side = 0; side < 2; side++) {
+            Interval& u = side ? y : x;
+            const Interval& k = side ? x : y;
+            if (k.lo != k.hi) continue;
+            if ((u.lo == k.lo) && (u.lo < INT64_MAX)) u.lo++;
+            else if ((u.hi == k.lo) && (u.hi > INT64_MIN)) u.hi--;
+        }
+        break;
+    default:
+        break;
+    }
+    return (x.lo <= x.hi) && (y.lo <= y.hi);
+}
+
+// Значение на стеке
+struct RangeValue {
+    Interval r;
+    int slot;    // Значение ячейки slot (LOAD), пока она не изменилась, иначе -1
+    int cmp;     // Результат сравнения cmp значений left и right (ячейки, как slot), иначе -1
+    int left;
+    int right;
+    Interval lr; // Диапазоны операндов сравнения
+    Interval rr;
+
+    bool operator==(const RangeValue& other) const {
+        return (r == other.r) && (slot == other.slot) && (cmp == other.cmp) && (left == other.left)
+            && (right == other.right) && (lr == other.lr) && (rr == other.rr);
+    }
+};
+
+static RangeValue MakeRange(const Interval& r) {
+    return { r, -1, -1, -1, -1, r, r };
+}
+
+// Состояние перед командой: диапазоны ячеек и значений на стеке
+struct RangeState {
+    std::map<int, Interval> vars; // Ячейка -> диапазон; нет -- любое значение её типа
+    std::vector<RangeValue> stack;
+
+    bool operator==(const RangeState& other) const { return (vars == other.vars) && (stack == other.stack); }
+};
+
+// Объединение состояний на входе в блок; false -- разная глубина стека
+static bool Join(const RangeState& a, const RangeState& b, RangeState& out) {
+    if (a.stack.size() != b.stack.size()) {
+        return false;
+    }
+    RangeState r;
+    for (const auto& v : a.vars) {
+        auto it = b.vars.find(v.first);
+        if (it != b.vars.end()) {
+            r.vars[v.first] = Hull(v.second, it->second);
+        }
+    }
+    for (size_t i = 0; i < a.stack.size(); i++) {
+        const RangeValue& x = a.stack[i];
+        const RangeValue& y = b.stack[i];
+        RangeValue v = MakeRange(Hull(x.r, y.r));
+        v.slot = (x.slot == y.slot) ? x.slot : -1;
+        if ((x.cmp >= 0) && (x.cmp == y.cmp) && (x.left == y.left) && (x.right == y.right)) {
+            v.cmp = x.cmp;
+            v.left = x.left;
+            v.right = x.right;
+            v.lr = Hull(x.lr, y.lr);
+            v.rr = Hull(x.rr, y.rr);
+        }
+        r.stack.push_back(v);
+    }
+    out = r;
+    return true;
+}
+
+// Расширение: граница, сдвинувшаяся после нескольких обходов цикла, уходит до ближайшего
+// порога (константы программы +-1, границы типов) или до предела; чтение ячейки ограничивает
+// её значение типом
+static void Widen(const std::set<int64_t>& thresholds, const Interval& old, Interval& next) {
+    if (next.lo < old.lo) {
+        auto it = thresholds.upper_bound(next.lo);
+        next.lo = (it == thresholds.begin()) ? INT64_MIN : *--it;
+    }
+    if (next.hi > old.hi) {
+        auto it = thresholds.lower_bound(next.hi);
+        next.hi = (it == thresholds.end()) ? INT64_MAX : *it;
+    }
+}
+
+static void Widen(const std::set<int64_t>& thresholds, const RangeState& old, RangeState& next) {
+    for (auto& v : next.vars) {
+        Widen(thresholds, old.vars.at(v.first), v.second);
+    }
+    for (size_t i = 0; i < next.stack.size(); i++) {
+        RangeValue& v = next.stack[i];
+        const RangeValue& o = old.stack[i];
+        Widen(thresholds, o.r, v.r);
+        Widen(thresholds, o.lr, v.lr);
+        Widen(thresholds, o.rr, v.rr);
+    }
+}
+
+// Пересечение с диапазоном типа (значение ячейки не выходит из него)
+static Interval Clip(const Interval& r, const Interval& type) {
+    const Interval x = { std::max(r.lo, type.lo), std::min(r.hi, type.hi) };
+    return (x.lo <= x.hi) ? x : type;
+}
+
+// Ячейка изменилась: значения на стеке больше не связаны с ней
+static void Forget(RangeState& s, int slot) {
+    for (RangeValue& v : s.stack) {
+        if (v.slot == slot) v.slot = -1;
+        if (v.left == slot) v.left = -1;
+        if (v.right == slot) v.right = -1;
+    }
+}
+
+// Ячейка slot (если есть) принимает значения только из r; false -- ни одного
+static bool Narrow(RangeState& s, int slot, const Interval& r) {
+    if (slot < 0) {
+        return true;
+    }
+    auto it = s.vars.find(slot);
+    if (it == s.vars.end()) {
+        s.vars[slot] = r;
+        return true;
+    }
+    it->second = { std::max(it->second.lo, r.lo), std::min(it->second.hi, r.hi) };
+    return it->second.lo <= it->second.hi;
+}
+
+// Переход по значению условия v: truth -- условие истинно. Сравнение сужает диапазоны
+// ячеек-операндов, чтение ячейки -- её диапазон. false -- переход невозможен
+static bool Assume(RangeState& s, const RangeValue& v, bool truth) {
+    if (truth ? ((v.r.lo == 0) && (v.r.hi == 0)) : ((v.r.lo > 0) || (v.r.hi < 0))) {
+        return false;
+    }
+    if (v.cmp >= 0) {
+        Interval x = v.lr;
+        Interval y = v.rr;
+        return Constrain(truth ? v.cmp : NegateCompare(v.cmp), x, y) && Narrow(s, v.left, x) && Narrow(s, v.right, y);
+    }
+    Interval x = v.r;
+    Interval zero = { 0, 0 };
+    return Constrain(truth ? OP_NE : OP_EQ, x, zero) && Narrow(s, v.slot, x);
+}
+
+// Выполнить над состоянием s команды блока [first, last]; edge(адрес, состояние) -- переход
+// (в том числе в следующий блок). flags -- отметить команды (PROVEN_FLAG).
+// false -- стек не сходится (анализ не применяется)
+template <typename Edge>
+static bool RangeBlock(const std::vector<Instr>& c, int first, int last, RangeState s, bool debug, bool checked,
+    Edge edge, std::vector<uint8_t>* flags) {
+    for (int pc = first; pc <= last; pc++) {
+        const Instr& in = c[pc];
+        const size_t depth = s.stack.size();
+        switch (in.op) {
+        case OP_NOP: case OP_ENTER: case OP_EXIT:
+            break;
+        case OP_CONST:
+            s.stack.push_back(MakeRange({ in.imm, in.imm }));
+            break;
+        case OP_LOADQ:
+        case OP_LOAD: {
+            if (in.op == OP_LOADQ) {
+                if (static_cast<size_t>(in.imm) > depth) return false;
+                RangeState q = s;
+                q.stack.resize(depth - static_cast<size_t>(in.imm));
+                edge(in.b, q);
+            }
+            auto it = s.vars.find(in.a);
+            const Interval type = TypeInterval(in.type);
+            RangeValue v = MakeRange((it != s.vars.end()) ? Clip(it->second, type) : type);
+            v.slot = in.a;
+            s.stack.push_back(v);
+            break;
+        }
+        case OP_STORE: {
+            if (depth < 1) return false;
+            const Interval value = s.stack.back().r;
+            s.stack.pop_back();
+            const Interval to = ShiftInterval(in.shift);
+            const bool fits = value.Within(to);
+            // В debug режиме присваивание значения другого типа всё равно выдаёт предупреждение
+            if (flags && fits && (in.type2 != in.type) && !debug) {
+                (*flags)[pc] |= PROVEN_FITS;
+            }
+            Forget(s, in.a);
+            s.vars[in.a] = fits ? value : to;
+            break;
+        }
+        case OP_TSET:
+            if (depth < 1) return false;
+            Forget(s, in.a);
+            s.vars[in.a] = s.stack.back().r;
+            s.stack.pop_back();
+            break;
+        case OP_TCLR:
+            Forget(s, in.a);
+            s.vars.erase(in.a);
+            break;
+        case OP_TGET: {
+            RangeState q = s;
+            auto it = s.vars.find(in.a);
+            q.stack.push_back(MakeRange((it != s.vars.end()) ? it->second : ANY_VALUE));
+            edge(in.b, q);
+            break;
+        }
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD: case OP_DIVQ: case OP_MODQ: {
+            if (depth < 2) return false;
+            Interval b = s.stack[depth - 1].r;
+            const Interval a = s.stack[depth - 2].r;
+            int op = in.op;
+            if ((op == OP_DIVQ) || (op == OP_MODQ)) {
+                if (static_cast<size_t>(in.imm) > depth) return false;
+                if ((b.lo <= 0) && (b.hi >= 0)) {
+                    RangeState q = s;
+                    q.stack.resize(depth - static_cast<size_t>(in.imm));
+                    edge(in.b, q);
+                }
+                op = (op == OP_DIVQ) ? OP_DIV : OP_MOD;
+            }
+            if ((op == OP_DIV) || (op == OP_MOD)) {
+                // Дальше -- только с ненулевым делителем
+                if ((b.lo == 0) && (b.hi == 0)) return true;
+                if (b.lo == 0) b.lo = 1;
+                if (b.hi == 0) b.hi = -1;
+            }
+            s.stack.resize(depth - 2);
+
+            const Interval type = ShiftInterval(in.shift);
+            Interval exact = ANY_VALUE;
+            const bool known = ExactRange(op, a, b, exact);
+            Interval r = type;
+            if (known && exact.Within(type)) {
+                r = exact;
+                if (flags) (*flags)[pc] |= PROVEN_FITS;
+            }
+            else if (known && checked && CanOverflow(op) && (exact.lo <= type.hi) && (exact.hi >= type.lo)) {
+                // Значение вне типа -- ошибка выполнения
+                r = { std::max(exact.lo, type.lo), std::min(exact.hi, type.hi) };
+            }
+            if (flags && (op >= OP_DIV) && (in.reduce == REDUCE_NONE) && known && exact.Within(INT32_VALUE)
+                && a.Within(INT32_VALUE) && b.Within(INT32_VALUE)) {
+                (*flags)[pc] |= PROVEN_NARROW;
+            }
+            s.stack.push_back(MakeRange(r));
+            break;
+        }
+        case OP_LT: case OP_LE: case OP_GT: case OP_GE: case OP_EQ: case OP_NE: {
+            if (depth < 2) return false;
+            const RangeValue& x = s.stack[depth - 2];
+            const RangeValue& y = s.stack[depth - 1];
+            Interval tx = x.r, ty = y.r, fx = x.r, fy = y.r;
+            const bool can_true = Constrain(in.op, tx, ty);
+            const bool can_false = Constrain(NegateCompare(in.op), fx, fy);
+            RangeValue v = MakeRange({ can_false ? 0 : 1, can_true ? 1 : 0 });
+            if (v.r.lo > v.r.hi) v.r = { 0, 1 };
+            v.cmp = in.op;
+            v.left = x.slot;
+            v.right = y.slot;
+            v.lr = x.r;
+            v.rr = y.r;
+            s.stack.resize(depth - 2);
+            s.stack.push_back(v);
+            break;
+        }
+        case OP_JMP:
+            edge(in.a, s);
+            return true;
+        case OP_JZ: {
+            if (depth < 1) return false;
+            const RangeValue v = s.stack.back();
+            s.stack.pop_back();
+            RangeState taken = s;
+            if (Assume(taken, v, false)) {
+                edge(in.a, taken);
+            }
+            if (!Assume(s, v, true)) {
+                return true;
+            }
+            break;
+        }
+        case OP_LOOP: case OP_NEXT:
+            // Имена тела объявляются заново: значение неизвестно
+            for (int64_t slot = in.b; slot < in.imm; slot++) {
+                Forget(s, static_cast<int>(slot));
+                s.vars.erase(static_cast<int>(slot));
+            }
+            if (in.op == OP_LOOP) {
+                edge(in.a, s);
+                return true;
+            }
+            break;
+        case OP_ITER:
+            edge(in.a, s);
+            break;
+        case OP_RAISE: case OP_HALT:
+            return true;
+        default:
+            // Суперкоманды: анализ -- до Fuse
+            return false;
+        }
+    }
+    edge(last + 1, s);
+    return true;
+}
+
+// Число изменений состояния на входе в заголовок цикла, после которого диапазоны расширяются
+static const int WIDEN_AFTER = 3;
+// Проходов сужения после неподвижной точки с расширением
+static const int NARROW_ROUNDS = 2;
+
+// Диапазоны значений ячеек и стека на входе в каждый блок -- интервальный анализ с расширением
+// и сужением; условия переходов (сравнение переменной с переменной или константой) сужают
+// диапазоны. Присваивание и арифметика, значение которых заведомо в диапазоне типа,
+// получают PROVEN_FITS, деление и остаток в 32 битах -- PROVEN_NARROW
+static void AnalyzeRanges(Code& code, bool debug, bool checked) {
+    std::vector<Instr>& c = code.instrs;
+    for (Instr& in : c) {
+        in.proven &= ~(PROVEN_FITS | PROVEN_NARROW);
+    }
+    if (c.empty()) {
+        return;
+    }
+    const Ssa ssa(code);
+    const std::vector<Ssa::Block>& blocks = ssa.Blocks();
+    const int n = static_cast<int>(c.size());
+    const size_t count = blocks.size();
+
+    std::vector<RangeState> state(count);
+    std::vector<bool> reached(count, false);
+    std::vector<int> changes(count, 0);
+    // Расширяются только заголовки циклов: блоки, на которые есть переход назад
+    std::vector<bool> head(count, false);
+    for (size_t b = 0; b < count; b++) {
+        for (int p : blocks[b].preds) {
+            if (p >= static_cast<int>(b)) head[b] = true;
+        }
+    }
+    std::set<int64_t> thresholds = { INT16_MIN, INT16_MAX, INT32_MIN, INT32_MAX };
+    for (const Instr& in : c) {
+        if (in.op != OP_CONST) continue;
+        thresholds.insert(in.imm);
+        if (in.imm > INT64_MIN) thresholds.insert(in.imm - 1);
+        if (in.imm < INT64_MAX) thresholds.insert(in.imm + 1);
+    }
+    std::set<int> work;
+    bool failed = false;
+    reached[0] = true;
+    work.insert(0);
+
+    auto propagate = [&](int pc, const RangeState& in) {
+        if ((pc < 0) || (pc >= n)) return;
+        const int b = ssa.BlockOf(pc);
+        if (!reached[b]) {
+            state[b] = in;
+            reached[b] = true;
+            work.insert(b);
+            return;
+        }
+        RangeState merged;
+        if (!Join(state[b], in, merged)) {
+            failed = true;
+            return;
+        }
+        if (merged == state[b]) return;
+        if (head[b] && (++changes[b] > WIDEN_AFTER)) {
+            Widen(thresholds, state[b], merged);
+        }
+        state[b] = merged;
+        work.insert(b);
+    };
+    while (!work.empty() && !failed) {
+        const int b = *work.begin();
+        work.erase(work.begin());
+        failed = !RangeBlock(c, blocks[b].first, blocks[b].last, state[b], debug, checked, propagate, nullptr);
+    }
+    if (failed) {
+        return;
+    }
+
+    // Сужение: вход каждого блока пересчитывается по выходам предшественников
+    for (int round = 0; round < NARROW_ROUNDS; round++) {
+        std::vector<RangeState> next(count);
+        std::vector<bool> got(count, false);
+        got[0] = true;
+        auto collect = [&](int pc, const RangeState& in) {
+            if ((pc < 0) || (pc >= n)) return;
+            const int b = ssa.BlockOf(pc);
+            if (!got[b]) {
+                next[b] = in;
+                got[b] = true;
+            }
+            else if (!Join(next[b], in, next[b])) {
+                failed = true;
+            }
+        };
+        for (size_t b = 0; b < count; b++) {
+            if (reached[b]) {
+                RangeBlock(c, blocks[b].first, blocks[b].last, state[b], debug, checked, collect, nullptr);
+            }
+        }
+        if (failed) {
+            return;
+        }
+        for (size_t b = 0; b < count; b++) {
+            reached[b] = reached[b] && got[b];
+            if (reached[b]) state[b] = next[b];
+        }
+    }
+
+    std::vector<uint8_t> flags(c.size(), 0);
+    auto ignore = [](int, const RangeState&) {};
+    for (size_t b = 0; b < count; b++) {
+        if (reached[b]) {
+            RangeBlock(c, blocks[b].first, blocks[b].last, state[b], debug, checked, ignore, &flags);
+        }
+    }
+    for (int pc = 0; pc < n; pc++) {
+        c[pc].proven |= flags[pc];
+        if (!flags[pc]) continue;
+        if (c[pc].op == OP_STORE) code.fitStores++;
+        else if (flags[pc] & PROVEN_FITS) code.fitOps++;
+        if (flags[pc] & PROVEN_NARROW) code.narrowDivs++;
+    }
+}
+
+// Анализ инициализации переменных (OPT_INIT)
+
+// Определённость значения переменной по форме SSA: "на всех путях" -- наибольшая неподвижная
+// точка (phi -- если все операнды), "хотя бы на одном" -- наименьшая (phi -- если какой-нибудь).
+// Значение при входе в программу -- как в ячейках машины (Vm::Vm): из дерева. Чтение, значение
+// которого определено на всех путях, отмечается PROVEN_INIT; чтение, до которого значение
+// не доходит ни по одному пути, всегда завершается ошибкой -- в code.uninitLoads (ошибка
+// остаётся на месте: до неё выполняются те же операции). Остальные проверяются при выполнении
+static void AnalyzeInit(Code& code, const Tree& tree) {
+    std::vector<Instr>& c = code.instrs;
+    for (Instr& in : c) {
+        in.proven &= ~PROVEN_INIT;
+    }
+    code.initLoads = 0;
+    code.uninitLoads.clear();
+    if (c.empty()) {
+        return;
+    }
+    const Ssa ssa(code);
+    auto at_entry = [&](int slot) {
+        return (slot < tree.Count()) && tree.Sem(slot).hasValue
+            && (tree.Sem(slot).DataType >= TYPE_INT) && (tree.Sem(slot).DataType <= TYPE_LONG_LONG_INT);
+    };
+
+    // Определения, которые читают LOAD, и операнды их phi
+    std::map<int, bool> must;
+    std::map<int, bool> may;
+    std::vector<int> phis;
+    std::vector<int> work;
+    const int n = static_cast<int>(c.size());
+    for (int pc = 0; pc < n; pc++) {
+        if ((c[pc].op == OP_LOAD) && ssa.Blocks()[ssa.BlockOf(pc)].reachable) {
+            work.push_back(ssa.Use(pc));
+        }
+    }
+    while (!work.empty()) {
+        const int d = work.back();
+        work.pop_back();
+        if (must.count(d)) {
+            continue;
+        }
+        const Ssa::Def& def = ssa.Get(d);
+        switch (def.kind) {
+        case Ssa::DEF_STORE:
+            must[d] = may[d] = true;
+            break;
+        case Ssa::DEF_ENTRY:
+            must[d] = may[d] = at_entry(def.slot);
+            break;
+        case Ssa::DEF_UNDEF:
+            must[d] = may[d] = false;
+            break;
+        case Ssa::DEF_PHI:
+            must[d] = true;
+            may[d] = false;
+            phis.push_back(d);
+            for (int arg : def.args) {
+                work.push_back(ssa.Resolve(arg));
+            }
+            break;
+        }
+    }
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (int d : phis) {
+            bool all = true;
+            bool any = false;
+            for (int arg : ssa.Get(d).args) {
+                const int r = ssa.Resolve(arg);
+                all = all && must[r];
+                any = any || may[r];
+            }
+            if (must[d] && !all) {
+                must[d] = false;
+                changed = true;
+            }
+            if (!may[d] && any) {
+                may[d] = true;
+                changed = true;
+            }
+        }
+    }
+
+    for (int pc = 0; pc < n; pc++) {
+        if ((c[pc].op != OP_LOAD) || !ssa.Blocks()[ssa.BlockOf(pc)].reachable) {
+            continue;
+        }
+        const int d = ssa.Use(pc);
+        if (must[d]) {
+            c[pc].proven |= PROVEN_INIT;
+            code.initLoads++;
+        }
+        else if (!may[d]) {
+            code.uninitLoads.push_back(pc);
+        }
+    }
+}
+
+std::vector<Diagnostic> UninitializedReads(const Code& code, const Tree& tree) {
+    Code analyzed = code;
+    if (analyzed.temps == 0) {
+        analyzed.tempBase = tree.Count();
+    }
+    AnalyzeInit(analyzed, tree);
+    std::vector<Diagnostic> found;
+    for (int pc : analyzed.uninitLoads) {
+        const Diagnostic& e = analyzed.errors[analyzed.instrs[pc].b];
+        found.push_back({ DIAG_WARNING, e.message + " -- значение не присваивается ни на одном пути", e.id, e.line, e.col });
+    }
+    return found;
+}
+
+void Optimize(Code& code, const Tree& tree, unsigned passes, bool debug, int unroll, bool checked) {
+    if (code.temps == 0) {
+        code.tempBase = tree.Count();
+    }
+    // Распространение копий и констант открывает вычисление выражений и переходов,
+    // а оно -- новые копии
+    if (passes & (1u << OPT_COPY)) {
+        for (int round = 0; round < 4; round++) {
+            PropagateCopies(code);
+            if (!FoldConstants(code, debug, checked)) break;
+        }
+    }
+    if (passes & (1u << OPT_UNREACHABLE)) {
+        RemoveUnreachable(code);
+    }
+    if (passes & (1u << OPT_DSE)) {
+        for (int round = 0; round < 4; round++) {
+            if (!EliminateDeadStores(code, debug, checked)) break;
+        }
+    }
+    if (passes & (1u << OPT_EVAL)) {
+        EvaluateLoops(code, tree, debug, checked);
+    }
+    if (passes & (1u << OPT_UNROLL)) {
+        UnrollLoops(code, unroll);
+    }
+    if (passes & (1u << OPT_LICM)) {
+        HoistInvariants(code, debug, checked);
+    }
+    if (passes & (1u << OPT_STRENGTH)) {
+        ReduceStrength(code, checked);
+    }
+    if (passes & (1u << OPT_RANGE)) {
+        AnalyzeRanges(code, debug, checked);
+    }
+    if (passes & (1u << OPT_INIT)) {
+        AnalyzeInit(code, tree);
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "code_gen.h"
+#include <string>
+#include <vector>
+
+class Tree;
+
+// Оптимизации байт-кода (номер бита в маске Context::optimizations)
+enum OPT_PASS {
+    OPT_LICM,     // Вынесение инвариантных выражений из циклов
+    OPT_STRENGTH, // Умножение, деление и остаток на константу -- сдвигами и умножением
+    OPT_EVAL,     // Вычисление циклов с известными значениями при трансляции
+    OPT_UNROLL,   // Развёртывание циклов со счётчиком
+    OPT_COPY,     // Распространение копий и констант, вычисление операций над константами
+    OPT_DSE,      // Удаление затираемых присваиваний
+    OPT_UNREACHABLE, // Удаление недостижимого кода
+    OPT_RANGE,    // Анализ диапазонов: присваивания и операции без проверок обрезки и переполнения
+    OPT_INIT,     // Анализ инициализации: чтения переменных без проверки значения
+    OPT_COUNT
+};
+
+constexpr unsigned OPT_ALL = (1u << OPT_COUNT) - 1;
+
+const char* OptPassName(int pass);
+
+// Кратность развёртывания циклов по умолчанию (OPT_UNROLL)
+constexpr int UNROLL_DEFAULT = 4;
+
+// Маска по списку имён через запятую ("licm", "strength", "eval", "unroll", "copy", "dse",
+// "unreachable", "range", "init", "all", "none"); false -- неизвестное имя
+bool ParseOptPasses(const std::string& list, unsigned& passes);
+
+// Оптимизировать байт-код до подстановки суперкоманд (Fuse). Значения переменных,
+// предупреждения и ошибки (с местом и текстом) не меняются; история выполнения
+// содержит только операции, которые действительно выполнены.
+// debug -- операции с предупреждениями о преобразовании типов не переносятся.
+//
+// OPT_LICM: выражение цикла (условия и тела вместе с вложенными циклами), которое
+// не читает переменных, присваиваемых в цикле или объявленных в его теле, вычисляется
+// в предзаголовке перед входом в цикл во временную ячейку, а в цикле берётся из неё (TGET).
+// Предзаголовок вычисляет его без ошибок (LOADQ, DIVQ, MODQ): если значение не получилось
+// (неинициализированная переменная, деление на ноль), ячейка остаётся невычисленной,
+// и в цикле выполняется исходный код выражения -- ошибка выдаётся там же, где без оптимизации.
+// Переносится наибольшее инвариантное выражение, в котором есть хотя бы одна операция.
+//
+// OPT_STRENGTH: операции MUL, DIV, MOD с константой справа получают план замены (REDUCE_KIND):
+// степень двойки и 2^k +- 1 -- сдвиги и сложение, деление и остаток на другую константу --
+// умножение на магическое число (старшая половина произведения) и сдвиг. Результат точно
+// совпадает с делением с отбрасыванием дробной части в разрядности типа (short и int считаются
+// в 32 битах, longlong -- в 64). Константа остаётся на стеке, поэтому суперкоманды и переходы
+// не меняются. Выполняется после OPT_LICM
+//
+// OPT_COPY, OPT_UNREACHABLE, OPT_DSE строят форму SSA байт-кода (ssa.h) и выполняются
+// первыми, в этом порядке.
+// OPT_COPY: чтение переменной, до которого доходит единственное присваивание константы
+// или другой переменной (не изменённой с тех пор, того же типа), заменяется константой или
+// чтением той переменной; затем операции над константами и переходы по константе
+// вычисляются (кроме деления на ноль и операций с предупреждением в debug режиме).
+// OPT_UNREACHABLE: удаляются команды, на которые нельзя попасть из начала программы.
+// OPT_DSE: присваивание, значение которого в том же блоке затирается следующим раньше,
+// чем его прочтут или выполнение может прерваться ошибкой (значения переменных при ошибке
+// видны), удаляется вместе с вычислением значения, если в нём нет ошибок и предупреждений.
+// Присваивания с предупреждением (обрезка значения, в debug режиме -- преобразование типа) остаются
+//
+// OPT_EVAL: цикл, все значения которого известны при входе (константы, присвоенные
+// перед ним без переходов), выполняется при трансляции, если он завершается не более чем
+// за 2^20 команд без ошибок и предупреждений (присваивания с обрезкой значения и в debug
+// режиме с преобразованием типа, операции с предупреждением). Вместо него -- ITER (учёт
+// итераций) и присваивания итоговых значений; исходный цикл остаётся запасным путём, если
+// будет превышен предел итераций, чтобы ошибка выдавалась на той же итерации.
+// Выполняется первой, циклы -- начиная с внешних
+//
+// OPT_UNROLL: тело внутреннего цикла while (i cmp N), где i меняется только
+// присваиванием i = i +- c на каждой итерации, повторяется unroll раз подряд, пока
+// i cmp N -+ (unroll - 1) * c; остаток итераций выполняет исходный цикл. Арифметика
+// с переносом в разрядности типа (short, int) только удаляет i от N, поэтому условие
+// между копиями заведомо истинно. Выполняется после OPT_EVAL
+//
+// OPT_RANGE: интервальный анализ байт-кода (диапазоны переменных и значений на стеке
+// на входе в блоки, с расширением на циклах и сужением по условиям переходов: i < N,
+// x != 0, ...) отмечает команды (PROVEN_FLAG): присваивание значения другого типа, которое
+// заведомо умещается в тип переменной, -- без проверки обрезки (кроме debug режима, где
+// выдаётся предупреждение о преобразовании); операция, результат которой заведомо в диапазоне
+// типа, -- без приведения и проверки переполнения (checked); деление и остаток, операнды
+// и результат которых умещаются в int32, -- в 32 битах. Код не меняется. Выполняется после OPT_STRENGTH
+//
+// OPT_INIT: анализ определённости значений по форме SSA (в блоках и циклах while; LOOP
+// сбрасывает имена тела). Чтение переменной, до которого значение доходит на всех путях
+// (присваивание или значение в дереве до выполнения), отмечается PROVEN_INIT -- без проверки
+// значения (JIT, перевод в C). Чтения, до которых значение не доходит ни по одному пути, --
+// ошибки, известные при трансляции (Code::uninitLoads, предупреждения UninitializedReads); сообщение
+// об ошибке выдаётся при выполнении там же, где без оптимизации. Код не меняется. Выполняется последней
+//
+// checked -- арифметика с проверкой переполнения (Context::checkedArithmetic): сложение,
+// вычитание, умножение и деление, которые переполняют тип, не вычисляются при трансляции,
+// не выносятся из циклов (ошибка выдавалась бы раньше) и не считаются безошибочными для OPT_DSE;
+// умножение и деление на -1 не заменяются (OPT_STRENGTH)
+void Optimize(Code& code, const Tree& tree, unsigned passes, bool debug, int unroll = UNROLL_DEFAULT, bool checked = false);
+
+// Анализ инициализации (как OPT_INIT) без остальных оптимизаций: предупреждения (DIAG_WARNING)
+// о чтениях переменных, до которых значение не доходит ни по одному пути, -- со строкой
+// и позицией чтения, в порядке команд. Код не меняется (анализируется копия)
+std::vector<Diagnostic> UninitializedReads(const Code& code, const Tree& tree);
@@ -0,0 +1,184 @@
+#include "profiler.h"
+#include "tree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <map>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROFILER_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_RDTSC
+#endif
+
+static const char* const OP_NAMES[PROF_OP_COUNT] = {
+    "=", "+", "-", "*", "/", "%", "<", "<=", ">", ">=", "==", "!="
+};
+
+#ifdef PROFILER_RDTSC
+static const char* const TICK_UNIT = "тактов";
+#else
+static const char* const TICK_UNIT = "нс";
+#endif
+
+Profiler::Profiler() : last(Now()) {
+}
+
+uint64_t Profiler::Now() {
+#ifdef PROFILER_RDTSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+PROFILE_OP Profiler::OpKind(const std::string& op) {
+    for (int i = 0; i < PROF_OP_COUNT; i++) {
+        if (op == OP_NAMES[i]) {
+            return static_cast<PROFILE_OP>(i);
+        }
+    }
+    return PROF_ASSIGN;
+}
+
+uint64_t Profiler::TotalTicks() const {
+    uint64_t total = 0;
+    for (const auto& kv : entries) {
+        total += kv.second.ticks;
+    }
+    return total;
+}
+
+// Доля от общего времени в процентах
+static double Percent(uint64_t part, uint64_t total) {
+    return (total > 0) ? 100.0 * static_cast<double>(part) / static_cast<double>(total) : 0.0;
+}
+
+// Вывод текста, выровненного вправо по ширине width (в символах UTF-8, а не байтах)
+static void PadLeft(std::ostream& out, const char* text, size_t width) {
+    size_t chars = 0;
+    for (const char* c = text; *c; c++) {
+        if ((static_cast<unsigned char>(*c) & 0xC0) != 0x80) chars++;
+    }
+    for (; chars < width; chars++) {
+        out << ' ';
+    }
+    out << text;
+}
+
+void Profiler::Report(std::ostream& out, size_t top) const {
+    struct Row {
+        int line;
+        uint64_t count;
+        uint64_t ticks;
+    };
+
+    // Свёртка по строкам и по видам операций
+    std::map<int, Row> by_line;
+    uint64_t op_count[PROF_OP_COUNT] = {};
+    uint64_t op_ticks[PROF_OP_COUNT] = {};
+    for (const auto& kv : entries) {
+        int line = static_cast<int>((kv.first >> 8) & 0xFFFFFFu);
+        int kind = static_cast<int>(kv.first & 0xFFu);
+        Row& r = by_line.emplace(line, Row{ line, 0, 0 }).first->second;
+        r.count += kv.second.count;
+        r.ticks += kv.second.ticks;
+        op_count[kind] += kv.second.count;
+        op_ticks[kind] += kv.second.ticks;
+    }
+
+    std::vector<Row> lines;
+    for (const auto& kv : by_line) {
+        lines.push_back(kv.second);
+    }
+    std::sort(lines.begin(), lines.end(), [](const Row& a, const Row& b) {
+        return (a.ticks != b.ticks) ? (a.ticks > b.ticks) : (a.line < b.line);
+    });
+    if (lines.size() > top) {
+        lines.resize(top);
+    }
+
+    uint64_t total = TotalTicks();
+    std::ios_base::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(1);
+
+    out << "Профиль: всего " << total << " " << TICK_UNIT << "\n";
+    out << "Строки (top " << lines.size() << "):\n";
+    out << "  ";
+    PadLeft(out, "строка", 8);
+    PadLeft(out, "выполнений", 14);
+    PadLeft(out, TICK_UNIT, 18);
+    PadLeft(out, "%", 8);
+    out << "\n";
+    for (const Row& r : lines) {
+        out << "  " << std::setw(8) << r.line << std::setw(14) << r.count
+            << std::setw(18) << r.ticks << std::setw(8) << Percent(r.ticks, total) << "\n";
+    }
+
+    int kinds[PROF_OP_COUNT];
+    for (int i = 0; i < PROF_OP_COUNT; i++) {
+        kinds[i] = i;
+    }
+    std::sort(kinds, kinds + PROF_OP_COUNT, [&](int a, int b) {
+        return (op_ticks[a] != op_ticks[b]) ? (op_ticks[a] > op_ticks[b]) : (a < b);
+    });
+
+    out << "Операции:\n";
+    for (int k : kinds) {
+        if (op_count[k] == 0) continue;
+        out << "  " << std::setw(8) << OP_NAMES[k] << std::setw(14) << op_count[k]
+            << std::setw(18) << op_ticks[k] << std::setw(8) << Percent(op_ticks[k], total) << "\n";
+    }
+
+    out.flags(flags);
+}
+
+// Путь областей от корня до scope через ';'
+static std::string ScopePath(const Tree& tree, int scope) {
+    std::vector<int> chain;
+    for (int p = scope; (p != Tree::NONE) && (p < tree.Count()); p = tree.Up(p)) {
+        chain.push_back(p);
+    }
+    std::string path;
+    for (size_t i = chain.size(); i > 0; i--) {
+        int node = chain[i - 1];
+        if (!path.empty()) {
+            path += ";";
+        }
+        if (tree.Up(node) == Tree::NONE) {
+            path += "глобальная область";
+        }
+        else if (tree.Info(node).id.empty()) {
+            path += "{}";
+        }
+        else {
+            path += tree.Info(node).id;
+        }
+    }
+    return path;
+}
+
+void Profiler::WriteFolded(const Tree& tree, std::ostream& out) const {
+    // Упорядочение по ключу делает вывод воспроизводимым
+    std::map<uint64_t, Entry> sorted(entries.begin(), entries.end());
+    std::unordered_map<int, std::string> paths;
+
+    for (const auto& kv : sorted) {
+        int scope = static_cast<int>(static_cast<uint32_t>(kv.first >> 32));
+        int line = static_cast<int>((kv.first >> 8) & 0xFFFFFFu);
+        int kind = static_cast<int>(kv.first & 0xFFu);
+
+        auto it = paths.find(scope);
+        if (it == paths.end()) {
+            it = paths.emplace(scope, ScopePath(tree, scope)).first;
+        }
+        if (!it->second.empty()) {
+            out << it->second << ";";
+        }
+        out << "строка " << line << ";" << OP_NAMES[kind] << " " << kv.second.ticks << "\n";
+    }
+}
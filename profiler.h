@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Tree;
+
+// Вид профилируемой операции
+enum PROFILE_OP {
+    PROF_ASSIGN, // =
+    PROF_ADD,    // +
+    PROF_SUB,    // -
+    PROF_MUL,    // *
+    PROF_DIV,    // /
+    PROF_MOD,    // %
+    PROF_LT,     // <
+    PROF_LE,     // <=
+    PROF_GT,     // >
+    PROF_GE,     // >=
+    PROF_EQ,     // ==
+    PROF_NE,     // !=
+    PROF_OP_COUNT
+};
+
+// Профилировщик выполнения по строкам исходного текста.
+// Интерпретатор вычисляет выражения во время разбора, поэтому время между
+// двумя соседними операциями (разбор и вычисление операндов) относится
+// к следующей операции: сумма по всем операциям близка ко времени выполнения.
+// Счётчики копятся по (область, строка, операция); отчёты по строкам, видам
+// операций и свёрнутые стеки строятся из них после выполнения
+class Profiler {
+public:
+    Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Текущее значение счётчика тактов (rdtsc, где доступен, иначе steady_clock в нс)
+    static uint64_t Now();
+
+    // Вид операции по её знаку ("=", "+", "<=", ...)
+    static PROFILE_OP OpKind(const std::string& op);
+
+    // Начать отсчёт заново (перед выполнением программы)
+    void Start() { last = Now(); }
+
+    // Выполнена операция kind в строке line области scope
+    void Record(int scope, int line, PROFILE_OP kind) {
+        uint64_t now = Now();
+        Entry& e = entries[Key(scope, line, kind)];
+        e.count++;
+        e.ticks += now - last;
+        last = now;
+    }
+
+    // Всего тактов по всем операциям
+    uint64_t TotalTicks() const;
+
+    // Отчёт: top строк и все виды операций, по убыванию тактов
+    void Report(std::ostream& out, size_t top) const;
+
+    // Свёрнутые стеки для flamegraph.pl / speedscope:
+    // "область;...;строка N;операция такты" по строке на стек
+    void WriteFolded(const Tree& tree, std::ostream& out) const;
+
+private:
+    struct Entry {
+        uint64_t count = 0;
+        uint64_t ticks = 0;
+    };
+
+    static uint64_t Key(int scope, int line, PROFILE_OP kind) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(scope)) << 32)
+            | (static_cast<uint64_t>(static_cast<uint32_t>(line) & 0xFFFFFFu) << 8)
+            | static_cast<uint64_t>(kind);
+    }
+
+    std::unordered_map<uint64_t, Entry> entries;
+    uint64_t last;
+};
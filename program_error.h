@@ -0,0 +1,16 @@
+#pragma once
+#include "diagnostic.h"
+#include <stdexcept>
+#include <string>
+
+// Ошибка, прерывающая разбор/интерпретацию программы.
+// what() содержит сообщение в том виде, в котором оно выводится пользователю
+class ProgramError : public std::runtime_error {
+public:
+    explicit ProgramError(const Diagnostic& d) : std::runtime_error(FormatDiagnostic(d)), diag(d) {}
+
+    const Diagnostic& GetDiagnostic() const { return diag; }
+
+private:
+    Diagnostic diag;
+};
@@ -1,23 +1,37 @@
 #include "scanner.h"
 #include "defines.h"
+#include "stats.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 
 #define MAX_CONST_LEN 20 // Максимальная длина числовой константы и идентификатора
 
-Scanner::Scanner() : text(), current_pos(0) {}
+Scanner::Scanner() : text(), current_pos(0), line_starts(1, 0) {}
 
 bool Scanner::loadFile(const std::string& file_name) {
+    Stats::PhaseTimer timer(PHASE_SCAN);
     std::ifstream in(file_name);
     if (!in) return false;
 
     std::ostringstream ss;
     ss << in.rdbuf();
-    text = ss.str();
+    loadText(ss.str());
+    return true;
+}
+
+void Scanner::loadText(const std::string& source) {
+    text = source;
     text.push_back('\0');
     current_pos = 0;
-    return true;
+
+    line_starts.assign(1, 0);
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '\n') {
+            line_starts.push_back(i + 1);
+        }
+    }
 }
 
 char Scanner::peek(size_t offset) const {
@@ -77,6 +91,10 @@ void Scanner::skipIgnored() {
 }
 
 int Scanner::getNextLex(std::string& out_lex) {
+    Stats::PhaseTimer timer(PHASE_SCAN);
+    if (Stats* stats = Stats::Active()) {
+        stats->tokens++;
+    }
     out_lex.clear();
     skipIgnored();
 
@@ -312,15 +330,10 @@ int Scanner::getNextLex(std::string& out_lex) {
 
 // Подсчёт строки и столбца
 std::pair<int, int> Scanner::getLineCol() const {
-    int line = 1, col = 0;
-    for (size_t i = 0; (i < current_pos) && (i < text.size()); i++) {
-        if (text[i] == '\n') {
-            ++line;
-            col = 0;
-        }
-        else {
-            ++col;
-        }
-    }
-    return { line, col };
-}
\ No newline at end of file
+    Stats::PhaseTimer timer(PHASE_SCAN);
+    // Строка -- число переводов строки до текущей позиции + 1, позиция в строке --
+    // расстояние от начала строки; начала строк найдены при загрузке текста
+    size_t pos = std::min(current_pos, text.size());
+    size_t line = std::upper_bound(line_starts.begin(), line_starts.end(), pos) - line_starts.begin();
+    return { static_cast<int>(line), static_cast<int>(pos - line_starts[line - 1]) };
+}
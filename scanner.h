@@ -1,10 +1,12 @@
 #pragma once
 #include <string>
+#include <vector>
 
 class Scanner {
 private:
     std::string text;
     size_t current_pos;
+    std::vector<size_t> line_starts; // Позиции начала строк (для getLineCol)
 
     char peek(size_t offset = 0) const;
     char getChar();
@@ -23,6 +25,12 @@ public:
     Scanner();
 
     bool loadFile(const std::string& file_name);
+    void loadText(const std::string& source);
     int getNextLex(std::string& out_lex);
     std::pair<int, int> getLineCol() const;
+
+    // Текущая позиция в тексте; setPos возвращает сканер к сохранённой позиции
+    // (повторный разбор тела цикла)
+    size_t getPos() const { return current_pos; }
+    void setPos(size_t pos) { current_pos = pos; }
 };
\ No newline at end of file
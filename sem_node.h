@@ -1,9 +1,12 @@
 #pragma once
 #include <string>
+#include <cstdint>
 #include "data_type.h"
 
+// Горячая часть идентификатора: то, что читается при каждом обращении к переменной
+// (16 байт, плотно лежит в SymbolStore::values). Используется и для промежуточных
+// значений при вычислении выражений
 struct SemNode {
-	std::string id; // Имя идентификатора
 	DATA_TYPE DataType; // Тип объекта
 
 	bool hasValue = false; // Есть ли известное константное значение
@@ -13,10 +16,25 @@ struct SemNode {
 		int32_t v_int32;
 		int64_t v_int64;
 	} Value; // Само значение
+};
+
+// Значение целого типа, расширенное до 64 бит (другие типы -- 0)
+inline int64_t WidenValue(const SemNode& n) {
+	switch (n.DataType) {
+	case TYPE_SHORT_INT: return n.Value.v_int16;
+	case TYPE_INT: return n.Value.v_int32;
+	case TYPE_LONG_INT: return n.Value.v_int32;
+	case TYPE_LONG_LONG_INT: return n.Value.v_int64;
+	default: return 0;
+	}
+}
 
+// Холодная часть идентификатора: имя, позиция объявления и номер описателя типа
+// (нужны при объявлении, печати дерева и выдаче ошибок)
+struct SemInfo {
+	std::string id; // Имя идентификатора
 	int FlagConst; // Признак константы
-	DATA_TYPE BasicType; // Базовый тип (тип элемента массива или тип для которого создаётся метка)
-	int ArrElemCount; // Размерность массива (для метки типа для массива и для переменной-массива)
+	int TypeId; // Описатель типа в TypeTable (тип элемента и размерность массива или тип, для которого создаётся метка)
 	int index; // Для элемента массива, чтобы знать его индекс в массиве
 	int line; // Строка объявления (для сообщений об ошибках)
 	int col; // Позиция в строке (для сообщений об ошибках)
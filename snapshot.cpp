@@ -0,0 +1,276 @@
+#include "snapshot.h"
+#include "tree.h"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char SNAPSHOT_MAGIC[4] = { 'T', 'Y', 'S', 'N' };
+static const uint32_t NO_PARENT = 0xFFFFFFFFu;
+static const uint32_t BYTE_ORDER_MARK = 0x01020304u;
+
+struct SnapshotHeader {
+    char magic[4];         // "TYSN"
+    uint32_t version;      // Snapshot::VERSION
+    uint32_t byte_order;   // BYTE_ORDER_MARK в порядке байтов записавшей машины
+    uint32_t node_count;   // Количество узлов
+    uint32_t strings_size; // Размер таблицы имён
+    uint32_t reserved;     // 0 (узлы выровнены на 8 байт)
+};
+
+struct SnapshotNode {
+    uint32_t parent;       // NO_PARENT: все узлы -- элементы глобальной области
+    uint32_t name_offset;  // Смещение имени в таблице имён
+    uint32_t name_length;  // Длина имени
+    uint8_t data_type;     // DATA_TYPE
+    uint8_t basic_type;    // DATA_TYPE базового типа
+    uint8_t has_value;     // Есть ли значение
+    uint8_t flag_const;    // Признак константы
+    int32_t arr_elem_count;
+    int32_t index;
+    int32_t line;
+    int32_t col;
+    int64_t value;         // Значение, расширенное до 64 бит
+};
+
+static_assert(sizeof(SnapshotHeader) == 24, "SnapshotHeader layout");
+static_assert(sizeof(SnapshotNode) == 40, "SnapshotNode layout");
+
+static void NarrowValue(SemNode& n, int64_t v) {
+    switch (n.DataType) {
+    case TYPE_SHORT_INT: n.Value.v_int16 = static_cast<int16_t>(v); break;
+    case TYPE_INT: n.Value.v_int32 = static_cast<int32_t>(v); break;
+    case TYPE_LONG_INT: n.Value.v_int32 = static_cast<int32_t>(v); break;
+    case TYPE_LONG_LONG_INT: n.Value.v_int64 = v; break;
+    default: n.Value.v_int64 = 0; break;
+    }
+}
+
+// Объявления верхнего уровня глобальной области (без составных операторов) в порядке объявления
+static std::vector<int> TopLevel(const Context& ctx) {
+    std::vector<int> nodes;
+    if (ctx.Root == Tree::NONE) {
+        return nodes;
+    }
+    for (int t = ctx.tree.Right(ctx.Root); t != Tree::NONE; t = ctx.tree.Left(t)) {
+        if (ctx.tree.Sem(t).DataType != TYPE_SCOPE) {
+            nodes.push_back(t);
+        }
+    }
+    return nodes;
+}
+
+Snapshot::Snapshot() : data(nullptr), size(0), mapped(false) {}
+
+Snapshot::~Snapshot() {
+    Close();
+}
+
+void Snapshot::Close() {
+    if (data) {
+#ifndef _WIN32
+        if (mapped) {
+            munmap(const_cast<unsigned char*>(data), size);
+        }
+        else
+#endif
+        {
+            delete[] data;
+        }
+    }
+    data = nullptr;
+    size = 0;
+    mapped = false;
+}
+
+bool Snapshot::Save(const Context& ctx, const std::string& file_name) {
+    std::vector<SnapshotNode> nodes;
+    std::string strings;
+
+    // Объявления верхнего уровня -- непосредственные элементы глобальной области, кроме
+    // составных операторов (тело main и вложенные в него области с локальными именами)
+    const Tree& tree = ctx.tree;
+    for (int t : TopLevel(ctx)) {
+        const SemNode& n = tree.Sem(t);
+        const SemInfo& si = tree.Info(t);
+        SnapshotNode sn;
+        std::memset(&sn, 0, sizeof(sn));
+        sn.parent = NO_PARENT;
+        sn.name_offset = static_cast<uint32_t>(strings.size());
+        sn.name_length = static_cast<uint32_t>(si.id.size());
+        sn.data_type = static_cast<uint8_t>(n.DataType);
+        sn.basic_type = static_cast<uint8_t>(tree.Type(t).BasicType);
+        sn.has_value = n.hasValue ? 1 : 0;
+        sn.flag_const = si.FlagConst ? 1 : 0;
+        sn.arr_elem_count = tree.Type(t).ArrElemCount;
+        sn.index = si.index;
+        sn.line = si.line;
+        sn.col = si.col;
+        sn.value = n.hasValue ? WidenValue(n) : 0;
+        strings += si.id;
+        nodes.push_back(sn);
+    }
+
+    SnapshotHeader header;
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.reserved = 0;
+    header.node_count = static_cast<uint32_t>(nodes.size());
+    header.strings_size = static_cast<uint32_t>(strings.size());
+
+    std::ofstream out(file_name, std::ios::binary);
+    if (!out) return false;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(SnapshotNode));
+    out.write(strings.data(), strings.size());
+    return static_cast<bool>(out);
+}
+
+bool Snapshot::Open(const std::string& file_name) {
+    Close();
+
+#ifndef _WIN32
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if ((fstat(fd, &st) == 0) && (st.st_size > 0)) {
+        void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            data = static_cast<const unsigned char*>(p);
+            size = static_cast<size_t>(st.st_size);
+            mapped = true;
+        }
+    }
+    ::close(fd);
+#endif
+
+    if (!data) {
+        std::ifstream in(file_name, std::ios::binary | std::ios::ate);
+        if (!in) return false;
+        std::streamoff len = in.tellg();
+        if (len <= 0) return false;
+        unsigned char* buf = new unsigned char[static_cast<size_t>(len)];
+        in.seekg(0);
+        in.read(reinterpret_cast<char*>(buf), len);
+        data = buf;
+        size = static_cast<size_t>(len);
+    }
+
+    // Проверка заголовка и размеров
+    SnapshotHeader header;
+    if (size < sizeof(header)) {
+        Close();
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if ((std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) || (header.version != VERSION)
+        || (header.byte_order != BYTE_ORDER_MARK)) {
+        Close();
+        return false;
+    }
+    size_t expected = sizeof(header) + static_cast<size_t>(header.node_count) * sizeof(SnapshotNode) + header.strings_size;
+    if (size != expected) {
+        Close();
+        return false;
+    }
+
+    // Узлы -- только элементы глобальной области, имена -- внутри таблицы имён (LoadInto не проверяет)
+    const unsigned char* node_data = data + sizeof(header);
+    for (uint32_t i = 0; i < header.node_count; i++) {
+        SnapshotNode sn;
+        std::memcpy(&sn, node_data + static_cast<size_t>(i) * sizeof(SnapshotNode), sizeof(sn));
+        if ((sn.parent != NO_PARENT) || (sn.name_offset > header.strings_size)
+            || (sn.name_length > header.strings_size - sn.name_offset)) {
+            Close();
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t Snapshot::NodeCount() const {
+    if (!data) return 0;
+    SnapshotHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    return header.node_count;
+}
+
+void Snapshot::LoadInto(Context& ctx) const {
+    if (!data) return;
+
+    int saved_cur = ctx.Cur;
+    int root = ctx.CreateRoot();
+
+    SnapshotHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    const unsigned char* node_data = data + sizeof(header);
+    const char* strings = reinterpret_cast<const char*>(node_data + static_cast<size_t>(header.node_count) * sizeof(SnapshotNode));
+
+    // Все узлы снимка -- элементы глобальной области (проверено в Open): связи и массивы
+    // дерева заполняются разом, без поиска дублей и без разбора текста
+    Tree& tree = ctx.tree;
+    int first = tree.AddChildren(root, static_cast<int>(header.node_count));
+    for (uint32_t i = 0; i < header.node_count; i++) {
+        SnapshotNode sn;
+        std::memcpy(&sn, node_data + static_cast<size_t>(i) * sizeof(SnapshotNode), sizeof(sn));
+        int t = first + static_cast<int>(i);
+
+        SemInfo& si = tree.Info(t);
+        si.id.assign(strings + sn.name_offset, sn.name_length);
+        si.TypeId = tree.types.Intern(static_cast<DATA_TYPE>(sn.basic_type), sn.arr_elem_count);
+        si.FlagConst = sn.flag_const;
+        si.index = sn.index;
+        si.line = sn.line;
+        si.col = sn.col;
+        tree.symbols.hashes[t] = SymbolStore::Hash(si.id);
+
+        SemNode& n = tree.Sem(t);
+        n.DataType = static_cast<DATA_TYPE>(sn.data_type);
+        n.hasValue = (sn.has_value != 0);
+        if (n.hasValue) {
+            NarrowValue(n, sn.value);
+        }
+    }
+
+    ctx.Cur = (saved_cur != Tree::NONE) ? saved_cur : root;
+}
+
+bool Snapshot::Verify(const Context& ctx, const std::string& file_name) {
+    Snapshot snapshot;
+    if (!snapshot.Open(file_name)) {
+        return false;
+    }
+    Context loaded;
+    snapshot.LoadInto(loaded);
+
+    // Глобальная область загруженного контекста -- только сохранённые объявления, без областей
+    std::vector<int> expected = TopLevel(ctx);
+    std::vector<int> actual;
+    for (int t = loaded.tree.Right(loaded.Root); t != Tree::NONE; t = loaded.tree.Left(t)) {
+        actual.push_back(t);
+    }
+    if ((actual.size() != expected.size()) || (loaded.tree.Count() != static_cast<int>(expected.size()) + 1)) {
+        return false;
+    }
+    for (size_t i = 0; i < expected.size(); i++) {
+        const SemNode& a = loaded.tree.Sem(actual[i]);
+        const SemNode& e = ctx.tree.Sem(expected[i]);
+        const TypeDesc& at = loaded.tree.Type(actual[i]);
+        const TypeDesc& et = ctx.tree.Type(expected[i]);
+        if ((loaded.tree.Info(actual[i]).id != ctx.tree.Info(expected[i]).id) || (a.DataType != e.DataType)
+            || (a.hasValue != e.hasValue) || (a.hasValue && (WidenValue(a) != WidenValue(e)))
+            || (at.BasicType != et.BasicType) || (at.ArrElemCount != et.ArrElemCount)
+            || ((loaded.tree.Info(actual[i]).FlagConst != 0) != (ctx.tree.Info(expected[i]).FlagConst != 0))) {
+            return false;
+        }
+    }
+    return true;
+}
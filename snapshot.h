@@ -0,0 +1,54 @@
+#pragma once
+#include "context.h"
+#include <cstdint>
+#include <string>
+
+// Двоичный снимок семантического дерева (таблицы символов).
+// Позволяет один раз разобрать общий набор объявлений (typedef, const, глобальные
+// переменные) и затем подставлять его как глобальную область без повторного разбора.
+// Сохраняются только объявления верхнего уровня: тело main (составной оператор)
+// и всё, что объявлено в нём, в снимок не попадает. Значения -- как в контексте при сохранении;
+// lab4 --save-snapshot разбирает тело main без выполнения (Context::declarationsOnly),
+// поэтому глобальные переменные сохраняются со значениями из объявлений.
+//
+// Формат (числа -- в порядке байтов записавшей машины, файл можно отображать в память как есть;
+// снимок с другим порядком байтов, см. SnapshotHeader::byte_order, не открывается):
+//   SnapshotHeader
+//   SnapshotNode[node_count]   -- элементы глобальной области в порядке объявления
+//   char[strings_size]         -- имена идентификаторов
+//
+// Загрузка (LoadInto) расширяет массивы дерева один раз и заполняет их из снимка без разбора
+// текста и поиска дублей. Время загрузки всё же линейно по числу узлов: имена копируются
+// в строки SemInfo, хеши имён вычисляются заново
+class Snapshot {
+public:
+    static const uint32_t VERSION = 2;
+
+    Snapshot();
+    ~Snapshot();
+
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    // Сохранить объявления глобальной области контекста в файл
+    static bool Save(const Context& ctx, const std::string& file_name);
+
+    // Проверка сохранённого снимка: он открывается, а глобальная область нового контекста
+    // после LoadInto содержит ровно объявления верхнего уровня ctx (имена, типы, значения)
+    static bool Verify(const Context& ctx, const std::string& file_name);
+
+    // Открыть (отобразить в память) и проверить файл снимка
+    bool Open(const std::string& file_name);
+
+    // Добавить объявления из снимка в глобальную область контекста
+    void LoadInto(Context& ctx) const;
+
+    size_t NodeCount() const;
+
+private:
+    const unsigned char* data; // Содержимое файла
+    size_t size;               // Размер файла
+    bool mapped;               // Файл отображён в память (иначе data выделен через new[])
+
+    void Close();
+};
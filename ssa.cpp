@@ -0,0 +1,323 @@
+#include "ssa.h"
+
+#include <algorithm>
+
+Ssa::Ssa(const Code& code) : code(code) {
+    const int n = static_cast<int>(code.instrs.size());
+    uses.assign(static_cast<size_t>(n), -1);
+    stores.assign(static_cast<size_t>(n), -1);
+    BuildBlocks();
+
+    const size_t count = blocks.size();
+    current.resize(count);
+    atEntry.resize(count);
+    incomplete.resize(count);
+    sealed.assign(count, false);
+    filled.assign(count, false);
+
+    // Блок запечатывается, когда заполнены все его предшественники (обратные переходы --
+    // после заполнения тела цикла)
+    auto try_seal = [&](int b) {
+        if (sealed[b]) return;
+        for (int p : blocks[b].preds) {
+            if (!filled[p]) return;
+        }
+        Seal(b);
+    };
+    for (int b = 0; b < static_cast<int>(count); b++) {
+        try_seal(b);
+        Fill(b);
+        filled[b] = true;
+        for (int s : blocks[b].succs) {
+            try_seal(s);
+        }
+    }
+    for (int b = 0; b < static_cast<int>(count); b++) {
+        if (!sealed[b]) Seal(b);
+    }
+    Analyze();
+}
+
+void Ssa::BuildBlocks() {
+    const std::vector<Instr>& c = code.instrs;
+    const int n = static_cast<int>(c.size());
+    std::vector<bool> leader(static_cast<size_t>(n) + 1, false);
+    leader[0] = true;
+    for (int pc = 0; pc < n; pc++) {
+        const Instr& in = c[pc];
+        if (const int32_t* t = JumpTarget(in)) {
+            if ((*t >= 0) && (*t < n)) leader[*t] = true;
+            leader[pc + 1] = true;
+        }
+        if ((in.op == OP_RAISE) || (in.op == OP_HALT)) {
+            leader[pc + 1] = true;
+        }
+    }
+
+    blockOf.assign(static_cast<size_t>(n), 0);
+    for (int pc = 0; pc < n; pc++) {
+        if (leader[pc]) {
+            blocks.push_back({ pc, pc, {}, {}, false });
+        }
+        blocks.back().last = pc;
+        blockOf[pc] = static_cast<int>(blocks.size()) - 1;
+    }
+
+    for (int b = 0; b < static_cast<int>(blocks.size()); b++) {
+        const Instr& in = c[blocks[b].last];
+        std::vector<int>& succs = blocks[b].succs;
+        const int32_t* t = JumpTarget(in);
+        if (t && (*t >= 0) && (*t < n)) {
+            succs.push_back(blockOf[*t]);
+        }
+        bool falls = (in.op != OP_JMP) && (in.op != OP_LOOP) && (in.op != OP_RAISE) && (in.op != OP_HALT);
+        if (falls && (blocks[b].last + 1 < n)) {
+            succs.push_back(b + 1);
+        }
+        std::sort(succs.begin(), succs.end());
+        succs.erase(std::unique(succs.begin(), succs.end()), succs.end());
+        for (int s : succs) {
+            blocks[s].preds.push_back(b);
+        }
+    }
+
+    if (blocks.empty()) {
+        return;
+    }
+    std::vector<int> work(1, 0);
+    blocks[0].reachable = true;
+    while (!work.empty()) {
+        int b = work.back();
+        work.pop_back();
+        for (int s : blocks[b].succs) {
+            if (!blocks[s].reachable) {
+                blocks[s].reachable = true;
+                work.push_back(s);
+            }
+        }
+    }
+}
+
+int Ssa::NewDef(DEF_KIND kind, int slot, int at) {
+    defs.push_back({ kind, slot, at, {}, -1 });
+    return static_cast<int>(defs.size()) - 1;
+}
+
+int Ssa::EntryDef(int slot) {
+    auto it = entry.find(slot);
+    if (it == entry.end()) {
+        it = entry.insert({ slot, NewDef(DEF_ENTRY, slot, -1) }).first;
+    }
+    return it->second;
+}
+
+int Ssa::Read(int slot, int block) {
+    auto it = current[block].find(slot);
+    if (it != current[block].end()) {
+        return it->second;
+    }
+    return ReadRecursive(slot, block);
+}
+
+// Начало программы -- ещё один (неявный) предшественник блока 0
+int Ssa::ReadRecursive(int slot, int block) {
+    const std::vector<int>& preds = blocks[block].preds;
+    const size_t inputs = preds.size() + ((block == 0) ? 1 : 0);
+    int value;
+    if (!sealed[block]) {
+        value = NewDef(DEF_PHI, slot, block);
+        incomplete[block][slot] = value;
+    }
+    else if (inputs == 0) {
+        value = EntryDef(slot);
+    }
+    else if (inputs == 1) {
+        value = preds.empty() ? EntryDef(slot) : Read(slot, preds[0]);
+    }
+    else {
+        value = NewDef(DEF_PHI, slot, block);
+        Write(slot, block, value);
+        value = AddPhiOperands(slot, value);
+    }
+    Write(slot, block, value);
+    return value;
+}
+
+int Ssa::ReadEntry(int slot, int block) {
+    auto it = atEntry[block].find(slot);
+    if (it != atEntry[block].end()) {
+        return it->second;
+    }
+    const std::vector<Instr>& c = code.instrs;
+    bool written = false;
+    for (int pc = blocks[block].first; (pc <= blocks[block].last) && !written; pc++) {
+        written = ((stores[pc] >= 0) && (defs[stores[pc]].slot == slot))
+            || (((c[pc].op == OP_LOOP) || (c[pc].op == OP_NEXT)) && (slot >= c[pc].b) && (slot < c[pc].imm));
+    }
+    int value;
+    if (!written) {
+        // В блоке ячейка не меняется: определение в начале то же, что в конце
+        value = Read(slot, block);
+    }
+    else if (blocks[block].preds.size() + ((block == 0) ? 1 : 0) == 1) {
+        value = blocks[block].preds.empty() ? EntryDef(slot) : Read(slot, blocks[block].preds[0]);
+    }
+    else if ((block != 0) && blocks[block].preds.empty()) {
+        value = EntryDef(slot);
+    }
+    else {
+        value = NewDef(DEF_PHI, slot, block);
+        atEntry[block][slot] = value;
+        value = AddPhiOperands(slot, value);
+    }
+    atEntry[block][slot] = value;
+    return value;
+}
+
+int Ssa::AddPhiOperands(int slot, int phi) {
+    const int block = defs[phi].at;
+    for (int p : blocks[block].preds) {
+        int arg = Read(slot, p);
+        defs[phi].args.push_back(arg);
+    }
+    if (block == 0) {
+        int arg = EntryDef(slot);
+        defs[phi].args.push_back(arg);
+    }
+    return TryRemoveTrivial(phi);
+}
+
+// phi, все операнды которой (кроме неё самой) -- одно определение, заменяется им
+int Ssa::TryRemoveTrivial(int phi) {
+    int same = -1;
+    for (size_t i = 0; i < defs[phi].args.size(); i++) {
+        int arg = Resolve(defs[phi].args[i]);
+        if ((arg == same) || (arg == phi)) {
+            continue;
+        }
+        if (same >= 0) {
+            return phi;
+        }
+        same = arg;
+    }
+    if (same < 0) {
+        // Блок недостижим или phi ссылается только на себя
+        same = EntryDef(defs[phi].slot);
+    }
+    defs[phi].same = same;
+    return same;
+}
+
+void Ssa::Seal(int block) {
+    const std::map<int, int> phis = incomplete[block];
+    for (const auto& phi : phis) {
+        AddPhiOperands(phi.first, phi.second);
+    }
+    incomplete[block].clear();
+    sealed[block] = true;
+}
+
+void Ssa::Fill(int block) {
+    const std::vector<Instr>& c = code.instrs;
+    for (int pc = blocks[block].first; pc <= blocks[block].last; pc++) {
+        const Instr& in = c[pc];
+        switch (in.op) {
+        case OP_LOAD: case OP_LOADQ: case OP_TGET: {
+            const bool first = current[block].find(in.a) == current[block].end();
+            uses[pc] = Read(in.a, block);
+            if (first) {
+                atEntry[block][in.a] = uses[pc];
+            }
+            break;
+        }
+        case OP_STORE: case OP_TSET:
+            stores[pc] = NewDef(DEF_STORE, in.a, pc);
+            Write(in.a, block, stores[pc]);
+            break;
+        case OP_TCLR:
+            stores[pc] = NewDef(DEF_UNDEF, in.a, pc);
+            Write(in.a, block, stores[pc]);
+            break;
+        case OP_LOOP: case OP_NEXT:
+            for (int64_t slot = in.b; slot < in.imm; slot++) {
+                int def = NewDef(DEF_UNDEF, static_cast<int>(slot), pc);
+                undefs[{ pc, static_cast<int>(slot) }] = def;
+                Write(static_cast<int>(slot), block, def);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void Ssa::Analyze() {
+    // Phi, ставшие тривиальными после замены операндов
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (int d = 0; d < static_cast<int>(defs.size()); d++) {
+            if ((defs[d].kind == DEF_PHI) && (defs[d].same < 0) && (TryRemoveTrivial(d) != d)) {
+                changed = true;
+            }
+        }
+    }
+
+    reads.assign(defs.size(), 0);
+    for (int use : uses) {
+        if (use >= 0) reads[Resolve(use)]++;
+    }
+    for (int d = 0; d < static_cast<int>(defs.size()); d++) {
+        if ((defs[d].kind != DEF_PHI) || (defs[d].same >= 0)) continue;
+        for (int arg : defs[d].args) {
+            if (Resolve(arg) != d) reads[Resolve(arg)]++;
+        }
+    }
+
+    // Наибольшая неподвижная точка: phi определена, пока не найден неопределённый операнд
+    defined.assign(defs.size(), false);
+    for (int d = 0; d < static_cast<int>(defs.size()); d++) {
+        defined[d] = (defs[d].kind == DEF_STORE) || (defs[d].kind == DEF_PHI);
+    }
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (int d = 0; d < static_cast<int>(defs.size()); d++) {
+            if ((defs[d].kind != DEF_PHI) || (defs[d].same >= 0) || !defined[d]) continue;
+            for (int arg : defs[d].args) {
+                if (!defined[Resolve(arg)]) {
+                    defined[d] = false;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+int Ssa::DefAt(int slot, int pc) {
+    const std::vector<Instr>& c = code.instrs;
+    const int block = blockOf[pc];
+    for (int j = pc - 1; j >= blocks[block].first; j--) {
+        if ((stores[j] >= 0) && (defs[stores[j]].slot == slot)) {
+            return Resolve(stores[j]);
+        }
+        if (((c[j].op == OP_LOOP) || (c[j].op == OP_NEXT)) && (slot >= c[j].b) && (slot < c[j].imm)) {
+            return Resolve(undefs[{ j, slot }]);
+        }
+    }
+    const size_t before = defs.size();
+    int def = ReadEntry(slot, block);
+    if (defs.size() != before) {
+        Analyze();
+    }
+    return Resolve(def);
+}
+
+void Ssa::Retarget(int pc, int def) {
+    if (uses[pc] >= 0) {
+        reads[Resolve(uses[pc])]--;
+    }
+    uses[pc] = def;
+    if (def >= 0) {
+        reads[Resolve(def)]++;
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "code_gen.h"
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Байт-код в форме SSA (статического единственного присваивания) для оптимизаций
+// (optimizer.h). Переменная -- ячейка узла семантического дерева: имена разных областей
+// видимости уже разведены по узлам, поэтому переименовывать нужно только присваивания
+// одной ячейке. Каждое присваивание (STORE, TSET) -- новое определение; LOOP, NEXT и TCLR --
+// определение "без значения" для сбрасываемых ячеек (имена тела объявляются заново); в блоках,
+// где сходятся разные определения, -- phi. Чтение (LOAD, LOADQ, TGET) связано с определением,
+// которое до него доходит. Построение -- по Braun и др. ("Simple and Efficient Construction of
+// Static Single Assignment Form"): без дерева доминаторов, тривиальные phi удаляются.
+// Код до подстановки суперкоманд (Fuse)
+class Ssa {
+public:
+    // Вид определения
+    enum DEF_KIND {
+        DEF_ENTRY, // Значение при входе в программу (неизвестно)
+        DEF_STORE, // Присваивание: at -- команда STORE или TSET
+        DEF_UNDEF, // Без значения: at -- команда LOOP, NEXT или TCLR
+        DEF_PHI    // Слияние: at -- блок, args -- определения по предшественникам
+    };
+
+    struct Def {
+        DEF_KIND kind;
+        int slot;
+        int at;
+        std::vector<int> args;
+        int same; // Тривиальная phi -- определение, которым она заменена (иначе -1)
+    };
+
+    // Базовый блок: команды [first, last]
+    struct Block {
+        int first;
+        int last;
+        std::vector<int> preds;
+        std::vector<int> succs;
+        bool reachable; // Достижим из начала программы
+    };
+
+    explicit Ssa(const Code& code);
+
+    const std::vector<Block>& Blocks() const { return blocks; }
+    int BlockOf(int pc) const { return blockOf[pc]; }
+    // Команда -- начало блока (на неё можно перейти или войти не из предыдущей команды)
+    bool Leader(int pc) const { return blocks[blockOf[pc]].first == pc; }
+
+    // Определение, которое читает команда pc, и определение, которое создаёт STORE, TSET или TCLR pc (-1 -- нет)
+    int Use(int pc) const { return (uses[pc] < 0) ? -1 : Resolve(uses[pc]); }
+    int DefOf(int pc) const { return stores[pc]; }
+    const Def& Get(int def) const { return defs[def]; }
+
+    // Определение ячейки slot, действующее перед командой pc
+    int DefAt(int slot, int pc);
+
+    // Число чтений определения (LOAD и операнды нетривиальных phi)
+    int Reads(int def) const { return reads[Resolve(def)]; }
+
+    // Значение определено на всех путях: присваивание или phi только из таких определений
+    bool Defined(int def) const { return defined[Resolve(def)]; }
+
+    // Команда pc теперь читает определение def (-1 -- больше ничего не читает)
+    void Retarget(int pc, int def);
+
+    int Resolve(int def) const {
+        while (defs[def].same >= 0) {
+            def = defs[def].same;
+        }
+        return def;
+    }
+
+private:
+    const Code& code;
+    std::vector<Block> blocks;
+    std::vector<int> blockOf;
+    std::vector<Def> defs;
+    std::vector<int> uses;   // Команда -> читаемое определение (-1)
+    std::vector<int> stores; // Команда -> создаваемое определение (-1)
+    std::vector<int> reads;
+    std::vector<bool> defined;
+
+    std::map<std::pair<int, int>, int> undefs;  // (LOOP/NEXT, ячейка) -> DEF_UNDEF
+
+    std::vector<std::map<int, int>> current;    // Блок -> ячейка -> определение в конце (или на месте) заполнения
+    std::vector<std::map<int, int>> atEntry;    // Блок -> ячейка -> определение в начале блока
+    std::vector<std::map<int, int>> incomplete; // Неполные phi незапечатанных блоков
+    std::vector<bool> sealed;
+    std::vector<bool> filled;
+    std::map<int, int> entry;                   // Ячейка -> DEF_ENTRY
+
+    void BuildBlocks();
+    int NewDef(DEF_KIND kind, int slot, int at);
+    void Write(int slot, int block, int def) { current[block][slot] = def; }
+    int EntryDef(int slot);
+    int Read(int slot, int block);
+    int ReadRecursive(int slot, int block);
+    int ReadEntry(int slot, int block);
+    int AddPhiOperands(int slot, int phi);
+    int TryRemoveTrivial(int phi);
+    void Seal(int block);
+    void Fill(int block);
+    void Analyze();
+};
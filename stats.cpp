@@ -0,0 +1,55 @@
+#include "stats.h"
+
+
+thread_local Stats* Stats::active = nullptr;
+
+Stats::Scope::Scope(Stats* stats) : previous(active) {
+    active = stats;
+}
+
+Stats::Scope::~Scope() {
+    active = previous;
+}
+
+STATS_PHASE Stats::Switch(STATS_PHASE phase) {
+    auto now = std::chrono::steady_clock::now();
+    phases[current].ns += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - since).count());
+    since = now;
+    STATS_PHASE previous = current;
+    current = phase;
+    return previous;
+}
+
+void Stats::Start() {
+    since = std::chrono::steady_clock::now();
+}
+
+void Stats::Stop() {
+    Switch(current);
+}
+
+static const char* const PHASE_NAMES[PHASE_COUNT] = { "parse", "scan", "semantic", "eval" };
+
+void Stats::WriteJson(std::ostream& out) const {
+    uint64_t total_ns = 0;
+    uint64_t total_allocs = 0;
+    uint64_t total_bytes = 0;
+
+    out << "{\n  \"phases\": {\n";
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        const Phase& p = phases[i];
+        total_ns += p.ns;
+        total_allocs += p.allocs;
+        total_bytes += p.bytes;
+        out << "    \"" << PHASE_NAMES[i] << "\": { \"ns\": " << p.ns
+            << ", \"allocs\": " << p.allocs << ", \"bytes\": " << p.bytes << " }"
+            << ((i + 1 < PHASE_COUNT) ? ",\n" : "\n");
+    }
+    out << "  },\n";
+    out << "  \"total\": { \"ns\": " << total_ns << ", \"allocs\": " << total_allocs
+        << ", \"bytes\": " << total_bytes << ", \"frees\": " << frees << " },\n";
+    out << "  \"counters\": { \"lookups\": " << lookups << ", \"sibling_hops\": " << siblingHops
+        << ", \"nodes_created\": " << nodesCreated << ", \"tokens\": " << tokens << " }\n";
+    out << "}\n";
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Фаза работы интерпретатора
+enum STATS_PHASE {
+    PHASE_PARSE,    // Синтаксический разбор (всё, что не отнесено к другим фазам)
+    PHASE_SCAN,     // Лексический анализ (Scanner)
+    PHASE_SEMANTIC, // Семантические операции дерева (SemInclude, FindUp, ...)
+    PHASE_EVAL,     // Вычисление (ExecuteArithmeticOp, SetVarValue, ...)
+    PHASE_COUNT
+};
+
+// Статистика одного разбора/выполнения: собственное время фаз, выделения
+// памяти в каждой фазе и счётчики операций дерева.
+// Статистика включается для потока (Stats::Scope) -- контекст выполняется
+// одним потоком, а глобальный operator new не знает о контексте. Выделения памяти
+// учитываются, только если в программу собран stats_alloc.cpp (lab4). Если для
+// потока статистика не включена, каждая точка учёта -- одна проверка указателя
+class Stats {
+public:
+    struct Phase {
+        uint64_t ns = 0;     // Собственное время фазы (без вложенных фаз)
+        uint64_t allocs = 0; // Выделений памяти
+        uint64_t bytes = 0;  // Выделено байт
+    };
+
+    Phase phases[PHASE_COUNT];
+
+    uint64_t lookups = 0;      // Поисков имени (FindUp, FindUpOneLevel)
+    uint64_t siblingHops = 0;  // Переходов по соседям в FindUpOneLevel
+    uint64_t nodesCreated = 0; // Созданных узлов дерева
+    uint64_t tokens = 0;       // Прочитанных лексем
+    uint64_t frees = 0;        // Освобождений памяти
+
+    // Статистика текущего потока (nullptr -- не собирается)
+    static Stats* Active() { return active; }
+
+    // Включение статистики для текущего потока на время существования объекта
+    class Scope {
+    public:
+        explicit Scope(Stats* stats);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Stats* previous;
+    };
+
+    // Учёт времени фазы: время до конца области относится к phase,
+    // по выходу продолжается отсчёт внешней фазы
+    class PhaseTimer {
+    public:
+        explicit PhaseTimer(STATS_PHASE phase) : stats(Active()) {
+            if (stats) {
+                previous = stats->Switch(phase);
+            }
+        }
+
+        ~PhaseTimer() {
+            if (stats) {
+                stats->Switch(previous);
+            }
+        }
+
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    private:
+        Stats* stats;
+        STATS_PHASE previous = PHASE_PARSE;
+    };
+
+    // Учёт выделения/освобождения памяти (вызывается из operator new/delete)
+    void CountAlloc(size_t size) {
+        phases[current].allocs++;
+        phases[current].bytes += size;
+    }
+
+    void CountFree() { frees++; }
+
+    // Сброс отсчёта (перед измеряемым участком)
+    void Start();
+
+    // Отнести время с последнего переключения к текущей фазе
+    void Stop();
+
+    // Вывод в JSON
+    void WriteJson(std::ostream& out) const;
+
+private:
+    static thread_local Stats* active;
+
+    STATS_PHASE current = PHASE_PARSE;
+    std::chrono::steady_clock::time_point since = std::chrono::steady_clock::now();
+
+    // Сменить текущую фазу, вернуть прежнюю
+    STATS_PHASE Switch(STATS_PHASE phase);
+};
@@ -0,0 +1,63 @@
+#include "stats.h"
+
+#include <cstdlib>
+#include <new>
+
+// Замена глобального распределителя памяти: выделения учитываются
+// в статистике текущего потока, сама память берётся из malloc.
+// Собирается только в программу lab4, не в библиотеку tayat: замена действовала бы
+// во всей программе, встроившей библиотеку
+
+void* operator new(std::size_t size) {
+    if (Stats* s = Stats::Active()) {
+        s->CountAlloc(size);
+    }
+    void* p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    if (Stats* s = Stats::Active()) {
+        s->CountAlloc(size);
+    }
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return ::operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    if (Stats* s = Stats::Active()) {
+        s->CountFree();
+    }
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    ::operator delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    ::operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    ::operator delete(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    ::operator delete(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    ::operator delete(p);
+}
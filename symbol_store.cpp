@@ -0,0 +1,53 @@
+#include "symbol_store.h"
+
+int SymbolStore::Add(const std::string& id, DATA_TYPE t, int line, int col) {
+    SemNode value;
+    value.DataType = t;
+    value.hasValue = false;
+    value.Value.v_int64 = 0;
+
+    SemInfo si;
+    si.id = id;
+    si.FlagConst = 0;
+    si.TypeId = 0;
+    si.index = 0;
+    si.line = line;
+    si.col = col;
+
+    values.push_back(value);
+    hashes.push_back(Hash(id));
+    info.push_back(si);
+    return static_cast<int>(values.size()) - 1;
+}
+
+void SymbolStore::Grow(int count) {
+    size_t n = values.size() + static_cast<size_t>(count);
+    SemNode value;
+    value.DataType = TYPE_UNDEFINED;
+    value.hasValue = false;
+    value.Value.v_int64 = 0;
+    values.resize(n, value);
+    hashes.resize(n, 0);
+    info.resize(n, SemInfo{ std::string(), 0, 0, 0, 0, 0 });
+}
+
+void SymbolStore::Clear() {
+    values.clear();
+    hashes.clear();
+    info.clear();
+}
+
+void SymbolStore::Truncate(int count) {
+    values.resize(count);
+    hashes.resize(count);
+    info.resize(count);
+}
+
+uint32_t SymbolStore::Hash(const std::string& id) {
+    uint32_t h = 2166136261u;
+    for (unsigned char c : id) {
+        h ^= c;
+        h *= 16777619u;
+    }
+    return h;
+}
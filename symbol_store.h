@@ -0,0 +1,32 @@
+#pragma once
+#include "sem_node.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Хранилище идентификаторов в виде параллельных массивов (номер идентификатора -- индекс
+// во всех массивах). Горячие данные (тип и значение) лежат плотно, по 16 байт на
+// идентификатор; хеши имён -- отдельным массивом, чтобы поиск по области не трогал строки;
+// имена, позиции объявления и сведения о типе вынесены в SemInfo
+class SymbolStore {
+public:
+    std::vector<SemNode> values;  // Тип и значение
+    std::vector<uint32_t> hashes; // Хеши имён
+    std::vector<SemInfo> info;    // Имя, позиция, сведения о типе
+
+    // Добавить идентификатор, вернуть его номер
+    int Add(const std::string& id, DATA_TYPE t, int line, int col);
+
+    int Count() const { return static_cast<int>(values.size()); }
+
+    // Добавить count идентификаторов без имён и значений (заполняет вызывающий, хеш -- Hash(имя))
+    void Grow(int count);
+
+    void Clear();
+
+    // Оставить первые count идентификаторов
+    void Truncate(int count);
+
+    // Хеш имени (FNV-1a)
+    static uint32_t Hash(const std::string& id);
+};
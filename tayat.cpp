@@ -0,0 +1,249 @@
+#include "tayat.h"
+#include "diagram.h"
+#include "program_error.h"
+#include "code_gen.h"
+#include "c_emitter.h"
+#include "optimizer.h"
+
+#include <sstream>
+
+// Результат проверки: байт-код и дерево объявлений после CompileProgram.
+// Не меняется после Compile; Run и TranslateToC работают с копиями
+struct CompiledProgram {
+    Tree tree; // Дерево после порождения байт-кода (значения -- только известные до выполнения)
+    int root;  // Глобальная область в tree
+    Code code; // Байт-код без оптимизаций
+};
+
+// Собрать переменные дерева в порядке объявления
+// (номера узлов идут в прямом порядке обхода, родитель раньше детей)
+static void CollectVariables(const Tree& tree, int root, std::vector<VarValue>& vars) {
+    if (root == Tree::NONE) {
+        return;
+    }
+    std::vector<int> depth(tree.Count(), 0);
+    for (int t = root + 1; t < tree.Count(); t++) {
+        int up = tree.Up(t);
+        depth[t] = (up == root) ? 0 : depth[up] + 1;
+
+        const SemNode& n = tree.Sem(t);
+        if (n.DataType == TYPE_SHORT_INT || n.DataType == TYPE_INT || n.DataType == TYPE_LONG_INT || n.DataType == TYPE_LONG_LONG_INT) {
+            vars.push_back({ tree.Info(t).id, n.DataType, n.hasValue, n.hasValue ? WidenValue(n) : 0, depth[t] });
+        }
+    }
+}
+
+Program Compile(const std::string& source) {
+    Program program;
+    program.source = source;
+    program.ok = false;
+
+    Scanner sc;
+    sc.loadText(source);
+
+    // Только проверка синтаксиса и типов: значения вычисляются в Run. Проверка -- тот же
+    // разбор, что порождает байт-код: по нему же -- чтения без значения на всех путях
+    Context ctx;
+    ctx.out = nullptr;
+    ctx.err = nullptr;
+
+    Code code;
+    Diagram dg(&sc, &ctx);
+    try {
+        dg.CompileProgram(code);
+        if (code.parseError >= 0) {
+            ctx.warnings.push_back(code.errors[code.parseError]);
+        }
+        else {
+            program.ok = true;
+            for (const Diagnostic& d : UninitializedReads(code, ctx.tree)) {
+                ctx.warnings.push_back(d);
+            }
+            std::shared_ptr<CompiledProgram> compiled = std::make_shared<CompiledProgram>();
+            compiled->tree.CopyFrom(ctx.tree);
+            compiled->root = ctx.Root;
+            compiled->code = std::move(code);
+            program.compiled = compiled;
+        }
+    }
+    catch (const ProgramError& e) {
+        ctx.warnings.push_back(e.GetDiagnostic());
+    }
+
+    program.diagnostics = std::move(ctx.warnings);
+    return program;
+}
+
+RunResult Run(const Program& program, bool isDebug) {
+    RunOptions options;
+    options.isDebug = isDebug;
+    return Run(program, options);
+}
+
+RunResult Run(const Program& program, const RunOptions& options) {
+    bool isDebug = options.isDebug;
+    RunResult result;
+    result.ok = false;
+
+    if (!program.ok) {
+        result.diagnostics = program.diagnostics;
+        return result;
+    }
+
+    Scanner sc;
+    std::ostringstream out;
+    Context ctx;
+    ctx.out = isDebug ? &out : nullptr;
+    ctx.err = nullptr;
+    ctx.engine = options.engine;
+    ctx.superinstructions = options.superinstructions ? SUPER_ALL : 0;
+    ctx.optimizations = options.optimizations;
+    ctx.unrollFactor = options.unrollFactor;
+    ctx.maxIterations = options.maxIterations;
+    ctx.jitThreshold = options.jitThreshold;
+    ctx.checkedArithmetic = options.checkedArithmetic;
+
+    Diagram dg(&sc, &ctx);
+    try {
+        // Байт-код выполняется из Program без повторного разбора; интерпретатор по дереву
+        // вычисляет по ходу разбора, поэтому разбирает текст заново
+        if (program.compiled && ctx.RunsBytecode(true)) {
+            ctx.tree.CopyFrom(program.compiled->tree);
+            ctx.Root = program.compiled->root;
+            ctx.Cur = ctx.Root;
+            dg.ParseProgram(true, isDebug, &program.compiled->code);
+        }
+        else {
+            sc.loadText(program.source);
+            dg.ParseProgram(true, isDebug);
+        }
+        result.ok = true;
+    }
+    catch (const ProgramError& e) {
+        ctx.warnings.push_back(e.GetDiagnostic());
+        std::ostringstream recent;
+        ctx.DumpRecent(recent);
+        result.recent = recent.str();
+    }
+
+    result.diagnostics = std::move(ctx.warnings);
+    result.output = out.str();
+    CollectVariables(ctx.tree, ctx.Root, result.variables);
+    return result;
+}
+
+std::string TranslateToC(const Program& program, const RunOptions& options) {
+    std::vector<Diagnostic> diagnostics;
+    return TranslateToC(program, options, diagnostics);
+}
+
+std::string TranslateToC(const Program& program, const RunOptions& options, std::vector<Diagnostic>& diagnostics) {
+    if (!program.ok) {
+        diagnostics = program.diagnostics;
+        return "";
+    }
+
+    Scanner sc;
+    Context ctx;
+    ctx.out = nullptr;
+    ctx.err = nullptr;
+    ctx.debug = options.isDebug;
+
+    std::ostringstream out;
+    try {
+        // Байт-код проверки (Program::compiled) -- без повторного разбора
+        Code code;
+        const Tree* tree = &ctx.tree;
+        if (program.compiled) {
+            code = program.compiled->code;
+            tree = &program.compiled->tree;
+        }
+        else {
+            sc.loadText(program.source);
+            Diagram dg(&sc, &ctx);
+            dg.CompileProgram(code);
+            if (code.parseError >= 0) {
+                diagnostics.push_back(code.errors[code.parseError]);
+                return "";
+            }
+        }
+        Optimize(code, *tree, options.optimizations, options.isDebug, options.unrollFactor, options.checkedArithmetic);
+
+        CEmitOptions emit;
+        emit.debug = options.isDebug;
+        emit.maxIterations = options.maxIterations;
+        emit.checked = options.checkedArithmetic;
+        EmitC(code, *tree, emit, out);
+    }
+    catch (const ProgramError& e) {
+        diagnostics.push_back(e.GetDiagnostic());
+        return "";
+    }
+    catch (const std::exception& e) {
+        diagnostics.push_back({ DIAG_INTERP, std::string("Внутренняя ошибка: ") + e.what(), "", 0, 0 });
+        return "";
+    }
+    return out.str();
+}
+
+std::string FormatRunResult(const RunResult& result) {
+    std::ostringstream out;
+    for (const Diagnostic& d : result.diagnostics) {
+        out << "D\t" << d.kind << "\t" << d.line << "\t" << d.col << "\t" << d.id << "\t" << d.message << "\n";
+    }
+    out << "OK\t" << (result.ok ? 1 : 0) << "\n";
+    for (const VarValue& v : result.variables) {
+        out << "V\t" << v.type << "\t" << v.depth << "\t" << (v.hasValue ? 1 : 0) << "\t" << v.value << "\t" << v.name << "\n";
+    }
+    return out.str();
+}
+
+// Строка, разделённая табуляциями; последнее поле забирает остаток строки
+static std::vector<std::string> SplitFields(const std::string& line, size_t count) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (fields.size() + 1 < count) {
+        size_t tab = line.find('\t', start);
+        if (tab == std::string::npos) {
+            break;
+        }
+        fields.push_back(line.substr(start, tab - start));
+        start = tab + 1;
+    }
+    fields.push_back(line.substr(start));
+    return fields;
+}
+
+bool ParseRunResult(const std::string& text, RunResult& result) {
+    result = RunResult();
+    result.ok = false;
+    bool seen_ok = false;
+
+    std::istringstream in(text);
+    std::string line;
+    try {
+        while (std::getline(in, line)) {
+            if (line.compare(0, 2, "D\t") == 0) {
+                std::vector<std::string> f = SplitFields(line, 6);
+                if (f.size() != 6) return false;
+                result.diagnostics.push_back({ static_cast<DIAG_KIND>(std::stoi(f[1])), f[5], f[4], std::stoi(f[2]), std::stoi(f[3]) });
+            }
+            else if (line.compare(0, 3, "OK\t") == 0) {
+                result.ok = (line.substr(3) == "1");
+                seen_ok = true;
+            }
+            else if (line.compare(0, 2, "V\t") == 0) {
+                std::vector<std::string> f = SplitFields(line, 6);
+                if (f.size() != 6) return false;
+                result.variables.push_back({ f[5], static_cast<DATA_TYPE>(std::stoi(f[1])), f[3] == "1", std::stoll(f[4]), std::stoi(f[2]) });
+            }
+            else {
+                return false;
+            }
+        }
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    return seen_ok;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "diagnostic.h"
+#include "data_type.h"
+#include "exec_engine.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Программный интерфейс интерпретатора для встраивания в другие приложения.
+// Ошибки не завершают процесс, а возвращаются в виде диагностических сообщений
+
+// Значение переменной после выполнения программы
+struct VarValue {
+    std::string name; // Имя переменной (элемент массива -- имя_индекс)
+    DATA_TYPE type;   // Тип переменной
+    bool hasValue;    // Есть ли значение
+    int64_t value;    // Значение, расширенное до 64 бит
+    int depth;        // Глубина области (0 -- глобальная область)
+};
+
+struct CompiledProgram; // Байт-код и дерево объявлений (tayat.cpp)
+
+// Проверенная программа. Копии разделяют один неизменяемый результат проверки
+struct Program {
+    bool ok;                             // Программа прошла проверку без ошибок
+    std::string source;                  // Исходный текст
+    std::vector<Diagnostic> diagnostics; // Предупреждения и ошибка проверки
+    std::shared_ptr<const CompiledProgram> compiled; // Байт-код проверки (если ok): Run с ENGINE_VM и TranslateToC без разбора
+};
+
+// Результат выполнения программы
+struct RunResult {
+    bool ok;                             // Программа выполнена без ошибок
+    std::vector<Diagnostic> diagnostics; // Предупреждения и ошибка выполнения
+    std::string output;                  // Отладочный вывод (если включён)
+    std::string recent;                  // Последние выполненные операции (при ошибке)
+    std::vector<VarValue> variables;     // Переменные всех областей в порядке объявления
+};
+
+// Параметры выполнения
+struct RunOptions {
+    bool isDebug = false;             // Подробный вывод и предупреждения о преобразовании типов
+    EXEC_ENGINE engine = ENGINE_TREE; // Исполнитель
+    bool superinstructions = true;    // Суперкоманды байт-кода (ENGINE_VM)
+    unsigned optimizations = 0;       // Оптимизации байт-кода (ENGINE_VM и TranslateToC; маска OPT_PASS, optimizer.h)
+    int unrollFactor = 4;             // Кратность развёртывания циклов (OPT_UNROLL)
+    uint64_t maxIterations = 0;       // Предел числа итераций циклов (0 -- без предела)
+    uint64_t jitThreshold = 0;        // Итераций цикла до трансляции в машинный код (ENGINE_VM; 0 -- выключена)
+    bool checkedArithmetic = false;   // Переполнение в арифметике -- ошибка выполнения (иначе -- с переносом)
+};
+
+// Разобрать и проверить программу один раз: синтаксис и типы, без вычисления значений
+// (ошибки времени выполнения, например деление на ноль, выдаёт только Run). Разбор порождает
+// байт-код (Program::compiled): Run с ENGINE_VM и TranslateToC выполняют и переводят его копию,
+// не разбирая текст; интерпретатор по дереву (ENGINE_TREE) вычисляет по ходу разбора и разбирает
+// текст при каждом Run. Чтения переменных, до которых значение не доходит ни по одному пути,
+// -- предупреждения (UninitializedReads, optimizer.h)
+Program Compile(const std::string& source);
+
+// Выполнить проверенную программу
+RunResult Run(const Program& program, bool isDebug = false);
+RunResult Run(const Program& program, const RunOptions& options);
+
+// Перевести проверенную программу в исходный текст на C (c_emitter.h);
+// isDebug, optimizations, maxIterations и checkedArithmetic -- как при Run. Пустая строка, если программа
+// не прошла проверку или перевод не удался; причина -- в diagnostics (исключения не выходят наружу)
+std::string TranslateToC(const Program& program, const RunOptions& options);
+std::string TranslateToC(const Program& program, const RunOptions& options, std::vector<Diagnostic>& diagnostics);
+
+// Результат выполнения в текстовой форме (её же выводит программа, переведённая в C,
+// с ключом --result): строки "D\tвид\tстрока\tпозиция\tлексема\tсообщение",
+// затем "OK\t0|1", затем "V\tтип\tглубина\tесть_значение\tзначение\tимя".
+// output и recent не входят
+std::string FormatRunResult(const RunResult& result);
+
+// Разобрать текстовую форму результата; false -- текст не в этой форме
+bool ParseRunResult(const std::string& text, RunResult& result);
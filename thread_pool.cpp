@@ -0,0 +1,91 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(unsigned threads_count) : queued(0), unfinished(0), next_queue(0), stopping(false) {
+    if (threads_count == 0) {
+        threads_count = 1;
+    }
+    for (unsigned i = 0; i < threads_count; i++) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (unsigned i = 0; i < threads_count; i++) {
+        threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(wake_m);
+        stopping = true;
+    }
+    wake_cv.notify_all();
+    for (std::thread& t : threads) {
+        t.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> job) {
+    size_t target;
+    {
+        std::lock_guard<std::mutex> lock(wake_m);
+        target = next_queue;
+        next_queue = (next_queue + 1) % queues.size();
+        // Счётчики увеличиваем под wake_m до вставки, чтобы поток не пропустил пробуждение
+        // и не завершил задачу раньше, чем она будет учтена
+        unfinished++;
+        queued++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->m);
+        queues[target]->jobs.push_back(std::move(job));
+    }
+    wake_cv.notify_one();
+}
+
+void ThreadPool::Wait() {
+    std::unique_lock<std::mutex> lock(wake_m);
+    done_cv.wait(lock, [this] { return unfinished == 0; });
+}
+
+// Взять задачу: сначала с конца своей очереди, затем из начала чужих
+bool ThreadPool::TryPop(size_t self, std::function<void()>& job) {
+    {
+        WorkQueue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.m);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); i++) {
+        WorkQueue& victim = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.m);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::WorkerLoop(size_t self) {
+    for (;;) {
+        std::function<void()> job;
+        if (TryPop(self, job)) {
+            queued--;
+            job();
+            std::lock_guard<std::mutex> lock(wake_m);
+            if (--unfinished == 0) {
+                done_cv.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_m);
+        wake_cv.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с перехватом работы (work stealing).
+// У каждого потока своя очередь: свои задачи он берёт с конца очереди,
+// а когда она пуста -- забирает задачи из начала чужих очередей
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Поставить задачу в очередь (очереди потоков заполняются по кругу)
+    void Submit(std::function<void()> job);
+
+    // Дождаться выполнения всех поставленных задач
+    void Wait();
+
+    unsigned Size() const { return static_cast<unsigned>(threads.size()); }
+
+private:
+    struct WorkQueue {
+        std::mutex m;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex wake_m;
+    std::condition_variable wake_cv; // Появилась работа или пора завершаться
+    std::condition_variable done_cv; // Все задачи выполнены
+
+    std::atomic<size_t> queued;  // Задачи, ещё не взятые ни одним потоком
+    size_t unfinished;           // Задачи, ещё не завершённые (под wake_m)
+    size_t next_queue;           // Очередь для следующей задачи (под wake_m)
+    bool stopping;               // Пул завершается (под wake_m)
+
+    bool TryPop(size_t self, std::function<void()>& job);
+    void WorkerLoop(size_t self);
+};
@@ -0,0 +1,354 @@
+#include "trace_sink.h"
+
+#include <cstring>
+#include <vector>
+
+static const char TRACE_MAGIC[4] = { 'T', 'Y', 'T', 'R' };
+
+// Виды записей двоичного формата
+enum TRACE_RECORD {
+    TREC_STRING = 1,
+    TREC_MESSAGE,
+    TREC_ASSIGN,
+    TREC_ARITH
+};
+
+static void AppendInt(std::string& buf, long long v) {
+    char tmp[24];
+    int len = 0;
+    unsigned long long u = (v < 0) ? 0ULL - static_cast<unsigned long long>(v) : static_cast<unsigned long long>(v);
+    do {
+        tmp[len++] = static_cast<char>('0' + (u % 10));
+        u /= 10;
+    } while (u != 0);
+    if (v < 0) {
+        buf.push_back('-');
+    }
+    while (len > 0) {
+        buf.push_back(tmp[--len]);
+    }
+}
+
+// Значение в текстовом виде: "5 (int)", "unknown" или "неинициализирована"
+static void AppendValueText(std::string& buf, DATA_TYPE type, bool hasValue, int64_t value) {
+    if (!hasValue) {
+        buf += "неинициализирована";
+        return;
+    }
+    switch (type) {
+    case TYPE_SHORT_INT: AppendInt(buf, value); buf += " (short)"; break;
+    case TYPE_INT: AppendInt(buf, value); buf += " (int)"; break;
+    case TYPE_LONG_INT: AppendInt(buf, value); buf += " (long)"; break;
+    case TYPE_LONG_LONG_INT: AppendInt(buf, value); buf += " (longlong)"; break;
+    default: buf += "unknown"; break;
+    }
+}
+
+static void AppendPrefixText(std::string& buf, const std::string& area, int line, int col) {
+    buf += "DEBUG: [";
+    buf += area;
+    buf += "]";
+    if (line > 0) {
+        buf += " (строка ";
+        AppendInt(buf, line);
+        buf += ":";
+        AppendInt(buf, col);
+        buf += ")";
+    }
+    buf += " ";
+}
+
+template <typename T>
+static void AppendRaw(std::string& buf, T v) {
+    char tmp[sizeof(T)];
+    std::memcpy(tmp, &v, sizeof(T));
+    buf.append(tmp, sizeof(T));
+}
+
+static void AppendValueBinary(std::string& buf, const SemNode& v) {
+    AppendRaw<uint8_t>(buf, static_cast<uint8_t>(v.DataType));
+    AppendRaw<uint8_t>(buf, v.hasValue ? 1 : 0);
+    if (v.hasValue) {
+        AppendRaw<int64_t>(buf, WidenValue(v));
+    }
+}
+
+TraceSink::TraceSink() : out(nullptr), format(TRACE_TEXT), async(false), writing(false), stop(false) {}
+
+TraceSink::~TraceSink() {
+    Close();
+}
+
+void TraceSink::Open(std::ostream* stream, TRACE_FORMAT trace_format, bool use_async) {
+    Close();
+    out = stream;
+    format = trace_format;
+    async = use_async;
+    string_ids.clear();
+    buf.clear();
+    buf.reserve(BUFFER_SIZE + 4096);
+
+    if (format == TRACE_BINARY) {
+        buf.append(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+        AppendRaw<uint32_t>(buf, VERSION);
+    }
+
+    if (async && out) {
+        stop = false;
+        writing = false;
+        writer = std::thread(&TraceSink::writerLoop, this);
+    }
+}
+
+uint32_t TraceSink::stringId(const std::string& s) {
+    auto it = string_ids.find(s);
+    if (it != string_ids.end()) {
+        return it->second;
+    }
+    uint32_t id = static_cast<uint32_t>(string_ids.size());
+    string_ids.emplace(s, id);
+    AppendRaw<uint8_t>(buf, TREC_STRING);
+    AppendRaw<uint32_t>(buf, id);
+    AppendRaw<uint32_t>(buf, static_cast<uint32_t>(s.size()));
+    buf += s;
+    return id;
+}
+
+void TraceSink::Message(const std::string& area, const std::string& text, int line, int col) {
+    if (!out) return;
+    if (format == TRACE_TEXT) {
+        AppendPrefixText(buf, area, line, col);
+        buf += text;
+        buf += "\n";
+    }
+    else {
+        uint32_t area_id = stringId(area);
+        uint32_t text_id = stringId(text);
+        AppendRaw<uint8_t>(buf, TREC_MESSAGE);
+        AppendRaw<int32_t>(buf, line);
+        AppendRaw<int32_t>(buf, col);
+        AppendRaw<uint32_t>(buf, area_id);
+        AppendRaw<uint32_t>(buf, text_id);
+    }
+    if (buf.size() >= BUFFER_SIZE) submit();
+}
+
+void TraceSink::Assignment(const std::string& area, const std::string& name, const SemNode& value, int line, int col) {
+    if (!out) return;
+    if (format == TRACE_TEXT) {
+        AppendPrefixText(buf, area, line, col);
+        buf += "Присваивание: ";
+        buf += name;
+        buf += " = ";
+        AppendValueText(buf, value.DataType, value.hasValue, WidenValue(value));
+        buf += "\n";
+    }
+    else {
+        uint32_t area_id = stringId(area);
+        uint32_t name_id = stringId(name);
+        AppendRaw<uint8_t>(buf, TREC_ASSIGN);
+        AppendRaw<int32_t>(buf, line);
+        AppendRaw<int32_t>(buf, col);
+        AppendRaw<uint32_t>(buf, area_id);
+        AppendRaw<uint32_t>(buf, name_id);
+        AppendValueBinary(buf, value);
+    }
+    if (buf.size() >= BUFFER_SIZE) submit();
+}
+
+void TraceSink::ArithmeticOp(const std::string& area, const std::string& op, const SemNode& left, const SemNode& right,
+    const SemNode& result, int line, int col) {
+    if (!out) return;
+    if (format == TRACE_TEXT) {
+        AppendPrefixText(buf, area, line, col);
+        buf += "Арифметическая операция: ";
+        AppendValueText(buf, left.DataType, left.hasValue, WidenValue(left));
+        buf += " ";
+        buf += op;
+        buf += " ";
+        AppendValueText(buf, right.DataType, right.hasValue, WidenValue(right));
+        buf += " = ";
+        AppendValueText(buf, result.DataType, result.hasValue, WidenValue(result));
+        buf += "\n";
+    }
+    else {
+        uint32_t area_id = stringId(area);
+        AppendRaw<uint8_t>(buf, TREC_ARITH);
+        AppendRaw<int32_t>(buf, line);
+        AppendRaw<int32_t>(buf, col);
+        AppendRaw<uint32_t>(buf, area_id);
+        AppendRaw<uint8_t>(buf, static_cast<uint8_t>(op.empty() ? '?' : op[0]));
+        AppendValueBinary(buf, left);
+        AppendValueBinary(buf, right);
+        AppendValueBinary(buf, result);
+    }
+    if (buf.size() >= BUFFER_SIZE) submit();
+}
+
+// Передать буфер на запись: в очередь фонового потока или сразу в поток вывода
+void TraceSink::submit() {
+    if (!out || buf.empty()) return;
+    if (async) {
+        std::string block;
+        block.reserve(BUFFER_SIZE + 4096);
+        block.swap(buf);
+        {
+            std::lock_guard<std::mutex> lock(m);
+            queue.push_back(std::move(block));
+        }
+        cv.notify_one();
+    }
+    else {
+        out->write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        buf.clear();
+    }
+}
+
+void TraceSink::Flush() {
+    if (!out) return;
+    submit();
+    if (async) {
+        std::unique_lock<std::mutex> lock(m);
+        idle_cv.wait(lock, [this] { return queue.empty() && !writing; });
+    }
+    out->flush();
+}
+
+void TraceSink::Close() {
+    if (!out) return;
+    Flush();
+    if (async) {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stop = true;
+        }
+        cv.notify_one();
+        writer.join();
+    }
+    out = nullptr;
+    async = false;
+}
+
+void TraceSink::writerLoop() {
+    std::unique_lock<std::mutex> lock(m);
+    while (true) {
+        cv.wait(lock, [this] { return stop || !queue.empty(); });
+        if (queue.empty()) {
+            break; // stop и всё записано
+        }
+        std::string block = std::move(queue.front());
+        queue.pop_front();
+        writing = true;
+        lock.unlock();
+        out->write(block.data(), static_cast<std::streamsize>(block.size()));
+        lock.lock();
+        writing = false;
+        if (queue.empty()) {
+            idle_cv.notify_all();
+        }
+    }
+}
+
+// Чтение двоичной трассировки
+class TraceReader {
+public:
+    explicit TraceReader(std::istream& stream) : in(stream) {}
+
+    template <typename T>
+    bool Read(T& v) {
+        char tmp[sizeof(T)];
+        if (!in.read(tmp, sizeof(T))) return false;
+        std::memcpy(&v, tmp, sizeof(T));
+        return true;
+    }
+
+    bool ReadValue(DATA_TYPE& type, bool& hasValue, int64_t& value) {
+        uint8_t t = 0, h = 0;
+        if (!Read(t) || !Read(h)) return false;
+        type = static_cast<DATA_TYPE>(t);
+        hasValue = (h != 0);
+        value = 0;
+        return !hasValue || Read(value);
+    }
+
+private:
+    std::istream& in;
+};
+
+bool TraceSink::Decode(std::istream& in, std::ostream& out) {
+    TraceReader reader(in);
+    char magic[4];
+    uint32_t version = 0;
+    if (!in.read(magic, sizeof(magic)) || (std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0)) return false;
+    if (!reader.Read(version) || (version != VERSION)) return false;
+
+    std::vector<std::string> strings;
+    std::string text;
+    uint8_t kind = 0;
+
+    auto str = [&strings](uint32_t id) -> const std::string* {
+        return (id < strings.size()) ? &strings[id] : nullptr;
+    };
+
+    while (reader.Read(kind)) {
+        if (kind == TREC_STRING) {
+            uint32_t id = 0, len = 0;
+            if (!reader.Read(id) || !reader.Read(len) || (id != strings.size())) return false;
+            std::string s(len, '\0');
+            if (len > 0 && !in.read(&s[0], len)) return false;
+            strings.push_back(std::move(s));
+            continue;
+        }
+
+        int32_t line = 0, col = 0;
+        uint32_t area_id = 0;
+        if (!reader.Read(line) || !reader.Read(col) || !reader.Read(area_id)) return false;
+        const std::string* area = str(area_id);
+        if (!area) return false;
+
+        text.clear();
+        AppendPrefixText(text, *area, line, col);
+
+        if (kind == TREC_MESSAGE) {
+            uint32_t text_id = 0;
+            if (!reader.Read(text_id) || !str(text_id)) return false;
+            text += *str(text_id);
+        }
+        else if (kind == TREC_ASSIGN) {
+            uint32_t name_id = 0;
+            DATA_TYPE type;
+            bool hasValue;
+            int64_t value;
+            if (!reader.Read(name_id) || !str(name_id) || !reader.ReadValue(type, hasValue, value)) return false;
+            text += "Присваивание: ";
+            text += *str(name_id);
+            text += " = ";
+            AppendValueText(text, type, hasValue, value);
+        }
+        else if (kind == TREC_ARITH) {
+            uint8_t op = 0;
+            DATA_TYPE type[3];
+            bool hasValue[3];
+            int64_t value[3];
+            if (!reader.Read(op)) return false;
+            for (int i = 0; i < 3; i++) {
+                if (!reader.ReadValue(type[i], hasValue[i], value[i])) return false;
+            }
+            text += "Арифметическая операция: ";
+            AppendValueText(text, type[0], hasValue[0], value[0]);
+            text += " ";
+            text.push_back(static_cast<char>(op));
+            text += " ";
+            AppendValueText(text, type[1], hasValue[1], value[1]);
+            text += " = ";
+            AppendValueText(text, type[2], hasValue[2], value[2]);
+        }
+        else {
+            return false;
+        }
+        text += "\n";
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+    out.flush();
+    return in.eof();
+}
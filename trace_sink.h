@@ -0,0 +1,83 @@
+#pragma once
+#include "sem_node.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Формат отладочной трассировки
+enum TRACE_FORMAT {
+    TRACE_TEXT,  // Текст "DEBUG: [область] (строка l:c) ..."
+    TRACE_BINARY // Двоичные записи, декодируются TraceSink::Decode
+};
+
+// Приёмник отладочной трассировки интерпретатора.
+// События складываются в буфер контекста (контекст используется одним потоком,
+// поэтому буфер фактически принадлежит потоку) и уходят в поток вывода крупными
+// блоками: напрямую или через фоновый поток записи. Поток вывода сбрасывается
+// только в Flush/Close, а не после каждого события.
+//
+// Двоичный формат (числа little-endian):
+//   "TYTR" u32 версия
+//   записи: u8 вид, далее
+//     TREC_STRING:  u32 номер, u32 длина, байты          -- строка (имя, область), далее по номеру
+//     TREC_MESSAGE: i32 line, i32 col, u32 область, u32 текст
+//     TREC_ASSIGN:  i32 line, i32 col, u32 область, u32 имя, значение
+//     TREC_ARITH:   i32 line, i32 col, u32 область, u8 операция, значение x3 (левый, правый, результат)
+//   значение: u8 DATA_TYPE, u8 есть значение, [i64 значение, если есть]
+class TraceSink {
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t BUFFER_SIZE = 1 << 20; // Размер блока, после которого буфер передаётся на запись
+
+    TraceSink();
+    ~TraceSink();
+
+    TraceSink(const TraceSink&) = delete;
+    TraceSink& operator=(const TraceSink&) = delete;
+
+    // Начать трассировку в поток out; async -- писать в фоновом потоке
+    void Open(std::ostream* out, TRACE_FORMAT format, bool async);
+
+    bool IsOpen() const { return out != nullptr; }
+
+    // События (area -- имя текущей области)
+    void Message(const std::string& area, const std::string& text, int line, int col);
+    void Assignment(const std::string& area, const std::string& name, const SemNode& value, int line, int col);
+    void ArithmeticOp(const std::string& area, const std::string& op, const SemNode& left, const SemNode& right,
+        const SemNode& result, int line, int col);
+
+    // Записать накопленное и сбросить поток (например, перед выводом предупреждения в другой поток)
+    void Flush();
+
+    // Flush и завершение трассировки
+    void Close();
+
+    // Перевести двоичную трассировку в текстовую; false -- повреждённый файл
+    static bool Decode(std::istream& in, std::ostream& out);
+
+private:
+    std::ostream* out;
+    TRACE_FORMAT format;
+    std::string buf;
+    std::unordered_map<std::string, uint32_t> string_ids; // Уже записанные строки (двоичный формат)
+
+    // Фоновая запись
+    bool async;
+    std::thread writer;
+    std::mutex m;
+    std::condition_variable cv;      // Появился блок или запрошена остановка
+    std::condition_variable idle_cv; // Очередь записана
+    std::deque<std::string> queue;
+    bool writing;
+    bool stop;
+
+    uint32_t stringId(const std::string& s);
+    void submit();
+    void writerLoop();
+};
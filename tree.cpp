@@ -1,4 +1,8 @@
 #include "tree.h"
+#include "checked_arith.h"
+#include "context.h"
+#include "program_error.h"
+#include "stats.h"
 
 #include <iostream>
 #include <sstream>
@@ -6,356 +10,330 @@
 #include <algorithm>
 #include <functional>
 
-Tree* Tree::Root = nullptr;
-Tree* Tree::Cur = nullptr;
-bool Tree::interpretationEnabled = true; // По умолчанию включена
-bool Tree::debug = true; // По умолчанию включен подробный вывод
-Tree* Tree::currentArea = nullptr;
-
 // Печать предупреждения о преобразовании типов
-void Tree::PrintTypeConversionWarning(DATA_TYPE from, DATA_TYPE to, const std::string& context,
+void Tree::PrintTypeConversionWarning(Context& ctx, DATA_TYPE from, DATA_TYPE to, const std::string& context,
     const std::string& expression, int line, int col) {
     
     // Выводим только если включен debug режим
-    if (!debug) return;
+    if (!ctx.debug) return;
 
-    std::cerr << "Предупреждение: неявное преобразование типа ";
+    std::ostringstream err;
+    err << "неявное преобразование типа ";
 
     switch (from) {
-    case TYPE_SHORT_INT: std::cerr << "short"; break;
-    case TYPE_INT: std::cerr << "int"; break;
-    case TYPE_LONG_INT: std::cerr << "long"; break;
-    case TYPE_LONG_LONG_INT: std::cerr << "longlong"; break;
-    default: std::cerr << "unknown"; break;
+    case TYPE_SHORT_INT: err << "short"; break;
+    case TYPE_INT: err << "int"; break;
+    case TYPE_LONG_INT: err << "long"; break;
+    case TYPE_LONG_LONG_INT: err << "longlong"; break;
+    default: err << "unknown"; break;
     }
 
-    std::cerr << " к ";
+    err << " к ";
 
     switch (to) {
-    case TYPE_SHORT_INT: std::cerr << "short"; break;
-    case TYPE_INT: std::cerr << "int"; break;
-    case TYPE_LONG_INT: std::cerr << "long"; break;
-    case TYPE_LONG_LONG_INT: std::cerr << "longlong"; break;
-    default: std::cerr << "unknown"; break;
+    case TYPE_SHORT_INT: err << "short"; break;
+    case TYPE_INT: err << "int"; break;
+    case TYPE_LONG_INT: err << "long"; break;
+    case TYPE_LONG_LONG_INT: err << "longlong"; break;
+    default: err << "unknown"; break;
     }
 
-    std::cerr << " в " << context;
+    err << " в " << context;
     if (!expression.empty()) {
-        std::cerr << " выражения " << expression;
+        err << " выражения " << expression;
     }
-    std::cerr << std::endl << "(строка " << line << ":" << col << ")" << std::endl;
+    ctx.Warn(err.str(), line, col);
 }
 
 // Печать семантической ошибки
 void Tree::SemError(const std::string& msg, const std::string& id, int line, int col) {
-    std::cerr << "Семантическая ошибка: " << msg;
-    if (!id.empty()) {
-        std::cerr << " (около '" << id << "')";
-    }
-    std::cerr << std::endl << "(строка " << line << ":" << col << ")" << std::endl;
-    std::exit(1);
+    throw ProgramError({ DIAG_SEMANTIC, msg, id, line, col });
 }
 
 void Tree::InterpError(const std::string& msg, const std::string& id, int line, int col) {
-    std::cerr << "Ошибка при интерпретации: " << msg;
-    if (!id.empty()) std::cerr << " (около '" << id << "')";
-    std::cerr << std::endl << "(строка " << line << ":" << col << ")" << std::endl;
-    std::exit(1);
+    throw ProgramError({ DIAG_INTERP, msg, id, line, col });
 }
 
-Tree::Tree(SemNode* node, Tree* up) : n(node), Up(up), Left(nullptr), Right(nullptr) {
-    if (Root == nullptr) {
-        Root = this;
-        Cur = this;
-    }
+void Tree::Clear() {
+    links.clear();
+    symbols.Clear();
+    types.Clear();
+    typedef_ids.clear();
 }
 
-Tree::~Tree() {
-    if (n) {
-        delete n;
+void Tree::CopyFrom(const Tree& other) {
+    links = other.links;
+    symbols = other.symbols;
+    types = other.types;
+    typedef_ids = other.typedef_ids;
+}
+
+Tree::Mark Tree::MarkScope(int scope) const {
+    return { Count(), scope, links[scope].Right, links[scope].Last };
+}
+
+// Все узлы, добавленные после MarkScope, лежат в поддереве области (прямой порядок),
+// поэтому достаточно отрезать конец массивов и восстановить ссылки области
+// и её прежнего последнего элемента
+void Tree::Rollback(const Mark& mark) {
+    links.resize(mark.count);
+    symbols.Truncate(mark.count);
+    links[mark.scope].Right = mark.right;
+    links[mark.scope].Last = mark.last;
+    if (mark.last != NONE) {
+        links[mark.last].Left = NONE;
     }
-    // Рекурсивно очищаем детей/соседей
-    if (Right) { 
-        delete Right; Right = nullptr;
+}
+
+void Tree::Truncate(int count) {
+    if (count >= Count()) {
+        return;
     }
-    if (Left) {
-        delete Left; Left = nullptr;
+    links.resize(count);
+    symbols.Truncate(count);
+    for (int n = 0; n < count; n++) {
+        TreeLink& l = links[n];
+        if (l.Left >= count) l.Left = NONE;
+        if (l.Right >= count) l.Right = NONE;
+        if (l.Last >= count) {
+            // Последний из оставшихся детей
+            l.Last = l.Right;
+            while ((l.Last != NONE) && (links[l.Last].Left != NONE) && (links[l.Last].Left < count)) {
+                l.Last = links[l.Last].Left;
+            }
+        }
     }
 }
 
-// Вставка первого дочернего элемента (правая ссылка)
-// Если Right==nullptr, создаём новый узел и присваиваем Right
-// Иначе добавляем в конец списка Left-соседей
-void Tree::SetRight(SemNode* Data) {
-    Tree* newNode = new Tree(Data, this);
-    if (this->Right == nullptr) {
-        this->Right = newNode;
+// Добавление узла последним дочерним элементом parent
+// (Right -- первый дочерний, далее цепочка Left-соседей)
+int Tree::AddNode(int parent, const std::string& id, DATA_TYPE t, int line, int col) {
+    int node = symbols.Add(id, t, line, col);
+    links.push_back({ parent, NONE, NONE, NONE });
+    if (Stats* stats = Stats::Active()) {
+        stats->nodesCreated++;
     }
-    else {
-        // Найти последнего левого соседа среди детей
-        Tree* p = this->Right;
-        while (p->Left) {
-            p = p->Left;
+
+    if (parent != NONE) {
+        TreeLink& up = links[parent];
+        if (up.Right == NONE) {
+            up.Right = node;
+        }
+        else {
+            links[up.Last].Left = node;
         }
-        p->Left = newNode;
-        newNode->Up = this;
+        up.Last = node;
     }
+    return node;
 }
 
-// Вставка левого соседа относительно THIS
-// Обычно вызывается на некотором узле: this->Left = newNode
-void Tree::SetLeft(SemNode* Data) {
-    Tree* newNode = new Tree(Data, this->Up);
-    // Вставляем после текущего узла
-    newNode->Left = this->Left;
-    this->Left = newNode;
-    newNode->Up = this->Up; // Тот же родитель, что и у текущего узла
+int Tree::AddChildren(int parent, int count) {
+    int first = Count();
+    if (count <= 0) {
+        return first;
+    }
+    symbols.Grow(count);
+    links.reserve(links.size() + count);
+    for (int i = 0; i < count; i++) {
+        links.push_back({ parent, (i + 1 < count) ? first + i + 1 : NONE, NONE, NONE });
+    }
+    if (Stats* stats = Stats::Active()) {
+        stats->nodesCreated += count;
+    }
+
+    if (parent != NONE) {
+        TreeLink& up = links[parent];
+        if (up.Right == NONE) {
+            up.Right = first;
+        }
+        else {
+            links[up.Last].Left = first;
+        }
+        up.Last = first + count - 1;
+    }
+    return first;
 }
 
 // FindUpOneLevel: ищет имя id среди дочерних элементов узла From (т.е. в текущем уровне)
-Tree* Tree::FindUpOneLevel(Tree* From, const std::string& id) {
-    if (From == nullptr) {
-        return nullptr;
-    }
-    Tree* p = From->Right;
-    while (p != nullptr) {
-        if ((p->n) && (p->n->id == id)) {
-            return p;
+// Сначала сравниваются хеши из плотного массива, строки -- только при совпадении хеша
+int Tree::FindUpOneLevel(int From, const std::string& id) const {
+    if (From == NONE) {
+        return NONE;
+    }
+    uint32_t h = SymbolStore::Hash(id);
+    int p = links[From].Right;
+    uint64_t hops = 0;
+    while (p != NONE) {
+        if ((symbols.hashes[p] == h) && (symbols.info[p].id == id)) {
+            break;
         }
-        p = p->Left;
+        p = links[p].Left;
+        hops++;
     }
-    return nullptr;
+    if (Stats* stats = Stats::Active()) {
+        stats->lookups++;
+        stats->siblingHops += hops;
+    }
+    return p;
 }
 
 // FindUp: поиск с подъёмом по областям (блочная видимость)
-Tree* Tree::FindUp(Tree* From, const std::string& id) {
-    Tree* cur = From;
-    while (cur != nullptr) {
-        Tree* found = FindUpOneLevel(cur, id);
-        if (found) return found;
-        cur = cur->Up;
+int Tree::FindUp(int From, const std::string& id) const {
+    int cur = From;
+    while (cur != NONE) {
+        int found = FindUpOneLevel(cur, id);
+        if (found != NONE) return found;
+        cur = links[cur].Up;
     }
-    return nullptr;
+    return NONE;
 }
 
 // DupControl: проверка дубля на уровне Addr (Addr — текущая область)
-bool Tree::DupControl(Tree* Addr, const std::string& a) {
-    return FindUpOneLevel(Addr, a) != nullptr;
+bool Tree::DupControl(int Addr, const std::string& a) const {
+    return FindUpOneLevel(Addr, a) != NONE;
 }
 
-// SemInclude: добавляет идентификатор в текущую область Cur
-Tree* Tree::SemInclude(const std::string& a, DATA_TYPE t, int line, int col) {
-    if (Cur == nullptr) {
-        SemError("Внутренняя ошибка: текущая область не установлена при SemInclude", a, line, col);
-    }
-
-    if (DupControl(Cur, a)) {
+// SemInclude: добавляет идентификатор в область Scope
+int Tree::SemInclude(int Scope, const std::string& a, DATA_TYPE t, int line, int col) {
+    Stats::PhaseTimer timer(PHASE_SEMANTIC);
+    if (DupControl(Scope, a)) {
         SemError("Повторное описание идентификатора", a, line, col);
     }
-
-    SemNode* node = new SemNode();
-    node->id = a;
-    node->DataType = t;
-    node->hasValue = false;
-    node->FlagConst = 0;
-    node->BasicType = TYPE_UNDEFINED;
-    node->ArrElemCount = 0;
-    node->index = 0;
-    node->line = line;
-    node->col = col;
-
-    Cur->SetRight(node);
-    Tree* added = Cur->Right;
-    while (added->Left) added = added->Left;
-    return added;
+    return AddNode(Scope, a, t, line, col);
 }
 
 // Занесение константы со значением
-Tree* Tree::SemIncludeConstant(const std::string& a, DATA_TYPE t, const std::string& value, int line, int col) {
-    Tree* node = SemInclude(a, t, line, col);
-    if (node && node->n) {
-        node->n->hasValue = true;
-        // Преобразование строкового значения в соответствующий тип
-        try {
-            long long val = std::stoll(value, nullptr, 0);
-            if (t == TYPE_SHORT_INT) {
-                node->n->Value.v_int16 = static_cast<int16_t>(val);
-            }
-            else if (t == TYPE_INT) {
-                node->n->Value.v_int32 = static_cast<int32_t>(val);
-            }
-            else if (t == TYPE_LONG_INT) {
-                node->n->Value.v_int32 = static_cast<int32_t>(val);
-            }
-            else if (t == TYPE_LONG_LONG_INT) {
-                node->n->Value.v_int64 = static_cast<int64_t>(val);
-            }
+int Tree::SemIncludeConstant(int Scope, const std::string& a, DATA_TYPE t, const std::string& value, int line, int col) {
+    Stats::PhaseTimer timer(PHASE_SEMANTIC);
+    int node = SemInclude(Scope, a, t, line, col);
+    SemNode& n = Sem(node);
+    n.hasValue = true;
+    // Преобразование строкового значения в соответствующий тип
+    try {
+        long long val = std::stoll(value, nullptr, 0);
+        if (t == TYPE_SHORT_INT) {
+            n.Value.v_int16 = static_cast<int16_t>(val);
+        }
+        else if (t == TYPE_INT) {
+            n.Value.v_int32 = static_cast<int32_t>(val);
+        }
+        else if (t == TYPE_LONG_INT) {
+            n.Value.v_int32 = static_cast<int32_t>(val);
         }
-        catch (const std::exception& e) {
-            SemError("Неверный формат константы: " + std::string(e.what()), a, line, col);
+        else if (t == TYPE_LONG_LONG_INT) {
+            n.Value.v_int64 = static_cast<int64_t>(val);
         }
     }
+    catch (const std::exception& e) {
+        SemError("Неверный формат константы: " + std::string(e.what()), a, line, col);
+    }
     return node;
 }
 
 // SemSetConst: установить флаг именованной константы
-void Tree::SemSetConst(Tree* Addr, int value) {
-    if (Addr == nullptr || Addr->n == nullptr) {
+void Tree::SemSetConst(int Addr, int value) {
+    if (Addr < 0 || Addr >= Count()) {
         SemError("SemSetConst: неверный адрес именованной константы");
     }
-    Addr->n->FlagConst = value;
-}
-
-// SemSetBasicType: установить базовый тип (для массивов и меток типов)
-void Tree::SemSetBasicType(Tree* Addr, DATA_TYPE bt) {
-    if (Addr == nullptr || Addr->n == nullptr) {
-        SemError("SemSetBasicType: неверный адрес массива или метки типа");
-    }
-    Addr->n->BasicType = bt;
+    Info(Addr).FlagConst = value;
 }
 
-// SemSetArrElemCount: установить размерность массива
-void Tree::SemSetArrElemCount(Tree* Addr, int aec) {
-    if (Addr == nullptr || Addr->n == nullptr) {
-        SemError("SemSetArrElemCount: неверный адрес массива");
+// SemSetType: установить описатель типа (для массивов и меток типов)
+void Tree::SemSetType(int Addr, int typeId) {
+    if (Addr < 0 || Addr >= Count()) {
+        SemError("SemSetType: неверный адрес массива или метки типа");
     }
-    Addr->n->ArrElemCount = aec;
+    Info(Addr).TypeId = typeId;
 }
 
 // SemSetIndex: установить индекс элемента массива
-void Tree::SemSetIndex(Tree* Addr, int index) {
-    if (Addr == nullptr || Addr->n == nullptr) {
+void Tree::SemSetIndex(int Addr, int index) {
+    if (Addr < 0 || Addr >= Count()) {
         SemError("SemSetIndex: неверный адрес элемента массива");
     }
-    Addr->n->index = index;
+    Info(Addr).index = index;
 }
 
 // SemGetVar: найти переменную / именованную константу (не метку типа) по имени (в видимых областях)
-Tree* Tree::SemGetVar(const std::string& a, int line, int col) {
-    Tree* v = FindUp(Cur, a);
-    if (v == nullptr) {
+int Tree::SemGetVar(int Scope, const std::string& a, int line, int col) const {
+    Stats::PhaseTimer timer(PHASE_SEMANTIC);
+    int v = FindUp(Scope, a);
+    if (v == NONE) {
         SemError("Отсутствует описание идентификатора", a, line, col);
     }
-    if (v->n->DataType == TYPE_TYPEDEF_NAME) {
+    if (Sem(v).DataType == TYPE_TYPEDEF_NAME) {
         SemError("Неверное использование - идентификатор является меткой типа", a, line, col);
     }
     return v;
 }
 
 // SemGetType: найти метку типа по имени
-Tree* Tree::SemGetType(const std::string& a, int line, int col) {
-    Tree* v = FindUp(Cur, a);
-    if (v == nullptr) {
+int Tree::SemGetType(int Scope, const std::string& a, int line, int col) const {
+    Stats::PhaseTimer timer(PHASE_SEMANTIC);
+    int v = FindUp(Scope, a);
+    if (v == NONE) {
         SemError("Отсутствует описание метки типа", a, line, col);
     }
-    if (v->n->DataType != TYPE_TYPEDEF_NAME) {
+    if (Sem(v).DataType != TYPE_TYPEDEF_NAME) {
         SemError("Идентификатор не является меткой типа", a, line, col);
     }
     return v;
 }
 
-// SemEnterBlock: создать узел-область и перейти в него
-Tree* Tree::SemEnterBlock(int line, int col) {
-    if (Cur == nullptr) {
-        SemError("SemEnterBlock: текущая область не установлена");
-    }
-    SemNode* sn = new SemNode();
-    sn->id = "";
-    sn->DataType = TYPE_SCOPE;
-    sn->FlagConst = 0;
-    sn->BasicType = TYPE_UNDEFINED;
-    sn->ArrElemCount = 0;
-    sn->index = 0;
-    sn->line = line;
-    sn->col = col;
-
-    // Вставляем новую область как дочерний элемент текущего Cur
-    // (т.е. она будет видимой как локальная область для последующих SemInclude)
-    SetRight(sn);
-
-    // Возвращаем указатель на созданный узел (последний дочерний)
-    Tree* created = Cur->Right;
-    while (created->Left) {
-        created = created->Left;
+// SemResolveType: описатель типа для метки типа из глобальной области
+int Tree::SemResolveType(int Root, const std::string& a, int line, int col) {
+    Stats::PhaseTimer timer(PHASE_SEMANTIC);
+    auto it = typedef_ids.find(a);
+    if (it != typedef_ids.end()) {
+        return it->second;
     }
+    int typeId = Info(SemGetType(Root, a, line, col)).TypeId;
+    typedef_ids.emplace(a, typeId);
+    return typeId;
+}
 
-    // переключаем текущую область на созданную
-    Cur = created;
-    return created;
+// SemEnterBlock: создать узел-область внутри Scope (в него затем переходит вызывающий)
+// Новая область -- последний дочерний элемент Scope, видимый как локальная
+// область для последующих SemInclude
+int Tree::SemEnterBlock(int Scope, int line, int col) {
+    Stats::PhaseTimer timer(PHASE_SEMANTIC);
+    return AddNode(Scope, "", TYPE_SCOPE, line, col);
 }
 
-// SemExitBlock: вернуться на уровень вверх
-void Tree::SemExitBlock() {
-    if (Cur == nullptr) {
-        SemError("SemExitBlock: текущая область не установлена");
-    }
-    if (Cur->Up == nullptr) {
+// SemExitBlock: вернуть область на уровень выше
+int Tree::SemExitBlock(int Scope) const {
+    int up = links[Scope].Up;
+    if (up == NONE) {
         SemError("SemExitBlock: попытка выйти из корневой области");
     }
-    Cur = Cur->Up;
+    return up;
 }
 
-void Tree::SetVarValue(const std::string& name, const SemNode& value, int line, int col) {
-    Tree* varNode = Cur->SemGetVar(name, line, col);
+void Tree::SetVarValue(Context& ctx, const std::string& name, const SemNode& value, int line, int col) {
+    Stats::PhaseTimer timer(PHASE_EVAL);
+    int node = ctx.tree.SemGetVar(ctx.Cur, name, line, col);
+    SemNode& var = ctx.tree.Sem(node);
 
     if (value.hasValue) {
-        if (CanImplicitCast(value.DataType, varNode->n->DataType)) {
-            // Проверяем обрезку значений для всех типов
-            bool needsTruncationWarning = false;
-            long long originalValue = 0;
-
+        if (CanImplicitCast(value.DataType, var.DataType)) {
             // Получаем оригинальное значение в long long
-            switch (value.DataType) {
-            case TYPE_SHORT_INT: originalValue = value.Value.v_int16; break;
-            case TYPE_INT: originalValue = value.Value.v_int32; break;
-            case TYPE_LONG_INT: originalValue = value.Value.v_int32; break;
-            case TYPE_LONG_LONG_INT: originalValue = value.Value.v_int64; break;
-            default: break;
-            }
+            long long originalValue = WidenValue(value);
 
-            // Проверяем обрезку для типа переменной
-            if (varNode->n->DataType == TYPE_SHORT_INT) {
-                if (originalValue < -32768 || originalValue > 32767) {
-                    needsTruncationWarning = true;
-                }
-            }
-            else if (varNode->n->DataType == TYPE_INT) {
-                if (originalValue < -2147483648LL || originalValue > 2147483647LL) {
-                    needsTruncationWarning = true;
-                }
-            }
-            else if (varNode->n->DataType == TYPE_LONG_INT) {
-                if (originalValue < -2147483648LL || originalValue > 2147483647LL) {
-                    needsTruncationWarning = true;
-                }
-            }
-
-            // Выводим предупреждение об обрезке всегда (независимо от debug)
-            if (needsTruncationWarning) {
-                std::string text_type = "long";
-                if (varNode->n->DataType == TYPE_SHORT_INT) {
-                    text_type = "short";
-                }
-                else if (varNode->n->DataType == TYPE_INT) {
-                    text_type = "int";
-                }
-
-                std::cerr << "Предупреждение: значение " << originalValue
-                    << " обрезается при преобразовании к "
-                    << text_type;
-                std::cerr << std::endl << "(строка " << line << ":" << col << ")" << std::endl;
-            }
-            // Выводим предупреждение о преобразовании типов только в debug режиме
-            else if (value.DataType != varNode->n->DataType && debug) {
-                PrintTypeConversionWarning(value.DataType, varNode->n->DataType,
+            // Предупреждение об обрезке выводится всегда, о преобразовании типов -- только в debug режиме
+            if (!WarnTruncation(ctx, var.DataType, originalValue, line, col) && (value.DataType != var.DataType) && ctx.debug) {
+                PrintTypeConversionWarning(ctx, value.DataType, var.DataType,
                     "присваивании", name + " = ...", line, col);
             }
 
-            SemNode converted = CastToType(value, varNode->n->DataType, line, col);
-            varNode->n->Value = converted.Value;
-            varNode->n->hasValue = true;
+            SemNode converted = CastToType(value, var.DataType, line, col);
+            var.Value = converted.Value;
+            var.hasValue = true;
 
-            PrintAssignment(name, converted, line, col);
+            ctx.ring.Record(RING_ASSIGN, node, 0, converted, line, col);
+            if (ctx.profiler) {
+                ctx.profiler->Record(ctx.Cur, line, PROF_ASSIGN);
+            }
+            PrintAssignment(ctx, name, converted, line, col);
         }
         else {
             SemError("Несовместимые типы при присваивании", name, line, col);
@@ -366,12 +344,59 @@ void Tree::SetVarValue(const std::string& name, const SemNode& value, int line,
     }
 }
 
-SemNode Tree::GetVarValue(const std::string& name, int line, int col) {
-    Tree* varNode = Cur->SemGetVar(name, line, col); // Используем Cur->
-    if (!varNode->n->hasValue) {
+bool Tree::WarnTruncation(Context& ctx, DATA_TYPE to, long long value, int line, int col) {
+    // Проверяем обрезку для типа переменной
+    bool truncated = false;
+    if (to == TYPE_SHORT_INT) {
+        truncated = !Fits<int16_t>(value);
+    }
+    else if (to == TYPE_INT || to == TYPE_LONG_INT) {
+        truncated = !Fits<int32_t>(value);
+    }
+    if (!truncated) {
+        return false;
+    }
+
+    std::string text_type = "long";
+    if (to == TYPE_SHORT_INT) {
+        text_type = "short";
+    }
+    else if (to == TYPE_INT) {
+        text_type = "int";
+    }
+    ctx.Warn("значение " + std::to_string(value) + " обрезается при преобразовании к " + text_type, line, col);
+    return true;
+}
+
+void Tree::OverflowError(DATA_TYPE type, char op, long long a, long long b, int line, int col) {
+    const char* text_type = "longlong";
+    if (type == TYPE_SHORT_INT) {
+        text_type = "short";
+    }
+    else if (type == TYPE_INT) {
+        text_type = "int";
+    }
+    else if (type == TYPE_LONG_INT) {
+        text_type = "long";
+    }
+    throw ProgramError({ DIAG_INTERP, "Переполнение при вычислении " + std::to_string(a) + " " + op + " "
+        + std::to_string(b) + " в типе " + text_type, "", line, col });
+}
+
+void Tree::CountIteration(Context& ctx, int line, int col) {
+    ctx.iterations++;
+    if ((ctx.maxIterations > 0) && (ctx.iterations > ctx.maxIterations)) {
+        InterpError("Превышен предел числа итераций циклов (" + std::to_string(ctx.maxIterations) + ")", "", line, col);
+    }
+}
+
+SemNode Tree::GetVarValue(Context& ctx, const std::string& name, int line, int col) {
+    Stats::PhaseTimer timer(PHASE_EVAL);
+    const SemNode& var = ctx.tree.Sem(ctx.tree.SemGetVar(ctx.Cur, name, line, col));
+    if (!var.hasValue) {
         SemError("Использование неинициализированной переменной", name, line, col);
     }
-    return *(varNode->n);
+    return var;
 }
 
 // Определение максимального типа
@@ -404,14 +429,7 @@ SemNode Tree::CastToType(const SemNode& value, DATA_TYPE targetType, int line, i
     if (!value.hasValue) return result;
 
     // Получаем значение в long long для безопасного приведения
-    long long originalValue = 0;
-    switch (value.DataType) {
-    case TYPE_SHORT_INT: originalValue = value.Value.v_int16; break;
-    case TYPE_INT: originalValue = value.Value.v_int32; break;
-    case TYPE_LONG_INT: originalValue = value.Value.v_int32; break;
-    case TYPE_LONG_LONG_INT: originalValue = value.Value.v_int64; break;
-    default: break;
-    }
+    long long originalValue = WidenValue(value);
 
     // Выполняем приведение
     switch (targetType) {
@@ -438,21 +456,54 @@ SemNode Tree::CastToType(const SemNode& value, DATA_TYPE targetType, int line, i
     return result;
 }
 
-// Арифметические операции
-SemNode Tree::ExecuteArithmeticOp(const SemNode& left, const SemNode& right, const std::string& op, int line, int col) {
+// Операция над значениями типа type разрядности T. Без проверки (Checked = false) переполнение
+// -- с переносом; делитель -1 обрабатывается отдельно: для наименьшего значения типа частное
+// не представимо и аппаратное деление завершает процесс, результат -- как при переполнении
+// умножения. С проверкой переполнение -- ошибка выполнения. Проверка выбирается экземпляром
+// шаблона, а не флагом на каждой операции
+template <bool Checked, typename T>
+static T ArithKernel(DATA_TYPE type, char op, T a, T b, int line, int col) {
+    T r = 0;
+    switch (op) {
+    case '+':
+        if (!Checked) return static_cast<T>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+        if (AddOverflow(a, b, &r)) Tree::OverflowError(type, op, a, b, line, col);
+        return r;
+    case '-':
+        if (!Checked) return static_cast<T>(static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+        if (SubOverflow(a, b, &r)) Tree::OverflowError(type, op, a, b, line, col);
+        return r;
+    case '*':
+        if (!Checked) return static_cast<T>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+        if (MulOverflow(a, b, &r)) Tree::OverflowError(type, op, a, b, line, col);
+        return r;
+    case '/':
+        if (b == 0) Tree::InterpError("Деление на ноль", "", line, col);
+        if (Checked && DivOverflow(a, b)) Tree::OverflowError(type, op, a, b, line, col);
+        return (b == -1) ? static_cast<T>(0ull - static_cast<uint64_t>(a)) : static_cast<T>(a / b);
+    case '%':
+        if (b == 0) Tree::InterpError("Деление на ноль", "", line, col);
+        return (b == -1) ? 0 : static_cast<T>(a % b);
+    default:
+        return 0;
+    }
+}
+
+template <bool Checked>
+static SemNode Arithmetic(Context& ctx, const SemNode& left, const SemNode& right, const std::string& op, int line, int col) {
     if (!left.hasValue || !right.hasValue) {
-        SemError("Операция с неинициализированными значениями", "", line, col);
+        Tree::SemError("Операция с неинициализированными значениями", "", line, col);
     }
 
     // Выводим предупреждение если операнды разных типов
-    if (left.DataType != right.DataType && debug) {
-        PrintTypeConversionWarning(left.DataType, right.DataType,
+    if (left.DataType != right.DataType && ctx.debug) {
+        Tree::PrintTypeConversionWarning(ctx, left.DataType, right.DataType,
             "арифметической операции", "", line, col);
     }
 
-    DATA_TYPE resultType = GetMaxType(left.DataType, right.DataType);
-    SemNode leftConv = CastToType(left, resultType, line, col);
-    SemNode rightConv = CastToType(right, resultType, line, col);
+    DATA_TYPE resultType = Tree::GetMaxType(left.DataType, right.DataType);
+    SemNode leftConv = Tree::CastToType(left, resultType, line, col);
+    SemNode rightConv = Tree::CastToType(right, resultType, line, col);
 
     SemNode result;
     result.DataType = resultType;
@@ -460,75 +511,48 @@ SemNode Tree::ExecuteArithmeticOp(const SemNode& left, const SemNode& right, con
 
     switch (resultType) {
     case TYPE_SHORT_INT:
-        if (op == "+") result.Value.v_int16 = leftConv.Value.v_int16 + rightConv.Value.v_int16;
-        else if (op == "-") result.Value.v_int16 = leftConv.Value.v_int16 - rightConv.Value.v_int16;
-        else if (op == "*") result.Value.v_int16 = leftConv.Value.v_int16 * rightConv.Value.v_int16;
-        else if (op == "/") {
-            if (rightConv.Value.v_int16 == 0) InterpError("Деление на ноль", "", line, col);
-            result.Value.v_int16 = leftConv.Value.v_int16 / rightConv.Value.v_int16;
-        }
-        else if (op == "%") {
-            if (rightConv.Value.v_int16 == 0) InterpError("Деление на ноль", "", line, col);
-            result.Value.v_int16 = leftConv.Value.v_int16 % rightConv.Value.v_int16;
-        }
+        result.Value.v_int16 = ArithKernel<Checked>(resultType, op[0], leftConv.Value.v_int16, rightConv.Value.v_int16, line, col);
         break;
 
     case TYPE_INT:
-        if (op == "+") result.Value.v_int32 = leftConv.Value.v_int32 + rightConv.Value.v_int32;
-        else if (op == "-") result.Value.v_int32 = leftConv.Value.v_int32 - rightConv.Value.v_int32;
-        else if (op == "*") result.Value.v_int32 = leftConv.Value.v_int32 * rightConv.Value.v_int32;
-        else if (op == "/") {
-            if (rightConv.Value.v_int32 == 0) InterpError("Деление на ноль", "", line, col);
-            result.Value.v_int32 = leftConv.Value.v_int32 / rightConv.Value.v_int32;
-        }
-        else if (op == "%") {
-            if (rightConv.Value.v_int32 == 0) InterpError("Деление на ноль", "", line, col);
-            result.Value.v_int32 = leftConv.Value.v_int32 % rightConv.Value.v_int32;
-        }
-        break;
-
     case TYPE_LONG_INT:
-        if (op == "+") result.Value.v_int32 = leftConv.Value.v_int32 + rightConv.Value.v_int32;
-        else if (op == "-") result.Value.v_int32 = leftConv.Value.v_int32 - rightConv.Value.v_int32;
-        else if (op == "*") result.Value.v_int32 = leftConv.Value.v_int32 * rightConv.Value.v_int32;
-        else if (op == "/") {
-            if (rightConv.Value.v_int32 == 0) InterpError("Деление на ноль", "", line, col);
-            result.Value.v_int32 = leftConv.Value.v_int32 / rightConv.Value.v_int32;
-        }
-        else if (op == "%") {
-            if (rightConv.Value.v_int32 == 0) InterpError("Деление на ноль", "", line, col);
-            result.Value.v_int32 = leftConv.Value.v_int32 % rightConv.Value.v_int32;
-        }
+        result.Value.v_int32 = ArithKernel<Checked>(resultType, op[0], leftConv.Value.v_int32, rightConv.Value.v_int32, line, col);
         break;
 
     case TYPE_LONG_LONG_INT:
-        if (op == "+") result.Value.v_int64 = leftConv.Value.v_int64 + rightConv.Value.v_int64;
-        else if (op == "-") result.Value.v_int64 = leftConv.Value.v_int64 - rightConv.Value.v_int64;
-        else if (op == "*") result.Value.v_int64 = leftConv.Value.v_int64 * rightConv.Value.v_int64;
-        else if (op == "/") {
-            if (rightConv.Value.v_int64 == 0) InterpError("Деление на ноль", "", line, col);
-            result.Value.v_int64 = leftConv.Value.v_int64 / rightConv.Value.v_int64;
-        }
-        else if (op == "%") {
-            if (rightConv.Value.v_int64 == 0) InterpError("Деление на ноль", "", line, col);
-            result.Value.v_int64 = leftConv.Value.v_int64 % rightConv.Value.v_int64;
-        }
+        result.Value.v_int64 = ArithKernel<Checked>(resultType, op[0], leftConv.Value.v_int64, rightConv.Value.v_int64, line, col);
         break;
 
     default:
-        SemError("Неподдерживаемый тип для арифметической операции", "", line, col);
+        Tree::SemError("Неподдерживаемый тип для арифметической операции", "", line, col);
+    }
+
+    ctx.ring.Record(RING_ARITH, Tree::NONE, op[0], result, line, col);
+    if (ctx.profiler) {
+        ctx.profiler->Record(ctx.Cur, line, Profiler::OpKind(op));
     }
 
     // Вывод информации об операции (отладочный)
-    if (debug && interpretationEnabled) {
-        PrintArithmeticOp(op, leftConv, rightConv, result, line, col);
+    if (ctx.debug && ctx.interpretationEnabled) {
+        Tree::PrintArithmeticOp(ctx, op, leftConv, rightConv, result, line, col);
     }
 
     return result;
 }
 
+Tree::ArithmeticFn Tree::ArithmeticFor(bool checked) {
+    return checked ? &Arithmetic<true> : &Arithmetic<false>;
+}
+
+// Арифметические операции
+SemNode Tree::ExecuteArithmeticOp(Context& ctx, const SemNode& left, const SemNode& right, const std::string& op, int line, int col) {
+    Stats::PhaseTimer timer(PHASE_EVAL);
+    return ctx.arithmetic(ctx, left, right, op, line, col);
+}
+
 // Операции сравнения
-SemNode Tree::ExecuteComparisonOp(const SemNode& left, const SemNode& right, const std::string& op, int line, int col) {
+SemNode Tree::ExecuteComparisonOp(Context& ctx, const SemNode& left, const SemNode& right, const std::string& op, int line, int col) {
+    Stats::PhaseTimer timer(PHASE_EVAL);
     if (!left.hasValue || !right.hasValue) {
         SemError("Операция с неинициализированными значениями", "", line, col);
     }
@@ -582,225 +606,257 @@ SemNode Tree::ExecuteComparisonOp(const SemNode& left, const SemNode& right, con
         SemError("Неподдерживаемый тип для операции сравнения", "", line, col);
     }
 
+    if (ctx.profiler) {
+        ctx.profiler->Record(ctx.Cur, line, Profiler::OpKind(op));
+    }
+
     return result;
 }
 
-// Создать строковое представление узла для печати
-std::string Tree::makeLabel(const Tree* tree) const {
-    if (tree == nullptr) {
-        return std::string("<null-tree>");
+// Имя типа для печати
+static const char* TypeName(DATA_TYPE t) {
+    switch (t) {
+    case TYPE_INT: return "int";
+    case TYPE_SHORT_INT: return "short";
+    case TYPE_LONG_INT: return "long";
+    case TYPE_LONG_LONG_INT: return "longlong";
+    default: return "?";
     }
-    SemNode* n = tree->n;
-    if (!n) {
-        return std::string("<null-node>");
+}
+
+// Дописать в буфер строку с экранированием для DOT/JSON
+static void AppendEscaped(std::string& buf, const std::string& s) {
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            buf.push_back('\\');
+        }
+        buf.push_back(c);
     }
+}
 
-    std::ostringstream oss;
+// Дописать в буфер строковое представление узла для печати
+void Tree::appendLabel(std::string& buf, int node) const {
+    if (node == NONE) {
+        buf += "<null-tree>";
+        return;
+    }
+    const SemNode& n = Sem(node);
+    const SemInfo& si = Info(node);
+    const TypeDesc& type = types.Get(si.TypeId);
 
-    if (!n->id.empty()) {
-        oss << n->id;
+    if (!si.id.empty()) {
+        buf += si.id;
     }
     else {
-        oss << "{}";
+        buf += "{}";
     }
 
     // Тип
-    switch (n->DataType) {
-    case TYPE_INT:              oss << " (int)"; break;
-    case TYPE_SHORT_INT:        oss << " (short)"; break;
-    case TYPE_LONG_INT:         oss << " (long)"; break;
-    case TYPE_LONG_LONG_INT:    oss << " (longlong)"; break;
-    case TYPE_ARRAY:            oss << " (массив)[" << n->ArrElemCount << "] (типа "; break;
-    case TYPE_TYPEDEF_NAME:     oss << " (метка типа) (для типа "; break;
-    case TYPE_SCOPE:            oss << " (область)"; break;
-    default:                    oss << " (?)"; break;
-    }
-
-    if (n->FlagConst) {
-        oss << " (const)";
-    }
-
-    if (n->DataType == TYPE_ARRAY) {
-        switch (n->BasicType) {
-        case TYPE_INT: oss << "int)"; break;
-        case TYPE_SHORT_INT: oss << "short)"; break;
-        case TYPE_LONG_INT: oss << "long)"; break;
-        case TYPE_LONG_LONG_INT: oss << "longlong)"; break;
-        default: oss << "?)"; break;
-        }
+    switch (n.DataType) {
+    case TYPE_INT:              buf += " (int)"; break;
+    case TYPE_SHORT_INT:        buf += " (short)"; break;
+    case TYPE_LONG_INT:         buf += " (long)"; break;
+    case TYPE_LONG_LONG_INT:    buf += " (longlong)"; break;
+    case TYPE_ARRAY:            buf += " (массив)["; buf += std::to_string(type.ArrElemCount); buf += "] (типа "; break;
+    case TYPE_TYPEDEF_NAME:     buf += " (метка типа) (для типа "; break;
+    case TYPE_SCOPE:            buf += " (область)"; break;
+    default:                    buf += " (?)"; break;
     }
 
-    if (n->DataType == TYPE_TYPEDEF_NAME) {
-        switch (n->BasicType) {
-        case TYPE_INT: oss << "int)"; break;
-        case TYPE_SHORT_INT: oss << "short)"; break;
-        case TYPE_LONG_INT: oss << "long)"; break;
-        case TYPE_LONG_LONG_INT: oss << "longlong)"; break;
-        default: oss << "?)"; break;
-        }
-
-        if (n->ArrElemCount > 0) {
-            oss << " (массив как тип)[" << n->ArrElemCount << "]";
-        }
+    if (si.FlagConst) {
+        buf += " (const)";
     }
 
-    // Берём имена правого и левого потомков
-    auto childName = [](const Tree* t)->std::string {
-        if (!t || !t->n) {
-            return std::string("-");
-        }
-        if (t->n->DataType == TYPE_SCOPE) {
-            return std::string("{}");
-        }
-        if (t->n->id.empty()) {
-            return std::string("?");
-        }
-        return t->n->id;
-    };
-     
-    std::string rname = childName(tree->Right);
-    std::string lname = childName(tree->Left);
+    if (n.DataType == TYPE_ARRAY) {
+        buf += TypeName(type.BasicType);
+        buf += ")";
+    }
 
-    oss << " (L = " << lname << ", R = " << rname << ")";
+    if (n.DataType == TYPE_TYPEDEF_NAME) {
+        buf += TypeName(type.BasicType);
+        buf += ")";
 
-    return oss.str();
+        if (type.ArrElemCount > 0) {
+            buf += " (массив как тип)[";
+            buf += std::to_string(type.ArrElemCount);
+            buf += "]";
+        }
+    }
 }
 
-void Tree::Print(int depth) {
-    if (this == nullptr) return;
-
-    // Печатаем текущий узел
-    std::string label = makeLabel(this);
-    for (int i = 0; i < depth; ++i) {
-        std::cout << ' ';
+// Дописать в буфер имя правого/левого потомка
+void Tree::appendChildName(std::string& buf, int node) const {
+    if (node == NONE) {
+        buf += "-";
     }
-    std::cout << label << '\n';
-
-    // Затем рекурсивно печатаем всех потомков
-    Tree* child = this->Right;
-    while (child) {
-        child->Print(depth + 4); // Сдвиг для уровня (4 пробела)
-        child = child->Left;
+    else if (Sem(node).DataType == TYPE_SCOPE) {
+        buf += "{}";
+    }
+    else if (Info(node).id.empty()) {
+        buf += "?";
+    }
+    else {
+        buf += Info(node).id;
     }
 }
 
-// Печать дерева с нулевого отступа
-void Tree::Print() {
-    Print(0);
-}
-
-void Tree::EnableInterpretation() { interpretationEnabled = true; }
-void Tree::DisableInterpretation() { interpretationEnabled = false; }
-bool Tree::IsInterpretationEnabled() { return interpretationEnabled; }
-
-// Метод для вывода отладочной информации
-void Tree::PrintDebugInfo(const std::string& message, int line, int col) {
-    if (!debug || !interpretationEnabled) return;
-
-    // Определяем контекст
-    std::string context = "глобальная область";
+// Печать дерева без рекурсии: стек хранит для каждой открытой вершины
+// следующего ещё не напечатанного потомка. Вывод накапливается в буфере
+// и сбрасывается в поток крупными блоками
+void Tree::Print(int From, std::ostream& out, PRINT_FORMAT format) const {
+    const size_t FLUSH_SIZE = 1 << 20;
 
-    // Используем currentArea для определения контекста
-    if (currentArea && currentArea->n) {
-        context = currentArea->n->id;
-    }
+    struct Frame {
+        int node;          // Вершина, потомки которой печатаются
+        int next_child;    // Следующий потомок
+        size_t number;     // Номер вершины (для DOT)
+        bool has_children; // Уже напечатан хотя бы один потомок (для JSON)
+    };
 
-    // Выводим сообщение с контекстом и позицией
-    std::cout << "DEBUG: [" << context << "]";
-    if (line > 0) {
-        std::cout << " (строка " << line << ":" << col << ")";
+    if (From == NONE) {
+        return;
     }
-    std::cout << " " << message << std::endl;
-}
 
-// Метод для вывода присваивания
-void Tree::PrintAssignment(const std::string& varName, const SemNode& value, int line, int col) {
-    if (!debug || !interpretationEnabled) return;
+    std::string buf;
+    buf.reserve(FLUSH_SIZE + 4096);
+    std::vector<Frame> stack;
+    size_t counter = 0;
 
-    std::ostringstream oss;
-    oss << "Присваивание: " << varName << " = ";
+    if (format == PRINT_DOT) {
+        buf += "digraph Tree {\n    node [shape=box];\n";
+    }
 
-    if (value.hasValue) {
-        switch (value.DataType) {
-        case TYPE_SHORT_INT:
-            oss << value.Value.v_int16 << " (short)";
-            break;
-        case TYPE_INT:
-            oss << value.Value.v_int32 << " (int)";
+    // Печать начала вершины (depth -- уровень вложенности, parent -- кадр родителя или nullptr)
+    auto open = [&](int t, size_t depth, Frame* parent) {
+        size_t number = counter++;
+        switch (format) {
+        case PRINT_TEXT:
+            buf.append(depth * 4, ' '); // Сдвиг для уровня (4 пробела)
+            appendLabel(buf, t);
+            buf += " (L = ";
+            appendChildName(buf, Left(t));
+            buf += ", R = ";
+            appendChildName(buf, Right(t));
+            buf += ")\n";
             break;
-        case TYPE_LONG_INT:
-            oss << value.Value.v_int32 << " (long)";
-            break;
-        case TYPE_LONG_LONG_INT:
-            oss << value.Value.v_int64 << " (longlong)";
+
+        case PRINT_DOT: {
+            std::string label;
+            appendLabel(label, t);
+            buf += "    n";
+            buf += std::to_string(number);
+            buf += " [label=\"";
+            AppendEscaped(buf, label);
+            buf += "\"];\n";
+            if (parent) {
+                buf += "    n";
+                buf += std::to_string(parent->number);
+                buf += " -> n";
+                buf += std::to_string(number);
+                buf += ";\n";
+            }
             break;
-        default:
-            oss << "unknown";
         }
-    }
-    else {
-        oss << "неинициализирована";
-    }
 
-    PrintDebugInfo(oss.str(), line, col);
-}
+        case PRINT_JSON: {
+            // Без отступов: на глубоких деревьях они сделали бы размер вывода квадратичным
+            if (parent) {
+                buf += parent->has_children ? ",\n" : "\n";
+                parent->has_children = true;
+            }
+            const SemNode& n = Sem(t);
+            const SemInfo& si = Info(t);
+            buf += "{\"id\": \"";
+            AppendEscaped(buf, si.id);
+            buf += "\", \"type\": \"";
+            switch (n.DataType) {
+            case TYPE_ARRAY: buf += "array"; break;
+            case TYPE_TYPEDEF_NAME: buf += "typedef"; break;
+            case TYPE_SCOPE: buf += "scope"; break;
+            default: buf += TypeName(n.DataType); break;
+            }
+            buf += "\"";
+            if (n.DataType == TYPE_ARRAY || n.DataType == TYPE_TYPEDEF_NAME) {
+                buf += ", \"basicType\": \"";
+                buf += TypeName(Type(t).BasicType);
+                buf += "\", \"arrElemCount\": ";
+                buf += std::to_string(Type(t).ArrElemCount);
+            }
+            if (si.FlagConst) {
+                buf += ", \"const\": true";
+            }
+            buf += ", \"line\": ";
+            buf += std::to_string(si.line);
+            buf += ", \"col\": ";
+            buf += std::to_string(si.col);
+            buf += ", \"children\": [";
+            break;
+        }
+        }
+        stack.push_back({ t, Right(t), number, false });
+    };
 
-// Метод для вывода арифметической операции
-void Tree::PrintArithmeticOp(const std::string& op, const SemNode& left, const SemNode& right, const SemNode& result, int line, int col) {
-    if (!debug || !interpretationEnabled) return;
-
-    std::ostringstream oss;
-    oss << "Арифметическая операция: ";
-
-    // Левый операнд
-    if (left.hasValue) {
-        switch (left.DataType) {
-        case TYPE_SHORT_INT: oss << left.Value.v_int16 << " (short)"; break;
-        case TYPE_INT: oss << left.Value.v_int32 << " (int)"; break;
-        case TYPE_LONG_INT: oss << left.Value.v_int32 << " (long)"; break;
-        case TYPE_LONG_LONG_INT: oss << left.Value.v_int64 << " (longlong)"; break;
-        default: oss << "unknown";
+    // Печать конца вершины (после всех потомков)
+    auto close = [&]() {
+        if (format == PRINT_JSON) {
+            buf += "]}";
         }
-    }
-    else {
-        oss << "неинициализирована";
-    }
+    };
 
-    oss << " " << op << " ";
+    open(From, 0, nullptr);
+    while (!stack.empty()) {
+        Frame& top = stack.back();
+        if (top.next_child == NONE) {
+            close();
+            stack.pop_back();
+        }
+        else {
+            int child = top.next_child;
+            top.next_child = Left(child);
+            open(child, stack.size(), &top);
+        }
 
-    // Правый операнд
-    if (right.hasValue) {
-        switch (right.DataType) {
-        case TYPE_SHORT_INT: oss << right.Value.v_int16 << " (short)"; break;
-        case TYPE_INT: oss << right.Value.v_int32 << " (int)"; break;
-        case TYPE_LONG_INT: oss << right.Value.v_int32 << " (long)"; break;
-        case TYPE_LONG_LONG_INT: oss << right.Value.v_int64 << " (longlong)"; break;
-        default: oss << "unknown";
+        if (buf.size() >= FLUSH_SIZE) {
+            out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+            buf.clear();
         }
     }
-    else {
-        oss << "неинициализирована";
-    }
-
-    oss << " = ";
 
-    // Результат
-    if (result.hasValue) {
-        switch (result.DataType) {
-        case TYPE_SHORT_INT: oss << result.Value.v_int16 << " (short)"; break;
-        case TYPE_INT: oss << result.Value.v_int32 << " (int)"; break;
-        case TYPE_LONG_INT: oss << result.Value.v_int32 << " (long)"; break;
-        case TYPE_LONG_LONG_INT: oss << result.Value.v_int64 << " (longlong)"; break;
-        default: oss << "unknown";
-        }
+    if (format == PRINT_DOT) {
+        buf += "}\n";
     }
-    else {
-        oss << "неинициализирована";
+    else if (format == PRINT_JSON) {
+        buf += "\n";
     }
+    out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    out.flush();
+}
 
-    PrintDebugInfo(oss.str(), line, col);
+// Имя текущей области для отладочного вывода
+static const std::string& AreaName(const Context& ctx) {
+    static const std::string global_area = "глобальная область";
+    return (ctx.currentArea != Tree::NONE) ? ctx.tree.Info(ctx.currentArea).id : global_area;
 }
 
-void Tree::EnableDebug() { debug = true; }
-void Tree::DisableDebug() { debug = false; }
-bool Tree::IsDebugEnabled() { return debug; }
\ No newline at end of file
+// Отладочный вывод включён и трассировка открыта
+static bool TraceEnabled(const Context& ctx) {
+    return ctx.debug && ctx.interpretationEnabled && ctx.trace.IsOpen();
+}
+
+// Метод для вывода отладочной информации
+void Tree::PrintDebugInfo(Context& ctx, const std::string& message, int line, int col) {
+    if (!TraceEnabled(ctx)) return;
+    ctx.trace.Message(AreaName(ctx), message, line, col);
+}
+
+// Метод для вывода присваивания
+void Tree::PrintAssignment(Context& ctx, const std::string& varName, const SemNode& value, int line, int col) {
+    if (!TraceEnabled(ctx)) return;
+    ctx.trace.Assignment(AreaName(ctx), varName, value, line, col);
+}
+
+// Метод для вывода арифметической операции
+void Tree::PrintArithmeticOp(Context& ctx, const std::string& op, const SemNode& left, const SemNode& right, const SemNode& result, int line, int col) {
+    if (!TraceEnabled(ctx)) return;
+    ctx.trace.ArithmeticOp(AreaName(ctx), op, left, right, result, line, col);
+}
@@ -1,89 +1,161 @@
 #pragma once
 #include "sem_node.h"
+#include "symbol_store.h"
+#include "type_table.h"
 #include <fstream>
 #include <vector>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 
+class Context;
+
+// Формат печати семантического дерева
+enum PRINT_FORMAT {
+    PRINT_TEXT, // Текст с отступами
+    PRINT_DOT, // Graphviz DOT
+    PRINT_JSON // JSON
+};
+
+// Семантическое дерево: области видимости и идентификаторы.
+// Узел задаётся номером; номер узла совпадает с номером идентификатора в symbols,
+// поэтому тип и значение переменной читаются из плотного массива symbols.values.
+// Связи хранятся 32-битными номерами в одном непрерывном массиве (links)
 class Tree {
 public:
-    SemNode* n;    // Данные узла
-    Tree* Up;      // Родитель (внешняя область)
-    Tree* Left;    // Следующий элемент на том же уровне (левый сосед)
-    Tree* Right;   // Первый вложенный элемент (правая ссылка)
+    static constexpr int NONE = -1; // Отсутствующий узел
+
+    SymbolStore symbols; // Данные узлов
+    TypeTable types;     // Описатели типов (массивы и метки типов)
+
+    Tree() {}
+
+    Tree(const Tree&) = delete;
+    Tree& operator=(const Tree&) = delete;
+
+    // Количество узлов
+    int Count() const { return static_cast<int>(links.size()); }
+
+    // Навигация: родитель, следующий сосед, первый вложенный элемент (NONE, если нет)
+    int Up(int node) const { return links[node].Up; }
+    int Left(int node) const { return links[node].Left; }
+    int Right(int node) const { return links[node].Right; }
+
+    // Данные узла
+    SemNode& Sem(int node) { return symbols.values[node]; }
+    const SemNode& Sem(int node) const { return symbols.values[node]; }
+    SemInfo& Info(int node) { return symbols.info[node]; }
+    const SemInfo& Info(int node) const { return symbols.info[node]; }
+
+    // Добавить узел последним дочерним элементом parent (NONE -- корень), без проверки дублей
+    int AddNode(int parent, const std::string& id, DATA_TYPE t, int line, int col);
+
+    // Добавить count узлов подряд последними дочерними элементами parent: массивы расширяются
+    // один раз, связи заполняются за один проход. Данные узлов (symbols: значения, хеши имён,
+    // SemInfo) заполняет вызывающий (загрузка снимка). Возвращает номер первого узла
+    int AddChildren(int parent, int count);
+
+    // Удалить все узлы
+    void Clear();
 
-    // Текущая позиция (корень/текущий блок) -- статическая
-    static Tree* Root;
-    static Tree* Cur;
+    // Заменить содержимое копией other (копирование по ошибке запрещено -- только явно)
+    void CopyFrom(const Tree& other);
 
-    // Конструкторы / деструктор
-    Tree(SemNode* node = nullptr, Tree* up = nullptr);
-    ~Tree();
+    // Состояние дерева перед добавлением узлов в область scope
+    struct Mark {
+        int count; // Число узлов
+        int scope; // Область
+        int right; // Первый и последний элементы области
+        int last;
+    };
 
-    // Управление деревом: вставка левого/правого дочернего (создают новый узел)
-    void SetLeft(SemNode* Data);   // Вставить как левого соседа текущего узла
-    void SetRight(SemNode* Data);  // Вставить как первый дочерний элемент текущего узла
+    // Запомнить состояние перед выполнением оператора в области scope
+    Mark MarkScope(int scope) const;
+    // Удалить узлы, добавленные после MarkScope (оператор выполняется повторно:
+    // тело цикла при каждой итерации разбирается заново и снова объявляет свои имена)
+    void Rollback(const Mark& mark);
+    // Оставить первые count узлов (ссылки на удалённые узлы сбрасываются)
+    void Truncate(int count);
 
     // Поиск: блочная видимость
-    Tree* FindUp(Tree* From, const std::string& id);        // Поиск в текущей и внешних областях
-    Tree* FindUpOneLevel(Tree* From, const std::string& id);// Поиск только в текущем уровне (среди детей From)
+    int FindUp(int From, const std::string& id) const;        // Поиск в текущей и внешних областях
+    int FindUpOneLevel(int From, const std::string& id) const;// Поиск только в текущем уровне (среди детей From)
 
-    // Семантические операции
-    // Занесение идентификатора a в текущую область
-    Tree* SemInclude(const std::string& a, DATA_TYPE t, int line, int col);
+    // Семантические операции (Scope -- область, в которой выполняется операция)
+    // Занесение идентификатора a в область Scope
+    int SemInclude(int Scope, const std::string& a, DATA_TYPE t, int line, int col);
 
     // Занесение константы со значением
-    Tree* SemIncludeConstant(const std::string& a, DATA_TYPE t, const std::string& value, int line, int col);
+    int SemIncludeConstant(int Scope, const std::string& a, DATA_TYPE t, const std::string& value, int line, int col);
 
     // Установить флаг именованной константы
-    void SemSetConst(Tree* Addr, int value);
+    void SemSetConst(int Addr, int value);
 
-    // Установить базовый тип (для массивов и меток типов)
-    void SemSetBasicType(Tree* Addr, DATA_TYPE bt);
+    // Установить описатель типа (для массивов и меток типов)
+    void SemSetType(int Addr, int typeId);
 
-    // Установить размерность массива
-    void SemSetArrElemCount(Tree* Addr, int aec);
+    // Описатель типа узла
+    const TypeDesc& Type(int node) const { return types.Get(symbols.info[node].TypeId); }
 
     // Установить индекс элемента массива
-    void SemSetIndex(Tree* Addr, int index);
+    void SemSetIndex(int Addr, int index);
 
     // Найти переменную / именованную константу (не метку типа) с именем a в видимых областях
-    Tree* SemGetVar(const std::string& a, int line, int col);
+    int SemGetVar(int Scope, const std::string& a, int line, int col) const;
 
     // Найти метку типа с именем a
-    Tree* SemGetType(const std::string& a, int line, int col);
+    int SemGetType(int Scope, const std::string& a, int line, int col) const;
+
+    // Описатель типа для метки типа a из глобальной области Root.
+    // Метки типов объявляются только в глобальной области и не переопределяются,
+    // поэтому результат запоминается по имени и повторные обращения не ищут в дереве
+    int SemResolveType(int Root, const std::string& a, int line, int col);
 
     // Проверка дубля на текущем уровне
-    bool DupControl(Tree* Addr, const std::string& a);
+    bool DupControl(int Addr, const std::string& a) const;
 
     // Вход/выход в/из области (составной оператор)
-    // SemEnterBlock создаёт анонимный узел области под Cur и переключает Cur на него
-    Tree* SemEnterBlock(int line, int col);
-    void SemExitBlock();
-
-    // Установка/получение текущей вершины
-    static void SetCur(Tree* a) { Cur = a; }
-    static Tree* GetCur() { return Cur; }
+    // SemEnterBlock создаёт анонимный узел области под Scope и возвращает его (новая текущая область)
+    int SemEnterBlock(int Scope, int line, int col);
+    // SemExitBlock возвращает внешнюю область (новая текущая область)
+    int SemExitBlock(int Scope) const;
 
-    void Print(); // Печать дерева с нулевого отступа
+    // Печать поддерева From с нулевого отступа
+    void Print(int From, std::ostream& out = std::cout, PRINT_FORMAT format = PRINT_TEXT) const;
 
-    // Печать ошибки и остановка
+    // Печать ошибки и остановка разбора (исключение ProgramError)
     static void SemError(const std::string& msg, const std::string& id = "", int line = -1, int col = -1);
 
     static void InterpError(const std::string& msg, const std::string& id = "", int line = -1, int col = -1);
 
     // Установка значения переменной
-    static void SetVarValue(const std::string& name, const SemNode& value, int line, int col);
+    static void SetVarValue(Context& ctx, const std::string& name, const SemNode& value, int line, int col);
+
+    // Предупреждение об обрезке при присваивании значения value переменной типа to
+    // (выдаётся всегда, независимо от debug); false -- значение помещается в тип
+    static bool WarnTruncation(Context& ctx, DATA_TYPE to, long long value, int line, int col);
+
+    // Ошибка выполнения: операция op над a и b переполняет тип type (режим ctx.checkedArithmetic)
+    [[noreturn]] static void OverflowError(DATA_TYPE type, char op, long long a, long long b, int line, int col);
+
+    // Учёт выполненной итерации цикла: при превышении ctx.maxIterations -- ошибка выполнения
+    static void CountIteration(Context& ctx, int line, int col);
 
     // Получение значения переменной
-    static SemNode GetVarValue(const std::string& name, int line, int col);
+    static SemNode GetVarValue(Context& ctx, const std::string& name, int line, int col);
+
+    // Арифметика с проверкой переполнения (checked) или с переносом; выбирается один раз на запуск
+    typedef SemNode (*ArithmeticFn)(Context& ctx, const SemNode& left, const SemNode& right, const std::string& op, int line, int col);
+    static ArithmeticFn ArithmeticFor(bool checked);
 
-    // Выполнение арифметических операций
-    static SemNode ExecuteArithmeticOp(const SemNode& left, const SemNode& right, const std::string& op, int line, int col);
+    // Выполнение арифметических операций экземпляром ctx.arithmetic
+    static SemNode ExecuteArithmeticOp(Context& ctx, const SemNode& left, const SemNode& right, const std::string& op, int line, int col);
 
     // Выполнение операций сравнения
-    static SemNode ExecuteComparisonOp(const SemNode& left, const SemNode& right, const std::string& op, int line, int col);
+    static SemNode ExecuteComparisonOp(Context& ctx, const SemNode& left, const SemNode& right, const std::string& op, int line, int col);
 
     // Приведение типов для операций
     static DATA_TYPE GetMaxType(DATA_TYPE t1, DATA_TYPE t2);
@@ -93,34 +165,29 @@ public:
     // Проверка возможности приведения
     static bool CanImplicitCast(DATA_TYPE from, DATA_TYPE to);
 
-    // Методы для управления интерпретацией
-    static void EnableInterpretation();
-    static void DisableInterpretation();
-    static bool IsInterpretationEnabled();
-
-    static void EnableDebug();
-    static void DisableDebug();
-    static bool IsDebugEnabled();
-
     // Методы для вывода
-    static void PrintDebugInfo(const std::string& message, int line = 0, int col = 0);
-    static void PrintAssignment(const std::string& varName, const SemNode& value, int line, int col);
-    static void PrintArithmeticOp(const std::string& op, const SemNode& left, const SemNode& right, const SemNode& result, int line, int col);
-    static void PrintTypeConversionWarning(DATA_TYPE from, DATA_TYPE to, const std::string& context, const std::string& expression, int line, int col);
-
-    // Текущая область для контекста
-    static Tree* currentArea;
-
-    // Методы для управления текущей областью
-    static void SetCurrentArea(Tree* area) { currentArea = area; }
-    static Tree* GetCurrentArea() { return currentArea; }
+    static void PrintDebugInfo(Context& ctx, const std::string& message, int line = 0, int col = 0);
+    static void PrintAssignment(Context& ctx, const std::string& varName, const SemNode& value, int line, int col);
+    static void PrintArithmeticOp(Context& ctx, const std::string& op, const SemNode& left, const SemNode& right, const SemNode& result, int line, int col);
+    static void PrintTypeConversionWarning(Context& ctx, DATA_TYPE from, DATA_TYPE to, const std::string& context, const std::string& expression, int line, int col);
 
 private:
-    // Печать дерева
-    void Print(int depth);
-    std::string makeLabel(const Tree* tree) const;
-
-    // Флаг интерпретации
-    static bool interpretationEnabled;
-    static bool debug; // Флаг для подробного вывода
+    // Связи узла: номера соседей (NONE, если нет)
+    struct TreeLink {
+        int32_t Up;    // Родитель (внешняя область)
+        int32_t Left;  // Следующий элемент на том же уровне (левый сосед)
+        int32_t Right; // Первый вложенный элемент (правая ссылка)
+        int32_t Last;  // Последний вложенный элемент (для добавления за O(1))
+    };
+
+    // Узлы в порядке добавления. Добавление идёт только в области текущего пути
+    // от корня, поэтому этот порядок совпадает с прямым порядком обхода
+    std::vector<TreeLink> links;
+
+    std::unordered_map<std::string, int> typedef_ids; // Метка типа -> описатель (уже найденные)
+
+    // Дописать в буфер строковое представление узла
+    void appendLabel(std::string& buf, int node) const;
+    // Дописать в буфер имя правого/левого потомка
+    void appendChildName(std::string& buf, int node) const;
 };
\ No newline at end of file
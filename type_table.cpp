@@ -0,0 +1,23 @@
+#include "type_table.h"
+
+TypeTable::TypeTable() {
+    Clear();
+}
+
+int TypeTable::Intern(DATA_TYPE bt, int aec) {
+    uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(bt)) << 32) | static_cast<uint32_t>(aec);
+    auto it = ids.find(key);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    int id = static_cast<int>(types.size());
+    types.push_back({ bt, aec });
+    ids.emplace(key, id);
+    return id;
+}
+
+void TypeTable::Clear() {
+    types.clear();
+    ids.clear();
+    Intern(TYPE_UNDEFINED, 0);
+}
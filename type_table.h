@@ -0,0 +1,31 @@
+#pragma once
+#include "data_type.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Описатель типа: базовый тип и размерность (0 -- не массив)
+struct TypeDesc {
+    DATA_TYPE BasicType;
+    int ArrElemCount;
+};
+
+// Таблица описателей типов. Одинаковые описатели хранятся один раз,
+// идентификатор хранит только номер описателя (0 -- пустой описатель)
+class TypeTable {
+public:
+    TypeTable();
+
+    // Номер описателя (BasicType, ArrElemCount); новый описатель добавляется при первом обращении
+    int Intern(DATA_TYPE bt, int aec);
+
+    const TypeDesc& Get(int id) const { return types[id]; }
+
+    int Count() const { return static_cast<int>(types.size()); }
+
+    void Clear();
+
+private:
+    std::vector<TypeDesc> types;
+    std::unordered_map<uint64_t, int> ids; // (BasicType, ArrElemCount) -> номер
+};
@@ -0,0 +1,531 @@
+#include "vm.h"
+#include "checked_arith.h"
+#include "context.h"
+#include "jit.h"
+#include "program_error.h"
+#include "stats.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__GNUC__) && !defined(TAYAT_VM_SWITCH)
+#define TAYAT_VM_THREADED 1
+#else
+#define TAYAT_VM_THREADED 0
+#endif
+
+// Значение в виде узла (для истории выполнения, трассировки и записи в дерево)
+static SemNode MakeValue(int type, int64_t value) {
+    SemNode n;
+    n.DataType = static_cast<DATA_TYPE>(type);
+    n.hasValue = true;
+    switch (type) {
+    case TYPE_SHORT_INT: n.Value.v_int16 = static_cast<int16_t>(value); break;
+    case TYPE_INT: n.Value.v_int32 = static_cast<int32_t>(value); break;
+    case TYPE_LONG_INT: n.Value.v_int32 = static_cast<int32_t>(value); break;
+    default: n.Value.v_int64 = value; break;
+    }
+    return n;
+}
+
+// Приведение к типу разрядности 64 - shift (с переносом, как при static_cast)
+static inline int64_t Wrap(int64_t value, unsigned shift) {
+    return static_cast<int64_t>(static_cast<uint64_t>(value) << shift) >> shift;
+}
+
+// Старшая половина 128-битного произведения
+static inline int64_t MulHigh(int64_t a, int64_t b) {
+#if defined(_MSC_VER)
+    return __mulh(a, b);
+#else
+    return static_cast<int64_t>((static_cast<__int128>(a) * b) >> 64);
+#endif
+}
+
+// Деление и остаток на константу c по плану замены (optimizer.h, OPT_STRENGTH):
+// результат тот же, что у x / c и x % c в 64 битах
+static inline int64_t ReducedDivide(int64_t x, int64_t c, const Instr& in) {
+    const uint64_t ux = static_cast<uint64_t>(x);
+    if ((in.reduce == REDUCE_DIV_POW2) || (in.reduce == REDUCE_MOD_POW2)) {
+        const uint64_t mask = (uint64_t(1) << in.a) - 1;
+        const uint64_t biased = ux + (static_cast<uint64_t>(x >> 63) & mask);
+        if (in.reduce == REDUCE_MOD_POW2) {
+            return static_cast<int64_t>(ux - (biased & ~mask));
+        }
+        uint64_t q = static_cast<uint64_t>(static_cast<int64_t>(biased) >> in.a);
+        return static_cast<int64_t>((in.b & REDUCE_NEG) ? 0 - q : q);
+    }
+    uint64_t high = (in.shift >= 32) ? static_cast<uint64_t>((x * in.imm) >> 32) : static_cast<uint64_t>(MulHigh(x, in.imm));
+    if (in.b & REDUCE_ADD) {
+        high += ux;
+    }
+    uint64_t q = static_cast<uint64_t>(static_cast<int64_t>(high) >> in.a) + (ux >> 63);
+    if (in.b & REDUCE_NEG) {
+        q = 0 - q;
+    }
+    return static_cast<int64_t>((in.reduce == REDUCE_DIV_MAGIC) ? q : ux - q * static_cast<uint64_t>(c));
+}
+
+static bool IsIntType(DATA_TYPE t) {
+    return (t == TYPE_SHORT_INT) || (t == TYPE_INT) || (t == TYPE_LONG_INT) || (t == TYPE_LONG_LONG_INT);
+}
+
+Vm::Vm(Context& ctx, const Code& code) : ctx(ctx), code(code.instrs), errors(code.errors), nodes(code.nodes), failed(0),
+    debug(ctx.debug), tracing(ctx.debug && ctx.interpretationEnabled && ctx.trace.IsOpen()) {
+    // Ячейки -- по всем узлам дерева; значения, уже известные до выполнения
+    // (например, из снимка глобальных объявлений), переносятся из дерева
+    // Ячейки вынесенных значений (optimizer.h) -- после ячеек узлов, не вычислены
+    slots.resize(static_cast<size_t>(std::max(ctx.tree.Count(), code.tempBase + code.temps)), Slot{ 0, false });
+    for (int n = 0; n < ctx.tree.Count(); n++) {
+        const SemNode& value = ctx.tree.Sem(n);
+        slots[n].init = value.hasValue && IsIntType(value.DataType);
+        slots[n].value = slots[n].init ? WidenValue(value) : 0;
+    }
+    stack.resize(static_cast<size_t>(code.maxStack) + 1);
+
+    // С трассировкой каждая операция печатается -- только интерпретатор
+    if ((ctx.jitThreshold > 0) && !tracing && Jit::Supported()) {
+        jit.reset(new Jit(ctx, this->code, ctx.jitThreshold));
+    }
+}
+
+Vm::~Vm() {
+}
+
+int Vm::JitCompiled() const {
+    return jit ? jit->Compiled() : 0;
+}
+
+const char* Vm::Dispatch() {
+    return TAYAT_VM_THREADED ? "threaded" : "switch";
+}
+
+void Vm::Run() {
+    Stats::PhaseTimer timer(PHASE_EVAL);
+    try {
+        if (ctx.checkedArithmetic) {
+            Execute<true>();
+        }
+        else {
+            Execute<false>();
+        }
+    }
+    catch (...) {
+        // Интерпретатор по дереву до места ошибки не дошёл до дальнейших объявлений
+        WriteBack();
+        ctx.tree.Truncate(nodes[failed]);
+        throw;
+    }
+    WriteBack();
+}
+
+void Vm::WriteBack() {
+    for (int n = 0; n < ctx.tree.Count(); n++) {
+        SemNode& value = ctx.tree.Sem(n);
+        if (IsIntType(value.DataType)) {
+            value.hasValue = slots[n].init;
+            if (slots[n].init) {
+                value.Value = MakeValue(value.DataType, slots[n].value).Value;
+            }
+        }
+    }
+}
+
+void Vm::Raise(int error) const {
+    throw ProgramError(errors[error]);
+}
+
+// Арифметика как в Tree::ExecuteArithmeticOp: предупреждение о разных типах
+// операндов, вычисление в 64 битах и приведение к типу результата, история, трассировка.
+// op -- константа в каждом обработчике, поэтому switch сворачивается при подстановке.
+// Checked -- проверка переполнения в разрядности типа результата (свой экземпляр Execute),
+// кроме операций, результат которых заведомо в диапазоне типа (PROVEN_FITS)
+template <bool Checked>
+inline int64_t Vm::Arith(int op, int64_t a, int64_t b, const Instr& in) {
+    static const char* const OP_TEXT[5] = { "+", "-", "*", "/", "%" };
+
+    if (in.warn && debug) {
+        Tree::PrintTypeConversionWarning(ctx, static_cast<DATA_TYPE>(in.type2), static_cast<DATA_TYPE>(in.type3),
+            "арифметической операции", "", in.line, in.col);
+    }
+
+    int64_t result = 0;
+    if (Checked && (op != OP_MOD) && !(in.proven & PROVEN_FITS)) {
+        // Деление на ноль не переполняет: его ошибку выдаёт деление ниже
+        if (ArithOverflow(OP_TEXT[op - OP_ADD][0], a, b, in.shift, result)) {
+            Tree::OverflowError(static_cast<DATA_TYPE>(in.type), OP_TEXT[op - OP_ADD][0], a, b, in.line, in.col);
+        }
+    }
+    switch (op) {
+    case OP_ADD:
+        result = static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+        break;
+    case OP_SUB:
+        result = static_cast<int64_t>(static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+        break;
+    case OP_MUL:
+        // Замена умножения сдвигами (in.reduce) машине не выгодна: её выполняет машинный код
+        result = static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+        break;
+    case OP_DIV:
+        if (in.reduce) {
+            result = ReducedDivide(a, b, in);
+            break;
+        }
+        if (b == 0) Tree::InterpError("Деление на ноль", "", in.line, in.col);
+        if (b == -1) result = static_cast<int64_t>(0ull - static_cast<uint64_t>(a));
+        else if (in.proven & PROVEN_NARROW) result = static_cast<int32_t>(a) / static_cast<int32_t>(b);
+        else result = a / b;
+        break;
+    case OP_MOD:
+        if (in.reduce) {
+            result = ReducedDivide(a, b, in);
+            break;
+        }
+        if (b == 0) Tree::InterpError("Деление на ноль", "", in.line, in.col);
+        if (b == -1) result = 0;
+        else if (in.proven & PROVEN_NARROW) result = static_cast<int32_t>(a) % static_cast<int32_t>(b);
+        else result = a % b;
+        break;
+    }
+    result = Wrap(result, in.shift);
+
+    ctx.ring.Record(RING_ARITH, Tree::NONE, OP_TEXT[op - OP_ADD][0], MakeValue(in.type, result), in.line, in.col);
+    if (tracing) {
+        Tree::PrintArithmeticOp(ctx, OP_TEXT[op - OP_ADD], MakeValue(in.type, a), MakeValue(in.type, b),
+            MakeValue(in.type, result), in.line, in.col);
+    }
+    return result;
+}
+
+// Присваивание как в Tree::SetVarValue; значение в диапазоне типа (PROVEN_FITS) не проверяется
+inline void Vm::Store(const Instr& in, int64_t value) {
+    if ((in.type2 != in.type) && !(in.proven & PROVEN_FITS)) {
+        value = Convert(in, value);
+    }
+    Slot& slot = slots[in.a];
+    slot.value = value;
+    slot.init = true;
+
+    ctx.ring.Record(RING_ASSIGN, in.a, 0, MakeValue(in.type, value), in.line, in.col);
+    if (tracing) {
+        Tree::PrintAssignment(ctx, ctx.tree.Info(in.a).id, MakeValue(in.type, value), in.line, in.col);
+    }
+}
+
+// Присваивание значения другого типа: предупреждения и приведение
+int64_t Vm::Convert(const Instr& in, int64_t value) {
+    DATA_TYPE to = static_cast<DATA_TYPE>(in.type);
+    if (!Tree::WarnTruncation(ctx, to, value, in.line, in.col) && debug) {
+        Tree::PrintTypeConversionWarning(ctx, static_cast<DATA_TYPE>(in.type2), to,
+            "присваивании", ctx.tree.Info(in.a).id + " = ...", in.line, in.col);
+    }
+    return Wrap(value, in.shift);
+}
+
+template <bool Checked>
+void Vm::Execute() {
+    Instr* const base = code.data();
+    Slot* const sl = slots.data();
+    int64_t* sp = stack.data(); // Первая свободная позиция
+    const Instr* ip = base;
+
+    try {
+#if TAYAT_VM_THREADED
+    static const void* const HANDLERS[OP_COUNT] = {
+#define TAYAT_OPCODE_LABEL(name) &&L_##name,
+        TAYAT_OPCODES(TAYAT_OPCODE_LABEL)
+#undef TAYAT_OPCODE_LABEL
+    };
+    for (Instr& in : code) {
+        in.handler = HANDLERS[in.op];
+    }
+#define VM_CASE(name) L_##name:
+#define VM_NEXT() goto *ip->handler
+    VM_NEXT();
+#else
+#define VM_CASE(name) case OP_##name:
+#define VM_NEXT() continue
+    for (;;) {
+        switch (ip->op) {
+#endif
+
+// Чтение переменной: не инициализирована -- ошибка, как в Diagram::Prim
+#define VM_LOAD(in, to) \
+    { const Slot& s = sl[(in).a]; if (!s.init) Raise((in).b); to = s.value; }
+
+    VM_CASE(NOP) {
+        ip++;
+        VM_NEXT();
+    }
+    VM_CASE(CONST) {
+        *sp++ = ip->imm;
+        ip++;
+        VM_NEXT();
+    }
+    VM_CASE(LOAD) {
+        VM_LOAD(*ip, *sp);
+        sp++;
+        ip++;
+        VM_NEXT();
+    }
+    VM_CASE(STORE) {
+        Store(*ip, *--sp);
+        ip++;
+        VM_NEXT();
+    }
+
+#define VM_ARITH(name) \
+    VM_CASE(name) { \
+        sp--; \
+        sp[-1] = Arith<Checked>(OP_##name, sp[-1], sp[0], *ip); \
+        ip++; \
+        VM_NEXT(); \
+    }
+    VM_ARITH(ADD)
+    VM_ARITH(SUB)
+    VM_ARITH(MUL)
+    VM_ARITH(DIV)
+    VM_ARITH(MOD)
+
+#define VM_COMPARE(name, cmp) \
+    VM_CASE(name) { \
+        sp--; \
+        sp[-1] = (sp[-1] cmp sp[0]) ? 1 : 0; \
+        ip++; \
+        VM_NEXT(); \
+    }
+    VM_COMPARE(LT, <)
+    VM_COMPARE(LE, <=)
+    VM_COMPARE(GT, >)
+    VM_COMPARE(GE, >=)
+    VM_COMPARE(EQ, ==)
+    VM_COMPARE(NE, !=)
+
+    VM_CASE(JMP) {
+        ip = base + ip->a;
+        VM_NEXT();
+    }
+    VM_CASE(JZ) {
+        ip = (*--sp == 0) ? base + ip->a : ip + 1;
+        VM_NEXT();
+    }
+    VM_CASE(LOOP) {
+        // Как при повторном разборе тела: имена тела объявляются заново, без значений
+        Tree::CountIteration(ctx, ip->line, ip->col);
+        for (int64_t n = ip->b; n < ip->imm; n++) {
+            sl[n].init = false;
+        }
+        if (jit) {
+            int next = jit->Run(static_cast<int>(ip - base), sl, sp);
+            if (next >= 0) {
+                ip = base + next;
+                VM_NEXT();
+            }
+        }
+        ip = base + ip->a;
+        VM_NEXT();
+    }
+    VM_CASE(ENTER) {
+        ctx.currentArea = ip->a;
+        ctx.ring.Record(RING_ENTER, ip->a, ip->line, ip->col);
+        ip++;
+        VM_NEXT();
+    }
+    VM_CASE(EXIT) {
+        ctx.ring.Record(RING_EXIT, ip->a, ip->line, ip->col);
+        ctx.currentArea = ip->b;
+        ip++;
+        VM_NEXT();
+    }
+    VM_CASE(RAISE) {
+        Raise(ip->b);
+    }
+    VM_CASE(HALT) {
+        return;
+    }
+
+    // Вынесенные из циклов выражения
+    VM_CASE(TGET) {
+        const Slot& s = sl[ip->a];
+        if (s.init) {
+            *sp++ = s.value;
+            ip = base + ip->b;
+        }
+        else {
+            ip++;
+        }
+        VM_NEXT();
+    }
+    VM_CASE(TSET) {
+        sl[ip->a].value = *--sp;
+        sl[ip->a].init = true;
+        ip++;
+        VM_NEXT();
+    }
+    VM_CASE(TCLR) {
+        sl[ip->a].init = false;
+        ip++;
+        VM_NEXT();
+    }
+    VM_CASE(LOADQ) {
+        const Slot& s = sl[ip->a];
+        if (!s.init) {
+            sp -= ip->imm;
+            ip = base + ip->b;
+            VM_NEXT();
+        }
+        *sp++ = s.value;
+        ip++;
+        VM_NEXT();
+    }
+
+#define VM_ARITH_Q(name, op) \
+    VM_CASE(name) { \
+        if (sp[-1] == 0) { \
+            sp -= ip->imm; \
+            ip = base + ip->b; \
+            VM_NEXT(); \
+        } \
+        sp--; \
+        sp[-1] = Arith<Checked>(op, sp[-1], sp[0], *ip); \
+        ip++; \
+        VM_NEXT(); \
+    }
+    VM_ARITH_Q(DIVQ, OP_DIV)
+    VM_ARITH_Q(MODQ, OP_MOD)
+
+    // Развёрнутые и вычисленные при трансляции циклы
+    VM_CASE(NEXT) {
+        Tree::CountIteration(ctx, ip->line, ip->col);
+        for (int64_t n = ip->b; n < ip->imm; n++) {
+            sl[n].init = false;
+        }
+        ip++;
+        VM_NEXT();
+    }
+    VM_CASE(ITER) {
+        // Предел будет превышен -- исходный цикл выдаст ошибку на той же итерации
+        if ((ctx.maxIterations > 0) && (ctx.iterations + static_cast<uint64_t>(ip->imm) > ctx.maxIterations)) {
+            ip = base + ip->a;
+            VM_NEXT();
+        }
+        ctx.iterations += static_cast<uint64_t>(ip->imm);
+        ip++;
+        VM_NEXT();
+    }
+
+    // Суперкоманды: ip[0] -- голова, операнды -- в ip[1..]
+
+#define VM_LC_OP_ST(name, op) \
+    VM_CASE(name) { \
+        int64_t x; \
+        VM_LOAD(ip[0], x); \
+        Store(ip[3], Arith<Checked>(op, x, ip[1].imm, ip[2])); \
+        ip += 4; \
+        VM_NEXT(); \
+    }
+    VM_LC_OP_ST(LC_ADD_ST, OP_ADD)
+    VM_LC_OP_ST(LC_SUB_ST, OP_SUB)
+    VM_LC_OP_ST(LC_MUL_ST, OP_MUL)
+    VM_LC_OP_ST(LC_DIV_ST, OP_DIV)
+    VM_LC_OP_ST(LC_MOD_ST, OP_MOD)
+
+#define VM_LL_CMP_JZ(name, cmp) \
+    VM_CASE(name) { \
+        int64_t x, y; \
+        VM_LOAD(ip[0], x); \
+        VM_LOAD(ip[1], y); \
+        ip = (x cmp y) ? ip + 4 : base + ip[3].a; \
+        VM_NEXT(); \
+    }
+    VM_LL_CMP_JZ(LL_LT_JZ, <)
+    VM_LL_CMP_JZ(LL_LE_JZ, <=)
+    VM_LL_CMP_JZ(LL_GT_JZ, >)
+    VM_LL_CMP_JZ(LL_GE_JZ, >=)
+    VM_LL_CMP_JZ(LL_EQ_JZ, ==)
+    VM_LL_CMP_JZ(LL_NE_JZ, !=)
+
+#define VM_LC_CMP_JZ(name, cmp) \
+    VM_CASE(name) { \
+        int64_t x; \
+        VM_LOAD(ip[0], x); \
+        ip = (x cmp ip[1].imm) ? ip + 4 : base + ip[3].a; \
+        VM_NEXT(); \
+    }
+    VM_LC_CMP_JZ(LC_LT_JZ, <)
+    VM_LC_CMP_JZ(LC_LE_JZ, <=)
+    VM_LC_CMP_JZ(LC_GT_JZ, >)
+    VM_LC_CMP_JZ(LC_GE_JZ, >=)
+    VM_LC_CMP_JZ(LC_EQ_JZ, ==)
+    VM_LC_CMP_JZ(LC_NE_JZ, !=)
+
+#define VM_LL_OP(name, op) \
+    VM_CASE(name) { \
+        int64_t x, y; \
+        VM_LOAD(ip[0], x); \
+        VM_LOAD(ip[1], y); \
+        *sp++ = Arith<Checked>(op, x, y, ip[2]); \
+        ip += 3; \
+        VM_NEXT(); \
+    }
+    VM_LL_OP(LL_ADD, OP_ADD)
+    VM_LL_OP(LL_SUB, OP_SUB)
+    VM_LL_OP(LL_MUL, OP_MUL)
+    VM_LL_OP(LL_DIV, OP_DIV)
+    VM_LL_OP(LL_MOD, OP_MOD)
+
+#define VM_LC_OP(name, op) \
+    VM_CASE(name) { \
+        int64_t x; \
+        VM_LOAD(ip[0], x); \
+        *sp++ = Arith<Checked>(op, x, ip[1].imm, ip[2]); \
+        ip += 3; \
+        VM_NEXT(); \
+    }
+    VM_LC_OP(LC_ADD, OP_ADD)
+    VM_LC_OP(LC_SUB, OP_SUB)
+    VM_LC_OP(LC_MUL, OP_MUL)
+    VM_LC_OP(LC_DIV, OP_DIV)
+    VM_LC_OP(LC_MOD, OP_MOD)
+
+    VM_CASE(C_ST) {
+        Store(ip[1], ip[0].imm);
+        ip += 2;
+        VM_NEXT();
+    }
+    VM_CASE(L_ST) {
+        int64_t x;
+        VM_LOAD(ip[0], x);
+        Store(ip[1], x);
+        ip += 2;
+        VM_NEXT();
+    }
+
+#if !TAYAT_VM_THREADED
+        default:
+            return;
+        }
+    }
+#endif
+    }
+    catch (...) {
+        failed = static_cast<int>(ip - base);
+        throw;
+    }
+
+#undef VM_LC_OP
+#undef VM_LL_OP
+#undef VM_LC_CMP_JZ
+#undef VM_LL_CMP_JZ
+#undef VM_LC_OP_ST
+#undef VM_ARITH_Q
+#undef VM_COMPARE
+#undef VM_ARITH
+#undef VM_LOAD
+#undef VM_NEXT
+#undef VM_CASE
+}
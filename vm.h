@@ -0,0 +1,63 @@
+#pragma once
+#include "code_gen.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class Context;
+class Jit;
+
+// Виртуальная машина для байт-кода (code_gen.h).
+// Диспетчеризация -- шитый код: адрес обработчика хранится в самой команде,
+// и каждый обработчик заканчивается косвенным переходом на обработчик следующей
+// (goto по адресу метки, расширение GCC/Clang). Без расширения, а также при
+// TAYAT_VM_SWITCH используется переносимый цикл со switch.
+// Значения переменных на время выполнения лежат в ячейках машины и записываются
+// в семантическое дерево по окончании (в том числе при ошибке; тогда из дерева
+// удаляются узлы, объявленные после места ошибки)
+class Vm {
+public:
+    Vm(Context& ctx, const Code& code);
+    ~Vm();
+
+    // Выполнить программу; ошибка выполнения или разбора -- исключение ProgramError
+    void Run();
+
+    // Способ диспетчеризации, с которым собрана машина
+    static const char* Dispatch();
+
+    // Оттранслировано циклов в машинный код (jit.h)
+    int JitCompiled() const;
+
+    // Ячейка переменной (её раскладку использует и машинный код)
+    struct Slot {
+        int64_t value;
+        bool init;
+    };
+
+private:
+
+    Context& ctx;
+    std::vector<Instr> code;               // Копия команд (с адресами обработчиков)
+    const std::vector<Diagnostic>& errors;
+    const std::vector<int>& nodes;
+    int failed;                            // Команда, на которой произошла ошибка
+    std::vector<Slot> slots;               // Ячейки переменных по номерам узлов
+    std::vector<int64_t> stack;            // Стек значений
+    bool debug;                            // Предупреждения о преобразовании типов
+    bool tracing;                          // Отладочная трассировка
+    std::unique_ptr<Jit> jit;              // Машинный код горячих циклов (nullptr -- выключен)
+
+    // Checked -- с проверкой переполнения (ctx.checkedArithmetic): режим выбирается один раз
+    // экземпляром шаблона, обработчики без проверки флага
+    template <bool Checked>
+    void Execute();
+    void WriteBack();
+
+    [[noreturn]] void Raise(int error) const;
+
+    template <bool Checked>
+    inline int64_t Arith(int op, int64_t a, int64_t b, const Instr& in);
+    inline void Store(const Instr& in, int64_t value);
+    int64_t Convert(const Instr& in, int64_t value);
+};